@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <gsl/gsl_rng.h>
 
@@ -17,25 +19,38 @@ main(int argc, char **argv)
 {
   char *netF;
   FILE *infile=NULL;
-  FILE *outfileAND=NULL, *outfileOR=NULL;
   struct node_gra *net=NULL;
   gsl_rng *rand_gen;
-  double **newA_AND;
-  struct node_gra *p1, *p2;
+  struct pair_matrix *newA_AND;
   long int seed;
-  char outFileNameOR[200], outFileNameAND[200];
+  char outFileNameAND[200];
+  struct sbm_likelihood *lk = NULL;
+  struct ls_sampling smp;
+  struct ls_output out;
+  int c;
 
   /*
     ---------------------------------------------------------------------------
     Command line parameters
     ---------------------------------------------------------------------------
   */
-  if (argc < 2) {
-    printf("\nUse: links net_file seed\n\n");
+  SetLSOutput(&out, NULL, NULL);
+  SetLSSampling(&smp, 10000);
+  while ((c = getopt(argc, argv, LS_SAMPLING_OPTIONS LS_OUTPUT_OPTIONS)) != -1) {
+    if (!LSSamplingOption(&smp, c, optarg) && !LSOutputOption(&out, c, optarg))
+      argc = 0;
+  }
+  if (argc - optind < 2) {
+    printf("\nUse: links [-i niter] [-c nchain [-t nthread] [-r rhat]]\n");
+    printf("            [-D file] [-m file] [-s file] [-k topk | -K topk] [-T threshold]\n");
+    printf("            [-b file] net_file seed\n\n");
+    PrintLSSamplingUsage();
+    PrintLSOutputUsage();
+    printf("  By default, the scores of all pairs go to net_file.AND_scores.\n\n");
     return -1;
   }
-  netF = argv[1];
-  seed = atoi(argv[2]);
+  netF = argv[optind];
+  seed = atoi(argv[optind + 1]);
   rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
   gsl_rng_set(rand_gen, seed);
 
@@ -53,25 +68,22 @@ main(int argc, char **argv)
     Get link reliabilities
     ---------------------------------------------------------------------------
   */
-  newA_AND = LinkScoreMB(net, 0.0, 10000, rand_gen, 'q');
+  lk = CreateSBMLikelihoodMB(CountNodes(net), 0.0);
+  newA_AND = SampledLinkScore(net, lk, 0, &smp, rand_gen, 'q', NULL);
+  FreeSBMLikelihood(lk);
 
   /*
     ---------------------------------------------------------------------------
     Output
     ---------------------------------------------------------------------------
   */
-  strcpy(outFileNameAND, netF);
-  strcat(outFileNameAND, ".AND_scores");
-  outfileAND = fopen(outFileNameAND, "w");
-  p1 = net;
-  while ((p1 = p1->next) != NULL) {
-    p2 = p1;
-    while ((p2 = p2->next) != NULL) {
-      fprintf(outfileAND,
-	      "%g %s %s\n", newA_AND[p1->num][p2->num], p1->label, p2->label);
-    }
+  if (out.missingF == NULL) {
+    strcpy(outFileNameAND, netF);
+    strcat(outFileNameAND, ".AND_scores");
+    out.missingF = outFileNameAND;
   }
-  fclose(outfileAND);
+  FWriteLinkScores(&out, net, newA_AND, NULL);
+  FreePairMatrix(newA_AND);
 
   /*
     ---------------------------------------------------------------------------
@@ -13,6 +13,7 @@
 #define USAGE "Usage:\n\
 \tnetcarto [-f FILE] [-o FILE] [-s SEED] [-i ITER] [-c COOL] [-wmr]\n\
 \tnetcarto [-f FILE] [-o FILE] [-s SEED] [-i ITER] [-c COOL] [-wmr] -b [-t]\n\
+\tnetcarto [-f FILE] [-o FILE] [-s SEED] [-i ITER] [-c COOL] [-w] [-b [-t]] -n NREP\n\
 \tnetcarto [-f FILE] [-o FILE] [-p FILE] [-w]\n\
 \tnetcarto [-f FILE] [-o FILE] [-p FILE] [-w] -b [-t]\n\
 \tnetcarto  -h\n"
@@ -28,6 +29,7 @@
 \t -b : Use bipartite modularity,\n\
 \t -r : Compute modularity roles,\n\
 \t -t : [with -b only] Find modules for the second column (default: first),\n\
+\t -n NREP: Also find the modules of NREP randomizations of the network (in parallel) and report the mean, standard deviation and z-score of the modularity,\n\
 \t -h : Display this message.\n"
 
 int
@@ -74,6 +76,9 @@ main(int argc, char **argv)
   int louvain = 0;
   int bipartite = 0;
   int clustering = 1;
+  unsigned int nrep = 0, rep;
+  double *nullmod = NULL;
+  double nullmean = 0, nullstd = 0;
   int c;
   double *connectivity, *participation;
   int i;
@@ -92,7 +97,7 @@ main(int argc, char **argv)
   }
 
   else{
-	while ((c = getopt(argc, argv, "hbwtrmaf:s:i:c:o:S:p:C:")) != -1)
+	while ((c = getopt(argc, argv, "hbwtrmaf:s:i:c:o:S:p:C:n:")) != -1)
 	  switch (c) {
 	  case 'h':
 		printf(USAGE ARGUMENTS);
@@ -142,6 +147,9 @@ main(int argc, char **argv)
 	  case 't':
 		invert = 1;
 		break;
+	  case 'n':
+		nrep = atoi(optarg);
+		break;
 	  }
   }
 
@@ -180,21 +188,18 @@ main(int argc, char **argv)
 		ProjectBipartEdgeList(nodes1, nodes2, weights, E,
 		                      &part, &adj);
 	}
-  free(nodes1);
-  free(nodes2);
-  free(weights);
   if (from_file) fclose(inF);
 
   // SIMULATED ANNEALING CLUSTERING
+  Ti = 1. / (double)N;
+  Tf = 1e-200;
+  nochange_limit = 25;
   if (clustering){
-    Ti = 1. / (double)N;
-    Tf = 1e-200;
-    nochange_limit = 25;
   	AssignNodesToModules(part,randGen);
   	GeneralSA(&part, adj, fac,
   			  Ti, Tf, Ts,
   			  proba_components, nochange_limit,
-  			  randGen);
+  			  1, randGen);
   	CompressPartition(part);
   }
 
@@ -218,6 +223,36 @@ main(int argc, char **argv)
   modularity = PartitionModularity(part,adj,0);
   modularity_diag = PartitionModularity(part,adj,1);
 
+  // NULL MODEL: MODULARITY OF RANDOMIZED NETWORKS
+  if (nrep > 0){
+	fprintf(stderr, "Null model (%u replicas)...\n", nrep);
+	nullmod = (double*) calloc(nrep,sizeof(double));
+	if (nullmod == NULL){
+	  perror("Error while allocating the null model modularities");
+	  exit(1);
+	}
+	if (NullModelModularity(nodes1, nodes2, weights, E, N,
+							bipartite, nrep,
+							fac, Ti, Tf, Ts,
+							proba_components, nochange_limit,
+							seed, nullmod) != 0){
+	  // The randomization needs a simple network: report no null
+	  // model rather than the modularity of unrandomized copies.
+	  nrep = 0;
+	} else {
+	  for (rep = 0; rep < nrep; rep++)
+		nullmean += nullmod[rep];
+	  nullmean /= nrep;
+	  for (rep = 0; rep < nrep; rep++)
+		nullstd += (nullmod[rep] - nullmean) * (nullmod[rep] - nullmean);
+	  if (nrep > 1)
+		nullstd = sqrt(nullstd / (nrep - 1));
+	}
+  }
+  free(nodes1);
+  free(nodes2);
+  free(weights);
+
   if(roles){
 	connectivity = (double*) calloc(part->N,sizeof(double));
 	participation = (double*) calloc(part->N,sizeof(double));
@@ -245,6 +280,16 @@ main(int argc, char **argv)
   // Print output
   fprintf(outF,"# Modularity: %f\n",modularity);
   fprintf(outF,"# Modularity (with diagonal): %f\n",modularity_diag);
+  if (nrep > 0){
+	fprintf(outF,"# Null model modularity: %f +- %f (%u replicas)\n",
+			nullmean, nullstd, nrep);
+	if (nullstd > 0)
+	  fprintf(outF,"# Z-score: %f\n",(modularity - nullmean) / nullstd);
+	fprintf(outF,"# Null model modularities:");
+	for (rep = 0; rep < nrep; rep++)
+	  fprintf(outF," %f",nullmod[rep]);
+	fprintf(outF,"\n");
+  }
 
   if (roles)
 	TabularOutput(outF, labels, part, connectivity, participation);
@@ -263,6 +308,7 @@ main(int argc, char **argv)
     free(labels[i]);
   }
   free(labels);
+  free(nullmod);
   FreeAdjaArray(adj);
   FreePartition(part);
   gsl_rng_free(randGen);
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <gsl/gsl_rng.h>
 
@@ -19,24 +20,60 @@ main(int argc, char **argv)
 {
   char *netF;
   FILE *infile=NULL;
-  FILE *outfile1=NULL, *outfile2=NULL;
   struct node_gra *net=NULL;
   gsl_rng *rand_gen;
-  double **newA;
-  struct node_gra *p1, *p2;
+  struct pair_matrix *newA = NULL;
   long int seed;
+  char *pairF = NULL;
+  int nnonlink = -1, deferred = 0, c;
+  struct sbm_likelihood *lk = NULL;
+  struct ls_sampling smp;
+  struct ls_output out;
+  struct pair_score *cand = NULL;
+  struct sbm_samples *samples = NULL;
 
   /*
     ---------------------------------------------------------------------------
     Command line parameters
     ---------------------------------------------------------------------------
   */
-  if (argc < 2) {
-    printf("\nUse: links net_file seed\n\n");
+  SetLSOutput(&out, "missing.dat", "spurious.dat");
+  SetLSSampling(&smp, 10000);
+  while ((c = getopt(argc, argv,
+		     "p:n:d" LS_SAMPLING_OPTIONS LS_OUTPUT_OPTIONS)) != -1) {
+    if (LSSamplingOption(&smp, c, optarg) || LSOutputOption(&out, c, optarg))
+      continue;
+    switch (c) {
+    case 'p':
+      pairF = optarg;
+      break;
+    case 'n':
+      nnonlink = atoi(optarg);
+      break;
+    case 'd':
+      deferred = 1;
+      break;
+    default:
+      argc = 0;
+      break;
+    }
+  }
+  if (argc - optind < 2 || (deferred == 1 && smp.nchain > 1) ||
+      (out.binaryF != NULL && (pairF != NULL || nnonlink >= 0))) {
+    printf("\nUse: links [-p pair_file | -n nonlinks] [-d] [-i niter]\n");
+    printf("            [-c nchain [-t nthread] [-r rhat]]\n");
+    printf("            [-D file] [-m file] [-s file] [-k topk | -K topk] [-T threshold]\n");
+    printf("            [-b file] net_file seed\n\n");
+    printf("  -p pair_file: only score the node pairs in pair_file (two labels per line)\n");
+    printf("  -n nonlinks: only score the links and nonlinks random non-links\n");
+    printf("  -d: record the samples and compute the scores at the end (one chain only)\n");
+    PrintLSSamplingUsage();
+    PrintLSOutputUsage();
+    printf("     (not with -p or -n)\n\n");
     return -1;
   }
-  netF = argv[1];
-  seed = atoi(argv[2]);
+  netF = argv[optind];
+  seed = atoi(argv[optind + 1]);
   rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
   gsl_rng_set(rand_gen, seed);
 
@@ -54,31 +91,43 @@ main(int argc, char **argv)
     Get link reliabilities
     ---------------------------------------------------------------------------
   */
-  newA = LinkScore(net, 0.0, 10000, rand_gen, 'v');
+  lk = CreateSBMLikelihood(CountNodes(net), 0.0);
+  if (deferred == 1)
+    samples = LinkScoreSamples(net, 0.0, smp.niter, rand_gen, 'v');
+  if (pairF == NULL && nnonlink < 0) {
+    if (samples != NULL)
+      newA = SBMSamplesScoreMatrix(samples);
+    else
+      newA = SampledLinkScore(net, lk, 0, &smp, rand_gen, 'v', NULL);
+  }
+  else {
+    if (pairF != NULL) {
+      infile = fopen(pairF, "r");
+      cand = FReadCandidatePairs(infile, net);
+      fclose(infile);
+    }
+    else {
+      cand = CandidatePairs(net, nnonlink, rand_gen);
+    }
+    if (samples != NULL)
+      SBMSamplesCandidateScores(samples, cand);
+    else
+      SampledLinkScore(net, lk, 0, &smp, rand_gen, 'v', cand);
+  }
+  FreeSBMLikelihood(lk);
+  if (samples != NULL)
+    FreeSBMSamples(samples);
 
   /*
     ---------------------------------------------------------------------------
     Output
     ---------------------------------------------------------------------------
   */
-  outfile1 = fopen("missing.dat", "w");
-  outfile2 = fopen("spurious.dat", "w");
-  p1 = net;
-  while ((p1 = p1->next) != NULL) {
-    p2 = p1;
-    while ((p2 = p2->next) != NULL) {
-      if (IsThereLink(p1, p2) == 0) {
-	fprintf(outfile1,
-		"%g %s %s\n", newA[p1->num][p2->num], p1->label, p2->label);
-      }
-      else {
-	fprintf(outfile2,
-		"%g %s %s\n", newA[p1->num][p2->num], p1->label, p2->label);
-      }
-    }
-  }
-  fclose(outfile1);
-  fclose(outfile2);
+  FWriteLinkScores(&out, net, newA, cand);
+  if (cand == NULL)
+    FreePairMatrix(newA);
+  else
+    FreePairScore(cand);
 
   /*
     ---------------------------------------------------------------------------
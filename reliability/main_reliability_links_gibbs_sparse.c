@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <gsl/gsl_rng.h>
 
@@ -19,24 +20,37 @@ main(int argc, char **argv)
 {
   char *netF;
   FILE *infile=NULL;
-  FILE *outfile1=NULL, *outfile2=NULL;
   struct node_gra *net=NULL;
   gsl_rng *rand_gen;
-  double **newA;
-  struct node_gra *p1, *p2;
+  struct pair_matrix *newA;
   long int seed;
+  struct sbm_likelihood *lk = NULL;
+  struct ls_sampling smp;
+  struct ls_output out;
+  int c;
 
   /*
     ---------------------------------------------------------------------------
     Command line parameters
     ---------------------------------------------------------------------------
   */
-  if (argc < 2) {
-    printf("\nUse: links net_file seed\n\n");
-    return;
+  SetLSOutput(&out, "-", NULL);
+  SetLSSampling(&smp, 10000);
+  while ((c = getopt(argc, argv, LS_SAMPLING_OPTIONS LS_OUTPUT_OPTIONS)) != -1) {
+    if (!LSSamplingOption(&smp, c, optarg) && !LSOutputOption(&out, c, optarg))
+      argc = 0;
   }
-  netF = argv[1];
-  seed = atoi(argv[2]);
+  if (argc - optind < 2) {
+    printf("\nUse: links [-i niter] [-c nchain [-t nthread] [-r rhat]]\n");
+    printf("            [-D file] [-m file] [-s file] [-k topk | -K topk] [-T threshold]\n");
+    printf("            [-b file] net_file seed\n\n");
+    PrintLSSamplingUsage();
+    PrintLSOutputUsage();
+    printf("  By default, the scores of all pairs go to stdout.\n\n");
+    return -1;
+  }
+  netF = argv[optind];
+  seed = atoi(argv[optind + 1]);
   rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
   gsl_rng_set(rand_gen, seed);
 
@@ -54,40 +68,17 @@ main(int argc, char **argv)
     Get link reliabilities
     ---------------------------------------------------------------------------
   */
-  newA = SparseGibbsLinkScore(net, 10000, rand_gen, 'q');
+  lk = SparseCreateSBMLikelihoodNet(net);
+  newA = SampledLinkScore(net, lk, 1, &smp, rand_gen, 'q', NULL);
+  FreeSBMLikelihood(lk);
 
   /*
     ---------------------------------------------------------------------------
     Output
     ---------------------------------------------------------------------------
   */
-  /* outfile1 = fopen("missing.dat", "w"); */
-  /* outfile2 = fopen("spurious.dat", "w"); */
-  /* p1 = net; */
-  /* while ((p1 = p1->next) != NULL) { */
-  /*   p2 = p1; */
-  /*   while ((p2 = p2->next) != NULL) { */
-  /*     if (IsThereLink(p1, p2) == 0) { */
-  /* 	fprintf(outfile1, */
-  /* 		"%g %s %s\n", newA[p1->num][p2->num], p1->label, p2->label); */
-  /*     } */
-  /*     else { */
-  /* 	fprintf(outfile2, */
-  /* 		"%g %s %s\n", newA[p1->num][p2->num], p1->label, p2->label); */
-  /*     } */
-  /*   } */
-  /* } */
-  /* fclose(outfile1); */
-  /* fclose(outfile2); */
-
-  p1 = net;
-  while ((p1 = p1->next) != NULL) {
-    p2 = p1;
-    while ((p2 = p2->next) != NULL) {
-	fprintf(stdout,
-		"%g %s %s\n", newA[p1->num][p2->num], p1->label, p2->label);
-    }
-  }
+  FWriteLinkScores(&out, net, newA, NULL);
+  FreePairMatrix(newA);
 
   /*
     ---------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 #include <gsl/gsl_rng.h>
 
 #include "tools.h"
+#include "datastruct.h"
 #include "graph.h"
 #include "modules.h"
 
@@ -649,34 +650,51 @@ ProjectBipartWeighted(struct binet *binet)
 }
 
 
+// ---------------------------------------------------------------------
+// Compare two integers (for qsort)
+// ---------------------------------------------------------------------
+static int
+IntCompare(const void *i1, const void *i2)
+{
+  int a = *(const int *)i1, b = *(const int *)i2;
+
+  return (a > b) - (a < b);
+}
+
 /*
   ---------------------------------------------------------------------
-  Randomize links in a bipartite network
+  Get the links of a bipartite network as a flat list: link i goes
+  from node ori[i] of net1 to node des[i] of net2 (given by their
+  nums) and has weight weight[i] and status status[i]. Also fills
+  nodes1[num] and nodes2[num]. Returns the number of links.
   ---------------------------------------------------------------------
 */
-struct binet *
-RandomizeBipart(struct binet *binet, double times, gsl_rng *gen)
+static int
+BipartLinkArrays(struct binet *binet,
+		 struct node_gra **nodes1, struct node_gra **nodes2,
+		 int **ori, int **des, double **weight, int **status)
 {
-  int i;
-  int nlink, niter, coun = 0;
-  int target1, target2;
-  struct node_gra *p = NULL;
-  struct node_lis *l = NULL;
-  struct node_gra *n1, *n2, *n3, *n4;
-  struct node_gra **ori, **des;
+  struct node_gra *p;
+  struct node_lis *l;
+  int nlink = NLinksBipart(binet), coun = 0;
 
-  /* Build the link lists (one for link origins and one for ends) */
-  nlink = NLinksBipart(binet);
-  niter = ceil(times * (double)nlink);
-  ori = (struct node_gra **) calloc(nlink, sizeof(struct node_gra *));
-  des = (struct node_gra **) calloc(nlink, sizeof(struct node_gra *));
+  *ori = allocate_i_vec(nlink + 1);
+  *des = allocate_i_vec(nlink + 1);
+  *weight = allocate_d_vec(nlink + 1);
+  *status = allocate_i_vec(nlink + 1);
 
+  p = binet->net2;
+  while ((p = p->next) !=  NULL)
+    nodes2[p->num] = p;
   p = binet->net1;
   while ((p = p->next) !=  NULL) {
+    nodes1[p->num] = p;
     l = p->neig;
     while ((l = l->next) !=  NULL) {
-      ori[coun] = p;
-      des[coun] = l->ref;
+      (*ori)[coun] = p->num;
+      (*des)[coun] = l->ref->num;
+      (*weight)[coun] = l->weight;
+      (*status)[coun] = l->status;
       coun++;
     }
   }
@@ -684,7 +702,122 @@ RandomizeBipart(struct binet *binet, double times, gsl_rng *gen)
   if (coun !=  nlink)
     fprintf(stderr, "Error in RandomizeBipart: coun !=  nlink!!\n");
 
-  /* Randomize the network */
+  return nlink;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Replace the links of a bipartite network by those in the flat list
+  (ori[i], des[i]) (see BipartLinkArrays). If weight (status) is
+  NULL, all links get weight (status) 1.
+  ---------------------------------------------------------------------
+*/
+static void
+SetBipartLinks(struct binet *binet,
+	       struct node_gra **nodes1, struct node_gra **nodes2,
+	       int nlink, int *ori, int *des, double *weight, int *status)
+{
+  int S1 = CountNodes(binet->net1), S2 = CountNodes(binet->net2);
+  struct node_lis **last1, **last2;
+  struct node_gra *p;
+  double w;
+  int i, st;
+
+  last1 = (struct node_lis **)calloc(S1 + 1, sizeof(struct node_lis *));
+  last2 = (struct node_lis **)calloc(S2 + 1, sizeof(struct node_lis *));
+  p = binet->net1;
+  while ((p = p->next) != NULL) {
+    if (p->neig->next != NULL)
+      FreeAdjacencyList(p->neig->next);
+    p->neig->next = NULL;
+    p->degree = 0;
+    p->strength = 0;
+    last1[p->num] = p->neig;
+  }
+  p = binet->net2;
+  while ((p = p->next) != NULL) {
+    if (p->neig->next != NULL)
+      FreeAdjacencyList(p->neig->next);
+    p->neig->next = NULL;
+    p->degree = 0;
+    p->strength = 0;
+    last2[p->num] = p->neig;
+  }
+
+  for (i=0; i<nlink; i++) {
+    w = (weight != NULL) ? weight[i] : 1.;
+    st = (status != NULL) ? status[i] : 1;
+    last1[ori[i]] = AppendAdjacency(last1[ori[i]], nodes2[des[i]], w, st);
+    last2[des[i]] = AppendAdjacency(last2[des[i]], nodes1[ori[i]], w, st);
+  }
+
+  free(last1);
+  free(last2);
+}
+
+// ---------------------------------------------------------------------
+// Hash set with the nlink bipartite links (ori[i], des[i]). Returns
+// NULL if there are repeated links.
+// ---------------------------------------------------------------------
+static struct hashset *
+BipartLinkSet(int nlink, int *ori, int *des)
+{
+  struct hashset *links = hashset_create(nlink);
+  int i;
+
+  for (i=0; i<nlink; i++) {
+    if (!hashset_add(links, ((unsigned long long)ori[i] << 32) | des[i])) {
+      fprintf(stderr,
+	      "Error in RandomizeBipart: the network is not simple!!\n");
+      hashset_free(links);
+      return NULL;
+    }
+  }
+  return links;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Returns 1 if none of the nlink bipartite links (ori[i], des[i]) is
+  repeated, which SwapBipartLinks requires, and 0 otherwise
+  ---------------------------------------------------------------------
+*/
+int
+IsBipartLinkListSimple(int nlink, int *ori, int *des)
+{
+  struct hashset *links = BipartLinkSet(nlink, ori, des);
+
+  if (links == NULL)
+    return 0;
+  hashset_free(links);
+  return 1;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize a flat list of bipartite links (see BipartLinkArrays)
+  with ceil(times * nlink) switches: links n1-n2 and n3-n4 become
+  n1-n4 and n3-n2, provided n1 != n3, n2 != n4 and the new links do
+  not exist. Only the ends in net2 change, so link i keeps its origin
+  (and its weight and status). Existing links are kept in a hash
+  set. The links must not be repeated; otherwise nothing is done and
+  -1 is returned. Returns 0 on success.
+  ---------------------------------------------------------------------
+*/
+int
+SwapBipartLinks(int nlink, int *ori, int *des,
+		double times, gsl_rng *gen)
+{
+  struct hashset *links;
+  int i, niter, target1, target2;
+  int n1, n2, n3, n4;
+
+  if (nlink < 2)
+    return 0;
+  if ((links = BipartLinkSet(nlink, ori, des)) == NULL)
+    return -1;
+  niter = ceil(times * (double)nlink);
+
   for (i=0; i<niter; i++) {
     
     /* select the two links (four nodes) to swap */
@@ -699,29 +832,279 @@ RandomizeBipart(struct binet *binet, double times, gsl_rng *gen)
 	n4 = des[target2];
       } while (n1 == n3 || n2 == n4);
 
-    } while (IsThereLink(n1, n4) == 1 ||
-	     IsThereLink(n2, n3) == 1);
+    } while (hashset_contains(links, ((unsigned long long)n1 << 32) | n4) ||
+	     hashset_contains(links, ((unsigned long long)n3 << 32) | n2));
 
     /* switch the link */
-    RemoveLink(n1, n2, 1);
-    RemoveLink(n3, n4, 1);
-    AddAdjacency(n1, n4, 0, 0, 0, 1);
-    AddAdjacency(n4, n1, 0, 0, 0, 1);
-    AddAdjacency(n3, n2, 0, 0, 0, 1);
-    AddAdjacency(n2, n3, 0, 0, 0, 1);
-
-    ori[target1] = n1;
+    hashset_remove(links, ((unsigned long long)n1 << 32) | n2);
+    hashset_remove(links, ((unsigned long long)n3 << 32) | n4);
+    hashset_add(links, ((unsigned long long)n1 << 32) | n4);
+    hashset_add(links, ((unsigned long long)n3 << 32) | n2);
     des[target1] = n4;
-    ori[target2] = n3;
     des[target2] = n2;
   }
 
-  free(ori);
-  free(des);
+  hashset_free(links);
+  return 0;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize a flat list of bipartite links (see BipartLinkArrays) with
+  the curveball algorithm (Strona et al., 2014). In each of the
+  ceil(times * S1) trades, two nodes of net1 are chosen at random; the
+  neighbors they do not share are pooled, shuffled, and dealt back to
+  them so that each keeps its degree. Degrees in both sets are
+  preserved, and a trade can change many links at once, so it mixes
+  much faster than link switching. The links are returned sorted by
+  origin.
+  ---------------------------------------------------------------------
+*/
+static void
+CurveballBipartLinks(int S1, int nlink, int *ori, int *des,
+		     double times, gsl_rng *gen)
+{
+  int *idx, *pool, *shared;
+  int i, t, ntrade, a, b, ia, ib, na, nb, npool, nshared, tmp;
+
+  /* Sort the links by origin (so that the neighbors of each node of
+     net1 are contiguous) and the neighbors of each node */
+  idx = allocate_i_vec(S1 + 1);
+  pool = allocate_i_vec(nlink + 1);
+  shared = allocate_i_vec(nlink + 1);
+  for (a=0; a<=S1; a++)
+    idx[a] = 0;
+  for (i=0; i<nlink; i++)
+    idx[ori[i] + 1]++;
+  for (a=0; a<S1; a++)
+    idx[a+1] += idx[a];
+  for (i=0; i<nlink; i++)
+    pool[idx[ori[i]]++] = des[i];
+  for (a=S1; a>0; a--)
+    idx[a] = idx[a-1];
+  idx[0] = 0;
+  for (a=0; a<S1; a++) {
+    for (i=idx[a]; i<idx[a+1]; i++) {
+      ori[i] = a;
+      des[i] = pool[i];
+    }
+    qsort(&des[idx[a]], idx[a+1] - idx[a], sizeof(int), IntCompare);
+  }
+
+  ntrade = (S1 < 2) ? 0 : ceil(times * (double)S1);
+  for (t=0; t<ntrade; t++) {
+    a = floor(gsl_rng_uniform(gen) * (double)S1);
+    do {
+      b = floor(gsl_rng_uniform(gen) * (double)S1);
+    } while (b == a);
+
+    /* Merge the sorted neighbor lists of a and b */
+    ia = idx[a];
+    ib = idx[b];
+    na = npool = nshared = 0;
+    while (ia < idx[a+1] || ib < idx[b+1]) {
+      if (ib == idx[b+1] || (ia < idx[a+1] && des[ia] < des[ib])) {
+	pool[npool++] = des[ia++];
+	na++;
+      }
+      else if (ia == idx[a+1] || des[ib] < des[ia]) {
+	pool[npool++] = des[ib++];
+      }
+      else {
+	shared[nshared++] = des[ia];
+	ia++;
+	ib++;
+      }
+    }
+    if (na == 0 || na == npool)
+      continue;
+
+    /* Shuffle the pool and deal it */
+    for (i=npool-1; i>0; i--) {
+      nb = floor(gsl_rng_uniform(gen) * (double)(i + 1));
+      tmp = pool[i];
+      pool[i] = pool[nb];
+      pool[nb] = tmp;
+    }
+    memcpy(&des[idx[a]], shared, nshared * sizeof(int));
+    memcpy(&des[idx[a] + nshared], pool, na * sizeof(int));
+    memcpy(&des[idx[b]], shared, nshared * sizeof(int));
+    memcpy(&des[idx[b] + nshared], &pool[na], (npool - na) * sizeof(int));
+    qsort(&des[idx[a]], idx[a+1] - idx[a], sizeof(int), IntCompare);
+    qsort(&des[idx[b]], idx[b+1] - idx[b], sizeof(int), IntCompare);
+  }
+
+  free_i_vec(idx);
+  free_i_vec(pool);
+  free_i_vec(shared);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize links in a bipartite network. Each link keeps its weight
+  and status. The network must not have repeated links; otherwise, it
+  is returned unchanged.
+  ---------------------------------------------------------------------
+*/
+struct binet *
+RandomizeBipart(struct binet *binet, double times, gsl_rng *gen)
+{
+  struct node_gra **nodes1, **nodes2;
+  int *ori, *des, *status;
+  double *weight;
+  int nlink;
+
+  nodes1 = (struct node_gra **)calloc(CountNodes(binet->net1) + 1,
+				      sizeof(struct node_gra *));
+  nodes2 = (struct node_gra **)calloc(CountNodes(binet->net2) + 1,
+				      sizeof(struct node_gra *));
+  nlink = BipartLinkArrays(binet, nodes1, nodes2,
+			   &ori, &des, &weight, &status);
+  if (SwapBipartLinks(nlink, ori, des, times, gen) == 0)
+    SetBipartLinks(binet, nodes1, nodes2, nlink, ori, des, weight, status);
+
+  free(nodes1);
+  free(nodes2);
+  free_i_vec(ori);
+  free_i_vec(des);
+  free_d_vec(weight);
+  free_i_vec(status);
+  return binet;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize links in a bipartite network with ceil(times * S1)
+  curveball trades (S1 is the number of nodes in net1). Links are
+  dealt again in each trade, so all of them get weight 1 and status
+  1. The network must not have repeated links; otherwise, it is
+  returned unchanged.
+  ---------------------------------------------------------------------
+*/
+struct binet *
+RandomizeBipartCurveball(struct binet *binet, double times, gsl_rng *gen)
+{
+  struct node_gra **nodes1, **nodes2;
+  struct hashset *links;
+  int S1 = CountNodes(binet->net1);
+  int *ori, *des, *status;
+  double *weight;
+  int nlink;
+
+  nodes1 = (struct node_gra **)calloc(S1 + 1, sizeof(struct node_gra *));
+  nodes2 = (struct node_gra **)calloc(CountNodes(binet->net2) + 1,
+				      sizeof(struct node_gra *));
+  nlink = BipartLinkArrays(binet, nodes1, nodes2,
+			   &ori, &des, &weight, &status);
+  if ((links = BipartLinkSet(nlink, ori, des)) != NULL) {
+    hashset_free(links);
+    CurveballBipartLinks(S1, nlink, ori, des, times, gen);
+    SetBipartLinks(binet, nodes1, nodes2, nlink, ori, des, NULL, NULL);
+  }
 
+  free(nodes1);
+  free(nodes2);
+  free_i_vec(ori);
+  free_i_vec(des);
+  free_d_vec(weight);
+  free_i_vec(status);
   return binet;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Generate nrep randomizations of a bipartite network in parallel,
+  with link switching (curveball_sw == 0, see RandomizeBipart) or
+  curveball trades (curveball_sw != 0, see RandomizeBipartCurveball).
+  The original network is not modified, and nothing is done if it has
+  repeated links. Replica r uses its own random number generator,
+  seeded with seed + r. If fnameFmt is not NULL, replica r is written,
+  as a list of links from net1 to net2, to the file named
+  sprintf(fnameFmt, r). If callback is not NULL, it is called with the
+  replica as a list of nlink links from node ori[i] of net1 to node
+  des[i] of net2 (given by their nums), and with the pointer data;
+  callbacks for different replicas may run at the same time in
+  different threads, and the arrays are only valid until the callback
+  returns.
+  ---------------------------------------------------------------------
+*/
+void
+RandomizeBipartReplicas(struct binet *binet,
+			int nrep,
+			double times,
+			int curveball_sw,
+			unsigned long int seed,
+			char *fnameFmt,
+			void (*callback)(int rep, struct binet *binet,
+					 int nlink, int *ori, int *des,
+					 void *data),
+			void *data)
+{
+  struct node_gra **nodes1, **nodes2;
+  struct hashset *links;
+  int S1 = CountNodes(binet->net1);
+  int *ori0, *des0, *status;
+  double *weight;
+  int nlink;
+
+  nodes1 = (struct node_gra **)calloc(S1 + 1, sizeof(struct node_gra *));
+  nodes2 = (struct node_gra **)calloc(CountNodes(binet->net2) + 1,
+				      sizeof(struct node_gra *));
+  nlink = BipartLinkArrays(binet, nodes1, nodes2,
+			   &ori0, &des0, &weight, &status);
+  if ((links = BipartLinkSet(nlink, ori0, des0)) == NULL)
+    nrep = 0;
+  else
+    hashset_free(links);
+
+#pragma omp parallel
+  {
+    int *ori = allocate_i_vec(nlink + 1);
+    int *des = allocate_i_vec(nlink + 1);
+    gsl_rng *gen = gsl_rng_alloc(gsl_rng_mt19937);
+    char fname[FILENAME_MAX];
+    FILE *outF;
+    int r, i;
+
+#pragma omp for schedule(dynamic, 1)
+    for (r=0; r<nrep; r++) {
+      memcpy(ori, ori0, nlink * sizeof(int));
+      memcpy(des, des0, nlink * sizeof(int));
+      gsl_rng_set(gen, seed + r);
+      if (curveball_sw)
+	CurveballBipartLinks(S1, nlink, ori, des, times, gen);
+      else
+	SwapBipartLinks(nlink, ori, des, times, gen);
+
+      if (fnameFmt != NULL) {
+	sprintf(fname, fnameFmt, r);
+	if ((outF = fopen(fname, "w")) == NULL) {
+	  fprintf(stderr, "RandomizeBipartReplicas: cannot open %s\n", fname);
+	}
+	else {
+	  for (i=0; i<nlink; i++)
+	    fprintf(outF, "%s %s\n",
+		    nodes1[ori[i]]->label, nodes2[des[i]]->label);
+	  fclose(outF);
+	}
+      }
+      if (callback != NULL)
+	callback(r, binet, nlink, ori, des, data);
+    }
+
+    free_i_vec(ori);
+    free_i_vec(des);
+    gsl_rng_free(gen);
+  }
+
+  free(nodes1);
+  free(nodes2);
+  free_i_vec(ori0);
+  free_i_vec(des0);
+  free_d_vec(weight);
+  free_i_vec(status);
+}
+
 
 /*
   ---------------------------------------------------------------------
@@ -61,8 +61,23 @@ struct binet *InvertBipart(struct binet *net);
 int NLinksBipart(struct binet *binet);
 struct node_gra *ProjectBipart(struct binet *binet);
 struct node_gra *ProjectBipartWeighted(struct binet *binet);
+int IsBipartLinkListSimple(int nlink, int *ori, int *des);
+int SwapBipartLinks(int nlink, int *ori, int *des,
+		    double times, gsl_rng *gen);
 struct binet *RandomizeBipart(struct binet *binet,
 			     double times, gsl_rng *gen);
+struct binet *RandomizeBipartCurveball(struct binet *binet,
+				      double times, gsl_rng *gen);
+void RandomizeBipartReplicas(struct binet *binet,
+			     int nrep,
+			     double times,
+			     int curveball_sw,
+			     unsigned long int seed,
+			     char *fnameFmt,
+			     void (*callback)(int rep, struct binet *binet,
+					      int nlink, int *ori, int *des,
+					      void *data),
+			     void *data);
 
 /*
   ---------------------------------------------------------------------
@@ -53,12 +53,12 @@ AllLinkScore2State(struct binet *ratings,
   int **N1G2_1=NULL, **N2G1_1=NULL;
   int **G1G2_0=NULL, **G2G1_0=NULL;
   int **G1G2_1=NULL, **G2G1_1=NULL;
-  int LogChooseListSize = 500;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
+  int LogChooseListSize = FastLogTableSize((long int)nnod1 * nnod2);
+  double *LogChooseList=InitializeFastLogChoose(LogChooseListSize);
   int LogListSize = 5000;
   double *LogList=InitializeFastLog(LogListSize);
-  int LogFactListSize = 2000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
+  int LogFactListSize = LogChooseListSize;
+  double *LogFactList = LogChooseList; /* same ln(r!) table */
   struct node_lis *n1=NULL, *n2=NULL;
   double contrib;
   int norm = 0;
@@ -180,7 +180,6 @@ AllLinkScore2State(struct binet *ratings,
   if (decorStep <= 0) {
     decorStep = GetDecorrelationStep2State(&H,
 						   nlist1, nlist2,
-						   glist1, glist2,
 						   part1, part2,
 						   nnod1, nnod2,
 						   &ng1, &ng2,
@@ -301,8 +300,7 @@ AllLinkScore2State(struct binet *ratings,
   free_i_mat(N1G2_1, nnod1);
   free_i_mat(N2G1_1, nnod2);
   FreeFastLog(LogList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
-  FreeFastLogFact(LogFactList);
+  FreeFastLogChoose(LogChooseList);
 
   /* Done */
   return querySet;
@@ -5,6 +5,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "datastruct.h"
 
@@ -256,3 +257,588 @@ queue_free(struct queue *theQueue)
   free(theQueue);
   return;
 }
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  Array stack functions
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Create an array stack with room for capacity elements
+  -----------------------------------------------------------------------------
+*/
+struct array_stack *
+array_stack_create(int capacity)
+{
+  struct array_stack *theStack;
+
+  if (capacity < 1)
+    capacity = 1;
+  theStack = (struct array_stack *)calloc(1, sizeof(struct array_stack));
+  theStack->data = (void **)malloc(capacity * sizeof(void *));
+  theStack->capacity = capacity;
+  theStack->length = 0;
+
+  return theStack;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return true if stack is empty
+  -----------------------------------------------------------------------------
+*/
+bool
+array_stack_empty(struct array_stack *theStack)
+{
+  return theStack->length == 0;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Push element onto stack (doubling the array if it is full)
+  -----------------------------------------------------------------------------
+*/
+void
+array_stack_push(struct array_stack *theStack, void *theElement)
+{
+  if (theStack->length == theStack->capacity) {
+    theStack->capacity *= 2;
+    theStack->data = (void **)realloc(theStack->data,
+				      theStack->capacity * sizeof(void *));
+  }
+  theStack->data[theStack->length++] = theElement;
+
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return top element and remove it from the stack
+  -----------------------------------------------------------------------------
+*/
+void *
+array_stack_pop(struct array_stack *theStack)
+{
+  if (array_stack_empty(theStack))
+    return NULL;
+  else
+    return theStack->data[--theStack->length];
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return top element
+  -----------------------------------------------------------------------------
+*/
+void *
+array_stack_top(struct array_stack *theStack)
+{
+  if (array_stack_empty(theStack))
+    return NULL;
+  else
+    return theStack->data[theStack->length - 1];
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Clear stack (the array is kept for reuse)
+  -----------------------------------------------------------------------------
+*/
+void
+array_stack_clear(struct array_stack *theStack)
+{
+  theStack->length = 0;
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Free memory allocated for an array stack
+  -----------------------------------------------------------------------------
+*/
+void
+array_stack_free(struct array_stack *theStack)
+{
+  free(theStack->data);
+  free(theStack);
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  Ring queue functions
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Create a ring queue with room for capacity elements
+  -----------------------------------------------------------------------------
+*/
+struct ring_queue *
+ring_queue_create(int capacity)
+{
+  struct ring_queue *theQueue;
+
+  if (capacity < 1)
+    capacity = 1;
+  theQueue = (struct ring_queue *)calloc(1, sizeof(struct ring_queue));
+  theQueue->data = (void **)malloc(capacity * sizeof(void *));
+  theQueue->capacity = capacity;
+  theQueue->first = 0;
+  theQueue->length = 0;
+
+  return theQueue;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return true if queue is empty
+  -----------------------------------------------------------------------------
+*/
+bool
+ring_queue_empty(struct ring_queue *theQueue)
+{
+  return theQueue->length == 0;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Push element onto queue. When the buffer is full its capacity is
+  doubled, and the elements that wrapped around to the beginning of
+  the array are moved after the old end.
+  -----------------------------------------------------------------------------
+*/
+void
+ring_queue_enqueue(struct ring_queue *theQueue, void *theElement)
+{
+  int old = theQueue->capacity, pos;
+
+  if (theQueue->length == old) {
+    theQueue->capacity *= 2;
+    theQueue->data = (void **)realloc(theQueue->data,
+				      theQueue->capacity * sizeof(void *));
+    memcpy(theQueue->data + old, theQueue->data,
+	   theQueue->first * sizeof(void *));
+  }
+
+  pos = theQueue->first + theQueue->length;
+  if (pos >= theQueue->capacity)
+    pos -= theQueue->capacity;
+  theQueue->data[pos] = theElement;
+  theQueue->length += 1;
+
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return first element and remove it from the queue
+  -----------------------------------------------------------------------------
+*/
+void *
+ring_queue_dequeue(struct ring_queue *theQueue)
+{
+  void *theData;
+
+  if (ring_queue_empty(theQueue)) {
+    return NULL;
+  }
+  else {
+    theData = theQueue->data[theQueue->first];
+    if (++theQueue->first == theQueue->capacity)
+      theQueue->first = 0;
+    theQueue->length -= 1;
+    return theData;
+  }
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return first element
+  -----------------------------------------------------------------------------
+*/
+void *
+ring_queue_first(struct ring_queue *theQueue)
+{
+  if (ring_queue_empty(theQueue))
+    return NULL;
+  else
+    return theQueue->data[theQueue->first];
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Clear queue (the buffer is kept for reuse)
+  -----------------------------------------------------------------------------
+*/
+void
+ring_queue_clear(struct ring_queue *theQueue)
+{
+  theQueue->first = 0;
+  theQueue->length = 0;
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Free memory allocated for a ring queue
+  -----------------------------------------------------------------------------
+*/
+void
+ring_queue_free(struct ring_queue *theQueue)
+{
+  free(theQueue->data);
+  free(theQueue);
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  Hash set functions
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Scramble a 64-bit key (multiplicative hashing; the high bits of the
+  product are the best mixed)
+  -----------------------------------------------------------------------------
+*/
+static unsigned long long
+hash_mix(unsigned long long theKey)
+{
+  theKey ^= theKey >> 33;
+  theKey *= 0xff51afd7ed558ccdULL;
+  theKey ^= theKey >> 33;
+  return theKey;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Slot where a key should be
+  -----------------------------------------------------------------------------
+*/
+static unsigned long long
+hashset_slot(struct hashset *theSet, unsigned long long theKey)
+{
+  return hash_mix(theKey) & theSet->mask;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Create a hash set with room for (at least) capacity keys
+  -----------------------------------------------------------------------------
+*/
+struct hashset *
+hashset_create(int capacity)
+{
+  struct hashset *theSet;
+  unsigned long long size = 16, i;
+
+  while (size < 2 * (unsigned long long)capacity)
+    size *= 2;
+  theSet = (struct hashset *)calloc(1, sizeof(struct hashset));
+  theSet->key = (unsigned long long *)malloc(size * sizeof(unsigned long long));
+  for (i=0; i<size; i++)
+    theSet->key[i] = hashset_empty;
+  theSet->mask = size - 1;
+  theSet->length = 0;
+
+  return theSet;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Return true if the key is in the set
+  -----------------------------------------------------------------------------
+*/
+bool
+hashset_contains(struct hashset *theSet, unsigned long long theKey)
+{
+  unsigned long long i = hashset_slot(theSet, theKey);
+
+  while (theSet->key[i] != hashset_empty) {
+    if (theSet->key[i] == theKey)
+      return true;
+    i = (i + 1) & theSet->mask;
+  }
+  return false;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Double the capacity of the set
+  -----------------------------------------------------------------------------
+*/
+static void
+hashset_grow(struct hashset *theSet)
+{
+  unsigned long long *old = theSet->key, oldsize = theSet->mask + 1, i, j;
+
+  theSet->mask = 2 * oldsize - 1;
+  theSet->key = (unsigned long long *)malloc(2 * oldsize *
+					     sizeof(unsigned long long));
+  for (i=0; i<2*oldsize; i++)
+    theSet->key[i] = hashset_empty;
+  for (i=0; i<oldsize; i++) {
+    if (old[i] != hashset_empty) {
+      j = hashset_slot(theSet, old[i]);
+      while (theSet->key[j] != hashset_empty)
+	j = (j + 1) & theSet->mask;
+      theSet->key[j] = old[i];
+    }
+  }
+  free(old);
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Add a key to the set. Return false if it was already there.
+  -----------------------------------------------------------------------------
+*/
+bool
+hashset_add(struct hashset *theSet, unsigned long long theKey)
+{
+  unsigned long long i;
+
+  if (2 * (unsigned long long)(theSet->length + 1) > theSet->mask + 1)
+    hashset_grow(theSet);
+
+  i = hashset_slot(theSet, theKey);
+  while (theSet->key[i] != hashset_empty) {
+    if (theSet->key[i] == theKey)
+      return false;
+    i = (i + 1) & theSet->mask;
+  }
+  theSet->key[i] = theKey;
+  theSet->length += 1;
+  return true;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Remove a key from the set. Return false if it was not there. The
+  keys that follow in the same probe run are shifted back, so that no
+  tombstones are left and lookups stay fast however many keys are
+  added and removed.
+  -----------------------------------------------------------------------------
+*/
+bool
+hashset_remove(struct hashset *theSet, unsigned long long theKey)
+{
+  unsigned long long i = hashset_slot(theSet, theKey), j, k;
+
+  while (theSet->key[i] != theKey) {
+    if (theSet->key[i] == hashset_empty)
+      return false;
+    i = (i + 1) & theSet->mask;
+  }
+
+  j = i;
+  while (1) {
+    j = (j + 1) & theSet->mask;
+    if (theSet->key[j] == hashset_empty)
+      break;
+    k = hashset_slot(theSet, theSet->key[j]);
+    /* Move key j to the hole at i unless its home slot k lies
+       (cyclically) in (i, j] */
+    if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+      continue;
+    theSet->key[i] = theSet->key[j];
+    i = j;
+  }
+  theSet->key[i] = hashset_empty;
+  theSet->length -= 1;
+  return true;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Clear hash set (without freeing the table)
+  -----------------------------------------------------------------------------
+*/
+void
+hashset_clear(struct hashset *theSet)
+{
+  unsigned long long i;
+
+  for (i=0; i<=theSet->mask; i++)
+    theSet->key[i] = hashset_empty;
+  theSet->length = 0;
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Free memory allocated for a hash set
+  -----------------------------------------------------------------------------
+*/
+void
+hashset_free(struct hashset *theSet)
+{
+  free(theSet->key);
+  free(theSet);
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  Hash map functions
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Create a hash map with room for (at least) capacity keys
+  -----------------------------------------------------------------------------
+*/
+struct hashmap *
+hashmap_create(int capacity)
+{
+  struct hashmap *theMap;
+  unsigned long long size = 16, i;
+
+  while (size < 2 * (unsigned long long)capacity)
+    size *= 2;
+  theMap = (struct hashmap *)calloc(1, sizeof(struct hashmap));
+  theMap->key = (unsigned long long *)malloc(size * sizeof(unsigned long long));
+  theMap->value = (int *)malloc(size * sizeof(int));
+  for (i=0; i<size; i++)
+    theMap->key[i] = hashset_empty;
+  theMap->mask = size - 1;
+  theMap->length = 0;
+
+  return theMap;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Double the capacity of the map
+  -----------------------------------------------------------------------------
+*/
+static void
+hashmap_grow(struct hashmap *theMap)
+{
+  unsigned long long *oldkey = theMap->key, oldsize = theMap->mask + 1, i, j;
+  int *oldvalue = theMap->value;
+
+  theMap->mask = 2 * oldsize - 1;
+  theMap->key = (unsigned long long *)malloc(2 * oldsize *
+					     sizeof(unsigned long long));
+  theMap->value = (int *)malloc(2 * oldsize * sizeof(int));
+  for (i=0; i<2*oldsize; i++)
+    theMap->key[i] = hashset_empty;
+  for (i=0; i<oldsize; i++) {
+    if (oldkey[i] != hashset_empty) {
+      j = hash_mix(oldkey[i]) & theMap->mask;
+      while (theMap->key[j] != hashset_empty)
+	j = (j + 1) & theMap->mask;
+      theMap->key[j] = oldkey[i];
+      theMap->value[j] = oldvalue[i];
+    }
+  }
+  free(oldkey);
+  free(oldvalue);
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Slot holding a key, or the empty slot where it would go (the map is
+  grown first if adding a key could make it more than half full)
+  -----------------------------------------------------------------------------
+*/
+static unsigned long long
+hashmap_slot(struct hashmap *theMap, unsigned long long theKey)
+{
+  unsigned long long i;
+
+  if (2 * (unsigned long long)(theMap->length + 1) > theMap->mask + 1)
+    hashmap_grow(theMap);
+
+  i = hash_mix(theKey) & theMap->mask;
+  while (theMap->key[i] != hashset_empty && theMap->key[i] != theKey)
+    i = (i + 1) & theMap->mask;
+  return i;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Get the value of a key. Return false (and leave theValue untouched)
+  if the key is not in the map.
+  -----------------------------------------------------------------------------
+*/
+bool
+hashmap_get(struct hashmap *theMap, unsigned long long theKey, int *theValue)
+{
+  unsigned long long i = hash_mix(theKey) & theMap->mask;
+
+  while (theMap->key[i] != hashset_empty) {
+    if (theMap->key[i] == theKey) {
+      *theValue = theMap->value[i];
+      return true;
+    }
+    i = (i + 1) & theMap->mask;
+  }
+  return false;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Set the value of a key, adding the key if necessary
+  -----------------------------------------------------------------------------
+*/
+void
+hashmap_set(struct hashmap *theMap, unsigned long long theKey, int theValue)
+{
+  unsigned long long i = hashmap_slot(theMap, theKey);
+
+  if (theMap->key[i] == hashset_empty) {
+    theMap->key[i] = theKey;
+    theMap->length += 1;
+  }
+  theMap->value[i] = theValue;
+  return;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Add inc to the value of a key (a new key starts at 0) and return the
+  new value. Used to count occurrences.
+  -----------------------------------------------------------------------------
+*/
+int
+hashmap_increment(struct hashmap *theMap, unsigned long long theKey, int inc)
+{
+  unsigned long long i = hashmap_slot(theMap, theKey);
+
+  if (theMap->key[i] == hashset_empty) {
+    theMap->key[i] = theKey;
+    theMap->value[i] = 0;
+    theMap->length += 1;
+  }
+  theMap->value[i] += inc;
+  return theMap->value[i];
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Free memory allocated for a hash map
+  -----------------------------------------------------------------------------
+*/
+void
+hashmap_free(struct hashmap *theMap)
+{
+  free(theMap->key);
+  free(theMap->value);
+  free(theMap);
+  return;
+}
@@ -91,4 +91,131 @@ void queue_clear(struct queue *theQueue);
 void queue_free(struct queue *theQueue);
 
 
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  ARRAY STACK AND RING QUEUE
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Definition of the array_stack and ring_queue structures: the same
+  as stack and queue, but the elements are kept in a single array
+  that doubles its capacity when full. Pushing and popping never
+  allocate memory once the array is large enough, and clearing keeps
+  the array, so one structure can be reused (for instance, for the BFS
+  from every node of a network).
+  -----------------------------------------------------------------------------
+*/
+struct array_stack{
+  void **data;               // the elements (bottom first)
+  int capacity;              // size of data
+  int length;                // number of elements in the stack
+};
+
+struct ring_queue{
+  void **data;               // the elements, in a circular buffer
+  int capacity;              // size of data
+  int first;                 // position of the first element
+  int length;                // number of elements in the queue
+};
+
+/*
+  -----------------------------------------------------------------------------
+  Array stack functions
+  -----------------------------------------------------------------------------
+*/
+struct array_stack *array_stack_create(int capacity);
+bool array_stack_empty(struct array_stack *theStack);
+void array_stack_push(struct array_stack *theStack, void *theElement);
+void *array_stack_pop(struct array_stack *theStack);
+void *array_stack_top(struct array_stack *theStack);
+void array_stack_clear(struct array_stack *theStack);
+void array_stack_free(struct array_stack *theStack);
+
+/*
+  -----------------------------------------------------------------------------
+  Ring queue functions
+  -----------------------------------------------------------------------------
+*/
+struct ring_queue *ring_queue_create(int capacity);
+bool ring_queue_empty(struct ring_queue *theQueue);
+void ring_queue_enqueue(struct ring_queue *theQueue, void *theElement);
+void *ring_queue_dequeue(struct ring_queue *theQueue);
+void *ring_queue_first(struct ring_queue *theQueue);
+void ring_queue_clear(struct ring_queue *theQueue);
+void ring_queue_free(struct ring_queue *theQueue);
+
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  HASH SET
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Definition of the hashset structure: a set of 64-bit keys stored in
+  an open-addressing table with linear probing (capacity is a power
+  of two, and is doubled when the set is more than half full)
+  -----------------------------------------------------------------------------
+*/
+struct hashset{
+  unsigned long long *key;   // the keys (hashset_empty marks empty slots)
+  unsigned long long mask;   // capacity - 1
+  int length;                // number of keys in the set
+};
+
+#define hashset_empty 0xffffffffffffffffULL
+
+/*
+  -----------------------------------------------------------------------------
+  Hash set functions
+  -----------------------------------------------------------------------------
+*/
+struct hashset *hashset_create(int capacity);
+bool hashset_contains(struct hashset *theSet, unsigned long long theKey);
+bool hashset_add(struct hashset *theSet, unsigned long long theKey);
+bool hashset_remove(struct hashset *theSet, unsigned long long theKey);
+void hashset_clear(struct hashset *theSet);
+void hashset_free(struct hashset *theSet);
+
+/*
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+  HASH MAP
+  -----------------------------------------------------------------------------
+  -----------------------------------------------------------------------------
+*/
+/*
+  -----------------------------------------------------------------------------
+  Definition of the hashmap structure: 64-bit keys with an int value
+  each, stored like a hashset. To visit all entries, loop over the
+  mask + 1 slots and skip those whose key is hashset_empty.
+  -----------------------------------------------------------------------------
+*/
+struct hashmap{
+  unsigned long long *key;   // the keys (hashset_empty marks empty slots)
+  int *value;                // the value of each key
+  unsigned long long mask;   // capacity - 1
+  int length;                // number of keys in the map
+};
+
+/*
+  -----------------------------------------------------------------------------
+  Hash map functions
+  -----------------------------------------------------------------------------
+*/
+struct hashmap *hashmap_create(int capacity);
+bool hashmap_get(struct hashmap *theMap, unsigned long long theKey,
+		 int *theValue);
+void hashmap_set(struct hashmap *theMap, unsigned long long theKey,
+		 int theValue);
+int hashmap_increment(struct hashmap *theMap, unsigned long long theKey,
+		      int inc);
+void hashmap_free(struct hashmap *theMap);
+
+
 #endif /* !RGRAPH_DATASTRUCT_H */
@@ -7,6 +7,9 @@
 #include "fillpartitions.h"
 #include "io.h"
 
+static int
+EdgeCompare(const void *p1, const void *p2);
+
 /**
 Normalize edges weight and node strength and store them in the
 Partition and AdjaArray structures.
@@ -34,9 +34,6 @@ typedef struct Edge {
   double strength;
 } Edge;
 
-static int
-EdgeCompare(const void *p1, const void *p2);
-
 int
 EdgeListToAdjaArray(int *nd_in, int *nd_out, double *weight,
 					          AdjaArray *adj, Partition *part, int normalize);
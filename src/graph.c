@@ -222,6 +222,35 @@ AddAdjacencySoft(struct node_gra *node1,
   }
 }
 
+// ---------------------------------------------------------------------
+// Creates an adjacency to node2 right after adjacency last (usually
+// the last one in the list of node1) and returns it. Unlike
+// AddAdjacency, it does not check whether the adjacency already
+// exists, so it takes constant time; it is meant for building lists
+// that are known to have no repeated neighbors.
+// ---------------------------------------------------------------------
+struct node_lis *
+AppendAdjacency(struct node_lis *last,
+		struct node_gra *node2,
+		double weight,
+		int status)
+{
+  struct node_lis *adja;
+
+  adja = (struct node_lis *)calloc(1, sizeof(struct node_lis));
+  adja->node = node2->num;
+  adja->nodeLabel = (char *)calloc(MAX_LABEL_LENGTH, sizeof(char));
+  strcpy(adja->nodeLabel, node2->label);
+  adja->status = status;
+  adja->next = last->next;
+  adja->ref = node2;
+  adja->btw = 0.0;
+  adja->weight = weight;
+  last->next = adja;
+
+  return adja;
+}
+
 // ---------------------------------------------------------------------
 // Sets the ref pointers of all the adjacencies to the corresponding
 // nodes based on their labels.
@@ -343,6 +372,86 @@ CopyNetwork(struct node_gra *p1)
   return root2;
 }
 
+// ---------------------------------------------------------------------
+// Copy the nnod nodes in nlist (with nlist[i]->num == i), including
+// their groups, into a new network, and store the copies in
+// clist. Links between nodes in nlist point to the copies, whereas
+// links to other nodes (for instance, to the other side of a
+// bipartite network) still point to the original nodes. Unlike
+// CopyNetwork, no label lookups are needed.
+// ---------------------------------------------------------------------
+struct node_gra *
+CopyNodeList(struct node_gra **nlist, int nnod, struct node_gra **clist)
+{
+  struct node_gra *root2=NULL, *last=NULL, *p1=NULL, *p2=NULL;
+  struct node_lis *nei=NULL, *adja=NULL;
+  int i;
+
+  // Copy the nodes
+  root2 = last = CreateHeaderGraph();
+  for (i=0; i<nnod; i++) {
+    p1 = nlist[i];
+    p2 = clist[i] = CreateNodeGraph(last, p1->label);
+    p2->coorX = p1->coorX;
+    p2->coorY = p1->coorY;
+    p2->coorZ = p1->coorZ;
+    p2->state = p1->state;
+    p2->ivar1 = p1->ivar1;
+    p2->inGroup = p1->inGroup;
+    p2->dvar1 = p1->dvar1;
+    p2->degree = p1->degree;
+    p2->strength = p1->strength;
+    last = p2;
+  }
+
+  // Copy the adjacency lists, keeping their order
+  for (i=0; i<nnod; i++) {
+    adja = clist[i]->neig;
+    nei = nlist[i]->neig;
+    while ((nei = nei->next) != NULL) {
+      adja->next = (struct node_lis *)calloc(1, sizeof(struct node_lis));
+      adja = adja->next;
+      adja->node = nei->node;
+      adja->nodeLabel = (char *)calloc(MAX_LABEL_LENGTH, sizeof(char));
+      strcpy(adja->nodeLabel, nei->nodeLabel);
+      adja->status = nei->status;
+      adja->next = NULL;
+      adja->btw = nei->btw;
+      adja->weight = nei->weight;
+      if (nei->ref->num >= 0 && nei->ref->num < nnod &&
+	  nlist[nei->ref->num] == nei->ref)
+	adja->ref = clist[nei->ref->num];
+      else
+	adja->ref = nei->ref;
+    }
+  }
+
+  return root2;
+}
+
+// ---------------------------------------------------------------------
+// Hash of the nodes in nlist and their links (by node num, with their
+// weights), continuing from hash (pass 0 to start a new hash). It
+// identifies a network in, for instance, a cache of results.
+// ---------------------------------------------------------------------
+unsigned long long
+NodeListHash(struct node_gra **nlist, int nnod, unsigned long long hash)
+{
+  struct node_lis *nei=NULL;
+  int i;
+
+  hash = hash_bytes(&nnod, sizeof(int), hash);
+  for (i=0; i<nnod; i++) {
+    hash = hash_bytes(&i, sizeof(int), hash);
+    nei = nlist[i]->neig;
+    while ((nei = nei->next) != NULL) {
+      hash = hash_bytes(&nei->ref->num, sizeof(int), hash);
+      hash = hash_bytes(&nei->weight, sizeof(double), hash);
+    }
+  }
+  return hash;
+}
+
 
 // ---------------------------------------------------------------------
 // Creates a binary tree for fast access to nodes by label
@@ -1274,51 +1383,201 @@ RenumberNodes(struct node_gra *net)
 
 // ---------------------------------------------------------------------
 // ---------------------------------------------------------------------
-// Network randomization
+// Compressed adjacency (CSR) snapshot
 // ---------------------------------------------------------------------
 // ---------------------------------------------------------------------
 
+// ---------------------------------------------------------------------
+// Compare two adjacencies by the num of the node they point to
+// (used to sort the neighbors of each node in the CSR)
+// ---------------------------------------------------------------------
+static int
+CSRLinkCompare(const void *l1, const void *l2)
+{
+  int n1 = (*(struct node_lis **)l1)->ref->num;
+  int n2 = (*(struct node_lis **)l2)->ref->num;
+
+  return (n1 > n2) - (n1 < n2);
+}
+
 /*
   ---------------------------------------------------------------------
-  Randomize the links of a network using the Markov chain switching
-  algorithm
+  Build a CSR snapshot of the network. The neighbors of each node are
+  sorted by num, and rev[e] points to the adjacency going the other
+  way (so link properties can be updated in both directions without
+  walking the lists). The snapshot is read-only, so it can be shared
+  by several threads; it must be rebuilt if the network changes.
   ---------------------------------------------------------------------
 */
-struct node_gra *
-RandomizeSymmetricNetwork(struct node_gra *net,
-			  double times,
-			  gsl_rng *gen)
+struct node_csr *
+BuildNodeCSR(struct node_gra *net)
 {
-  int i;
-  int nlink=0;
-  int target1=0, target2=0;
-  struct node_gra *p=NULL;
-  struct node_lis *l=NULL;
-  struct node_gra *n1, *n2, *n3, *n4;
-  struct node_gra **ori, **des;
-  int coun=0;
-  int niter=0;
+  struct node_csr *csr;
+  struct node_gra *p;
+  struct node_lis *l;
+  int i, j, e, k;
+  int *cursor;
 
-  /* Build the link lists (one for link origins and one for ends) */
-  nlink = TotalNLinks(net, 1);
-  niter =  ceil(times * (double)nlink + gsl_rng_uniform(gen));
-  ori = (struct node_gra **)calloc(nlink, sizeof(struct node_gra *));
-  des = (struct node_gra **)calloc(nlink, sizeof(struct node_gra *));
+  csr = (struct node_csr *)calloc(1, sizeof(struct node_csr));
+  csr->nnod = CountNodes(net);
+  csr->idx = allocate_i_vec(csr->nnod + 1);
+  csr->node = (struct node_gra **)calloc(csr->nnod + 1,
+					 sizeof(struct node_gra *));
+
+  /* Index the nodes and count their adjacencies */
   p = net;
-  while((p = p->next) !=  NULL){
-    l = p->neig;
-    while((l = l->next) !=  NULL){
-      if (p->num > l->node) {
-	ori[coun] = p;
-	des[coun] = l->ref;
-	coun++;
-      }
+  while ((p = p->next) != NULL)
+    csr->node[p->num] = p;
+  csr->idx[0] = 0;
+  for (i=0; i<csr->nnod; i++) {
+    k = 0;
+    l = csr->node[i]->neig;
+    while ((l = l->next) != NULL)
+      k++;
+    csr->idx[i+1] = csr->idx[i] + k;
+  }
+  csr->nlink = csr->idx[csr->nnod];
+
+  /* Fill and sort the adjacencies */
+  csr->neig = allocate_i_vec(csr->nlink + 1);
+  csr->rev = allocate_i_vec(csr->nlink + 1);
+  csr->lis = (struct node_lis **)calloc(csr->nlink + 1,
+					sizeof(struct node_lis *));
+  for (i=0; i<csr->nnod; i++) {
+    e = csr->idx[i];
+    l = csr->node[i]->neig;
+    while ((l = l->next) != NULL)
+      csr->lis[e++] = l;
+    qsort(&csr->lis[csr->idx[i]], csr->idx[i+1] - csr->idx[i],
+	  sizeof(struct node_lis *), CSRLinkCompare);
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+      csr->neig[e] = csr->lis[e]->ref->num;
+  }
+
+  /* Reverse adjacencies: because neighbor lists are sorted, the
+     reverse of the i->j adjacencies appear in order in j's list as i
+     increases, so one cursor per node is enough */
+  cursor = allocate_i_vec(csr->nnod + 1);
+  for (i=0; i<csr->nnod; i++)
+    cursor[i] = csr->idx[i];
+  for (i=0; i<csr->nnod; i++) {
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++) {
+      j = csr->neig[e];
+      while (cursor[j] < csr->idx[j+1] && csr->neig[cursor[j]] < i)
+	cursor[j]++;
+      if (cursor[j] < csr->idx[j+1] && csr->neig[cursor[j]] == i)
+	csr->rev[e] = cursor[j];
+      else
+	csr->rev[e] = -1;
     }
   }
-  if(coun !=  nlink)
-    fprintf(stderr, "Error in RandomizeNetwork: coun != nlink!!\n");
+  free_i_vec(cursor);
+
+  return csr;
+}
+
+// ---------------------------------------------------------------------
+// Free the memory allocated to a CSR snapshot
+// ---------------------------------------------------------------------
+void
+FreeNodeCSR(struct node_csr *csr)
+{
+  free_i_vec(csr->idx);
+  free_i_vec(csr->neig);
+  free_i_vec(csr->rev);
+  free(csr->node);
+  free(csr->lis);
+  free(csr);
+}
+
+// ---------------------------------------------------------------------
+// ---------------------------------------------------------------------
+// Network randomization
+// ---------------------------------------------------------------------
+// ---------------------------------------------------------------------
+
+// ---------------------------------------------------------------------
+// Key of the (undirected) link between nodes n1 and n2 in a hashset
+// ---------------------------------------------------------------------
+static unsigned long long
+SymmetricLinkKey(int n1, int n2)
+{
+  if (n1 < n2)
+    return ((unsigned long long)n1 << 32) | (unsigned long long)n2;
+  else
+    return ((unsigned long long)n2 << 32) | (unsigned long long)n1;
+}
+
+// ---------------------------------------------------------------------
+// Hash set with the nlink undirected links (ori[i], des[i]). Returns
+// NULL if the links are not simple (there are self-loops or repeated
+// links).
+// ---------------------------------------------------------------------
+static struct hashset *
+SymmetricLinkSet(int nlink, int *ori, int *des)
+{
+  struct hashset *links = hashset_create(nlink);
+  int i;
+
+  for (i=0; i<nlink; i++) {
+    if (ori[i] == des[i] ||
+	!hashset_add(links, SymmetricLinkKey(ori[i], des[i]))) {
+      fprintf(stderr,
+	      "Error in RandomizeNetwork: the network is not simple!!\n");
+      hashset_free(links);
+      return NULL;
+    }
+  }
+  return links;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Returns 1 if the nlink undirected links (ori[i], des[i]) are simple
+  (no self-loops or repeated links), which SwapSymmetricLinks
+  requires, and 0 otherwise
+  ---------------------------------------------------------------------
+*/
+int
+IsSymmetricLinkListSimple(int nlink, int *ori, int *des)
+{
+  struct hashset *links = SymmetricLinkSet(nlink, ori, des);
+
+  if (links == NULL)
+    return 0;
+  hashset_free(links);
+  return 1;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize a flat list of nlink undirected links (ori[i], des[i]),
+  given as node nums, using the Markov chain switching algorithm. In
+  each of the ceil(times * nlink) swaps, two links n1-n2 and n3-n4
+  (the second one with a random orientation) become n1-n4 and n3-n2,
+  provided the four nodes are different and the new links do not
+  exist. Link i keeps its position in the list, so any data stored
+  per link (weights, etc.) follows it. Existing links are kept in a
+  hash set, so that each swap takes constant time and no memory is
+  allocated. The links must be simple (no self-loops or repeated
+  links); otherwise nothing is done and -1 is returned. Returns 0 on
+  success.
+  ---------------------------------------------------------------------
+*/
+int
+SwapSymmetricLinks(int nlink, int *ori, int *des,
+		   double times, gsl_rng *gen)
+{
+  struct hashset *links;
+  int i, niter, target1, target2;
+  int n1, n2, n3, n4;
+
+  if (nlink < 2)
+    return 0;
+  if ((links = SymmetricLinkSet(nlink, ori, des)) == NULL)
+    return -1;
+  niter = ceil(times * (double)nlink + gsl_rng_uniform(gen));
 
-  /* Randomize the links */
   for (i=0; i<niter; i++) {
     /* select the 4 nodes */
     do {
@@ -1337,29 +1596,229 @@ RandomizeSymmetricNetwork(struct node_gra *net,
 	  n4 = des[target2];
 	}
       } while (n3 == n1 || n3 == n2 || n4 == n1 || n4 == n2);
-    } while (IsThereLinkSoft(n1, n4->num) == 1 ||
-	     IsThereLinkSoft(n2, n3->num) == 1);
-
-    /* switch the link */
-    RemoveLink(n1, n2, 1);
-    RemoveLink(n3, n4, 1);
-    AddAdjacency(n1, n4, 0, 0, 1., 1);
-    AddAdjacency(n4, n1, 0, 0, 1., 1);
-    AddAdjacency(n3, n2, 0, 0, 1., 1);
-    AddAdjacency(n2, n3, 0, 0, 1., 1);
-
+    } while (hashset_contains(links, SymmetricLinkKey(n1, n4)) ||
+	     hashset_contains(links, SymmetricLinkKey(n2, n3)));
+
+    /* switch the links */
+    hashset_remove(links, SymmetricLinkKey(n1, n2));
+    hashset_remove(links, SymmetricLinkKey(n3, n4));
+    hashset_add(links, SymmetricLinkKey(n1, n4));
+    hashset_add(links, SymmetricLinkKey(n3, n2));
     ori[target1] = n1;
     des[target1] = n4;
     ori[target2] = n3;
     des[target2] = n2;
   }
 
+  hashset_free(links);
+  return 0;
+}
+
+// ---------------------------------------------------------------------
+// Get the links of a symmetric network, other than self-loops, as a
+// flat list of node nums (each link once) and, if weight and status
+// are not NULL, their weights and status. Also fills nodes[num] with
+// the nodes. Returns the number of links.
+// ---------------------------------------------------------------------
+static int
+SymmetricLinkArrays(struct node_gra *net, struct node_gra **nodes,
+		    int **ori, int **des, double **weight, int **status)
+{
+  struct node_gra *p = net;
+  struct node_lis *l;
+  int nlink = 0, nrev = 0;
+
+  while ((p = p->next) != NULL) {
+    nodes[p->num] = p;
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      if (p->num > l->node)
+	nlink++;
+      else if (p->num < l->node)
+	nrev++;
+    }
+  }
+  if (nlink != nrev)
+    fprintf(stderr,
+	    "Error in RandomizeNetwork: the network is not symmetric!!\n");
+
+  *ori = allocate_i_vec(nlink + 1);
+  *des = allocate_i_vec(nlink + 1);
+  if (weight != NULL)
+    *weight = allocate_d_vec(nlink + 1);
+  if (status != NULL)
+    *status = allocate_i_vec(nlink + 1);
+  nlink = 0;
+  p = net;
+  while ((p = p->next) != NULL) {
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      if (p->num > l->node) {
+	(*ori)[nlink] = p->num;
+	(*des)[nlink] = l->node;
+	if (weight != NULL)
+	  (*weight)[nlink] = l->weight;
+	if (status != NULL)
+	  (*status)[nlink] = l->status;
+	nlink++;
+      }
+    }
+  }
+
+  return nlink;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Randomize the links of a network using the Markov chain switching
+  algorithm. Each link keeps its weight and status as it is swapped,
+  and self-loops are left in place. The network must be simple (no
+  repeated links); otherwise, it is returned unchanged.
+  ---------------------------------------------------------------------
+*/
+struct node_gra *
+RandomizeSymmetricNetwork(struct node_gra *net,
+			  double times,
+			  gsl_rng *gen)
+{
+  int nnod = CountNodes(net);
+  struct node_gra **nodes;
+  struct node_lis **last;
+  struct node_gra *p;
+  struct node_lis *l;
+  int *ori, *des, *status;
+  double *weight;
+  int i, nlink;
+
+  /* Build the link lists (one for link origins and one for ends) */
+  nodes = (struct node_gra **)calloc(nnod + 1, sizeof(struct node_gra *));
+  nlink = SymmetricLinkArrays(net, nodes, &ori, &des, &weight, &status);
+
+  /* Randomize the links and replace the adjacency lists (keeping the
+     self-loops) */
+  if (SwapSymmetricLinks(nlink, ori, des, times, gen) == 0) {
+    last = (struct node_lis **)calloc(nnod + 1, sizeof(struct node_lis *));
+    p = net;
+    while ((p = p->next) != NULL) {
+      last[p->num] = p->neig;
+      while ((l = last[p->num]->next) != NULL) {
+	if (l->node == p->num) {
+	  last[p->num] = l;
+	}
+	else {
+	  last[p->num]->next = l->next;
+	  l->next = NULL;
+	  FreeAdjacencyList(l);
+	}
+      }
+      p->degree = 0;
+      p->strength = 0;
+    }
+    for (i=0; i<nlink; i++) {
+      last[ori[i]] = AppendAdjacency(last[ori[i]], nodes[des[i]],
+				     weight[i], status[i]);
+      last[des[i]] = AppendAdjacency(last[des[i]], nodes[ori[i]],
+				     weight[i], status[i]);
+    }
+    free(last);
+  }
+
   /* Free memory and return the network */
-  free(ori);
-  free(des);
+  free(nodes);
+  free_i_vec(ori);
+  free_i_vec(des);
+  free_d_vec(weight);
+  free_i_vec(status);
   return net;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Generate nrep randomizations of a symmetric network (see
+  RandomizeSymmetricNetwork) in parallel. The original network is
+  not modified. The replicas only contain the links that are not
+  self-loops, and nothing is done if the network is not
+  simple. Replica r uses its own random number generator, seeded
+  with seed + r, so results do not depend on the number of
+  threads. If fnameFmt is not NULL, replica r is written, as a list of
+  links, to the file named sprintf(fnameFmt, r) (for example
+  "random_%04d.dat"). If callback is not NULL, it is called with the
+  replica as a list of nlink links (ori[i], des[i]) between nodes of
+  net, given by their nums, and with the pointer data; callbacks for
+  different replicas may run at the same time in different threads,
+  and the arrays are only valid until the callback returns.
+  ---------------------------------------------------------------------
+*/
+void
+RandomizeSymmetricReplicas(struct node_gra *net,
+			   int nrep,
+			   double times,
+			   unsigned long int seed,
+			   char *fnameFmt,
+			   void (*callback)(int rep, struct node_gra *net,
+					    int nlink, int *ori, int *des,
+					    void *data),
+			   void *data)
+{
+  int nnod = CountNodes(net);
+  struct node_gra **nodes;
+  struct hashset *links;
+  int *ori0, *des0;
+  int nlink;
+
+  nodes = (struct node_gra **)calloc(nnod + 1, sizeof(struct node_gra *));
+  nlink = SymmetricLinkArrays(net, nodes, &ori0, &des0, NULL, NULL);
+  if ((links = SymmetricLinkSet(nlink, ori0, des0)) == NULL) {
+    free(nodes);
+    free_i_vec(ori0);
+    free_i_vec(des0);
+    return;
+  }
+  hashset_free(links);
+
+#pragma omp parallel
+  {
+    int *ori = allocate_i_vec(nlink + 1);
+    int *des = allocate_i_vec(nlink + 1);
+    gsl_rng *gen = gsl_rng_alloc(gsl_rng_mt19937);
+    char fname[FILENAME_MAX];
+    FILE *outF;
+    int r, i;
+
+#pragma omp for schedule(dynamic, 1)
+    for (r=0; r<nrep; r++) {
+      memcpy(ori, ori0, nlink * sizeof(int));
+      memcpy(des, des0, nlink * sizeof(int));
+      gsl_rng_set(gen, seed + r);
+      SwapSymmetricLinks(nlink, ori, des, times, gen);
+
+      if (fnameFmt != NULL) {
+	sprintf(fname, fnameFmt, r);
+	if ((outF = fopen(fname, "w")) == NULL) {
+	  fprintf(stderr, "RandomizeSymmetricReplicas: cannot open %s\n",
+		  fname);
+	}
+	else {
+	  for (i=0; i<nlink; i++)
+	    fprintf(outF, "%s %s\n",
+		    nodes[ori[i]]->label, nodes[des[i]]->label);
+	  fclose(outF);
+	}
+      }
+      if (callback != NULL)
+	callback(r, net, nlink, ori, des, data);
+    }
+
+    free_i_vec(ori);
+    free_i_vec(des);
+    gsl_rng_free(gen);
+  }
+
+  free(nodes);
+  free_i_vec(ori0);
+  free_i_vec(des0);
+}
+
 
 // ---------------------------------------------------------------------
 // ---------------------------------------------------------------------
@@ -1476,137 +1935,240 @@ NodeStrength(struct node_gra *node)
   return node->strength;
 }
 
-// ---------------------------------------------------------------------
-// Print to a file the distribution of path lengths between all pairs
-// of nodes. NEEDS TESTING.
-// ---------------------------------------------------------------------
-void
-FPrintDistanceHistogram(FILE *file, struct node_gra *root)
+/*
+  ---------------------------------------------------------------------
+  Workspace for the BFS sweeps used in the distance statistics: the
+  level (distance from the source, or -1 if not reached) of each
+  node, and the reached nodes in BFS order (the frontier of each
+  level is a slice of this queue). Each thread allocates one and
+  reuses it for all its sources; after a sweep only the reached nodes
+  are reset, so no sweep is O(N) just to start.
+  ---------------------------------------------------------------------
+*/
+struct bfs_ws{
+  int *level;
+  int *queue;
+};
+
+#define BFS_ALPHA 14  // go bottom-up when the frontier has more than
+		      // 1/BFS_ALPHA of the unexplored adjacencies...
+#define BFS_BETA 24   // ...and back top-down when it has less than
+		      // 1/BFS_BETA of the nodes
+
+/*
+  ---------------------------------------------------------------------
+  Direction-optimizing BFS from node src. Levels are expanded
+  top-down (from the frontier to its out-neighbors) while the frontier
+  is small, and bottom-up (from each unreached node to its
+  in-neighbors, iidx/ineig, stopping at the first one in the
+  frontier) when it is large. Adds to hist[d] the number of nodes at
+  distance d >= 1 from src, and returns the number of nodes reached
+  (src included).
+  ---------------------------------------------------------------------
+*/
+static int
+BFSLevels(struct node_csr *csr, int *iidx, int *ineig, int src,
+	  struct bfs_ws *ws, long int *hist)
 {
-  double histogram[10000];
-  int a, d, nodes, *size, i, counter, size_ant;
-  struct node_gra *p = root;
-  struct node_bfs *list, *lp;
-  double av_dis, norm;
-  int **max_dis_pairs;
+  int nnod = csr->nnod;
+  int *level = ws->level, *queue = ws->queue;
+  int fs = 0, fe = 1, end = 1;
+  int d = 0, i, e, u, v;
+  int bottomup = 0;
+  long int mf, mu;
+
+  level[src] = 0;
+  queue[0] = src;
+  mf = csr->idx[src+1] - csr->idx[src];
+  mu = iidx[nnod] - (iidx[src+1] - iidx[src]);
+
+  while (fs < fe) {
+    if (!bottomup && mf > mu / BFS_ALPHA)
+      bottomup = 1;
+    else if (bottomup && fe - fs < nnod / BFS_BETA)
+      bottomup = 0;
+
+    if (bottomup) {
+      for (v=0; v<nnod; v++) {
+	if (level[v] < 0) {
+	  for (e=iidx[v]; e<iidx[v+1]; e++) {
+	    if (level[ineig[e]] == d) {
+	      level[v] = d + 1;
+	      queue[end++] = v;
+	      break;
+	    }
+	  }
+	}
+      }
+    }
+    else {
+      for (i=fs; i<fe; i++) {
+	u = queue[i];
+	for (e=csr->idx[u]; e<csr->idx[u+1]; e++) {
+	  v = csr->neig[e];
+	  if (level[v] < 0) {
+	    level[v] = d + 1;
+	    queue[end++] = v;
+	  }
+	}
+      }
+    }
+
+    /* The new nodes are the next frontier */
+    fs = fe;
+    fe = end;
+    d++;
+    if (fe > fs)
+      hist[d] += fe - fs;
+    mf = 0;
+    for (i=fs; i<fe; i++) {
+      mf += csr->idx[queue[i]+1] - csr->idx[queue[i]];
+      mu -= iidx[queue[i]+1] - iidx[queue[i]];
+    }
+  }
 
-  max_dis_pairs = allocate_i_mat(CountNodes(root), 2);
+  for (i=0; i<end; i++)
+    level[queue[i]] = -1;
+  return end;
+}
 
-  list = CreateHeaderList();
+/*
+  ---------------------------------------------------------------------
+  Histogram of the distances from node src (or from all nodes if src
+  < 0) to all other nodes: hist[d], d = 1..nnod-1, is the number of
+  (ordered) pairs at distance d. Sources are distributed among
+  threads, each with its own workspace and histogram. Returns the
+  histogram (nnod+1 entries) and, in *reached, the number of pairs
+  (source included) connected by a path. For directed networks links
+  are followed in their direction.
+  ---------------------------------------------------------------------
+*/
+static long int *
+DistanceCounts(struct node_csr *csr, int src, long int *reached)
+{
+  int nnod = csr->nnod;
+  long int *hist = (long int *)calloc(nnod + 1, sizeof(long int));
+  long int nreached = 0;
+  int *iidx = csr->idx, *ineig = csr->neig;
+  int i, e, symmetric = 1;
+
+  /* In-adjacencies for the bottom-up steps (only different from the
+     out-adjacencies if the network is directed) */
+  for (e=0; e<csr->nlink && symmetric; e++)
+    if (csr->rev[e] < 0)
+      symmetric = 0;
+  if (!symmetric) {
+    iidx = allocate_i_vec(nnod + 1);
+    ineig = allocate_i_vec(csr->nlink + 1);
+    for (i=0; i<=nnod; i++)
+      iidx[i] = 0;
+    for (e=0; e<csr->nlink; e++)
+      iidx[csr->neig[e] + 1]++;
+    for (i=0; i<nnod; i++)
+      iidx[i+1] += iidx[i];
+    for (i=0; i<nnod; i++)
+      for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+	ineig[iidx[csr->neig[e]]++] = i;
+    for (i=nnod; i>0; i--)
+      iidx[i] = iidx[i-1];
+    iidx[0] = 0;
+  }
 
-  for(i = 0;i<10000;i++)
-    histogram[i] = 0.0;
+#pragma omp parallel if (src < 0) reduction(+:nreached)
+  {
+    struct bfs_ws ws;
+    long int *loc = (long int *)calloc(nnod + 1, sizeof(long int));
+    int s, d;
 
-  counter = 0;
-  a = 0;
-  size = &a;
+    ws.level = allocate_i_vec(nnod + 1);
+    ws.queue = allocate_i_vec(nnod + 1);
+    for (s=0; s<nnod; s++)
+      ws.level[s] = -1;
 
-  nodes = CountNodes(root);
+    if (src >= 0) {
+      nreached += BFSLevels(csr, iidx, ineig, src, &ws, loc);
+    }
+    else {
+#pragma omp for schedule(dynamic, 16)
+      for (s=0; s<nnod; s++)
+	nreached += BFSLevels(csr, iidx, ineig, s, &ws, loc);
+    }
 
-  p = root;
-  while(p->next != NULL){
-    counter++;
-    d = 0;
-    printf("%d %d %d %d\n",counter,nodes,(p->next)->num,*size);
-    ResetNodesState(root);
-    p = p->next;
+#pragma omp critical
+    for (d=0; d<=nnod; d++)
+      hist[d] += loc[d];
 
-    Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				 //predecessor del primer!!!!!
-    lp = list;
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      d++;
-      if(*size != size_ant){
-	histogram[d] += (double)(*size-size_ant)/(double)nodes;
-      }
-    }while(*size != size_ant);
+    free(loc);
+    free_i_vec(ws.level);
+    free_i_vec(ws.queue);
+  }
 
-    ClearList(list, size);
+  if (!symmetric) {
+    free_i_vec(iidx);
+    free_i_vec(ineig);
   }
+  if (reached != NULL)
+    *reached = nreached;
+  return hist;
+}
+
+// ---------------------------------------------------------------------
+// Print to a file the distribution of path lengths between all pairs
+// of nodes.
+// ---------------------------------------------------------------------
+void
+FPrintDistanceHistogram(FILE *file, struct node_gra *root)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nodes = csr->nnod, i;
+  long int *hist = DistanceCounts(csr, -1, NULL);
+  double h, av_dis, norm;
 
   // Output the histogram
   av_dis = norm = 0.0;
-  for(i = 0;i<10000;i++){
-    if(histogram[i] != 0.0){
-      fprintf(file,"%d %lf\n",i,histogram[i]/(double)(nodes-1));
-      av_dis += (double)(i)*histogram[i]/(double)(nodes-1);
-      norm += (double)(histogram[i])/(double)(nodes-1);
+  for(i = 1;i<nodes;i++){
+    if(hist[i] != 0){
+      h = (double)hist[i]/(double)nodes;
+      fprintf(file,"%d %lf\n",i,h/(double)(nodes-1));
+      av_dis += (double)(i)*h/(double)(nodes-1);
+      norm += h/(double)(nodes-1);
     }
   }
   fprintf(file,"#Average distance = %lf\n",av_dis);
   fprintf(file,"#Normalization = %lf\n",norm);
-  fprintf(file,"#z = %lf\n",histogram[1]);
+  fprintf(file,"#z = %lf\n",(double)hist[1]/(double)nodes);
 
-  free_i_mat(max_dis_pairs, CountNodes(root));
-  free(list);
+  free(hist);
+  FreeNodeCSR(csr);
 }
 
 // ---------------------------------------------------------------------
 // Print to a file the distribution of path lengths between a node and
-// all other nodes. NEEDS TESTING.
+// all other nodes.
 // ---------------------------------------------------------------------
 void
 FPrintDistanceHistogramFromNode(FILE *file,
 				struct node_gra *root,
 				int orinode)
 {
-  double histogram[10000];
-  int a,d,nodes,*size,i,counter,size_ant;
-  struct node_gra *p = root;
-  struct node_bfs *list,*lp;
-  double av_dis,norm;
-
-  list = CreateHeaderList();
-
-  for(i = 0;i<10000;i++)
-    histogram[i] = 0.0;
-
-  counter = 0;
-  a = 0;
-  size = &a;
-
-  nodes = CountNodes(root);
-
-  p = root;
-  while(p->next != NULL){
-    counter++;
-    d = 0;
-    p = p->next;
-
-    if(p->num ==  orinode){
-      ResetNodesState(root);
-      
-      Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				   //predecessor del primer!!!!!
-      lp = list;
-      do{
-	size_ant = *size;
-	lp = RenewQueue(list,lp,size,d);
-	d++;
-	if(*size != size_ant){
-	  histogram[d] += (double)(*size-size_ant);
-	}
-      }while(*size != size_ant);
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nodes = csr->nnod, i;
+  long int *hist;
+  double av_dis;
 
-      ClearList(list,size);
-    }
-  }
+  if (orinode >= 0 && orinode < nodes)
+    hist = DistanceCounts(csr, orinode, NULL);
+  else
+    hist = (long int *)calloc(nodes + 1, sizeof(long int));
 
-  av_dis = norm = 0.0;
-  for(i = 0;i<10000;i++){
-    if(histogram[i] != 0.0){
-/*       fprintf(file,"%d %lf\n",i,histogram[i]); */
-      av_dis += (double)(i)*histogram[i]/(double)(nodes-1);
-      norm += (double)(histogram[i])/(double)(nodes-1);
-    }
-  }
+  av_dis = 0.0;
+  for(i = 1;i<nodes;i++)
+    av_dis += (double)(i)*(double)hist[i]/(double)(nodes-1);
   fprintf(file,"#Average distance = %lf\n",av_dis);
-/*   fprintf(file,"#Normalization = %lf\n",norm); */
-  fprintf(file,"#z = %lf\n",histogram[1]);
+  fprintf(file,"#z = %lf\n",(double)hist[1]);
 
-  free(list);
+  free(hist);
+  FreeNodeCSR(csr);
 }
 
 // ---------------------------------------------------------------------
@@ -1615,121 +2177,326 @@ FPrintDistanceHistogramFromNode(FILE *file,
 double
 AveragePathLength(struct node_gra *root)
 {
-  double histogram[10000];
-  int a, d, nodes, *size, i, counter, size_ant;
-  struct node_gra *p=root;
-  struct node_bfs *list,*lp;
-  double av_dis,norm;
-
-  list = CreateHeaderList();
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nodes = csr->nnod, i;
+  long int reached, *hist = DistanceCounts(csr, -1, &reached);
+  double av_dis;
+
+  if(reached != (long int)nodes*(long int)nodes){
+    printf("Sorry, the network is not connected!\n");
+    free(hist);
+    FreeNodeCSR(csr);
+    return -1;
+  }
 
-  for(i = 0;i<10000;i++)
-    histogram[i] = 0.0;
+  av_dis = 0.0;
+  for(i = 1;i<nodes;i++)
+    av_dis += (double)(i)*((double)hist[i]/(double)nodes)/(double)(nodes-1);
 
-  counter = 0;
-  a = 0;
-  size = &a;
+  free(hist);
+  FreeNodeCSR(csr);
+  return av_dis;
+}
 
-  nodes = CountNodes(root);
-  
-  p = root;
-  while(p->next != NULL){
-    counter++;
-    d = 0;
-    ResetNodesState(root);
-    p = p->next;
+// ---------------------------------------------------------------------
+// Calculates the average of the inverse of the path length between
+// nodes in a network
+// ---------------------------------------------------------------------
+double
+AverageInverseDistance(struct node_gra *root)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nodes = csr->nnod, i;
+  long int *hist = DistanceCounts(csr, -1, NULL);
+  double av_dis;
 
-    Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				 //predecessor del primer!!!!!
-    lp = list;
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      d++;
-      if(*size != size_ant){
-	histogram[d] += (double)(*size-size_ant)/(double)nodes;
-      }
-    }while(*size != size_ant);
+  // Calculate the average inverse distance
+  av_dis = 0.0;
+  for(i = 1; i<nodes; i++)
+    av_dis += ((double)hist[i]/(double)nodes)/(double)( i * (nodes-1) );
 
-    if(*size != nodes){
-      printf("Sorry, the network is not connected!\n");
-      ClearList(list,size);
-      free(list);
-      return -1;
-    }
+  free(hist);
+  FreeNodeCSR(csr);
+  return av_dis;
+}
 
-    ClearList(list,size);
-  }
+/*
+  ---------------------------------------------------------------------
+  Approximate distance distribution (HyperANF). Instead of one BFS
+  per node, each node v keeps a HyperLogLog counter with m = 2^log2m
+  registers estimating the size of its ball B(v,t), the set of nodes
+  within distance t from v. Since B(v,t) is v plus the union of the
+  balls B(w,t-1) of its out-neighbors w, and the union of HyperLogLog
+  counters is the register-wise maximum, iteration t costs one pass
+  over the links. The neighbourhood function N(t) = sum_v |B(v,t)|
+  gives the number of pairs within distance t. Memory is 2 N m bytes,
+  and the relative standard error of each counter is about
+  1.04/sqrt(m).
+  ---------------------------------------------------------------------
+*/
 
-  av_dis = norm = 0.0;
-  for(i = 0;i<10000;i++){
-    if(histogram[i] != 0.0){
-      av_dis += (double)(i)*histogram[i]/(double)(nodes-1);
-    }
-  }
+// ---------------------------------------------------------------------
+// 64-bit hash of a node (splitmix64 finalizer)
+// ---------------------------------------------------------------------
+static unsigned long long
+HLLHash(unsigned long long x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
 
-  free(list);
+// ---------------------------------------------------------------------
+// Auxiliary series of the HyperLogLog estimator of Ertl (2017)
+// ---------------------------------------------------------------------
+static double
+HLLSigma(double x)
+{
+  double y = 1.0, z = x, zp;
+
+  if (x == 1.0)
+    return HUGE_VAL;
+  do {
+    x *= x;
+    zp = z;
+    z += x * y;
+    y += y;
+  } while (z != zp);
+  return z;
+}
 
-  return av_dis;
+static double
+HLLTau(double x)
+{
+  double y = 1.0, z, zp;
+
+  if (x == 0.0 || x == 1.0)
+    return 0.0;
+  z = 1.0 - x;
+  do {
+    x = sqrt(x);
+    zp = z;
+    y *= 0.5;
+    z -= (1.0 - x) * (1.0 - x) * y;
+  } while (z != zp);
+  return z / 3.0;
 }
 
 // ---------------------------------------------------------------------
-// Calculates the average of the inverse of the path length between
-// nodes in a network
+// Estimate of the cardinality of a counter with m = 2^log2m
+// registers. Uses the improved estimator of Ertl (2017), which,
+// unlike the original one with the small-range correction, has no
+// bias at counts of a few times m (the typical size of the balls in
+// a network of moderate size).
 // ---------------------------------------------------------------------
-double
-AverageInverseDistance(struct node_gra *root)
+static double
+HLLEstimate(unsigned char *reg, int log2m)
 {
-  double histogram[10000];
-  int a,d,nodes,*size,i,counter,size_ant;
-  struct node_gra *p = root;
-  struct node_bfs *list,*lp;
-  double av_dis,norm;
-
-  list = CreateHeaderList();
+  int m = 1 << log2m, q = 64 - log2m;
+  int count[66];
+  double z;
+  int j;
+
+  for (j=0; j<=q+1; j++)
+    count[j] = 0;
+  for (j=0; j<m; j++)
+    count[reg[j]]++;
+
+  z = (double)m * HLLTau(1.0 - (double)count[q+1] / (double)m);
+  for (j=q; j>=1; j--)
+    z = 0.5 * (z + (double)count[j]);
+  z += (double)m * HLLSigma((double)count[0] / (double)m);
+
+  return (double)m * (double)m / (2.0 * log(2.0) * z);
+}
 
-  for(i = 0; i<10000; i++)
-    histogram[i] = 0.0;
+/*
+  ---------------------------------------------------------------------
+  Estimate the histogram of distances between all pairs of nodes
+  using HyperANF with 2^log2m registers per node (4 <= log2m <= 16)
+  and hash seed seed. Returns hist[d], d = 0..*maxd, the estimated
+  number of ordered pairs at distance d (hist[0] = 0), or NULL if
+  log2m is out of range. Node updates within each iteration are
+  distributed among threads. For directed networks links are followed
+  in their direction.
+  ---------------------------------------------------------------------
+*/
+double *
+ApproxDistanceHistogram(struct node_gra *root,
+			int log2m,
+			unsigned int seed,
+			int *maxd)
+{
+  struct node_csr *csr;
+  unsigned char *reg, *newreg, *tmp;
+  unsigned long long h;
+  double *nf = NULL, *hist;
+  int nnod, m, i, j, t, changed, nnf = 16;
+
+  if (log2m < 4 || log2m > 16) {
+    fprintf(stderr, "ApproxDistanceHistogram: log2m must be between 4 and 16\n");
+    return NULL;
+  }
+  m = 1 << log2m;
+
+  csr = BuildNodeCSR(root);
+  nnod = csr->nnod;
+  reg = (unsigned char *)calloc((size_t)nnod * m, sizeof(unsigned char));
+  newreg = (unsigned char *)calloc((size_t)nnod * m, sizeof(unsigned char));
+  if (reg == NULL || newreg == NULL) {
+    fprintf(stderr, "ApproxDistanceHistogram: out of memory (%lu bytes)\n",
+	    2UL * (unsigned long)nnod * (unsigned long)m);
+    free(reg);
+    free(newreg);
+    FreeNodeCSR(csr);
+    return NULL;
+  }
 
-  counter = 0;
-  a = 0;
-  size = &a;
+  /* Each node starts with a counter containing only itself: the
+     first log2m bits of its hash choose the register and the rest
+     give the position of the first 1 */
+  for (i=0; i<nnod; i++) {
+    h = HLLHash(((unsigned long long)seed << 32) ^ (unsigned long long)i);
+    j = (int)(h >> (64 - log2m));
+    h <<= log2m;
+    for (t=1; t<=64-log2m && !(h & (1ULL << 63)); t++)
+      h <<= 1;
+    reg[(size_t)i * m + j] = t;
+  }
 
-  nodes = CountNodes(root);
-  
-  p = root;
-  while(p->next !=  NULL){
-    counter++;
-    d = 0;
-    ResetNodesState(root);
-    p = p->next;
+  /* Iterate until no counter changes */
+  nf = (double *)malloc(nnf * sizeof(double));
+  nf[0] = 0.0;
+  for (i=0; i<nnod; i++)
+    nf[0] += HLLEstimate(&reg[(size_t)i * m], log2m);
+  t = 0;
+  do {
+    changed = 0;
+    t++;
+    if (t >= nnf) {
+      nnf *= 2;
+      nf = (double *)realloc(nf, nnf * sizeof(double));
+    }
+    nf[t] = 0.0;
 
-    Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				 //predecessor del primer!!!!!
-    lp = list;
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      d++;
-      if(*size !=  size_ant){
-	histogram[d] +=  (double)(*size-size_ant)/(double)nodes;
+#pragma omp parallel for schedule(dynamic, 64) private(j) reduction(+:changed)
+    for (i=0; i<nnod; i++) {
+      unsigned char *r = &newreg[(size_t)i * m], *s;
+      int e, ch = 0;
+
+      memcpy(r, &reg[(size_t)i * m], m);
+      for (e=csr->idx[i]; e<csr->idx[i+1]; e++) {
+	s = &reg[(size_t)csr->neig[e] * m];
+	for (j=0; j<m; j++)
+	  if (s[j] > r[j]) {
+	    r[j] = s[j];
+	    ch = 1;
+	  }
       }
-    }while(*size !=  size_ant);
+      changed += ch;
+    }
+
+    tmp = reg;
+    reg = newreg;
+    newreg = tmp;
+    for (i=0; i<nnod; i++)
+      nf[t] += HLLEstimate(&reg[(size_t)i * m], log2m);
+  } while (changed > 0);
+
+  /* The last iteration did not change anything; the histogram is the
+     increase of the neighbourhood function at each distance */
+  *maxd = t - 1;
+  hist = (double *)calloc(t + 1, sizeof(double));
+  for (i=1; i<=*maxd; i++)
+    hist[i] = (nf[i] > nf[i-1]) ? nf[i] - nf[i-1] : 0.0;
+
+  free(nf);
+  free(reg);
+  free(newreg);
+  FreeNodeCSR(csr);
+  return hist;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Approximate distance statistics from ApproxDistanceHistogram: the
+  average path length between connected pairs, the average inverse
+  distance over all pairs (as AverageInverseDistance), and the
+  effective diameter (the 90th percentile of the distances between
+  connected pairs, interpolated). Returns 0 on success and -1 if the
+  histogram could not be computed.
+  ---------------------------------------------------------------------
+*/
+int
+ApproxDistanceStatistics(struct node_gra *root,
+			 int log2m,
+			 unsigned int seed,
+			 double *theAPL,
+			 double *theInvDist,
+			 double *theEffDiam)
+{
+  double *hist, pairs = 0.0, cum = 0.0, target;
+  double nodes = (double)CountNodes(root);
+  int maxd, d;
 
-    ClearList(list,size);
+  if ((hist = ApproxDistanceHistogram(root, log2m, seed, &maxd)) == NULL)
+    return -1;
+
+  *theAPL = *theInvDist = *theEffDiam = 0.0;
+  for (d=1; d<=maxd; d++) {
+    pairs += hist[d];
+    *theAPL += (double)d * hist[d];
+    *theInvDist += hist[d] / (double)d;
+  }
+  if (pairs > 0.0)
+    *theAPL /= pairs;
+  *theInvDist /= nodes * (nodes - 1.0);
+
+  target = 0.9 * pairs;
+  for (d=1; d<=maxd; d++) {
+    if (cum + hist[d] >= target) {
+      *theEffDiam = (double)(d - 1) + (target - cum) / hist[d];
+      break;
+    }
+    cum += hist[d];
   }
 
-  // Calculate the average inverse distance
+  free(hist);
+  return 0;
+}
+
+// ---------------------------------------------------------------------
+// Print to a file the approximate distribution of path lengths
+// between all pairs of nodes, in the format of
+// FPrintDistanceHistogram
+// ---------------------------------------------------------------------
+void
+FPrintApproxDistanceHistogram(FILE *file,
+			      struct node_gra *root,
+			      int log2m,
+			      unsigned int seed)
+{
+  double *hist, h, av_dis, norm;
+  int nodes = CountNodes(root), maxd, i;
+
+  if ((hist = ApproxDistanceHistogram(root, log2m, seed, &maxd)) == NULL)
+    return;
+
   av_dis = norm = 0.0;
-  for(i = 0; i<10000; i++){
-    if(histogram[i] !=  0.0){
-      av_dis +=  histogram[i]/(double)( i * (nodes-1) );
+  for(i = 1;i<=maxd;i++){
+    if(hist[i] != 0.0){
+      h = hist[i]/(double)nodes;
+      fprintf(file,"%d %lf\n",i,h/(double)(nodes-1));
+      av_dis += (double)(i)*h/(double)(nodes-1);
+      norm += h/(double)(nodes-1);
     }
   }
+  fprintf(file,"#Average distance = %lf\n",av_dis);
+  fprintf(file,"#Normalization = %lf\n",norm);
+  fprintf(file,"#z = %lf\n",hist[1]/(double)nodes);
 
-  free(list);
-
-  return av_dis;
+  free(hist);
 }
 
 
@@ -1769,49 +2536,217 @@ int CalculateLinksBetweenNeig(struct node_bfs *p,
 }
 
 // ---------------------------------------------------------------------
-// Calculates the clustering coefficent of a network as the average of
-// the nodes individual clustering coefficient
+// Compare two integers (for qsort and bsearch)
 // ---------------------------------------------------------------------
-double
-ClusteringCoefficient(struct node_gra *root)
+static int
+IntCompare(const void *i1, const void *i2)
 {
-  int nodes,*size,res_size;
-  struct node_bfs *list;
-  struct node_gra *p = root;
-  double C_av;
-  int k_v;
-  int C_v;
+  int a = *(const int *)i1, b = *(const int *)i2;
 
-  C_av = 0.0;
-  res_size = 0;
-  size = &res_size;
-  list = CreateHeaderList();
-  
-  nodes = CountNodes(root);
+  return (a > b) - (a < b);
+}
 
-  while(p->next != NULL){
-    p = p->next;
-    ResetNodesState(root);
-    
-    Enqueue(p,list,list,size,0); //Posem el header com a predecessor
-				 //pero no afecta res!
-    RenewQueue(list,list,size,0);
-    Dequeue(list,size);
-    k_v = *size;
-    if(k_v>1){
-      p->state = 0;
-      C_v = CalculateLinksBetweenNeig(list,root);
-      C_av += (double)C_v/(double)(k_v*(k_v-1));
+// ---------------------------------------------------------------------
+// Get the (sorted) nums of the neighbors of a node, other than the
+// node itself. Returns the number of neighbors.
+// ---------------------------------------------------------------------
+static int
+SortedNeighbors(struct node_gra *node, int **neig)
+{
+  struct node_lis *l = node->neig;
+  int k = 0;
+
+  *neig = allocate_i_vec(NodeDegree(node) + 1);
+  while ((l = l->next) != NULL)
+    if (l->ref != node)
+      (*neig)[k++] = l->ref->num;
+  qsort(*neig, k, sizeof(int), IntCompare);
+
+  return k;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Triangle counting engine. Links are oriented from the endpoint with
+  lower to higher (degree, num) rank, and nodes are relabeled by rank,
+  so that each out-list is short (at most O(sqrt(E)) long) and sorted.
+  Each triangle u<v<w is then found exactly once, by merging the
+  out-lists of u and v, and the work is O(E^1.5) at worst. Nodes u are
+  distributed among threads, each with its own counters. Stores in
+  tri[num] the number of triangles through each node and returns the
+  total number of triangles. The network must be symmetric.
+  ---------------------------------------------------------------------
+*/
+static long int
+TriangleCount(struct node_csr *csr, long int *tri)
+{
+  int nnod = csr->nnod;
+  int *deg, *order, *rank, *oidx, *oneig;
+  long int *rtri;
+  int i, j, e, r;
+  long int total = 0;
+
+  /* Rank the nodes by degree (counting sort), ties broken by num */
+  deg = allocate_i_vec(nnod + 1);
+  order = allocate_i_vec(nnod + 1);
+  rank = allocate_i_vec(nnod + 1);
+  for (i=0; i<nnod; i++) {
+    deg[i] = 0;
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+      if (csr->neig[e] != i)
+	deg[i]++;
+  }
+  oidx = allocate_i_vec(nnod + 2);
+  for (i=0; i<=nnod+1; i++)
+    oidx[i] = 0;
+  for (i=0; i<nnod; i++)
+    oidx[deg[i] + 1]++;
+  for (i=0; i<nnod; i++)
+    oidx[i+1] += oidx[i];
+  for (i=0; i<nnod; i++)
+    order[oidx[deg[i]]++] = i;
+  for (r=0; r<nnod; r++)
+    rank[order[r]] = r;
+
+  /* Oriented CSR in rank labels */
+  for (r=0; r<=nnod; r++)
+    oidx[r] = 0;
+  for (i=0; i<nnod; i++)
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+      if (rank[csr->neig[e]] > rank[i])
+	oidx[rank[i] + 1]++;
+  for (r=0; r<nnod; r++)
+    oidx[r+1] += oidx[r];
+  oneig = allocate_i_vec(oidx[nnod] + 1);
+  for (r=0; r<nnod; r++) {
+    i = order[r];
+    j = oidx[r];
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+      if (rank[csr->neig[e]] > r)
+	oneig[j++] = rank[csr->neig[e]];
+    qsort(&oneig[oidx[r]], j - oidx[r], sizeof(int), IntCompare);
+  }
+
+  /* Triangles through each node, in rank labels */
+  rtri = (long int *)calloc(nnod + 1, sizeof(long int));
+
+#pragma omp parallel private(i, j, r) reduction(+:total)
+  {
+    long int *loc = (long int *)calloc(nnod + 1, sizeof(long int));
+    int u, v, a, b, aend, bend, n;
+
+#pragma omp for schedule(dynamic, 64)
+    for (u=0; u<nnod; u++) {
+      for (i=oidx[u]; i<oidx[u+1]; i++) {
+	v = oneig[i];
+	/* Merge the rest of u's out-list with v's out-list */
+	a = i + 1;
+	aend = oidx[u+1];
+	b = oidx[v];
+	bend = oidx[v+1];
+	n = 0;
+	while (a < aend && b < bend) {
+	  if (oneig[a] < oneig[b])
+	    a++;
+	  else if (oneig[a] > oneig[b])
+	    b++;
+	  else {
+	    loc[oneig[a]]++;
+	    n++;
+	    a++;
+	    b++;
+	  }
+	}
+	loc[u] += n;
+	loc[v] += n;
+	total += n;
+      }
     }
-    else {
-      nodes--;
+
+#pragma omp critical
+    for (r=0; r<nnod; r++)
+      rtri[r] += loc[r];
+
+    free(loc);
+  }
+
+  /* Back to num labels */
+  for (r=0; r<nnod; r++)
+    tri[order[r]] = rtri[r];
+
+  free(rtri);
+  free_i_vec(deg);
+  free_i_vec(order);
+  free_i_vec(rank);
+  free_i_vec(oidx);
+  free_i_vec(oneig);
+  return total;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Computes, in a single triangle-counting pass, the global clustering
+  coefficient (3 x triangles / connected triples, as in
+  ClusteringCoefficient2), the average of the clustering coefficients
+  of nodes with degree > 1 (as in ClusteringCoefficient), and, if
+  Cnode != NULL, the clustering coefficient of each node in Cnode[num]
+  (-1 for nodes with degree < 2, as in
+  OneNodeClusteringCoefficient). The network must be symmetric.
+  ---------------------------------------------------------------------
+*/
+void
+ClusteringCoefficients(struct node_gra *root,
+		       double *theGlobal,
+		       double *theAverage,
+		       double *Cnode)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  long int *tri = (long int *)calloc(csr->nnod + 1, sizeof(long int));
+  double ctr = 0.0, C_v, C_av = 0.0;
+  int i, e, k, nodes = 0;
+
+  TriangleCount(csr, tri);
+
+  for (i=0; i<csr->nnod; i++) {
+    k = 0;
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++)
+      if (csr->neig[e] != i)
+	k++;
+    if (k > 1) {
+      C_v = 2.0 * (double)tri[i] / ((double)k * (double)(k - 1));
+      C_av += C_v;
+      ctr += (double)k * (double)(k - 1);
+      nodes++;
     }
-    ClearList(list,size);
+    else
+      C_v = -1.0;
+    if (Cnode != NULL)
+      Cnode[i] = C_v;
+  }
+
+  if (theAverage != NULL)
+    *theAverage = C_av / (double)nodes;
+  if (theGlobal != NULL) {
+    *theGlobal = 0.0;
+    for (i=0; i<csr->nnod; i++)
+      *theGlobal += 2.0 * (double)tri[i];
+    *theGlobal /= ctr;
   }
 
-  C_av = C_av/(double)nodes;
+  free(tri);
+  FreeNodeCSR(csr);
+}
+
+// ---------------------------------------------------------------------
+// Calculates the clustering coefficent of a network as the average of
+// the nodes individual clustering coefficient
+// ---------------------------------------------------------------------
+double
+ClusteringCoefficient(struct node_gra *root)
+{
+  double C_av;
 
-  free(list);
+  ClusteringCoefficients(root, NULL, &C_av, NULL);
   return C_av;
 }
 
@@ -1823,121 +2758,105 @@ ClusteringCoefficient(struct node_gra *root)
 double
 ClusteringCoefficient2(struct node_gra *root)
 {
-  int nodes,*size,res_size;
-  struct node_bfs *list;
-  struct node_gra *p = root;
-  int tri,ctr;  //#triangles and #connected triplets
-  int k_v;
   double C;
 
-  tri = ctr = 0;
-  res_size = 0;
-  size = &res_size;
-  list = CreateHeaderList();
-  
-  nodes = CountNodes(root);
+  ClusteringCoefficients(root, &C, NULL, NULL);
+  return C;
+}
 
-  while(p->next != NULL){
-    p = p->next;
-    ResetNodesState(root);
-    
-    Enqueue(p,list,list,size,0); //Posem el header com a predecessor
-				 //pero no afecta res!
-    RenewQueue(list,list,size,0);
-    Dequeue(list,size);
-    k_v = *size;
-    if(k_v>1){
-      p->state = 0;
-      tri += CalculateLinksBetweenNeig(list,root);
-      ctr += k_v*(k_v-1);
+/*
+  ---------------------------------------------------------------------
+  Square counts of node v: k1 first neighbors, k2 second neighbors
+  (nodes at distance 2), and the sum over second neighbors of n(n-1),
+  where n is the number of paths of length 2 from v to them. cnt is
+  a zeroed per-thread array of nnod counters and touched a scratch
+  array of nnod entries; cnt is left zeroed.
+  ---------------------------------------------------------------------
+*/
+static void
+SquareCounts(struct node_csr *csr, int v, int *cnt, int *touched,
+	     int *k1, int *k2, long int *C_v)
+{
+  int e, f, u, w, i;
+
+  *k1 = *k2 = 0;
+  *C_v = 0;
+
+  /* Mark the node and its first neighbors */
+  cnt[v] = -1;
+  for (e=csr->idx[v]; e<csr->idx[v+1]; e++) {
+    if (csr->neig[e] != v) {
+      cnt[csr->neig[e]] = -1;
+      (*k1)++;
     }
-    else
-      nodes--;
-    ClearList(list,size);
   }
 
-  C = (double)tri/(double)ctr;
+  /* Count paths of length 2 to second neighbors */
+  for (e=csr->idx[v]; e<csr->idx[v+1]; e++) {
+    u = csr->neig[e];
+    if (u == v)
+      continue;
+    for (f=csr->idx[u]; f<csr->idx[u+1]; f++) {
+      w = csr->neig[f];
+      if (cnt[w] >= 0) {
+	if (cnt[w] == 0)
+	  touched[(*k2)++] = w;
+	cnt[w]++;
+      }
+    }
+  }
 
-  free(list);
-  return C;
+  /* Sum and clean up */
+  for (i=0; i<*k2; i++) {
+    w = touched[i];
+    *C_v += (long int)cnt[w] * (long int)(cnt[w] - 1);
+    cnt[w] = 0;
+  }
+  cnt[v] = 0;
+  for (e=csr->idx[v]; e<csr->idx[v+1]; e++)
+    cnt[csr->neig[e]] = 0;
 }
 
 // ---------------------------------------------------------------------
 // Same as the clustering coefficient, but counting squares rather
-// than triangles.
+// than triangles. Nodes with less than two neighbors, or without
+// second neighbors, are not included in the average.
 // ---------------------------------------------------------------------
 double
 SquareClustering(struct node_gra *root)
 {
-  int nodes,*size,res_size;
-  struct node_bfs *list;
-  struct node_bfs *lp;
-  struct node_bfs *pl;
-  struct node_gra *p = root;
-  double C_av;
-  int k1,k2;
-  int C_v;
-  int npre;
-  int totnodes;
-  int k1b;
-
-  C_av = 0.0;
-  res_size = 0;
-  size = &res_size;
-  list = CreateHeaderList();
-  
-  totnodes = nodes = CountNodes(root);
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nnod = csr->nnod;
+  double C_av = 0.0;
+  int nodes = 0;
 
-  while(p->next != NULL){
-    p = p->next;
-    ResetNodesState(root);
-    
-    Enqueue(p,list,list,size,0); //Posem el header com a predecessor
-				 //pero no afecta res!
-    lp = list;
-    if(*size<totnodes)
-      lp = RenewQueue(list,lp,size,0); // First neighbors
-    else{ // If the size of the cluster is 1
-      return -1.0;
-    }
-    k1b = *size-1;
-    if(*size<totnodes){
-      lp = RenewQueue(list,lp,size,1); // Second neighbors
-
-      k1 = k2 = 0;
-      pl = (list->next)->next; // Pointer to the first neighbor
-      while(pl->d<2){
-	pl = pl->next;
-	k1++;
-      }   // count first neighbors and place the pointer at the first
-	  // second neighbor
-      printf("%d %d = %d %d\n",p->num+1,k1,k1b,totnodes);
-    
-      C_v = 0;
-      while(pl != NULL){
-	k2++;
-	npre = CountPredecessors(pl);
-	C_v += npre*(npre-1);
-	pl = pl->next;
-      }
+  if (nnod <= 1) {
+    FreeNodeCSR(csr);
+    return -1.0;
+  }
 
-      if(k1>1){
-	C_av += (double)(C_v)/(double)(k2*k1*(k1-1));
+#pragma omp parallel reduction(+:C_av, nodes)
+  {
+    int *cnt = (int *)calloc(nnod + 1, sizeof(int));
+    int *touched = allocate_i_vec(nnod + 1);
+    int v, k1, k2;
+    long int C_v;
+
+#pragma omp for schedule(dynamic, 64)
+    for (v=0; v<nnod; v++) {
+      SquareCounts(csr, v, cnt, touched, &k1, &k2, &C_v);
+      if (k1 > 1 && k2 > 0) {
+	C_av += (double)C_v / ((double)k2 * (double)k1 * (double)(k1 - 1));
+	nodes++;
       }
-      else
-	nodes--;
     }
-    else
-      nodes--;
 
-    ClearList(list,size);
+    free(cnt);
+    free_i_vec(touched);
   }
 
-  C_av = C_av/(double)nodes;
-
-  free(list);
-
-  return C_av;
+  FreeNodeCSR(csr);
+  return C_av / (double)nodes;
 }
 
 // ---------------------------------------------------------------------
@@ -1947,34 +2866,31 @@ double
 OneNodeClusteringCoefficient(struct node_gra *node,
 			     struct node_gra *root)
 {
-  int *size, res_size;
-  struct node_bfs *list;
-  int k_v;
-  int C_v;
+  struct node_lis *l, *m;
+  int *neig;
+  int k_v, C_v = 0;
   double C;
 
-  res_size = 0;
-  size = &res_size;
-  list = CreateHeaderList();
-  
-  ResetNodesState(root);
-    
-  Enqueue(node,list,list,size,0); // Posem el header com a predecessor
-				  // pero no afecta res!
-  RenewQueue(list,list,size,0);
-  Dequeue(list,size);
-  k_v = *size;
-  if(k_v>1){
-    node->state = 0;
-    C_v = CalculateLinksBetweenNeig(list,root);
+  (void)root;
+  k_v = SortedNeighbors(node, &neig);
+  if (k_v > 1) {
+    /* Count the (ordered) pairs of linked neighbors */
+    l = node->neig;
+    while ((l = l->next) != NULL) {
+      if (l->ref == node)
+	continue;
+      m = l->ref->neig;
+      while ((m = m->next) != NULL)
+	if (m->ref != l->ref &&
+	    bsearch(&m->ref->num, neig, k_v, sizeof(int), IntCompare) != NULL)
+	  C_v++;
+    }
     C = (double)C_v/((double)k_v*(double)(k_v-1));
   }
   else
     C = -1.0000;
 
-  ClearList(list,size);
-  free(list);
-
+  free_i_vec(neig);
   return C;
 }
 
@@ -1985,341 +2901,571 @@ double
 OneNodeSquareClustering(struct node_gra *node,
 			struct node_gra *root)
 {
-  int *size, res_size;
-  struct node_bfs *list;
-  struct node_bfs *lp;
-  struct node_bfs *pl;
-  int k1,k2;
+  struct node_lis *l, *m;
+  int *neig, *second;
+  int k1, k2, nsec, i, j;
   int C_v;
-  int npre;
   double T;
-  int sizeant;
 
-  res_size = 0;
-  size = &res_size;
-  list = CreateHeaderList();
-  
+  (void)root;
   if(NodeDegree(node) == 0)
     return -1;
 
-  ResetNodesState(root);
-    
-  Enqueue(node,list,list,size,0); //Posem el header com a predecessor
-				  //pero no afecta res!
-  lp = list;
-  lp = RenewQueue(list,lp,size,0); // First neighbors
-
-  sizeant = *size;
-
-  lp = RenewQueue(list,lp,size,1); // Second neighbors
-
-  if(*size !=  sizeant){
+  /* Collect the ends of all paths of length 2 to second neighbors */
+  k1 = SortedNeighbors(node, &neig);
+  nsec = 0;
+  l = node->neig;
+  while ((l = l->next) != NULL)
+    if (l->ref != node)
+      nsec += NodeDegree(l->ref);
+  second = allocate_i_vec(nsec + 1);
+  nsec = 0;
+  l = node->neig;
+  while ((l = l->next) != NULL) {
+    if (l->ref == node)
+      continue;
+    m = l->ref->neig;
+    while ((m = m->next) != NULL)
+      if (m->ref != node &&
+	  bsearch(&m->ref->num, neig, k1, sizeof(int), IntCompare) == NULL)
+	second[nsec++] = m->ref->num;
+  }
+  free_i_vec(neig);
 
-    k1 = k2 = 0;
-    pl = (list->next)->next; // Pointer to the first neighbor
-    while(pl->d<2){
-      pl = pl->next;
-      k1++;
-    }   // count first neighbors and place the pointer at the first
-	// second neighbor
-    
-    C_v = 0;
-    while(pl != NULL){
-      k2++;
-      npre = CountPredecessors(pl);
-      C_v += npre*(npre-1);
-      pl = pl->next;
-    }
+  if (nsec == 0) {
+    free_i_vec(second);
+    return -3; // all nodes are first neighbors!!
+  }
+  if (k1 <= 1) {
+    free_i_vec(second);
+    return -2; // only 1 first neighbor!!
+  }
 
-    if(k1<= 1)
-      return -2; // only 1 first neighbor!!
+  /* Each run of equal values is a second neighbor reached by
+     (run length) paths */
+  qsort(second, nsec, sizeof(int), IntCompare);
+  k2 = 0;
+  C_v = 0;
+  for (i=0; i<nsec; i=j) {
+    for (j=i+1; j<nsec && second[j] == second[i]; j++);
+    k2++;
+    C_v += (j - i) * (j - i - 1);
   }
-  else
-    return -3; // all nodes are first neighbors!!
-  
-  T = (double)C_v/((double)k2*(double)k1*(double)(k1-1));
 
-  ClearList(list,size);
-  free(list);
+  T = (double)C_v/((double)k2*(double)k1*(double)(k1-1));
 
+  free_i_vec(second);
   return T;
 }
 
 
 /*
   ---------------------------------------------------------------------
-  Calculates the betweenness of each link and stores in the btw field
-  of the node_lis
+  Workspace for the single-source shortest path sweeps used in the
+  betweenness calculations. Each thread allocates one and reuses it
+  for all its sources, so that no memory is allocated during a
+  sweep. Predecessors are stored in flat arrays: those of node w
+  occupy positions pidx[w] to pidx[w]+npred[w]-1 (pidx is shared and
+  read-only).
   ---------------------------------------------------------------------
 */
-void
-CalculateLinkBetweenness(struct node_gra *root)
-{
-  int a,d,*size,i,counter,size_ant;
-  struct node_gra *p = root;
-  struct node_bfs *list,*lp;
-  double *bet_loc;
-  int n_pred;
-  struct pred *ppre;
-  int *ocupacio;
-  struct node_lis *tar,*temp;
-  int nnod=CountNodes(root);
-
-  ocupacio = allocate_i_vec(nnod);
-  bet_loc = allocate_d_vec(nnod);
+struct brandes_ws{
+  int *order;       // reached nodes in BFS order (also used as queue)
+  int *d;           // distance from the source (-1 if not reached)
+  double *sigma;    // number of shortest paths from the source
+  double *delta;    // dependency of the source on each node
+  double *flow;     // flow of the link betweenness through each node
+  int *npred;       // number of predecessors of each node
+  int *predNode;    // predecessors
+  int *predLink;    // CSR adjacency from each predecessor to the node
+  int *pidx;        // first predecessor position of each node
+};
 
-  list = CreateHeaderList();
+// ---------------------------------------------------------------------
+// Allocate and initialize a betweenness workspace
+// ---------------------------------------------------------------------
+static struct brandes_ws *
+CreateBrandesWS(struct node_csr *csr, int *pidx)
+{
+  struct brandes_ws *ws;
+  int i;
 
-  for(i=0; i<nnod; i++){
-    ocupacio[i] = 0;
+  ws = (struct brandes_ws *)calloc(1, sizeof(struct brandes_ws));
+  ws->order = allocate_i_vec(csr->nnod + 1);
+  ws->d = allocate_i_vec(csr->nnod + 1);
+  ws->sigma = allocate_d_vec(csr->nnod + 1);
+  ws->delta = allocate_d_vec(csr->nnod + 1);
+  ws->flow = allocate_d_vec(csr->nnod + 1);
+  ws->npred = allocate_i_vec(csr->nnod + 1);
+  ws->predNode = allocate_i_vec(csr->nlink + 1);
+  ws->predLink = allocate_i_vec(csr->nlink + 1);
+  ws->pidx = pidx;
+  for (i=0; i<csr->nnod; i++) {
+    ws->d[i] = -1;
+    ws->sigma[i] = 0.0;
+    ws->delta[i] = 0.0;
+    ws->flow[i] = 1.0;
+    ws->npred[i] = 0;
   }
-  counter = 0;
-  a = 0;
-  size = &a;
 
-  // set the btw of all links to 0
-  while(p->next != NULL){
-    p = p->next;
-    ocupacio[p->num] = 1;
-    temp = p->neig;
-    while(temp->next != NULL){
-      temp = temp->next;
-      temp->btw = 0.0;
-    }
-  }
-  
-  p = root;
-  while(p->next != NULL){
-    counter++;
-    d = 0;
-    ResetNodesState(root);
-    p = p->next;
+  return ws;
+}
 
-    Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				 //predecessor del primer!!!!!
-    lp = list;
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      d++;
-    }while(*size != size_ant);
+// ---------------------------------------------------------------------
+// Free the memory allocated to a betweenness workspace
+// ---------------------------------------------------------------------
+static void
+FreeBrandesWS(struct brandes_ws *ws)
+{
+  free_i_vec(ws->order);
+  free_i_vec(ws->d);
+  free_d_vec(ws->sigma);
+  free_d_vec(ws->delta);
+  free_d_vec(ws->flow);
+  free_i_vec(ws->npred);
+  free_i_vec(ws->predNode);
+  free_i_vec(ws->predLink);
+  free(ws);
+}
 
-    //Update the betweenness
-    for(i = 0;i<nnod;i++){
-      bet_loc[i] = (double)ocupacio[i];
-    }
-    
-    lp = list->last;
-    while((n_pred = CountPredecessors(lp)) != 0){
-      ppre = lp->pred;
-      while(ppre != NULL){
-	bet_loc[((ppre->ref)->ref)->num] +=
-	  bet_loc[(lp->ref)->num]/(double)n_pred;
-	
-	tar = ((lp->ref)->neig)->next;
-	while((tar->node) != ((ppre->ref)->ref)->num)
-	  tar = tar->next;
-	tar->btw += bet_loc[(lp->ref)->num]/(double)n_pred;
-
-	tar = (((ppre->ref)->ref)->neig)->next;
-	while((tar->node) != (lp->ref)->num)
-	  tar = tar->next;
-	tar->btw += bet_loc[(lp->ref)->num]/(double)n_pred;
-
-	ppre = ppre->next;
+/*
+  ---------------------------------------------------------------------
+  BFS from source s recording distances, number of shortest paths,
+  and predecessors. Returns the number of nodes reached, which are
+  stored in ws->order in order of non-decreasing distance.
+  ---------------------------------------------------------------------
+*/
+static int
+BrandesForward(struct node_csr *csr, int s, struct brandes_ws *ws)
+{
+  int head = 0, tail = 0;
+  int v, w, e, k;
+
+  ws->order[tail++] = s;
+  ws->d[s] = 0;
+  ws->sigma[s] = 1.0;
+  while (head < tail) {
+    v = ws->order[head++];
+    for (e=csr->idx[v]; e<csr->idx[v+1]; e++) {
+      w = csr->neig[e];
+      /* w found for the first time? */
+      if (ws->d[w] < 0) {
+	ws->order[tail++] = w;
+	ws->d[w] = ws->d[v] + 1;
+      }
+      /* Shortest path to w via v? */
+      if (ws->d[w] == ws->d[v] + 1) {
+	ws->sigma[w] += ws->sigma[v];
+	k = ws->pidx[w] + ws->npred[w]++;
+	ws->predNode[k] = v;
+	ws->predLink[k] = e;
       }
-      lp = lp->prev;
     }
- 
-    ClearList(list,size);
   }
-  
-  free_i_vec(ocupacio);
-  free_d_vec(bet_loc);
-  free(list);
+
+  return tail;
 }
 
 // ---------------------------------------------------------------------
-// Calculates the betweenness of each link and writes in n1 and n2 the
-// nodes corresponding to the largest betweenness in the network.
+// Restore the workspace entries touched by the last sweep (this is
+// O(nodes reached) rather than O(N))
 // ---------------------------------------------------------------------
-void
-CalculateBiggestLinkBetweenness(struct node_gra *root,int *n1,int *n2)
+static void
+BrandesReset(struct brandes_ws *ws, int nreached)
 {
-  int a,d,*size,i,counter,size_ant;
-  struct node_gra *p = root;
-  struct node_bfs *list,*lp;
-  double *bet_loc;
-  int n_pred;
-  struct pred *ppre;
-  int *ocupacio;
-  struct node_lis *big = NULL;
-  struct node_lis *tar,*temp;
-  int nnod=CountNodes(root);
-
-  ocupacio = allocate_i_vec(nnod);
-  bet_loc = allocate_d_vec(nnod);
-  list = CreateHeaderList();
-
-  for(i = 0;i<nnod;i++){
-    ocupacio[i] = 0;
-  }
-  counter = 0;
-  a = 0;
-  size = &a;
+  int i, v;
+
+  for (i=0; i<nreached; i++) {
+    v = ws->order[i];
+    ws->d[v] = -1;
+    ws->sigma[v] = 0.0;
+    ws->delta[v] = 0.0;
+    ws->flow[v] = 1.0;
+    ws->npred[v] = 0;
+  }
+}
 
-  while(p->next != NULL){
-    p = p->next;
-    ocupacio[p->num] = 1;
-    temp = p->neig;
-    while(temp->next != NULL){
-      temp = temp->next;
-      temp->btw = 0.0;
+/*
+  ---------------------------------------------------------------------
+  Run the betweenness sweeps from the nsrc sources in src (all nodes
+  if src == NULL), in parallel if OpenMP is available. Sources are
+  distributed among threads, each of which accumulates into its own
+  arrays; these are added to the output arrays at the end (the output
+  arrays are NOT reset, so that successive batches of sources can be
+  accumulated). If nodeBet != NULL, it gets the node betweenness
+  (Brandes' dependency accumulation). If linkBet != NULL, it gets the
+  betweenness of each CSR adjacency, where (as in the original
+  list-based version) the flow through a node is split evenly among
+  its predecessors and added to the link in both directions. If
+  nodeBet2 (linkBet2) != NULL, it gets the sum over sources of the
+  squared contribution of each source, as needed to estimate
+  confidence intervals when sources are sampled.
+  ---------------------------------------------------------------------
+*/
+static void
+BetweennessSources(struct node_csr *csr, int *src, int nsrc,
+		   double *nodeBet, double *nodeBet2,
+		   double *linkBet, double *linkBet2)
+{
+  int nnod = csr->nnod, nlink = csr->nlink;
+  int *pidx;
+  int i, e;
+
+  if (src == NULL)
+    nsrc = nnod;
+
+  /* A node cannot have more predecessors than incoming adjacencies */
+  pidx = allocate_i_vec(nnod + 1);
+  for (i=0; i<=nnod; i++)
+    pidx[i] = 0;
+  for (e=0; e<nlink; e++)
+    pidx[csr->neig[e] + 1]++;
+  for (i=0; i<nnod; i++)
+    pidx[i+1] += pidx[i];
+
+#pragma omp parallel private(i, e)
+  {
+    struct brandes_ws *ws = CreateBrandesWS(csr, pidx);
+    double *locNode = NULL, *locLink = NULL;
+    double *locNode2 = NULL, *locLink2 = NULL;
+    int si, s, v, w, j, k, nreached;
+    double c;
+
+    if (nodeBet != NULL)
+      locNode = (double *)calloc(nnod + 1, sizeof(double));
+    if (nodeBet2 != NULL)
+      locNode2 = (double *)calloc(nnod + 1, sizeof(double));
+    if (linkBet != NULL)
+      locLink = (double *)calloc(nlink + 1, sizeof(double));
+    if (linkBet2 != NULL)
+      locLink2 = (double *)calloc(nlink + 1, sizeof(double));
+
+#pragma omp for schedule(dynamic, 16)
+    for (si=0; si<nsrc; si++) {
+      s = (src == NULL) ? si : src[si];
+      nreached = BrandesForward(csr, s, ws);
+
+      /* Nodes in order of non-increasing distance from s (the source
+	 itself, at position 0, has no predecessors) */
+      for (j=nreached-1; j>0; j--) {
+	w = ws->order[j];
+	for (k=pidx[w]; k<pidx[w]+ws->npred[w]; k++) {
+	  v = ws->predNode[k];
+	  if (locNode != NULL)
+	    ws->delta[v] += (1. + ws->delta[w]) * ws->sigma[v] / ws->sigma[w];
+	  if (locLink != NULL) {
+	    /* Each adjacency is the predecessor link of at most one
+	       node per source, so c is its whole contribution */
+	    c = ws->flow[w] / (double)ws->npred[w];
+	    ws->flow[v] += c;
+	    e = ws->predLink[k];
+	    locLink[e] += c;
+	    if (locLink2 != NULL)
+	      locLink2[e] += c * c;
+	    if (csr->rev[e] >= 0) {
+	      locLink[csr->rev[e]] += c;
+	      if (locLink2 != NULL)
+		locLink2[csr->rev[e]] += c * c;
+	    }
+	  }
+	}
+	if (locNode != NULL)
+	  locNode[w] += ws->delta[w];
+	if (locNode2 != NULL)
+	  locNode2[w] += ws->delta[w] * ws->delta[w];
+      }
+
+      BrandesReset(ws, nreached);
     }
+
+#pragma omp critical
+    {
+      if (locNode != NULL)
+	for (i=0; i<nnod; i++)
+	  nodeBet[i] += locNode[i];
+      if (locNode2 != NULL)
+	for (i=0; i<nnod; i++)
+	  nodeBet2[i] += locNode2[i];
+      if (locLink != NULL)
+	for (e=0; e<nlink; e++)
+	  linkBet[e] += locLink[e];
+      if (locLink2 != NULL)
+	for (e=0; e<nlink; e++)
+	  linkBet2[e] += locLink2[e];
+    }
+
+    free(locNode);
+    free(locNode2);
+    free(locLink);
+    free(locLink2);
+    FreeBrandesWS(ws);
   }
-  
-  big = ((root->next)->neig)->next;
-  p = root;
-  while(p->next != NULL){
-    counter++;
-    d = 0;
-    ResetNodesState(root);
-    p = p->next;
 
-    Enqueue(p,list,list,size,0); //ATENCIO!! Posem el header com a
-				 //predecessor del primer!!!!!
-    lp = list;
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      d++;
-    }while(*size !=  size_ant);
+  free_i_vec(pidx);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Half-width of the empirical Bernstein confidence interval (Maurer &
+  Pontil, 2009) for the mean of a population of npop values in [0,
+  range], estimated from k of them, given the sum and sum of squares
+  of the sample. The interval holds with probability 1 - delta
+  whatever the distribution of the values (it is conservative when
+  sampling without replacement).
+  ---------------------------------------------------------------------
+*/
+static double
+SampleMeanHalfWidth(double sum, double sum2, int k, int npop,
+		    double range, double delta)
+{
+  double m, var, lg;
+
+  if (k >= npop)
+    return 0.0;
+  if (k < 2)
+    return range;
+  m = sum / (double)k;
+  var = (sum2 - k * m * m) / (double)(k - 1);
+  if (var < 0.0)
+    var = 0.0;
+  lg = log(4.0 / delta);  // two-sided
+  return sqrt(2.0 * var * lg / (double)k) + 7.0 * range * lg / (3.0 * (k - 1));
+}
+
+/*
+  ---------------------------------------------------------------------
+  Sampled betweenness engine. Sources are drawn uniformly without
+  replacement and the accumulated betweenness is rescaled by
+  nnod/k. If nsources > 0, exactly nsources sources are used;
+  otherwise, the sample is doubled until the confidence intervals of
+  all nelem quantities (nodes or adjacencies) have half-width below
+  eps * nnod * (nnod-1), that is, eps on the scale of betweennesses
+  normalized by the number of ordered pairs. Intervals hold jointly
+  with probability 1 - delta (Bonferroni correction over the nelem
+  quantities and, in the adaptive case, over the rounds: round r
+  spends delta / 2^(r+1) of the error budget). These are
+  distribution-free bounds, so certifying a small eps takes many
+  sources. Stores the estimates in bet and the
+  half-widths in ci (if not NULL), and returns the number of sources
+  used.
+  ---------------------------------------------------------------------
+*/
+static int
+SampledBetweenness(struct node_csr *csr, int nsources,
+		   double eps, double delta, gsl_rng *gen,
+		   int links, double *bet, double *ci)
+{
+  int nnod = csr->nnod;
+  int nelem = links ? csr->nlink : csr->nnod;
+  int *src;
+  double *bet2;
+  double range, hw, maxhw, target, rdelta;
+  int i, j, t, k, batch;
+
+  /* Random order of the sources */
+  src = allocate_i_vec(nnod + 1);
+  for (i=0; i<nnod; i++)
+    src[i] = i;
+  for (i=nnod-1; i>0; i--) {
+    j = floor(gsl_rng_uniform(gen) * (double)(i + 1));
+    t = src[i];
+    src[i] = src[j];
+    src[j] = t;
+  }
 
-    //Actualize the betweenness
-    for(i = 0;i<nnod;i++){
-      bet_loc[i] = (double)ocupacio[i];
+  bet2 = allocate_d_vec(nelem + 1);
+  for (i=0; i<nelem; i++)
+    bet[i] = bet2[i] = 0.0;
+
+  /* The contribution of one source to any node or link is at most
+     the number of other nodes */
+  range = (double)(nnod - 1);
+  target = eps * (double)nnod * (double)(nnod - 1);
+
+  k = 0;
+  batch = (nsources > 0) ? nsources : 64;
+  rdelta = (nsources > 0) ? delta : delta / 2.0;
+  do {
+    if (k > 0)
+      rdelta /= 2.0;  // error budget of this round
+    if (k + batch > nnod)
+      batch = nnod - k;
+    if (links)
+      BetweennessSources(csr, &src[k], batch, NULL, NULL, bet, bet2);
+    else
+      BetweennessSources(csr, &src[k], batch, bet, bet2, NULL, NULL);
+    k += batch;
+    batch = k;  // double the sample at each step
+
+    /* Worst confidence interval */
+    maxhw = 0.0;
+    for (i=0; i<nelem; i++) {
+      hw = SampleMeanHalfWidth(bet[i], bet2[i], k, nnod, range,
+			       rdelta / (double)nelem);
+      if (hw > maxhw)
+	maxhw = hw;
     }
-    
-    lp = list->last;
-    while((n_pred = CountPredecessors(lp)) != 0){
-      ppre = lp->pred;
-      while(ppre != NULL){
-	bet_loc[((ppre->ref)->ref)->num] +=
-	  bet_loc[(lp->ref)->num]/(double)n_pred;
-	
-	tar = ((lp->ref)->neig)->next;
-	while((tar->node) != ((ppre->ref)->ref)->num)
-	  tar = tar->next;
-	tar->btw += bet_loc[(lp->ref)->num]/(double)n_pred;
-	if(big ==  NULL || tar->btw > big->btw){
-	  big = tar;
-	  *n2 = (lp->ref)->num;
-	  *n1 = ((ppre->ref)->ref)->num;
-	}
+    maxhw *= (double)nnod;
+  } while (nsources <= 0 && maxhw > target && k < nnod);
+
+  /* Rescale estimates and half-widths to total betweenness */
+  for (i=0; i<nelem; i++) {
+    if (ci != NULL)
+      ci[i] = (double)nnod * SampleMeanHalfWidth(bet[i], bet2[i], k, nnod,
+						 range, rdelta / (double)nelem);
+    bet[i] *= (double)nnod / (double)k;
+  }
 
-	tar = (((ppre->ref)->ref)->neig)->next;
-	while((tar->node) != (lp->ref)->num)
-	  tar = tar->next;
-	tar->btw += bet_loc[(lp->ref)->num]/(double)n_pred;
+  free_i_vec(src);
+  free_d_vec(bet2);
+  return k;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Calculates the betweenness of each link and stores in the btw field
+  of the node_lis
+  ---------------------------------------------------------------------
+*/
+void
+CalculateLinkBetweenness(struct node_gra *root)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  double *linkBet = allocate_d_vec(csr->nlink + 1);
+  int e;
+
+  for (e=0; e<csr->nlink; e++)
+    linkBet[e] = 0.0;
+  BetweennessSources(csr, NULL, 0, NULL, NULL, linkBet, NULL);
+  for (e=0; e<csr->nlink; e++)
+    csr->lis[e]->btw = linkBet[e];
+
+  free_d_vec(linkBet);
+  FreeNodeCSR(csr);
+}
 
-	ppre = ppre->next;
+// ---------------------------------------------------------------------
+// Calculates the betweenness of each link and writes in n1 and n2 the
+// nodes corresponding to the largest betweenness in the network.
+// ---------------------------------------------------------------------
+void
+CalculateBiggestLinkBetweenness(struct node_gra *root,int *n1,int *n2)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  double *linkBet = allocate_d_vec(csr->nlink + 1);
+  double big = -1.0;
+  int i, e;
+
+  for (e=0; e<csr->nlink; e++)
+    linkBet[e] = 0.0;
+  BetweennessSources(csr, NULL, 0, NULL, NULL, linkBet, NULL);
+  for (i=0; i<csr->nnod; i++) {
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++) {
+      csr->lis[e]->btw = linkBet[e];
+      if (linkBet[e] > big) {
+	big = linkBet[e];
+	*n2 = i;
+	*n1 = csr->neig[e];
       }
-      lp = lp->prev;
     }
- 
-    ClearList(list,size);
   }
 
-  free_i_vec(ocupacio);
-  free_d_vec(bet_loc);
-  free(list);
+  free_d_vec(linkBet);
+  FreeNodeCSR(csr);
 }
 
 /*
   ----------------------------------------------------------------------------
   Calculates the betweenness of all nodes in a network. Results are
-  stored in the dvar1 attribute of each node. The algorithm is
-  directly taken from the pseudo-code in Algorithm 1 of the paper "A
-  faster algorithm for betweenness centrality," by Ulrik Brandes.
+  stored in the dvar1 attribute of each node. The algorithm is that
+  in Algorithm 1 of the paper "A faster algorithm for betweenness
+  centrality," by Ulrik Brandes, run over a CSR snapshot of the
+  network with one reusable workspace per thread.
   ----------------------------------------------------------------------------
 */
 void
 CalculateNodeBetweenness(struct node_gra *net)
 {
-  struct node_gra *nodep, *s, *v, *w;
-  struct node_lis *wp;
-  struct stack *S;
-  struct queue *Q;
-  struct queue **P;
-  int *sigma, *d;
-  double *delta;
-  int nnod = CountNodes(net);
+  struct node_csr *csr = BuildNodeCSR(net);
+  double *nodeBet = allocate_d_vec(csr->nnod + 1);
   int i;
 
-  /* Reset dvar1 to 0 for all nodes */
-  nodep = net;
-  while ((nodep = nodep->next) != NULL)
-    nodep->dvar1 = 0.0;
-
-  /* Brandes algorithm */
-  s = net;
-  while ((s = s->next) != NULL) {
-    S = stack_create();
-    P = (struct queue **)calloc(nnod, sizeof(struct queue *));
-    sigma = allocate_i_vec(nnod);
-    d = allocate_i_vec(nnod);
-    delta = allocate_d_vec(nnod);
-    Q = queue_create();
-    for (i=0; i<nnod; i++) {
-      P[i] = queue_create();
-      sigma[i] = 0;
-      d[i] = -1;
-      delta[i] = 0.0;
-    }
-    sigma[s->num] = 1;
-    d[s->num] = 0;
-    queue_enqueue(Q, (void *)s);
-    while (!queue_empty(Q)) {
-      v = (struct node_gra *)queue_dequeue(Q);
-      stack_push(S, (void *)v);
-      wp = v->neig;
-      while ((wp = wp->next) != NULL) {
-	w = wp->ref;
-	/* w found for the first time? */
-	if (d[w->num] < 0) {
-	  queue_enqueue(Q, (void *)w);
-	  d[w->num] = d[v->num] + 1;
-	}
-	/* Shortest path to w via v? */
-	if (d[w->num] == d[v->num] + 1) {
-	  sigma[w->num] = sigma[w->num] + sigma[v->num];
-	  queue_enqueue(P[w->num], (void *)v);
-	}
-      }
-    }
+  for (i=0; i<csr->nnod; i++)
+    nodeBet[i] = 0.0;
+  BetweennessSources(csr, NULL, 0, nodeBet, NULL, NULL, NULL);
+  for (i=0; i<csr->nnod; i++)
+    csr->node[i]->dvar1 = nodeBet[i];
 
-    /* S returns vertices in order of non-increasing distance from s */
-    while (!stack_empty(S)) {
-      w = (struct node_gra *)stack_pop(S);
-      while (!queue_empty(P[w->num])) {
-	v = (struct node_gra *)queue_dequeue(P[w->num]);
-	delta[v->num] += (1. + delta[w->num]) * sigma[v->num] / sigma[w->num];
-      }
-      if (w->num != s->num)
-	w->dvar1 += delta[w->num];
-    }
+  free_d_vec(nodeBet);
+  FreeNodeCSR(csr);
+}
 
-    /* Free all memory */
-    stack_free(S);
-    for (i=0; i<nnod; i++) {
-      queue_free(P[i]);
-    }
-    free(P);
-    free_i_vec(sigma);
-    free_i_vec(d);
-    free_d_vec(delta);
-    queue_free(Q);
+/*
+  ---------------------------------------------------------------------
+  Approximate node betweenness from a sample of sources: nsources
+  sources drawn uniformly if nsources > 0, or as many as needed to
+  estimate all betweennesses within eps * N * (N-1) with probability
+  1 - delta otherwise. Estimates are stored in the dvar1 attribute of
+  each node and, if ci != NULL, ci[num] gets the half-width of the
+  confidence interval of each node. Returns the number of sources
+  used.
+  ---------------------------------------------------------------------
+*/
+int
+CalculateNodeBetweennessSampled(struct node_gra *net,
+				int nsources,
+				double eps,
+				double delta,
+				gsl_rng *gen,
+				double *ci)
+{
+  struct node_csr *csr = BuildNodeCSR(net);
+  double *nodeBet = allocate_d_vec(csr->nnod + 1);
+  int i, k;
+
+  k = SampledBetweenness(csr, nsources, eps, delta, gen, 0, nodeBet, ci);
+  for (i=0; i<csr->nnod; i++)
+    csr->node[i]->dvar1 = nodeBet[i];
+
+  free_d_vec(nodeBet);
+  FreeNodeCSR(csr);
+  return k;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Same as CalculateNodeBetweennessSampled, but for the betweenness of
+  links, which is stored in the btw field of the node_lis. If maxCI
+  != NULL, it gets the largest half-width of the confidence intervals
+  of all links.
+  ---------------------------------------------------------------------
+*/
+int
+CalculateLinkBetweennessSampled(struct node_gra *root,
+				int nsources,
+				double eps,
+				double delta,
+				gsl_rng *gen,
+				double *maxCI)
+{
+  struct node_csr *csr = BuildNodeCSR(root);
+  double *linkBet = allocate_d_vec(csr->nlink + 1);
+  double *ci = allocate_d_vec(csr->nlink + 1);
+  int e, k;
+
+  k = SampledBetweenness(csr, nsources, eps, delta, gen, 1, linkBet, ci);
+  if (maxCI != NULL)
+    *maxCI = 0.0;
+  for (e=0; e<csr->nlink; e++) {
+    csr->lis[e]->btw = linkBet[e];
+    if (maxCI != NULL && ci[e] > *maxCI)
+      *maxCI = ci[e];
   }
+
+  free_d_vec(linkBet);
+  free_d_vec(ci);
+  FreeNodeCSR(csr);
+  return k;
 }
 
 /*
@@ -2358,6 +3504,54 @@ NodeBetweennessStatistics(struct node_gra *net,
   return;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Same as NodeBetweennessStatistics, but from sampled betweennesses
+  (see CalculateNodeBetweennessSampled). theCI gets the largest
+  half-width of the confidence intervals of the nodes; since all
+  intervals hold simultaneously, it also bounds the error of the
+  mean, std dev, min, and max. Returns the number of sources used.
+  ---------------------------------------------------------------------
+*/
+int
+NodeBetweennessStatisticsSampled(struct node_gra *net,
+				 int nsources,
+				 double eps,
+				 double delta,
+				 gsl_rng *gen,
+				 double *theMean,
+				 double *theStddev,
+				 double *theMin,
+				 double *theMax,
+				 double *theCI)
+{
+  int nnod = CountNodes(net);
+  double *betws = NULL, *ci = NULL;
+  struct node_gra *p = net;
+  int k;
+
+  /* Allocate memory */
+  betws = allocate_d_vec(nnod);
+  ci = allocate_d_vec(nnod);
+
+  /* Get betweennesses */
+  k = CalculateNodeBetweennessSampled(net, nsources, eps, delta, gen, ci);
+  while ((p = p->next) != NULL)
+    betws[p->num] = p->dvar1;
+
+  /* Get the statistical properties */
+  (*theMean) = mean(betws, nnod);
+  (*theStddev) = stddev(betws, nnod);
+  (*theMin) = min(betws, nnod);
+  (*theMax) = max(betws, nnod);
+  (*theCI) = max(ci, nnod);
+
+  /* Free memory and return */
+  free_d_vec(betws);
+  free_d_vec(ci);
+  return k;
+}
+
 // ---------------------------------------------------------------------
 // Calculates the assortativity of a network
 // ---------------------------------------------------------------------
@@ -2432,539 +3626,391 @@ CalculateKnn(struct node_gra *node)
 int
 IsGraphConnected(struct node_gra *p)
 {
-  struct node_bfs *list,*lp;
-  int *size,r1;
-  int size_ant;
-  int d;
-  int N = CountNodes(p);
+  struct ring_queue *queue;
+  struct node_gra *node;
+  struct node_lis *l;
+  int N = CountNodes(p), reached = 0;
 
-  r1 = 0;
-  size = &r1;
+  if (N == 0)
+    return 1;
 
   ResetNodesState(p);
-  p = p->next;
-  list = CreateHeaderList();
-
-  Enqueue(p,list,list,size,0);
-  lp = list;
-  d = 0;
-  do{
-    size_ant = *size;
-    lp = RenewQueue(list,lp,size,d);
-    d++;
-  }while(*size != size_ant);
-
-  ClearList(list,size);
-
-  free(list);
+  queue = ring_queue_create(N);
+  p->next->state = 1;
+  ring_queue_enqueue(queue, p->next);
+  while (!ring_queue_empty(queue)) {
+    node = (struct node_gra *)ring_queue_dequeue(queue);
+    reached++;
+    l = node->neig;
+    while ((l = l->next) != NULL) {
+      if (l->ref->state == 0) {
+	l->ref->state = 1;
+	ring_queue_enqueue(queue, l->ref);
+      }
+    }
+  }
+  ring_queue_free(queue);
 
-  if(size_ant == N)
+  if(reached == N)
     return 1;
   else
     return 0;
 }
 
 // ---------------------------------------------------------------------
-// ???????????
+// Returns 1 if there is a path from node n1 to any (other) node i
+// with cluslis[i] == 1, and 0 otherwise.
 // ---------------------------------------------------------------------
 int
 AreConnectedList(struct node_gra *root,
 		 struct node_gra *n1,
 		 int cluslis[])
 {
-  struct node_bfs *list,*lp,*lp2;
-  int *size,res1;
-  int size_ant;
-  int d;
-  
-  res1 = 0;
-  size = &res1;
-
-  list = CreateHeaderList();
+  struct ring_queue *queue;
+  struct node_gra *node;
+  struct node_lis *l;
+  int found = 0;
 
-  d = 0;
   ResetNodesState(root);
-  Enqueue(n1,list,list,size,d); //ATENCIO!! Posem el header com a
-				//predecessor del primer!!!!!
-  lp = list;
-  do{
-    size_ant = *size;
-    lp = RenewQueue(list,lp,size,d);
-    d++;
-    lp2 = lp;
-    while(lp2->next != NULL){
-      lp2 = lp2->next;
-      if(cluslis[(lp2->ref)->num] == 1){
-	ClearList(list,size);
-	free(list);
-	return 1;
+  queue = ring_queue_create(CountNodes(root));
+  n1->state = 1;
+  ring_queue_enqueue(queue, n1);
+  while (!found && !ring_queue_empty(queue)) {
+    node = (struct node_gra *)ring_queue_dequeue(queue);
+    l = node->neig;
+    while ((l = l->next) != NULL) {
+      if (l->ref->state == 0) {
+	if (cluslis[l->ref->num] == 1) {
+	  found = 1;
+	  break;
+	}
+	l->ref->state = 1;
+	ring_queue_enqueue(queue, l->ref);
       }
     }
-  }while(*size != size_ant);
-  
-  ClearList(list,size);
-  free(list);
-  return 0;
+  }
+  ring_queue_free(queue);
+
+  return found;
 }
 
 // ---------------------------------------------------------------------
-// Counts the number of strongly connected sets in the network
+// Find the root of the set of node i (with path halving)
 // ---------------------------------------------------------------------
-int
-CountStronglyConnectedSets(struct node_gra *root)
+static int
+UnionFindRoot(int *parent, int i)
 {
-  struct node_gra *root_cop = NULL;
-  struct node_gra *p;
-  struct node_bfs *list,*lp,*lp2;
-  int nnod = CountNodes(root);
-  int anod = 0;
-  int *size,res1;
-  int *selected;
-  int *this_net;
-  int i;
-  int size_ant;
-  int d;
-  int nclus = 0;
-
-  selected = allocate_i_vec(nnod);
-  this_net = allocate_i_vec(nnod);
-
-  for(i = 0;i<nnod;i++)
-    selected[i] = 0;
-  
-  root_cop = CopyNetwork(root);
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
 
-  res1 = 0;
-  size = &res1;
+// ---------------------------------------------------------------------
+// Relabel the (arbitrary) component ids in comp[] as 0..ncomp-1, in
+// order of appearance, and count the size of each component. Returns
+// the sizes (an array of ncomp integers to be freed by the caller).
+// ---------------------------------------------------------------------
+static int *
+RelabelComponents(int nnod, int *comp, int ncomp)
+{
+  int *newid, *size;
+  int i, c = 0;
+
+  newid = allocate_i_vec(nnod + 1);
+  size = allocate_i_vec(ncomp + 1);
+  for (i=0; i<nnod; i++)
+    newid[i] = -1;
+  for (i=0; i<ncomp; i++)
+    size[i] = 0;
+  for (i=0; i<nnod; i++) {
+    if (newid[comp[i]] < 0)
+      newid[comp[i]] = c++;
+    comp[i] = newid[comp[i]];
+    size[comp[i]]++;
+  }
 
-  list = CreateHeaderList();
+  free_i_vec(newid);
+  return size;
+}
 
-  do{
-    p = root->next;
-    while(selected[p->num] != 0)
-      p = p->next;
-    selected[p->num] = 1;
+/*
+  ---------------------------------------------------------------------
+  Weakly connected components of the network (links are taken as
+  undirected), found with union-find in O(N+E). On return comp[num]
+  is the component of each node, numbered 0..ncomp-1 in order of
+  appearance in the network, and *size points to an array with the
+  number of nodes in each component (to be freed with free_i_vec).
+  Returns the number of components ncomp.
+  ---------------------------------------------------------------------
+*/
+int
+WeaklyConnectedComponents(struct node_gra *root, int *comp, int **size)
+{
+  struct node_gra *p = root;
+  struct node_lis *l;
+  int nnod = CountNodes(root);
+  int *parent = allocate_i_vec(nnod + 1);
+  int i, r1, r2, ncomp = nnod;
 
-    for(i = 0;i<nnod;i++)
-      this_net[i] = 0;
-    d = 0;
+  for (i=0; i<nnod; i++) {
+    parent[i] = i;
+    comp[i] = 1;    // use comp to store the set sizes
+  }
 
-    ResetNodesState(root);
-    Enqueue(p,list,list,size,d);
-    anod++;
-    lp = list;
-    this_net[p->num] = 1;
-    
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      lp2 = lp;
-      while(lp2->next !=  NULL){
-	if(AreConnectedList(root_cop,GetNode(((lp2->next)->ref)->num,root_cop),this_net) == 0){
-	  DequeueOne(list,lp2,size);
-	}
-	else{
-	  this_net[((lp2->next)->ref)->num] = 1;
-	  selected[((lp2->next)->ref)->num] = 1;
-	  anod++;
-	  lp2 = lp2->next;
+  while ((p = p->next) != NULL) {
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      r1 = UnionFindRoot(parent, p->num);
+      r2 = UnionFindRoot(parent, l->ref->num);
+      if (r1 != r2) {
+	if (comp[r1] < comp[r2]) {
+	  i = r1;
+	  r1 = r2;
+	  r2 = i;
 	}
+	parent[r2] = r1;
+	comp[r1] += comp[r2];
+	ncomp--;
       }
-      d++;
-    }while(*size !=  size_ant);
-
-    ClearList(list,size);
-
-    nclus++;
-
-  }while(anod<nnod);
+    }
+  }
 
-  free(list);
-  RemoveGraph(root_cop);
+  for (i=0; i<nnod; i++)
+    comp[i] = UnionFindRoot(parent, i);
+  free_i_vec(parent);
 
-  free_i_vec(selected);
-  free_i_vec(this_net);
-  return nclus;
+  *size = RelabelComponents(nnod, comp, ncomp);
+  return ncomp;
 }
 
 /*
   ---------------------------------------------------------------------
-  Creates a network that contains only the giant component of root
+  Strongly connected components of the network (nodes that can reach
+  each other following links in their direction), found with an
+  iterative version of Tarjan's algorithm in O(N+E). Same output as
+  WeaklyConnectedComponents, to which it is equivalent for symmetric
+  networks.
   ---------------------------------------------------------------------
 */
-struct node_gra *
-GetLargestStronglyConnectedSet(struct node_gra *root,
-			       int thres)
+int
+StronglyConnectedComponents(struct node_gra *root, int *comp, int **size)
 {
-  struct node_gra *root_cop=NULL;
-  struct node_gra *root_loc=NULL;
-  struct node_gra *p;
-  struct node_gra *temp;
-  struct node_bfs *list, *lp, *lp2;
-  int nnod=CountNodes(root);
-  int anod=0;
-  int *size, res1;
-  int *selected;
-  int *this_net;
-  int i;
-  int size_ant;
-  int d;
-  int maxS = 0;
-  struct node_gra *giant = NULL;
-
-  selected = allocate_i_vec(nnod);
-  this_net = allocate_i_vec(nnod);
-
-  for(i = 0;i<nnod;i++)
-    selected[i] = 0;
-  
-  root_cop = CopyNetwork(root);
-
-  res1 = 0;
-  size = &res1;
-
-  list = CreateHeaderList();
+  struct node_csr *csr = BuildNodeCSR(root);
+  int nnod = csr->nnod;
+  int *index, *low, *stack, *call, *pos;
+  int nstack = 0, ncall, counter = 0, ncomp = 0;
+  int s, v, w, e;
+
+  index = allocate_i_vec(nnod + 1);
+  low = allocate_i_vec(nnod + 1);
+  stack = allocate_i_vec(nnod + 1);
+  call = allocate_i_vec(nnod + 1);
+  pos = allocate_i_vec(nnod + 1);
+  for (v=0; v<nnod; v++) {
+    index[v] = -1;
+    comp[v] = -1;
+  }
 
-  do{
-    root_loc = CreateHeaderGraph();
-    p = root->next;
-    while(selected[p->num] != 0)
-      p = p->next;
-    selected[p->num] = 1;
-
-    for(i = 0;i<nnod;i++)
-      this_net[i] = 0;
-    d = 0;
-
-    ResetNodesState(root);
-    Enqueue(p, list, list, size, d);
-    anod++;
-    lp = list;
-    temp = CreateNodeGraph(root_loc, p->label);
-    temp->num = p->num;
-    CopyAdjacencyList(p, temp);
-    this_net[p->num] = 1;
-    
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list, lp, size, d);
-      lp2 = lp;
-      while(lp2->next != NULL){
-	if(AreConnectedList(root_cop,
-			    GetNode(((lp2->next)->ref)->num, root_cop),
-			    this_net) == 0){
-	  DequeueOne(list, lp2, size);
+  for (s=0; s<nnod; s++) {
+    if (index[s] >= 0)
+      continue;
+
+    /* Depth-first search from s; call[] holds the path from s and
+       pos[v] the next adjacency of v to explore */
+    index[s] = low[s] = counter++;
+    stack[nstack++] = s;
+    call[0] = s;
+    pos[s] = csr->idx[s];
+    ncall = 1;
+    while (ncall > 0) {
+      v = call[ncall - 1];
+      if (pos[v] < csr->idx[v+1]) {
+	e = pos[v]++;
+	w = csr->neig[e];
+	if (index[w] < 0) {
+	  index[w] = low[w] = counter++;
+	  stack[nstack++] = w;
+	  pos[w] = csr->idx[w];
+	  call[ncall++] = w;
 	}
-	else{
-	  temp = CreateNodeGraph(root_loc,((lp2->next)->ref)->label);
-	  temp->num = lp2->next->ref->num;
-	  CopyAdjacencyList(GetNode(((lp2->next)->ref)->num,root),temp);
-	  this_net[temp->num] = 1;
-	  selected[temp->num] = 1;
-	  anod++;
-	  lp2 = lp2->next;
+	else if (comp[w] < 0 && index[w] < low[v]) {
+	  low[v] = index[w];  // w is still on the stack
 	}
       }
-      d++;
-    }while(*size != size_ant);
-
-    CleanAdjacencies(root_loc);
-    RewireAdjacencyByLabel(root_loc);
-    RenumberNodes(root_loc);
-
-    if (CountNodes(root_loc) > maxS) {
-      maxS = CountNodes(root_loc);
-      if (giant !=  NULL) {
-	RemoveGraph(giant);
-      }
-      giant = root_loc;
-      if (maxS > nnod/2 || maxS > thres) {
-	ClearList(list, size);
-	RemoveGraph(root_cop); // WAS COMMENTED OUT?!?!?!?!
-	return giant;
+      else {
+	ncall--;
+	if (low[v] == index[v]) {
+	  do {
+	    w = stack[--nstack];
+	    comp[w] = ncomp;
+	  } while (w != v);
+	  ncomp++;
+	}
+	if (ncall > 0 && low[v] < low[call[ncall - 1]])
+	  low[call[ncall - 1]] = low[v];
       }
     }
-    else
-      RemoveGraph(root_loc);
-
-    ClearList(list,size);
-    
-  }while(anod<nnod);
-
-  RemoveGraph(root_cop);
+  }
 
-  free(list);
-  free_i_vec(selected);
-  free_i_vec(this_net);
+  free_i_vec(index);
+  free_i_vec(low);
+  free_i_vec(stack);
+  free_i_vec(call);
+  free_i_vec(pos);
+  FreeNodeCSR(csr);
 
-  return giant;
+  *size = RelabelComponents(nnod, comp, ncomp);
+  return ncomp;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Creates a network with the nodes of root that belong to component c
+  (comp[num] == c, as returned by WeaklyConnectedComponents or
+  StronglyConnectedComponents) and the links between them. Nodes keep
+  their num, state and other properties.
+  ---------------------------------------------------------------------
+*/
 struct node_gra *
-GetLargestWeaklyConnectedSet(struct node_gra *root,int thres)
+ExtractComponent(struct node_gra *root, int *comp, int c)
 {
-  struct node_gra *root_cop = NULL;
-  struct node_gra *root_loc = NULL;
-  struct node_gra *p, *p3;
-  struct node_gra *temp;
-  struct node_bfs *list,*lp,*lp2;
-  int nnod=CountNodes(root);
-  int anod=0;
-  int *size, res1;
-  int *selected;
-  int *this_net;
-  int i;
-  int size_ant;
-  int d;
-  int maxS = 0;
-  struct node_gra *giant = NULL;
-
-  selected = allocate_i_vec(nnod);
-  this_net = allocate_i_vec(nnod);
-
-  for(i = 0;i<nnod;i++)
-    selected[i] = 0;
-  
-  root_cop = CopyNetwork(root);
+  struct node_gra *root2, *p = root, *p2, *last;
+  struct node_gra **map;
+  struct node_lis *l, *adja;
+  int nnod = CountNodes(root);
 
-  res1 = 0;
-  size = &res1;
+  map = (struct node_gra **)calloc(nnod + 1, sizeof(struct node_gra *));
 
-  list = CreateHeaderList();
-  
-  // Reachable from p
-  do{
-    root_loc = CreateHeaderGraph();
-    p = root->next;
+  /* Copy the nodes */
+  root2 = CreateHeaderGraph();
+  last = root2;
+  while ((p = p->next) != NULL) {
+    if (comp[p->num] == c) {
+      p2 = CreateNodeGraph(last, p->label);
+      p2->num = p->num;
+      p2->coorX = p->coorX;
+      p2->coorY = p->coorY;
+      p2->coorZ = p->coorZ;
+      p2->state = p->state;
+      p2->ivar1 = p->ivar1;
+      p2->inGroup = p->inGroup;
+      p2->dvar1 = p->dvar1;
+      map[p->num] = p2;
+      last = p2;
+    }
+  }
 
-    while(selected[p->num] != 0)
-      p = p->next;
-    selected[p->num] = 1;
-
-    for(i = 0;i<nnod;i++)
-      this_net[i] = 0;
-    d = 0;
-
-    ResetNodesState(root);
-    Enqueue(p,list,list,size,d);
-    anod++;
-    lp = list;
-    temp = CreateNodeGraph(root_loc, p->label);
-    temp->num = p->num;
-    CopyAdjacencyList(p,temp);
-    this_net[p->num] = 1;
-    
-    do{
-      size_ant = *size;
-      lp = RenewQueue(list,lp,size,d);
-      lp2 = lp;
-      while(lp2->next != NULL){
-	temp = CreateNodeGraph(root_loc,((lp2->next)->ref)->label);
-	temp->num = lp2->next->ref->num;
-	CopyAdjacencyList(GetNode(((lp2->next)->ref)->num,root),temp);
-	this_net[temp->num] = 1;
-	selected[temp->num] = 1;
-	anod++;
-	lp2 = lp2->next;
-      }
-      d++;
-    }while(*size != size_ant);
-
-    // Nodes that enable one to reach any node reachable from p
-    p3 = p;
-
-    while (p3->next != NULL){
-      p3 = p3->next;
-
-      if ((AreConnectedList(root_cop,GetNode(p3->num,root_cop),this_net) == 1)
-	  && (selected[p3->num] == 0)) {
-
-	temp = CreateNodeGraph(root_loc, p3->label);
-	temp->num = p3->num;
-	CopyAdjacencyList(p3, temp);
-	this_net[temp->num] = 1;
-	selected[temp->num] = 1;
-	anod++;
-	
-	Enqueue(p3,list,list,size,d);
-
-	do{
-	  size_ant = *size;
-	  lp = RenewQueue(list,lp,size,d);
-	  lp2 = lp;
-	  while(lp2->next != NULL){
-	    temp = CreateNodeGraph(root_loc,((lp2->next)->ref)->label);
-	    temp->num = lp2->next->ref->num;
-	    CopyAdjacencyList(GetNode(((lp2->next)->ref)->num,root),temp);
-	    this_net[temp->num] = 1;
-	    selected[temp->num] = 1;
-	    anod++;
-	    lp2 = lp2->next;
-	  }
-	  d++;
-	}while(*size != size_ant);
+  /* Copy the links within the component */
+  p = root;
+  while ((p = p->next) != NULL) {
+    if (comp[p->num] != c)
+      continue;
+    adja = map[p->num]->neig;
+    l = p->neig;
+    while ((l = l->next) != NULL)
+      if (comp[l->ref->num] == c)
+	adja = AppendAdjacency(adja, map[l->ref->num], l->weight, l->status);
+  }
 
-      }
-    }
+  free(map);
+  return root2;
+}
 
-    // Rewire the cluster
-    CleanAdjacencies(root_loc);
-    RewireAdjacencyByLabel(root_loc);
-    RenumberNodes(root_loc);
+// ---------------------------------------------------------------------
+// Returns the largest of ncomp components (the first one in case of
+// ties)
+// ---------------------------------------------------------------------
+static int
+LargestComponent(int ncomp, int *size)
+{
+  int c, cmax = 0;
 
-    // Check if this is the largest component
-    if(CountNodes(root_loc)>maxS){
-      maxS = CountNodes(root_loc);
-      if (giant !=  NULL){
-	RemoveGraph(giant);
-      }
-      giant = root_loc;
-      if(maxS>nnod/2 || maxS>thres ){
-	ClearList(list,size);
-/* 	RemoveGraph(root_cop); */
-	return giant;
-      }
-    }
-    else
-      RemoveGraph(root_loc);
+  for (c=1; c<ncomp; c++)
+    if (size[c] > size[cmax])
+      cmax = c;
+  return cmax;
+}
 
-    ClearList(list,size);
+// ---------------------------------------------------------------------
+// Counts the number of strongly connected sets in the network
+// ---------------------------------------------------------------------
+int
+CountStronglyConnectedSets(struct node_gra *root)
+{
+  int *comp = allocate_i_vec(CountNodes(root) + 1);
+  int *size;
+  int ncomp;
 
-  }while(anod<nnod);
+  ncomp = StronglyConnectedComponents(root, comp, &size);
 
-  RemoveGraph(root_cop);
+  free_i_vec(comp);
+  free_i_vec(size);
+  return ncomp;
+}
 
-  free(list);
-  free_i_vec(selected);
-  free_i_vec(this_net);
+/*
+  ---------------------------------------------------------------------
+  Creates a network that contains only the giant component of
+  root. The nodes are renumbered. thres is not used any more (the
+  largest component is always returned), and is kept for
+  compatibility.
+  ---------------------------------------------------------------------
+*/
+struct node_gra *
+GetLargestStronglyConnectedSet(struct node_gra *root,
+			       int thres)
+{
+  struct node_gra *giant;
+  int *comp = allocate_i_vec(CountNodes(root) + 1);
+  int *size;
+  int ncomp;
+
+  (void)thres;
+  ncomp = StronglyConnectedComponents(root, comp, &size);
+  giant = ExtractComponent(root, comp, LargestComponent(ncomp, size));
+  RenumberNodes(giant);
+
+  free_i_vec(comp);
+  free_i_vec(size);
   return giant;
 }
 
-//Function to remove those links that go to other components
-////It is necessary for the next function
-void ClearAdjacencies(struct node_gra *p,int *net)
+struct node_gra *
+GetLargestWeaklyConnectedSet(struct node_gra *root,int thres)
 {
-  struct node_lis *nei,*temp;
-
-  while(p->next!=NULL){
-    p=p->next;
-    nei=p->neig;
-    while(nei->next!=NULL){
-      if(net[(nei->next)->node]==0){
-        temp=nei->next;
-        if(temp->next==NULL)  nei->next=NULL;
-        else  nei->next=temp->next;
-        free(temp);
-      }else{
-        nei=nei->next;
-      }
-    }
-  }
+  struct node_gra *giant;
+  int *comp = allocate_i_vec(CountNodes(root) + 1);
+  int *size;
+  int ncomp;
+
+  (void)thres;
+  ncomp = WeaklyConnectedComponents(root, comp, &size);
+  giant = ExtractComponent(root, comp, LargestComponent(ncomp, size));
+  RenumberNodes(giant);
+
+  free_i_vec(comp);
+  free_i_vec(size);
+  return giant;
 }
 
-
 // Returns the number of connected components found. 
 // net_list must have been initialized, eg. struct node_gra *llista[1000];
+// Components are strongly connected and their nodes keep their num.
 int GetAllConnectedSets(struct node_gra *network,struct node_gra **net_list)
 {
-  struct node_gra *network_cop=NULL;
-  struct node_gra *network_loc=NULL;
-  struct node_gra *p;
-  struct node_gra *temp, *temp2;  
-  struct node_bfs *list,*lp,*lp2;
-  int numNodes=0;
-  int anod=0;
-  int *size,res1;
-  int *selected;
-  int *thisNet;
-  int i;
-  int sizeAnt;
-  int d;
-
-  int numComponents=0;
-  int MAX_SIZE_NET=10001;
-
-  selected=(int *)malloc(sizeof(int)*MAX_SIZE_NET);
-  thisNet=(int *)malloc(sizeof(int)*MAX_SIZE_NET);
-
-  for(i=0;i<MAX_SIZE_NET;i++)
-    selected[i]=0;
-
-  network_cop=CopyNetwork(network);
-
-  res1=0;
-  size=&res1;
-
-  numNodes=CountNodes(network);
-  //printf("Network has %i nodes\nDetecting connected components\n",numNodes);
-  list=CreateHeaderList();
-
-
-
-  do{
-    network_loc=CreateHeaderGraph();
-    p=network->next;
-    while(selected[p->num]!=0)  //Busquem 1 node no tractat encara
-      p=p->next;
-    selected[p->num]=1;
-
-
-    for(i=0;i<MAX_SIZE_NET;i++)
-      thisNet[i]=0;
-    d=0;
-
-    ResetNodesState(network);
-    Enqueue(p,list,list,size,d);
-    anod++;
-    //printf("Starting network with node %d    Total: %d/%d\n",p->num,anod,numNodes);
-
-    lp=list;
-    temp=CreateNodeGraph(network_loc,p->label);
-    temp->num=p->num;
-    temp->state=p->state;
-    CopyAdjacencyList(p,temp);
-    thisNet[p->num]=1;
-
-    do{
-
-      sizeAnt=*size;
-      lp=RenewQueue(list,lp,size,d);
-
-      lp2=lp;
-      while(lp2->next!=NULL){
-        if(AreConnectedList(network_cop,GetNode(((lp2->next)->ref)->num,network_cop),thisNet)==0){
-          DequeueOne(list,lp2,size);
-        }else{
-          temp=CreateNodeGraph(network_loc,((lp2->next)->ref)->label);
-          temp2=GetNode(((lp2->next)->ref)->num,network);
-          temp->num=temp2->num;
-          temp->state=temp2->state;
-          CopyAdjacencyList(temp2,temp);
-          thisNet[temp->num]=1;
-          selected[temp->num]=1;
-          anod++;
-          //printf("   adding %d    Total: %d/%d\n",temp->num,anod,numNodes);
-          lp2=lp2->next;
-        }
-      }
-      d++;
-    }while(*size!=sizeAnt);
-
-    ClearAdjacencies(network_loc,thisNet);
-    RewireAdjacencyByLabel(network_loc);
+  int *comp = allocate_i_vec(CountNodes(network) + 1);
+  int *size;
+  int c, numComponents;
 
-    net_list[numComponents]=network_loc;
-
-    //printf("Component %3i: Size %i\n",numComponents+1,CountNodes(net_list[numComponents]));
-    numComponents++;
-    ClearList(list,size);
-  }while(anod<numNodes);
-
-  free(list);
-  RemoveGraph(network_cop);
+  numComponents = StronglyConnectedComponents(network, comp, &size);
+  for (c=0; c<numComponents; c++)
+    net_list[c] = ExtractComponent(network, comp, c);
 
+  free_i_vec(comp);
+  free_i_vec(size);
   return numComponents;
-
 }
 
 
@@ -80,6 +80,23 @@ struct pred{
   struct pred *next;
 };
 
+/*
+  ---------------------------------------------------------------------
+  Definition of the node_csr structure: a compressed (CSR) snapshot of
+  the adjacency lists, for traversal-heavy algorithms. Node nums must
+  be 0..N-1 (as left by FBuildNetwork or RenumberNodes).
+  ---------------------------------------------------------------------
+*/
+struct node_csr{
+  int nnod;                // number of nodes
+  int nlink;               // number of adjacencies (2 x links if symmetric)
+  int *idx;                // neighbors of i are neig[idx[i]]..neig[idx[i+1]-1]
+  int *neig;               // num of the referenced node (sorted for each i)
+  int *rev;                // position of the reverse adjacency (-1 if none)
+  struct node_gra **node;  // node_gra whose num is i
+  struct node_lis **lis;   // node_lis corresponding to each adjacency
+};
+
 /*
   ---------------------------------------------------------------------
   Node, link, and graph creation and memory allocation
@@ -102,11 +119,19 @@ int AddAdjacencySoft(struct node_gra *node1,
 		     int add_weight_sw,
 		     double weight,
 		     int status);
+struct node_lis *AppendAdjacency(struct node_lis *last,
+				 struct node_gra *node2,
+				 double weight,
+				 int status);
 void RewireAdjacencyByNum(struct node_gra *root);
 void RewireAdjacencyByLabel(struct node_gra *root);
 void CopyAdjacencyList(struct node_gra *n1,
 		       struct node_gra *n2);
 struct node_gra *CopyNetwork(struct node_gra *p1);
+struct node_gra *CopyNodeList(struct node_gra **nlist, int nnod,
+			      struct node_gra **clist);
+unsigned long long NodeListHash(struct node_gra **nlist, int nnod,
+				unsigned long long hash);
 void *MakeLabelDict(struct node_gra *net);
 
 /*
@@ -222,14 +247,34 @@ void ClearList(struct node_bfs *list,
 void ResetNodesState(struct node_gra *p);
 void RenumberNodes(struct node_gra *net);
 
+/*
+  ---------------------------------------------------------------------
+  Compressed adjacency (CSR) snapshot
+  ---------------------------------------------------------------------
+*/
+struct node_csr *BuildNodeCSR(struct node_gra *net);
+void FreeNodeCSR(struct node_csr *csr);
+
 /*
   ---------------------------------------------------------------------
   Network randomization
   ---------------------------------------------------------------------
 */
+int IsSymmetricLinkListSimple(int nlink, int *ori, int *des);
+int SwapSymmetricLinks(int nlink, int *ori, int *des,
+		       double times, gsl_rng *gen);
 struct node_gra *RandomizeSymmetricNetwork(struct node_gra *net,
 					   double times,
 					   gsl_rng *gen);
+void RandomizeSymmetricReplicas(struct node_gra *net,
+				int nrep,
+				double times,
+				unsigned long int seed,
+				char *fnameFmt,
+				void (*callback)(int rep, struct node_gra *net,
+						 int nlink, int *ori, int *des,
+						 void *data),
+				void *data);
 
 /*
   ---------------------------------------------------------------------
@@ -255,12 +300,30 @@ void FPrintDistanceHistogramFromNode(FILE *file,
 				     int orinode);
 double AveragePathLength(struct node_gra *root);
 double AverageInverseDistance(struct node_gra *root);
+double *ApproxDistanceHistogram(struct node_gra *root,
+				int log2m,
+				unsigned int seed,
+				int *maxd);
+int ApproxDistanceStatistics(struct node_gra *root,
+			     int log2m,
+			     unsigned int seed,
+			     double *theAPL,
+			     double *theInvDist,
+			     double *theEffDiam);
+void FPrintApproxDistanceHistogram(FILE *file,
+				   struct node_gra *root,
+				   int log2m,
+				   unsigned int seed);
 
 /* Clustering coefficient and related functions */
 int SumCommonLinks(struct node_gra *node,
 		   struct node_gra *root);
 int CalculateLinksBetweenNeig(struct node_bfs *p,
 			      struct node_gra *root);
+void ClusteringCoefficients(struct node_gra *root,
+			    double *theGlobal,
+			    double *theAverage,
+			    double *Cnode);
 double ClusteringCoefficient(struct node_gra *root);
 double ClusteringCoefficient2(struct node_gra *root);
 double ClusteringCoefficientDegree(struct node_gra *root);
@@ -281,6 +344,28 @@ void NodeBetweennessStatistics(struct node_gra *net,
 			       double *theStddev,
 			       double *theMin,
 			       double *theMax);
+int CalculateNodeBetweennessSampled(struct node_gra *net,
+				    int nsources,
+				    double eps,
+				    double delta,
+				    gsl_rng *gen,
+				    double *ci);
+int CalculateLinkBetweennessSampled(struct node_gra *root,
+				    int nsources,
+				    double eps,
+				    double delta,
+				    gsl_rng *gen,
+				    double *maxCI);
+int NodeBetweennessStatisticsSampled(struct node_gra *net,
+				     int nsources,
+				     double eps,
+				     double delta,
+				     gsl_rng *gen,
+				     double *theMean,
+				     double *theStddev,
+				     double *theMin,
+				     double *theMax,
+				     double *theCI);
 
 /* Degree correlations */
 double Assortativity(struct node_gra *net);
@@ -292,6 +377,15 @@ int IsGraphConnected(struct node_gra *p);
 int AreConnectedList(struct node_gra *root,
 		     struct node_gra *n1,
 		     int cluslis[]);
+int WeaklyConnectedComponents(struct node_gra *root,
+			      int *comp,
+			      int **size);
+int StronglyConnectedComponents(struct node_gra *root,
+				int *comp,
+				int **size);
+struct node_gra *ExtractComponent(struct node_gra *root,
+				  int *comp,
+				  int c);
 int CountStronglyConnectedSets(struct node_gra *root);
 struct node_gra *GetLargestStronglyConnectedSet(struct node_gra *root,
 						int thres);
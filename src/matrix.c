@@ -3,6 +3,7 @@
   $LastChangedDate: 2008-10-13 19:13:23 -0500 (Mon, 13 Oct 2008) $
   $Revision: 130 $
 */
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -11,11 +12,19 @@
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_eigen.h>
 #include <gsl/gsl_sort_vector.h>
+#include <gsl/gsl_rng.h>
 
 #include "tools.h"
 #include "graph.h"
 #include "matrix.h"
 
+/* Lanczos parameters: residual tolerance (relative to an upper bound
+   of the spectrum), minimum number of extra Lanczos vectors besides
+   the wanted ones, and maximum number of restarts */
+#define LANCZOS_TOL 1.e-10
+#define LANCZOS_MIN_EXTRA 30
+#define LANCZOS_MAX_RESTART 10000
+
 /*
   Build the adjacency matrix of a network
 */
@@ -79,23 +88,32 @@ LaplacianMat(struct node_gra *net)
 }
 
 /*
-  Get the spectrum of the Laplacian
+  Get the spectrum of the Laplacian (dense, O(N^2) memory and O(N^3)
+  time; use LaplacianSpectrumLanczos for a few extreme eigenvalues of
+  large networks).
 */
 gsl_vector *
 LaplacianSpectrum(struct node_gra *net)
 {
   int nnod=CountNodes(net);
-  int **L=LaplacianMat(net);
-  int i, j;
+  struct node_gra *p=net;
+  struct node_lis *n;
   gsl_matrix *gslL;
   gsl_eigen_symm_workspace *workspace;
   gsl_vector *eval;
 
-  /* Create a Laplacian ready for GSL use */
+  /* Build the Laplacian directly as a GSL matrix (self-loops are
+     ignored) */
   gslL = gsl_matrix_calloc(nnod, nnod);
-  for (i=0; i<nnod; i++)
-    for (j=0; j<nnod; j++)
-      gsl_matrix_set(gslL, i, j, L[i][j]);
+  while ((p = p->next) != NULL) {
+    n = p->neig;
+    while ((n = n->next) != NULL) {
+      if (n->ref != p) {
+	*gsl_matrix_ptr(gslL, p->num, p->num) += 1.0;
+	*gsl_matrix_ptr(gslL, p->num, n->ref->num) -= 1.0;
+      }
+    }
+  }
   
   /* Get the eigenvalues */
   workspace = gsl_eigen_symm_alloc(nnod);
@@ -104,28 +122,347 @@ LaplacianSpectrum(struct node_gra *net)
   gsl_sort_vector(eval);
 
   /* Free memory and done */
-  free_i_mat(L, nnod);
   gsl_matrix_free(gslL);
   gsl_eigen_symm_free(workspace);
 
   return eval;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Sparse (matrix-free) Laplacian eigensolver
+  ---------------------------------------------------------------------
+*/
+
+/*
+  y = L x, with L the Laplacian of the network stored in csr
+  (self-loops are ignored).
+*/
+static void
+LaplacianProduct(struct node_csr *csr, const double *x, double *y)
+{
+  int i, e;
+
+#pragma omp parallel for schedule(static) private(e)
+  for (i=0; i<csr->nnod; i++) {
+    double sum = 0.0;
+    int deg = 0;
+    for (e=csr->idx[i]; e<csr->idx[i+1]; e++) {
+      if (csr->neig[e] != i) {
+	sum += x[csr->neig[e]];
+	deg++;
+      }
+    }
+    y[i] = deg * x[i] - sum;
+  }
+}
+
+/*
+  Remove from x its projection onto the null space of the Laplacian,
+  which is spanned by the indicator vectors of the connected
+  components.
+*/
+static void
+DeflateComponents(int nnod, const int *comp, int ncomp, const int *csize,
+		  double *mean, double *x)
+{
+  int i;
+
+  for (i=0; i<ncomp; i++)
+    mean[i] = 0.0;
+  for (i=0; i<nnod; i++)
+    mean[comp[i]] += x[i];
+  for (i=0; i<ncomp; i++)
+    mean[i] /= csize[i];
+  for (i=0; i<nnod; i++)
+    x[i] -= mean[comp[i]];
+}
+
+/*
+  Orthogonalize w against the ncol columns of V (stored one after the
+  other, each of length nnod), using classical Gram-Schmidt twice. The
+  projections are added to h.
+*/
+static void
+Orthogonalize(int nnod, const double *V, int ncol, double *w, double *h)
+{
+  double *d;
+  int pass, c, i;
+
+  d = allocate_d_vec(ncol + 1);
+  for (pass=0; pass<2; pass++) {
+#pragma omp parallel for schedule(static) private(i)
+    for (c=0; c<ncol; c++) {
+      double dot = 0.0;
+      for (i=0; i<nnod; i++)
+	dot += V[(long)c * nnod + i] * w[i];
+      d[c] = dot;
+    }
+#pragma omp parallel for schedule(static) private(c)
+    for (i=0; i<nnod; i++) {
+      double sub = 0.0;
+      for (c=0; c<ncol; c++)
+	sub += d[c] * V[(long)c * nnod + i];
+      w[i] -= sub;
+    }
+    for (c=0; c<ncol; c++)
+      h[c] += d[c];
+  }
+  free_d_vec(d);
+}
+
+static double
+VectorNorm(int nnod, const double *w)
+{
+  double norm = 0.0;
+  int i;
+
+  for (i=0; i<nnod; i++)
+    norm += w[i] * w[i];
+  return sqrt(norm);
+}
+
+/*
+  Fill w with a random unit vector orthogonal to the ncol columns of V
+  and to the null space of the Laplacian.
+*/
+static void
+RandomStartVector(int nnod, const int *comp, int ncomp, const int *csize,
+		  double *mean, const double *V, int ncol, double *w,
+		  gsl_rng *gen)
+{
+  double *h, norm;
+  int i;
+
+  h = allocate_d_vec(ncol + 1);
+  do {
+    for (i=0; i<nnod; i++)
+      w[i] = gsl_rng_uniform(gen) - 0.5;
+    Orthogonalize(nnod, V, ncol, w, h);
+    DeflateComponents(nnod, comp, ncomp, csize, mean, w);
+    norm = VectorNorm(nnod, w);
+  } while (norm < 1.e-8);
+  for (i=0; i<nnod; i++)
+    w[i] /= norm;
+  free_d_vec(h);
+}
+
+/*
+  Compute the k smallest (largest=0) or largest (largest=1) nonzero
+  eigenvalues of the Laplacian with the thick-restart Lanczos method
+  with full reorthogonalization. The Krylov space is kept orthogonal
+  to the null space of the Laplacian, so that the zero eigenvalues
+  (one per connected component) never show up. Only products with the
+  sparse Laplacian are needed, and memory is O(N m) with m =
+  max(3k, k+30) Lanczos vectors. The eigenvalues are stored in theta,
+  most extreme first, and the number of eigenvalues found (at most
+  N - ncomp) is returned.
+*/
+static int
+LanczosLaplacian(struct node_csr *csr, const int *comp, int ncomp,
+		 const int *csize, int k, int largest, double *theta)
+{
+  int nnod = csr->nnod, neff = nnod - ncomp;
+  int m, l = 0, i, j, c, r, iter, conv = 0, maxdeg = 0;
+  double *V, *w, *h, *mean, beta = 0.0, bound;
+  gsl_matrix *T, *A, *S;
+  gsl_vector *th;
+  gsl_eigen_symmv_workspace *ws;
+  gsl_rng *gen;
+
+  if (k > neff)
+    k = neff;
+  if (k <= 0)
+    return 0;
+  m = GSL_MIN(neff, GSL_MAX(3 * k, k + LANCZOS_MIN_EXTRA));
+
+  /* Gershgorin bound for the largest eigenvalue, used as the scale of
+     the convergence criterion */
+  for (i=0; i<nnod; i++)
+    if (csr->idx[i+1] - csr->idx[i] > maxdeg)
+      maxdeg = csr->idx[i+1] - csr->idx[i];
+  bound = 2.0 * maxdeg;
+
+  V = (double *)malloc((long)(m + 1) * nnod * sizeof(double));
+  if (V == NULL) {
+    fprintf(stderr, "ERROR: Cannot allocate %d Lanczos vectors of size %d\n",
+	    m + 1, nnod);
+    return 0;
+  }
+  h = allocate_d_vec(m + 1);
+  mean = allocate_d_vec(ncomp + 1);
+  T = gsl_matrix_calloc(m, m);
+  A = gsl_matrix_alloc(m, m);
+  S = gsl_matrix_alloc(m, m);
+  th = gsl_vector_alloc(m);
+  ws = gsl_eigen_symmv_alloc(m);
+  gen = gsl_rng_alloc(gsl_rng_mt19937);
+  gsl_rng_set(gen, 1111);
+
+  RandomStartVector(nnod, comp, ncomp, csize, mean, V, 0, V, gen);
+
+  for (iter=0; ; iter++) {
+    /* Extend the Lanczos basis from l to m vectors. The projected
+       matrix T is tridiagonal, except for the arrowhead coupling the
+       l Ritz vectors kept at the last restart to vector l. */
+    for (j=l; j<m; j++) {
+      w = V + (long)(j + 1) * nnod;
+      LaplacianProduct(csr, V + (long)j * nnod, w);
+      for (c=0; c<=j; c++)
+	h[c] = 0.0;
+      Orthogonalize(nnod, V, j + 1, w, h);
+      /* The null space is deflated after the orthogonalization,
+	 otherwise rounding errors along it (the extreme eigenvalue 0)
+	 grow exponentially with the Lanczos recurrence */
+      DeflateComponents(nnod, comp, ncomp, csize, mean, w);
+      beta = VectorNorm(nnod, w);
+      gsl_matrix_set(T, j, j, h[j]);
+      if (beta < LANCZOS_TOL * bound) {
+	/* Invariant subspace: continue with a fresh direction */
+	beta = 0.0;
+	if (j + 1 < m)
+	  RandomStartVector(nnod, comp, ncomp, csize, mean,
+			    V, j + 1, w, gen);
+      }
+      else {
+	for (i=0; i<nnod; i++)
+	  w[i] /= beta;
+      }
+      if (j + 1 < m) {
+	gsl_matrix_set(T, j, j + 1, beta);
+	gsl_matrix_set(T, j + 1, j, beta);
+      }
+    }
+
+    /* Ritz values, most extreme first */
+    gsl_matrix_memcpy(A, T);
+    gsl_eigen_symmv(A, th, S, ws);
+    gsl_eigen_symmv_sort(th, S, largest ? GSL_EIGEN_SORT_VAL_DESC :
+			 GSL_EIGEN_SORT_VAL_ASC);
+
+    /* Converged if the residual |L y - theta y| = beta |s_m| of all
+       the wanted Ritz pairs is small */
+    conv = 1;
+    for (i=0; i<k && conv; i++)
+      if (fabs(beta * gsl_matrix_get(S, m - 1, i)) > LANCZOS_TOL * bound)
+	conv = 0;
+    if (conv || m == neff || iter == LANCZOS_MAX_RESTART)
+      break;
+
+    /* Thick restart: keep the l best Ritz vectors plus the residual
+       direction as the new basis */
+    l = k + (m - k) / 2;
+#pragma omp parallel private(r, c, i)
+    {
+      double *row = allocate_d_vec(m);
+#pragma omp for schedule(static)
+      for (r=0; r<nnod; r++) {
+	for (c=0; c<m; c++)
+	  row[c] = V[(long)c * nnod + r];
+	for (i=0; i<l; i++) {
+	  double sum = 0.0;
+	  for (c=0; c<m; c++)
+	    sum += row[c] * gsl_matrix_get(S, c, i);
+	  V[(long)i * nnod + r] = sum;
+	}
+      }
+      free_d_vec(row);
+    }
+    memcpy(V + (long)l * nnod, V + (long)m * nnod, nnod * sizeof(double));
+    gsl_matrix_set_zero(T);
+    for (i=0; i<l; i++) {
+      gsl_matrix_set(T, i, i, gsl_vector_get(th, i));
+      gsl_matrix_set(T, i, l, beta * gsl_matrix_get(S, m - 1, i));
+      gsl_matrix_set(T, l, i, beta * gsl_matrix_get(S, m - 1, i));
+    }
+  }
+  if (!conv && m < neff)
+    fprintf(stderr,
+	    "WARNING: Lanczos did not converge after %d restarts\n", iter);
+
+  for (i=0; i<k; i++)
+    theta[i] = gsl_vector_get(th, i);
+
+  /* Free memory and done */
+  free(V);
+  free_d_vec(h);
+  free_d_vec(mean);
+  gsl_matrix_free(T);
+  gsl_matrix_free(A);
+  gsl_matrix_free(S);
+  gsl_vector_free(th);
+  gsl_eigen_symmv_free(ws);
+  gsl_rng_free(gen);
+  return k;
+}
+
+/*
+  Get the k smallest (largest=0) or k largest (largest=1) eigenvalues
+  of the Laplacian, sorted in increasing order like in
+  LaplacianSpectrum, using the sparse Lanczos solver. The zero
+  eigenvalues (one per connected component) are known exactly and are
+  not computed.
+*/
+gsl_vector *
+LaplacianSpectrumLanczos(struct node_gra *net, int k, int largest)
+{
+  struct node_csr *csr;
+  int nnod=CountNodes(net), ncomp, nz, nfound, i;
+  int *comp, *csize;
+  double *theta;
+  gsl_vector *eval;
+
+  if (k > nnod)
+    k = nnod;
+  eval = gsl_vector_calloc(GSL_MAX(k, 1));
+  if (k <= 0)
+    return eval;
+
+  csr = BuildNodeCSR(net);
+  comp = allocate_i_vec(nnod);
+  ncomp = WeaklyConnectedComponents(net, comp, &csize);
+  theta = allocate_d_vec(k);
+
+  if (largest) {
+    nfound = LanczosLaplacian(csr, comp, ncomp, csize, k, 1, theta);
+    for (i=0; i<nfound; i++)
+      gsl_vector_set(eval, k - 1 - i, theta[i]);
+  }
+  else {
+    nz = GSL_MIN(k, ncomp);
+    nfound = LanczosLaplacian(csr, comp, ncomp, csize, k - nz, 0, theta);
+    for (i=0; i<nfound; i++)
+      gsl_vector_set(eval, nz + i, theta[i]);
+  }
+
+  /* Free memory and done */
+  free_d_vec(theta);
+  free_i_vec(comp);
+  free_i_vec(csize);
+  FreeNodeCSR(csr);
+  return eval;
+}
+
 /*
   Get the "synchronizability", that is the ratio between the largest
-  and the smallest (non-zero) eigenvalues of the Laplacian.
+  and the smallest (non-zero) eigenvalues of the Laplacian. Only these
+  two eigenvalues are computed, with the sparse Lanczos solver.
 */
 double
 Synchronizability(struct node_gra *net)
 {
-  gsl_vector *spec=LaplacianSpectrum(net);
-  int count=0, nnod=CountNodes(net);
-  double l2=-1.0, lN=-1.0;
-  
-  lN = gsl_vector_get(spec, nnod - 1);
-  while (l2 < 1e-10)
-    l2 = gsl_vector_get(spec, count++);
-  
-  gsl_vector_free(spec);
+  struct node_csr *csr=BuildNodeCSR(net);
+  int nnod=CountNodes(net), ncomp;
+  int *comp, *csize;
+  double l2=0.0, lN=0.0;
+
+  comp = allocate_i_vec(nnod);
+  ncomp = WeaklyConnectedComponents(net, comp, &csize);
+  LanczosLaplacian(csr, comp, ncomp, csize, 1, 1, &lN);
+  LanczosLaplacian(csr, comp, ncomp, csize, 1, 0, &l2);
+
+  free_i_vec(comp);
+  free_i_vec(csize);
+  FreeNodeCSR(csr);
   return lN / l2;
 }
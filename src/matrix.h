@@ -18,6 +18,7 @@
 int **AdjacencyMat(struct node_gra *net);
 int **LaplacianMat(struct node_gra *net);
 gsl_vector *LaplacianSpectrum(struct node_gra *net);
+gsl_vector *LaplacianSpectrumLanczos(struct node_gra *net, int k, int largest);
 double Synchronizability(struct node_gra *net);
 
 #endif /* !RGRAPH_MISSING_H */
@@ -17,6 +17,7 @@
 
 #include "tools.h"
 #include "graph.h"
+#include "datastruct.h"
 #include "modules.h"
 #include "models.h"
 #include "recommend.h"
@@ -139,34 +140,278 @@ PartitionH(struct group *part, double linC)
   return H;
 }
 
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Block model sampler
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Terms of the (plain) block model likelihood behind PartitionH
+  ---------------------------------------------------------------------
+*/
+static double
+PlainBlockH(int r, int l, const struct sbm_likelihood *lk)
+{
+  return log(r + 1) + FastLogChoose(r, l,
+				    lk->LogChooseList, lk->LogChooseListSize);
+}
+
+static double
+PlainScore(int r, int l, const struct sbm_likelihood *lk)
+{
+  (void)lk;
+  return (float)(l + 1) / (float)(r + 2);
+}
+
+static double
+PlainPartitionH(struct group *part, const struct sbm_likelihood *lk)
+{
+  return PartitionH(part, lk->linC);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Set up the plain block model on tables owned by the caller
+  ---------------------------------------------------------------------
+*/
+static void
+SetPlainLikelihood(struct sbm_likelihood *lk,
+		   double linC,
+		   double *LogChooseList,
+		   int LogChooseListSize,
+		   double *LogFactList, int LogFactListSize)
+{
+  memset(lk, 0, sizeof(struct sbm_likelihood));
+  lk->name = "LinkScore";
+  lk->linC = linC;
+  lk->block = PlainBlockH;
+  lk->score = PlainScore;
+  lk->degeneracy = NULL;
+  lk->partitionH = PlainPartitionH;
+  lk->LogChooseList = LogChooseList;
+  lk->LogChooseListSize = LogChooseListSize;
+  lk->LogFactList = LogFactList;
+  lk->LogFactListSize = LogFactListSize;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Create the plain block model for a network with nnod nodes, with
+  its own ln(r!) table. Other models start from this one and replace
+  its terms (see CreateSBMLikelihoodMB, for instance). All the tables
+  are freed by FreeSBMLikelihood.
+  ---------------------------------------------------------------------
+*/
+struct sbm_likelihood *
+CreateSBMLikelihood(int nnod, double linC)
+{
+  struct sbm_likelihood *lk = NULL;
+  int LogChooseListSize = FastLogTableSize((long int)nnod * (nnod - 1) / 2);
+  double *LogChooseList = InitializeFastLogChoose(LogChooseListSize);
+
+  lk = (struct sbm_likelihood *)calloc(1, sizeof(struct sbm_likelihood));
+  SetPlainLikelihood(lk, linC,
+		     LogChooseList, LogChooseListSize,
+		     LogChooseList, LogChooseListSize); /* same table */
+  return lk;
+}
+
+void
+FreeSBMLikelihood(struct sbm_likelihood *lk)
+{
+  if (lk->LogFactList != NULL && lk->LogFactList != lk->LogChooseList)
+    FreeFastLogFact(lk->LogFactList);
+  if (lk->LogChooseList != NULL)
+    FreeFastLogChoose(lk->LogChooseList);
+  if (lk->HarmonicList != NULL)
+    FreeHarmonicList(lk->HarmonicList);
+  if (lk->LogGammaListA != NULL)
+    FreeFastLogGamma(lk->LogGammaListA);
+  if (lk->LogGammaListB != NULL)
+    FreeFastLogGamma(lk->LogGammaListB);
+  if (lk->LogGammaListAB != NULL)
+    FreeFastLogGamma(lk->LogGammaListAB);
+  free(lk);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Change of energy when a node moves from oldg to newg (or to any
+  empty group, if newg is NULL). n2gList holds the links of the node
+  to the groups in the shortlist slg, which must contain all
+  non-empty groups; effectng is the number of non-empty groups.
+  ---------------------------------------------------------------------
+*/
+static double
+SBMMoveH(const struct sbm_likelihood *lk,
+	 struct group **glist,
+	 int *slg, int slgsize,
+	 struct group_links *G2G,
+	 int *n2gList,
+	 int ngroup, int effectng,
+	 struct group *oldg, struct group *newg)
+{
+  double dH = 0.0;
+  struct group *g;
+  int noldg, nnewg, ng, n2g, oldg2g, newg2g;
+  int n2oldg, n2newg, newg2oldg, oldg2oldg, newg2newg;
+  int r, l, slgn;
+
+  noldg = oldg->size;
+  nnewg = (newg != NULL) ? newg->size : 0;
+  if (noldg == 1)  /* number of groups would decrease by one */ 
+    dH -= lk->linC;
+  if (nnewg == 0)  /* number of groups would increase by one */
+    dH += lk->linC;
+  n2oldg = n2gList[oldg->label];
+  n2newg = (nnewg > 0) ? n2gList[newg->label] : 0;
+  newg2oldg = (nnewg > 0) ? G2G_LINKS(G2G, newg->label, oldg->label) : 0;
+  oldg2oldg = oldg->inlinks;
+  newg2newg = (nnewg > 0) ? newg->inlinks : 0;
+
+  for (slgn=0; slgn<slgsize; slgn++) {
+    g = glist[slg[slgn]];
+    if (g->size == 0)  /* empty groups do not contribute */
+      continue;
+    if (g == oldg) {
+      /* old conf, oldg-oldg */
+      r = noldg * (noldg - 1) / 2;
+      l = oldg2oldg;
+      dH -= lk->block(r, l, lk);
+      /* new conf, oldg-oldg */
+      r = (noldg - 1) * (noldg - 2) / 2;
+      l = oldg2oldg - n2oldg;
+      dH += lk->block(r, l, lk);
+      /* old conf, newg-oldg */
+      r = nnewg * noldg;
+      l = newg2oldg;
+      dH -= lk->block(r, l, lk);
+      /* new conf, newg-oldg */
+      r = (nnewg + 1) * (noldg - 1);
+      l = newg2oldg + n2oldg - n2newg;
+      dH += lk->block(r, l, lk);
+    }
+    else if (g == newg) {
+      /* old conf, newg-newg */
+      r = nnewg * (nnewg - 1) / 2;
+      l = newg2newg;
+      dH -= lk->block(r, l, lk);
+      /* new conf, newg-newg */
+      r = (nnewg + 1) * nnewg / 2;
+      l = newg2newg + n2newg;
+      dH += lk->block(r, l, lk);
+    }
+    else {
+      n2g = n2gList[g->label];
+      oldg2g = G2G_LINKS(G2G, oldg->label, g->label);
+      newg2g = (nnewg > 0) ? G2G_LINKS(G2G, newg->label, g->label) : 0;
+      ng = g->size;
+      /* old conf, oldg-g */
+      r = noldg * ng;
+      l = oldg2g;
+      dH -= lk->block(r, l, lk);
+      /* new conf, oldg-g */
+      r = (noldg - 1) * ng;
+      l = oldg2g - n2g;
+      dH += lk->block(r, l, lk);
+      /* old conf, newg-g */
+      r = nnewg * ng;
+      l = newg2g;
+      dH -= lk->block(r, l, lk);
+      /* new conf, newg-g */
+      r = (nnewg + 1) * ng;
+      l = newg2g + n2g;
+      dH += lk->block(r, l, lk);
+    }
+  }
+
+  /* Labeled-groups sampling correction */
+  if (noldg == 1 && nnewg != 0) { // effectng would decrease by one
+    dH -= -FastLogFact(ngroup - effectng,
+		       lk->LogFactList, lk->LogFactListSize);
+    dH += -FastLogFact(ngroup - (effectng-1),
+		       lk->LogFactList, lk->LogFactListSize);
+    if (lk->degeneracy != NULL)
+      dH += lk->degeneracy(effectng) - lk->degeneracy(effectng - 1);
+  }
+  else if (noldg != 1 && nnewg == 0) {  // effectng would increase by one
+    dH -= -FastLogFact(ngroup - effectng,
+		       lk->LogFactList, lk->LogFactListSize);
+    dH += -FastLogFact(ngroup - (effectng+1),
+		       lk->LogFactList, lk->LogFactListSize);
+    if (lk->degeneracy != NULL)
+      dH += lk->degeneracy(effectng) - lk->degeneracy(effectng + 1);
+  }
+
+  return dH;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Move node from oldg to newg and update the bookkeeping: energy,
+  group-to-group links, shortlist of groups and number of non-empty
+  groups
+  ---------------------------------------------------------------------
+*/
+static void
+SBMMoveNode(struct node_gra *node,
+	    struct group *oldg, struct group *newg,
+	    double dH, double *H,
+	    struct group_links *G2G, int *n2gList,
+	    int *slg, int *slgsize, int *effectng)
+{
+  int slgn;
+
+  if (oldg != newg) {
+    if (oldg->size == 1)
+      (*effectng)--;
+    if (newg->size == 0)
+      (*effectng)++;
+  }
+  MoveNode(node, oldg, newg);
+  *H += dH;
+    
+  /* update G2G */
+  GroupLinksMoveNode(G2G, slg, *slgsize, n2gList, oldg->label, newg->label);
+
+  /* Add newg to shortlist (if it's not there already!) */
+  for (slgn=0; slgn<*slgsize; slgn++)
+    if (newg->label == slg[slgn])
+      return;
+  slg[(*slgsize)++] = newg->label;
+  return;
+}
+
 /*
   ---------------------------------------------------------------------
   Do a Monte Carlo step for the prediction of missing links. Each
-  "step" involves nnod independent attempts to move a single node.
+  "step" involves factor*nnod independent attempts to move a single
+  node.
   ---------------------------------------------------------------------
 */
 void
-LinkScoreMCStep(int factor,
-		double *H,
-		double linC,
-		struct node_gra **nlist,
-		struct group **glist,
-		struct group *part,
-		int nnod,
-		int **G2G,
-		int *n2gList,
-		double **LogChooseList,
-		int LogChooseListSize,
-		double *LogFactList, int LogFactListSize,
-		gsl_rng *gen)
+SBMMCStep(int factor,
+	  double *H,
+	  const struct sbm_likelihood *lk,
+	  struct node_gra **nlist,
+	  struct group **glist,
+	  struct group *part,
+	  int nnod,
+	  struct group_links *G2G,
+	  int *n2gList,
+	  gsl_rng *gen)
 {
   double dH;
   struct group *g, *oldg, *newg;
-  int dice, oldgnum, newgnum, n2g, oldg2g, newg2g, ng, noldg, nnewg;
+  int dice, oldgnum, newgnum;
   struct node_gra *node;
-  int n2oldg, n2newg, newg2oldg, oldg2oldg, newg2newg;
-  int r, l;
-  int i, j, ngroup=nnod;
+  int ngroup=nnod;
   int move;
   int effectng;
   /* Shortlist of groups. Groups not in this list are empty for
@@ -175,7 +420,7 @@ LinkScoreMCStep(int factor,
      never remove groups from it (even if they loose all their nodes
      during a step). slgXsize is the size of slgX. */
   int *slg=NULL;
-  int slgn, slgsize, isinlist;
+  int slgsize;
 
   /* Preliminaries */
   slg = allocate_i_vec(nnod);  // Shortlist of groups
@@ -184,6 +429,8 @@ LinkScoreMCStep(int factor,
   while ((g=g->next) != NULL)
     if (g->size > 0)
       slg[slgsize++] = g->label;
+  effectng = slgsize;
+  GroupLinksPrune(G2G, glist);  // free the slots of now empty groups
 
   /* Steps */
   for (move=0; move<nnod*factor; move++) {
@@ -199,210 +446,340 @@ LinkScoreMCStep(int factor,
     newg = glist[newgnum];
     
     /* Calculate the change of energy */
-    dH = 0.0;
+    n2gList[newgnum] = 0;  /* newg may be empty and not in slg */
+    NodeLinksToGroups(node, slg, slgsize, n2gList);
+    dH = SBMMoveH(lk, glist, slg, slgsize, G2G, n2gList,
+		  ngroup, effectng, oldg, newg);
+
+    /* Metropolis rule */
+    if ((dH <= 0.0) || (gsl_rng_uniform(gen) < exp(-dH)))
+      SBMMoveNode(node, oldg, newg, dH, H, G2G, n2gList,
+		  slg, &slgsize, &effectng);
+  } /* nnod moves completed: done! */
+
+  free_i_vec(slg);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Do a Gibbs (heat-bath) step: each node, in turn, is moved to a
+  group chosen with the probability it has given the rest of the
+  partition.
+
+  For each node, the non-empty groups other than its own are first
+  gathered into parallel arrays (size, inner links, links to the node
+  and slot in G2G). The terms of the energy change that only involve
+  the old group (the links between oldg and every other group) do not
+  depend on the destination, so they are computed once per node; each
+  destination newg then only adds the terms of its own links. All
+  empty groups are equivalent destinations and are handled as a
+  single candidate with multiplicity ngroup - effectng. The move is
+  drawn with a single uniform number from the cumulative weights,
+  which are shifted by the lowest energy change so that the
+  exponentials cannot overflow.
+  ---------------------------------------------------------------------
+*/
+void
+SBMGibbsStep(double *H,
+	     const struct sbm_likelihood *lk,
+	     struct node_gra **nlist,
+	     struct group **glist,
+	     struct group *part,
+	     int nnod,
+	     struct group_links *G2G,
+	     int *n2gList,
+	     gsl_rng *gen)
+{
+  struct group *g, *oldg, *newg;
+  struct node_gra *node;
+  int ngroup=nnod;
+  int move;
+  int effectng;
+  /* Shortlist of groups (see SBMMCStep) */
+  int *slg=NULL;
+  int slgsize, slgn;
+  /* Non-empty groups other than oldg, as parallel arrays */
+  int ncand;
+  int *clabel=NULL, *csize=NULL, *cinlinks=NULL, *cn2g=NULL, *cslot=NULL;
+  double *coldH=NULL;  // change of the oldg-g terms
+  double *cdH=NULL;    // change of energy
+  double *cw=NULL;     // cumulative weights
+  int k, j, target;
+  int noldg, nnewg, n2oldg, n2newg, oldg2oldg, newg2oldg, oldslot;
+  int *oldrow, *newrow;
+  double dHold, dHdec, dHinc, dHempty, dHmin, d;
+  double nempty, dice;
+  
+  /* Preliminaries */
+  slg = allocate_i_vec(nnod);  // Shortlist of groups
+  slgsize = 0;
+  g = part;
+  while ((g=g->next) != NULL)
+    if (g->size > 0)
+      slg[slgsize++] = g->label;
+  effectng = slgsize;
+  GroupLinksPrune(G2G, glist);  // free the slots of now empty groups
+  clabel = allocate_i_vec(nnod);
+  csize = allocate_i_vec(nnod);
+  cinlinks = allocate_i_vec(nnod);
+  cn2g = allocate_i_vec(nnod);
+  cslot = allocate_i_vec(nnod);
+  coldH = allocate_d_vec(nnod);
+  cdH = allocate_d_vec(nnod);
+  cw = allocate_d_vec(nnod + 1);
+
+  /* Steps */
+  for (move=0; move<nnod; move++) {
+    node = nlist[move];
+    oldg = glist[node->inGroup];
+    NodeLinksToGroups(node, slg, slgsize, n2gList);
     noldg = oldg->size;
-    nnewg = newg->size;
-    if (noldg == 1)  /* number of groups would decrease by one */ 
-      dH -= linC;
-    if (nnewg == 0)  /* number of groups would increase by one */
-      dH += linC;
-    n2oldg = NLinksToGroup(node, oldg);
-    n2newg = NLinksToGroup(node, newg);
-    newg2oldg = NG2GLinks(newg, oldg);
+    n2oldg = n2gList[oldg->label];
     oldg2oldg = oldg->inlinks;
-    newg2newg = newg->inlinks;
-    effectng = 0;
+    oldslot = G2G->slot[oldg->label];
+    oldrow = G2G->count[oldslot];
+
+    /* Gather the candidate groups */
+    ncand = 0;
     for (slgn=0; slgn<slgsize; slgn++) {
       g = glist[slg[slgn]];
-      if (g->size > 0) {  /* group is not empty */
-	effectng++;
-	n2gList[g->label] = NLinksToGroup(node, g);
-	if (g->label == oldg->label) {
-	  /* old conf, oldg-oldg */
-	  r = noldg * (noldg - 1) / 2;
-	  l = oldg2oldg;
-	  dH -= log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* new conf, oldg-olg */
-	  r = (noldg - 1) * (noldg - 2) / 2;
-	  l = oldg2oldg - n2oldg;
-	  dH += log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* old conf, newg-oldg */
-	  r = nnewg * noldg;
-	  l = newg2oldg;
-	  dH -= log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* new conf, newg-oldg */
-	  r = (nnewg + 1) * (noldg - 1);
-	  l = newg2oldg + n2oldg - n2newg;
-	  dH += log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	}
-	else if (g->label == newg->label) {
-	  /* old conf, newg-newg */
-	  r = nnewg * (nnewg - 1) / 2;
-	  l = newg2newg;
-	  dH -= log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* new conf, newg-olg */
-	  r = (nnewg + 1) * nnewg / 2;
-	  l = newg2newg + n2newg;
-	  dH += log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	}
-	else {
-	  n2g = n2gList[g->label];
-	  oldg2g = G2G[oldg->label][g->label];
-	  newg2g = G2G[newg->label][g->label];
-	  ng = g->size;
-	  /* old conf, oldg-g */
-	  r = noldg * ng;
-	  l = oldg2g;
-	  dH -= log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* new conf, oldg-g */
-	  r = (noldg - 1) * ng;
-	  l = oldg2g - n2g;
-	  dH += log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* old conf, newg-g */
-	  r = nnewg * ng;
-	  l = newg2g;
-	  dH -= log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	  /* new conf, newg-g */
-	  r = (nnewg + 1) * ng;
-	  l = newg2g + n2g;
-	  dH += log(r + 1) + FastLogChoose(r, l,
-					   LogChooseList, LogChooseListSize);
-	}
-      }
-      else { /* group is empty */
-	n2gList[g->label] = 0.0;
+      if (g->size > 0 && g != oldg) {
+	clabel[ncand] = g->label;
+	csize[ncand] = g->size;
+	cinlinks[ncand] = g->inlinks;
+	cn2g[ncand] = n2gList[g->label];
+	cslot[ncand] = G2G->slot[g->label];
+	ncand++;
       }
     }
 
-    /* Labeled-groups sampling correction */
-    if (noldg == 1 && nnewg != 0) { // effectng would decrease by one
-      dH -= -FastLogFact(ngroup - effectng, LogFactList, LogFactListSize);
-      dH += -FastLogFact(ngroup - (effectng-1), LogFactList, LogFactListSize);
+    /* Terms that do not depend on the destination: the node leaves
+       oldg */
+    dHold = 0.0;
+    if (noldg == 1)  /* number of groups would decrease by one */
+      dHold -= lk->linC;
+    dHold -= lk->block(noldg * (noldg - 1) / 2, oldg2oldg, lk);
+    dHold += lk->block((noldg - 1) * (noldg - 2) / 2, oldg2oldg - n2oldg, lk);
+    for (k=0; k<ncand; k++) {
+      coldH[k] = lk->block((noldg - 1) * csize[k], oldrow[cslot[k]] - cn2g[k],
+			   lk) -
+	lk->block(noldg * csize[k], oldrow[cslot[k]], lk);
+      dHold += coldH[k];
+    }
+
+    /* Labeled-groups sampling correction, for a destination that is
+       not empty (dHdec) or that is (dHinc) */
+    dHdec = dHinc = 0.0;
+    if (noldg == 1) {  // effectng would decrease by one
+      dHdec = FastLogFact(ngroup - effectng,
+			  lk->LogFactList, lk->LogFactListSize) -
+	FastLogFact(ngroup - (effectng - 1),
+		    lk->LogFactList, lk->LogFactListSize);
+      if (lk->degeneracy != NULL)
+	dHdec += lk->degeneracy(effectng) - lk->degeneracy(effectng - 1);
     }
-    else if (noldg != 1 && nnewg == 0) {  // effectng would increase by one
-      dH -= -FastLogFact(ngroup - effectng, LogFactList, LogFactListSize);
-      dH += -FastLogFact(ngroup - (effectng+1), LogFactList, LogFactListSize);
+    else {  // effectng would increase by one
+      dHinc = FastLogFact(ngroup - effectng,
+			  lk->LogFactList, lk->LogFactListSize) -
+	FastLogFact(ngroup - (effectng + 1),
+		    lk->LogFactList, lk->LogFactListSize);
+      if (lk->degeneracy != NULL)
+	dHinc += lk->degeneracy(effectng) - lk->degeneracy(effectng + 1);
     }
 
-    /* Metropolis rule */
-    if ((dH <= 0.0) || (gsl_rng_uniform(gen) < exp(-dH))) {
-      
-      /* accept move */
-      MoveNode(node, oldg, newg);
-      *H += dH;
-    
-      /* update G2G */
-      for (i=0; i<nnod; i++) {
-	G2G[i][oldgnum] -= n2gList[i];
-	G2G[oldgnum][i] = G2G[i][oldgnum];
-	G2G[i][newgnum] += n2gList[i];
-	G2G[newgnum][i] = G2G[i][newgnum];
+    /* Non-empty destinations */
+    dHmin = 0.0;  // staying in oldg costs nothing
+    for (k=0; k<ncand; k++) {
+      nnewg = csize[k];
+      n2newg = cn2g[k];
+      newrow = G2G->count[cslot[k]];
+      newg2oldg = newrow[oldslot];
+      /* oldg-newg was counted in dHold as an oldg-g pair */
+      d = dHold - coldH[k] + dHdec;
+      /* newg-oldg */
+      d -= lk->block(nnewg * noldg, newg2oldg, lk);
+      d += lk->block((nnewg + 1) * (noldg - 1), newg2oldg + n2oldg - n2newg,
+		     lk);
+      /* newg-newg */
+      d -= lk->block(nnewg * (nnewg - 1) / 2, cinlinks[k], lk);
+      d += lk->block((nnewg + 1) * nnewg / 2, cinlinks[k] + n2newg, lk);
+      /* newg-g */
+      for (j=0; j<ncand; j++) {
+	if (j != k)
+	  d += lk->block((nnewg + 1) * csize[j], newrow[cslot[j]] + cn2g[j],
+			 lk) -
+	    lk->block(nnewg * csize[j], newrow[cslot[j]], lk);
       }
+      cdH[k] = d;
+      if (d < dHmin)
+	dHmin = d;
+    }
 
-      /* Add newg to shortlist (if it's not there already!) */
-      isinlist = 0;
-      for (slgn=0; slgn<slgsize; slgn++)
-	if (newgnum == slg[slgn])
-	  isinlist = 1;
-      if (isinlist == 0)
-	slg[slgsize++] = newgnum;
+    /* Empty destination */
+    nempty = (double)(ngroup - effectng);
+    dHempty = dHold + lk->linC + dHinc;
+    dHempty += lk->block(noldg - 1, n2oldg, lk) - lk->block(0, 0, lk);
+    for (j=0; j<ncand; j++)
+      dHempty += lk->block(csize[j], cn2g[j], lk) - lk->block(0, 0, lk);
+    if (nempty > 0 && dHempty < dHmin)
+      dHmin = dHempty;
+
+    /** CHOOSE THE MOVE **/
+    /* Cumulative weights: the candidates, then oldg, then the empty
+       groups */
+    d = 0.0;
+    for (k=0; k<ncand; k++) {
+      d += exp(-(cdH[k] - dHmin));
+      cw[k] = d;
     }
-  } /* nnod moves completed: done! */
+    d += exp(dHmin);
+    cw[ncand] = d;
+    d += nempty * exp(-(dHempty - dHmin));
+    dice = d * gsl_rng_uniform(gen);
+    for (target=0; target<ncand && cw[target]<=dice; target++);
+
+    if (target < ncand) {
+      newg = glist[clabel[target]];
+      d = cdH[target];
+    }
+    else if (dice < cw[ncand] || nempty == 0) {
+      newg = oldg;
+      d = 0.0;
+    }
+    else {
+      newg = GetEmptyGroup(part);
+      d = dHempty;
+    }
+
+    /* MAKE THE MOVE AND UPDATE MATRICES */
+    SBMMoveNode(node, oldg, newg, d, H, G2G, n2gList,
+		slg, &slgsize, &effectng);
+  }  /* nnod moves completed: done! */
 
   free_i_vec(slg);
+  free_i_vec(clabel);
+  free_i_vec(csize);
+  free_i_vec(cinlinks);
+  free_i_vec(cn2g);
+  free_i_vec(cslot);
+  free_d_vec(coldH);
+  free_d_vec(cdH);
+  free_d_vec(cw);
 }
 
-
 /*
   ---------------------------------------------------------------------
-  
+  Estimate the number of Metropolis steps (SBMMCStep with factor 1)
+  after which the partition is decorrelated from the current one.
+  The estimate is cached (see GetCachedDecorrelationStep) under the
+  name of the model, the network and linC.
   ---------------------------------------------------------------------
 */
 int
-GetDecorrelationStep(double *H,
-		     double linC,
-		     struct node_gra **nlist,
-		     struct group **glist,
-		     struct group *part,
-		     int nnod,
-		     int **G2G,
-		     int *n2gList,
-		     double **LogChooseList,
-		     int LogChooseListSize,
-		     double *LogFactList, int LogFactListSize,
-		     gsl_rng *gen,
-		     char verbose_sw)
+SBMGetDecorrelationStep(double *H,
+			const struct sbm_likelihood *lk,
+			struct node_gra **nlist,
+			struct group *part,
+			int nnod,
+			struct group_links *G2G,
+			gsl_rng *gen,
+			char verbose_sw)
 {
-  struct group *partRef;
-  int step, x1, x2;
-  double y1, y2;
-  double mutualInfo;
+  int x1, x2;
   int rep, nrep=10;
   double *decay, meanDecay, sigmaDecay, result;
   int norm=0;
-
-  x2 = nnod / 5;
-  x1 = x2 / 4;
-
-  /* Get the nrep initial estimates */
-  decay = allocate_d_vec(nrep);
-  for (rep=0; rep<nrep; rep++) {
+  int *nignored;
+  unsigned long *seeds;
+  unsigned long long key;
+
+  /* Seeds of the estimates, drawn even if the step is cached */
+  seeds = (unsigned long *)calloc(nrep, sizeof(unsigned long));
+  for (rep=0; rep<nrep; rep++)
+    seeds[rep] = gsl_rng_get(gen);
+
+  /* Reuse the step cached for this network and model, if any */
+  key = NodeListHash(nlist, nnod,
+		     hash_bytes(lk->name, strlen(lk->name), 0));
+  key = hash_bytes(&lk->linC, sizeof(double), key);
+  if ((result = GetCachedDecorrelationStep(key)) > 0) {
     switch (verbose_sw) {
     case 'q':
       break;
     default:
-      fprintf(stderr, "#\n# Estimating decorrelation time (%d/%d)\n",
-	      rep + 1, nrep);
+      fprintf(stderr, "# Using the cached decorrelation step\n");
       break;
     }
-    partRef = CopyPartition(part);
-    for (step=0; step<=x2; step++) {
-      LinkScoreMCStep(1, H, linC, nlist, glist, part,
-		      nnod, G2G, n2gList, LogChooseList, LogChooseListSize,
-		      LogFactList, LogFactListSize, 
-		      gen);
-      if (step == x1)
-	y1 = MutualInformation(partRef, part, 0);
-    }
-    y2 = MutualInformation(partRef, part, 0);
-    RemovePartition(partRef);
-    decay[rep] = 2. * CalculateDecay(nnod, x1, y1, x2, y2);
+    free(seeds);
+    return result;
+  }
+
+  x2 = nnod / 5;
+  x1 = x2 / 4;
+
+  /* Get the nrep initial estimates. They are independent, so they
+     run concurrently, each on its own copy of the current state and
+     with its own random number generator. */
+  decay = allocate_d_vec(nrep);
+  nignored = allocate_i_vec(nrep);
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "#\n# Estimating decorrelation time (%d estimates)\n",
+	    nrep);
+    break;
+  }
+#pragma omp parallel for schedule(dynamic, 1)
+  for (rep=0; rep<nrep; rep++) {
+    struct sbm_state *state = CopySBMState(nlist, part, nnod, G2G, *H);
+    gsl_rng *rgen = gsl_rng_alloc(gsl_rng_mt19937);
+    struct group *partRef;
+    double y1, y2;
+    int step;
+
+    gsl_rng_set(rgen, seeds[rep]);
+    nignored[rep] = 0;
+    do {
+      partRef = CopyPartition(state->part);
+      for (step=0; step<=x2; step++) {
+	SBMMCStep(1, &state->H, lk,
+		  state->nlist, state->glist, state->part,
+		  nnod, state->G2G, state->n2gList, rgen);
+	if (step == x1)
+	  y1 = MutualInformation(partRef, state->part, 0);
+      }
+      y2 = MutualInformation(partRef, state->part, 0);
+      RemovePartition(partRef);
+      decay[rep] = 2. * CalculateDecay(nnod, x1, y1, x2, y2);
+      if (decay[rep] < 0)
+	nignored[rep]++;
+    } while (decay[rep] < 0);
+    gsl_rng_free(rgen);
+    FreeSBMState(state);
+  }
+  for (rep=0; rep<nrep; rep++) {
     switch (verbose_sw) {
     case 'q':
       break;
     default:
+      if (nignored[rep] > 0)
+	fprintf(stderr, "#\tignoring %d negative estimate(s)...\n",
+		nignored[rep]);
       fprintf(stderr, "# Decorrelation time (estimate %d) = %g\n",
 	      rep + 1, decay[rep]);
       break;
     }
-    if (decay[rep] < 0) {
-      rep--;
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tignoring...\n");
-	break;
-      }
-    }
   }
   
   /* Get rid of bad estimates (Chauvenet criterion)  */
   meanDecay = mean(decay, nrep);
   sigmaDecay = stddev(decay, nrep);
-  result = meanDecay * nrep;
+  /* Average the accepted estimates (subtracting the rejected ones
+     from the total would lose all precision after a huge outlier) */
+  result = 0.;
   for (rep=0; rep<nrep; rep++) {
     if (fabs(decay[rep] - meanDecay) / sigmaDecay > 2) {
-      result -= decay[rep];
       switch (verbose_sw) {
       case 'q':
 	break;
@@ -412,36 +789,40 @@ GetDecorrelationStep(double *H,
       }
     }
     else {
+      result += decay[rep];
       norm++;
     }
   }
   
   /* Clean up */
   free_d_vec(decay);
+  free_i_vec(nignored);
+  free(seeds);
 
+  CacheDecorrelationStep(key, (int)(result / norm));
   return result / norm;
 }
 
 /*
   ---------------------------------------------------------------------
-  
+  Bring a sampler to equilibrium, with blocks of Metropolis steps
+  (decorStep steps each) or of heat-bath sweeps (one each, if
+  gibbs_sw is 1), until the energy stops decreasing
   ---------------------------------------------------------------------
 */
 void
-ThermalizeLinkScoreMC(int decorStep,
-		      double *H,
-		      double linC,
-		      struct node_gra **nlist,
-		      struct group **glist,
-		      struct group *part,
-		      int nnod,
-		      int **G2G,
-		      int *n2gList,
-		      double **LogChooseList,
-		      int LogChooseListSize,
-		      double *LogFactList, int LogFactListSize,
-		      gsl_rng *gen,
-		      char verbose_sw)
+SBMThermalize(char gibbs_sw,
+	      int decorStep,
+	      double *H,
+	      const struct sbm_likelihood *lk,
+	      struct node_gra **nlist,
+	      struct group **glist,
+	      struct group *part,
+	      int nnod,
+	      struct group_links *G2G,
+	      int *n2gList,
+	      gsl_rng *gen,
+	      char verbose_sw)
 {
   double HMean0=1.e10, HStd0=1.e-10, HMean1, HStd1, *Hvalues;
   int rep, nrep=20;
@@ -453,13 +834,18 @@ ThermalizeLinkScoreMC(int decorStep,
     
     /* MC steps */
     for (rep=0; rep<nrep; rep++) {
-      LinkScoreMCStep(decorStep, H, linC, nlist, glist, part,
-		      nnod, G2G, n2gList, LogChooseList, LogChooseListSize,
-		      LogFactList, LogFactListSize,
-		      gen);
+      if (gibbs_sw)
+	SBMGibbsStep(H, lk, nlist, glist, part, nnod, G2G, n2gList, gen);
+      else
+	SBMMCStep(decorStep, H, lk, nlist, glist, part,
+		  nnod, G2G, n2gList, gen);
       switch (verbose_sw) {
       case 'q':
 	break;
+      case 'd':
+	fprintf(stderr, "%lf %lf %d\n", *H, lk->partitionH(part, lk),
+		NNonEmptyGroups(part));
+	break;
       default:
 	fprintf(stderr, "%lf\n", *H);
 	break;
@@ -496,216 +882,2091 @@ ThermalizeLinkScoreMC(int decorStep,
       equilibrated = 0;
     }
 
-  } while (equilibrated < 5);
-  
-  /* Clean up */
-  free_d_vec(Hvalues);
+  } while (equilibrated < 5);
+  
+  /* Clean up */
+  free_d_vec(Hvalues);
+
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Plain block model versions of the sampler functions above, on
+  tables owned by the caller
+  ---------------------------------------------------------------------
+*/
+void
+LinkScoreMCStep(int factor,
+		double *H,
+		double linC,
+		struct node_gra **nlist,
+		struct group **glist,
+		struct group *part,
+		int nnod,
+		struct group_links *G2G,
+		int *n2gList,
+		double *LogChooseList,
+		int LogChooseListSize,
+		double *LogFactList, int LogFactListSize,
+		gsl_rng *gen)
+{
+  struct sbm_likelihood lk;
+
+  SetPlainLikelihood(&lk, linC, LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize);
+  SBMMCStep(factor, H, &lk, nlist, glist, part, nnod, G2G, n2gList, gen);
+  return;
+}
+
+int
+GetDecorrelationStep(double *H,
+		     double linC,
+		     struct node_gra **nlist,
+		     struct group *part,
+		     int nnod,
+		     struct group_links *G2G,
+		     double *LogChooseList,
+		     int LogChooseListSize,
+		     double *LogFactList, int LogFactListSize,
+		     gsl_rng *gen,
+		     char verbose_sw)
+{
+  struct sbm_likelihood lk;
+
+  SetPlainLikelihood(&lk, linC, LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize);
+  return SBMGetDecorrelationStep(H, &lk, nlist, part, nnod, G2G,
+				 gen, verbose_sw);
+}
+
+void
+ThermalizeLinkScoreMC(int decorStep,
+		      double *H,
+		      double linC,
+		      struct node_gra **nlist,
+		      struct group **glist,
+		      struct group *part,
+		      int nnod,
+		      struct group_links *G2G,
+		      int *n2gList,
+		      double *LogChooseList,
+		      int LogChooseListSize,
+		      double *LogFactList, int LogFactListSize,
+		      gsl_rng *gen,
+		      char verbose_sw)
+{
+  struct sbm_likelihood lk;
+
+  SetPlainLikelihood(&lk, linC, LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize);
+  SBMThermalize(0, decorStep, H, &lk, nlist, glist, part,
+		nnod, G2G, n2gList, gen, verbose_sw);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Group-to-group link counts
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Give group g a slot in the count matrix (if it does not have one
+  already), growing the matrix if it is full. The row and column of
+  a new slot are zero, which is right for a group that was empty.
+  ---------------------------------------------------------------------
+*/
+void
+GroupLinksActivate(struct group_links *gl, int g)
+{
+  int s, i, j, **count = NULL;
+
+  if (gl->slot[g] >= 0)
+    return;
+
+  if (gl->nfree > 0) {
+    s = gl->freeSlot[--gl->nfree];
+  }
+  else {
+    if (gl->nslot == gl->capacity) {
+      count = allocate_i_mat(2 * gl->capacity, 2 * gl->capacity);
+      for (i=0; i<2*gl->capacity; i++)
+	for (j=0; j<2*gl->capacity; j++)
+	  count[i][j] = (i < gl->capacity && j < gl->capacity) ?
+	    gl->count[i][j] : 0;
+      free_i_mat(gl->count, gl->capacity);
+      gl->count = count;
+      gl->capacity *= 2;
+    }
+    s = gl->nslot++;
+  }
+
+  for (i=0; i<gl->nslot; i++)
+    gl->count[s][i] = gl->count[i][s] = 0;
+  gl->slot[g] = s;
+  gl->label[s] = g;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Create the link counts between the groups of a partition with
+  nlabel group labels (0..nlabel-1). Only the non-empty groups get a
+  slot, so that the memory is O(B^2 + nlabel) for B non-empty groups.
+  ---------------------------------------------------------------------
+*/
+struct group_links *
+CreateGroupLinks(struct group *part, int nlabel)
+{
+  struct group_links *gl = NULL;
+  struct group *g = part;
+  struct node_lis *p = NULL, *nei = NULL;
+  int i, s, nonempty = 0;
+
+  gl = (struct group_links *)calloc(1, sizeof(struct group_links));
+  gl->nlabel = nlabel;
+  gl->slot = allocate_i_vec(nlabel);
+  gl->label = allocate_i_vec(nlabel);
+  gl->freeSlot = allocate_i_vec(nlabel);
+  for (i=0; i<nlabel; i++)
+    gl->slot[i] = gl->label[i] = -1;
+  while ((g = g->next) != NULL)
+    if (g->size > 0)
+      nonempty++;
+  gl->capacity = 16;
+  while (gl->capacity < nonempty)
+    gl->capacity *= 2;
+  gl->count = allocate_i_mat(gl->capacity, gl->capacity);
+
+  g = part;
+  while ((g = g->next) != NULL)
+    if (g->size > 0)
+      GroupLinksActivate(gl, g->label);
+
+  g = part;
+  while ((g = g->next) != NULL) {
+    if (g->size > 0) {
+      s = gl->slot[g->label];
+      gl->count[s][s] = g->inlinks;
+      p = g->nodeList;
+      while ((p = p->next) != NULL) {
+	nei = p->ref->neig;
+	while ((nei = nei->next) != NULL)
+	  if (nei->ref->inGroup != g->label)
+	    gl->count[s][gl->slot[nei->ref->inGroup]]++;
+      }
+    }
+  }
+
+  return gl;
+}
+
+struct group_links *
+CopyGroupLinks(struct group_links *gl)
+{
+  struct group_links *copy = NULL;
+
+  copy = (struct group_links *)calloc(1, sizeof(struct group_links));
+  *copy = *gl;
+  copy->slot = allocate_i_vec(gl->nlabel);
+  copy->label = allocate_i_vec(gl->nlabel);
+  copy->freeSlot = allocate_i_vec(gl->nlabel);
+  memcpy(copy->slot, gl->slot, gl->nlabel * sizeof(int));
+  memcpy(copy->label, gl->label, gl->nlabel * sizeof(int));
+  memcpy(copy->freeSlot, gl->freeSlot, gl->nlabel * sizeof(int));
+  copy->count = copy_i_mat(gl->count, gl->capacity, gl->capacity);
+  return copy;
+}
+
+void
+FreeGroupLinks(struct group_links *gl)
+{
+  free_i_mat(gl->count, gl->capacity);
+  free_i_vec(gl->slot);
+  free_i_vec(gl->label);
+  free_i_vec(gl->freeSlot);
+  free(gl);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Release the slots of the groups that have become empty, so that
+  they can be reused. If only a small fraction of the count matrix
+  is then in use (for instance, when the number of groups has
+  dropped after a random initial partition), the slots are renumbered
+  and the matrix is shrunk. The samplers call this at the beginning
+  of each step, when they build their shortlist of non-empty groups.
+  ---------------------------------------------------------------------
+*/
+void
+GroupLinksPrune(struct group_links *gl, struct group **glist)
+{
+  int s, t, s2, t2, nactive, capacity, **count = NULL;
+
+  for (s=0; s<gl->nslot; s++) {
+    if (gl->label[s] >= 0 && glist[gl->label[s]]->size == 0) {
+      gl->slot[gl->label[s]] = -1;
+      gl->label[s] = -1;
+      gl->freeSlot[gl->nfree++] = s;
+    }
+  }
+
+  /* Shrink the matrix if less than a quarter of it is in use */
+  nactive = gl->nslot - gl->nfree;
+  capacity = gl->capacity;
+  while (capacity > 16 && 4 * nactive < capacity)
+    capacity /= 2;
+  if (capacity == gl->capacity)
+    return;
+
+  /* Renumber the slots in use (the free slot stack, which is about
+     to be emptied, holds the new number of each old slot) */
+  for (s=0, t=0; s<gl->nslot; s++)
+    gl->freeSlot[s] = (gl->label[s] >= 0) ? t++ : -1;
+  count = allocate_i_mat(capacity, capacity);
+  for (s=0; s<gl->nslot; s++) {
+    if ((t = gl->freeSlot[s]) >= 0) {
+      for (s2=0; s2<gl->nslot; s2++)
+	if ((t2 = gl->freeSlot[s2]) >= 0)
+	  count[t][t2] = gl->count[s][s2];
+    }
+  }
+  for (s=0; s<gl->nslot; s++) {
+    if ((t = gl->freeSlot[s]) >= 0) {
+      gl->slot[gl->label[s]] = t;
+      gl->label[t] = gl->label[s];
+    }
+  }
+  for (s=nactive; s<gl->nslot; s++)
+    gl->label[s] = -1;
+  free_i_mat(gl->count, gl->capacity);
+  gl->count = count;
+  gl->capacity = capacity;
+  gl->nslot = nactive;
+  gl->nfree = 0;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Update the link counts after moving a node from group oldg to group
+  newg. n2gList holds the links from the node to each group in the
+  list glabels (of size ngroup), which must include all the groups
+  the node has links to; if glabels is NULL, n2gList must be valid
+  for all the groups that have a slot.
+  ---------------------------------------------------------------------
+*/
+void
+GroupLinksMoveNode(struct group_links *gl,
+		   int *glabels, int ngroup, int *n2gList,
+		   int oldg, int newg)
+{
+  int i, s, so, sn, n2g;
+
+  if (gl->slot[newg] < 0) {
+    GroupLinksActivate(gl, newg);
+    n2gList[newg] = 0;
+  }
+  so = gl->slot[oldg];
+  sn = gl->slot[newg];
+
+  if (glabels == NULL)
+    ngroup = gl->nslot;
+  for (i=0; i<ngroup; i++) {
+    if (glabels == NULL) {
+      if (gl->label[i] < 0)
+	continue;
+      s = i;
+      n2g = n2gList[gl->label[i]];
+    }
+    else {
+      s = gl->slot[glabels[i]];
+      n2g = n2gList[glabels[i]];
+    }
+    gl->count[s][so] -= n2g;
+    gl->count[so][s] = gl->count[s][so];
+    gl->count[s][sn] += n2g;
+    gl->count[sn][s] = gl->count[s][sn];
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Sampler state copies
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Copy the state of a sampler whose nnod nodes are in nlist (with
+  group labels 0..nnod-1) into new nodes, partition and link counts,
+  so that the copy can be sampled (for instance, in another thread)
+  without touching the original.
+  ---------------------------------------------------------------------
+*/
+struct sbm_state *
+CopySBMState(struct node_gra **nlist, struct group *part,
+	     int nnod, struct group_links *G2G, double H)
+{
+  struct sbm_state *state = NULL;
+  int i;
+
+  state = (struct sbm_state *)calloc(1, sizeof(struct sbm_state));
+  state->nnod = nnod;
+  state->nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
+  state->glist = (struct group **) calloc(nnod, sizeof(struct group *));
+  state->net = CopyNodeList(nlist, nnod, state->nlist);
+  state->part = CopyPartitionToNodes(part, state->nlist, state->glist);
+  state->G2G = CopyGroupLinks(G2G);
+  state->n2gList = allocate_i_vec(nnod);
+  for (i=0; i<nnod; i++)
+    state->n2gList[i] = 0;
+  state->H = H;
+  return state;
+}
+
+void
+FreeSBMState(struct sbm_state *state)
+{
+  RemovePartition(state->part);
+  RemoveGraph(state->net);
+  free(state->glist);
+  free(state->nlist);
+  FreeGroupLinks(state->G2G);
+  free_i_vec(state->n2gList);
+  free(state);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Candidate pairs
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Create a list of npair (empty) candidate pairs with zero scores
+  ---------------------------------------------------------------------
+*/
+struct pair_score *
+CreatePairScore(int npair)
+{
+  struct pair_score *cand;
+
+  cand = (struct pair_score *)calloc(1, sizeof(struct pair_score));
+  cand->npair = npair;
+  cand->n1 = (int *)calloc(npair + 1, sizeof(int));
+  cand->n2 = (int *)calloc(npair + 1, sizeof(int));
+  cand->score = (double *)calloc(npair + 1, sizeof(double));
+  return cand;
+}
+
+void
+FreePairScore(struct pair_score *cand)
+{
+  free(cand->n1);
+  free(cand->n2);
+  free(cand->score);
+  free(cand);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Candidate pairs of a network: all its links, plus nnonlink
+  non-links chosen at random (all the non-links if nnonlink < 0 or
+  nnonlink is larger than the number of non-links). The links come
+  first, with n1 < n2.
+  ---------------------------------------------------------------------
+*/
+struct pair_score *
+CandidatePairs(struct node_gra *net, int nnonlink, gsl_rng *gen)
+{
+  int nnod = CountNodes(net), nlink = 0, npair = 0, nadja = 0, i, j, tmp;
+  long int nnonlinkTot;
+  int *link1 = NULL, *link2 = NULL;
+  struct node_gra *p = NULL;
+  struct node_lis *adja = NULL;
+  struct hashset *seen = NULL;
+  struct pair_score *cand = NULL;
+
+  /* Collect the links, once each (there may be repeated neighbors) */
+  p = net;
+  while ((p = p->next) != NULL)
+    nadja += NodeDegree(p);
+  link1 = allocate_i_vec(nadja + 1);
+  link2 = allocate_i_vec(nadja + 1);
+  seen = hashset_create(nadja);
+  p = net;
+  while ((p = p->next) != NULL) {
+    adja = p->neig;
+    while ((adja = adja->next) != NULL) {
+      if (p->num < adja->node &&
+	  hashset_add(seen, ((unsigned long long)p->num << 32) | adja->node)) {
+	link1[nlink] = p->num;
+	link2[nlink] = adja->node;
+	nlink++;
+      }
+    }
+  }
+  nnonlinkTot = (long int)nnod * (nnod - 1) / 2 - nlink;
+  if (nnonlink < 0 || nnonlink > nnonlinkTot)
+    nnonlink = nnonlinkTot;
+
+  /* Links */
+  cand = CreatePairScore(nlink + nnonlink);
+  for (npair=0; npair<nlink; npair++) {
+    cand->n1[npair] = link1[npair];
+    cand->n2[npair] = link2[npair];
+  }
+  free_i_vec(link1);
+  free_i_vec(link2);
+
+  /* Non-links: all of them, or sampled without repetition */
+  if (nnonlink == nnonlinkTot) {
+    for (i=0; i<nnod; i++) {
+      for (j=i+1; j<nnod; j++) {
+	if (!hashset_contains(seen, ((unsigned long long)i << 32) | j)) {
+	  cand->n1[npair] = i;
+	  cand->n2[npair] = j;
+	  npair++;
+	}
+      }
+    }
+  }
+  else {
+    while (npair < nlink + nnonlink) {
+      i = floor(gsl_rng_uniform(gen) * (double)nnod);
+      j = floor(gsl_rng_uniform(gen) * (double)nnod);
+      if (i == j)
+	continue;
+      if (i > j) {
+	tmp = i; i = j; j = tmp;
+      }
+      if (hashset_add(seen, ((unsigned long long)i << 32) | j)) {
+	cand->n1[npair] = i;
+	cand->n2[npair] = j;
+	npair++;
+      }
+    }
+  }
+
+  hashset_free(seen);
+  return cand;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Read candidate pairs from a file with two node labels per line
+  (anything else in the line is ignored). Pairs with labels that are
+  not in the network (or too long to be) and pairs of a node with
+  itself are skipped with a warning; repeated pairs (in either order)
+  are kept only once.
+  ---------------------------------------------------------------------
+*/
+struct pair_score *
+FReadCandidatePairs(FILE *inF, struct node_gra *net)
+{
+  char label1[MAX_LABEL_LENGTH], label2[MAX_LABEL_LENGTH];
+  char format[32];
+  void *nodeDict = MakeLabelDict(net);
+  struct node_gra *node1 = NULL, *node2 = NULL;
+  struct pair_score *cand = CreatePairScore(1024);
+  struct hashset *seen = hashset_create(1024);
+  int capacity = 1024, npair = 0, i, j;
+
+  /* Read at most MAX_LABEL_LENGTH - 1 characters per label, and skip
+     the rest of the line */
+  sprintf(format, "%%%ds %%%ds%%*[^\n]",
+	  MAX_LABEL_LENGTH - 1, MAX_LABEL_LENGTH - 1);
+  while (fscanf(inF, format, label1, label2) == 2) {
+    node1 = GetNodeDict(label1, nodeDict);
+    node2 = GetNodeDict(label2, nodeDict);
+    if (node1 == NULL || node2 == NULL) {
+      fprintf(stderr, "WARNING: skipping pair %s %s (unknown node)\n",
+	      label1, label2);
+      continue;
+    }
+    if (node1 == node2) {
+      fprintf(stderr, "WARNING: skipping pair %s %s (same node)\n",
+	      label1, label2);
+      continue;
+    }
+    i = (node1->num < node2->num) ? node1->num : node2->num;
+    j = (node1->num < node2->num) ? node2->num : node1->num;
+    if (!hashset_add(seen, ((unsigned long long)i << 32) | j))
+      continue;
+    if (npair == capacity) {
+      capacity *= 2;
+      cand->n1 = (int *)realloc(cand->n1, capacity * sizeof(int));
+      cand->n2 = (int *)realloc(cand->n2, capacity * sizeof(int));
+      cand->score = (double *)realloc(cand->score, capacity * sizeof(double));
+    }
+    cand->n1[npair] = node1->num;
+    cand->n2[npair] = node2->num;
+    cand->score[npair] = 0.0;
+    npair++;
+  }
+  cand->npair = npair;
+
+  hashset_free(seen);
+  FreeLabelDict(nodeDict);
+  return cand;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Number of links l and of possible links r between the groups of
+  two nodes (which may be the same group), given the group list and
+  the group-to-group link counts used by the samplers
+  ---------------------------------------------------------------------
+*/
+void
+GroupPairLinks(struct node_gra *n1, struct node_gra *n2,
+	       struct group **glist, struct group_links *G2G,
+	       int *l, int *r)
+{
+  struct group *g1 = glist[n1->inGroup], *g2 = glist[n2->inGroup];
+
+  if (g1 == g2) {
+    *l = g1->inlinks;
+    *r = g1->size * (g1->size - 1) / 2;
+  }
+  else {
+    *l = G2G_LINKS(G2G, g1->label, g2->label);
+    *r = g1->size * g2->size;
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Packed matrix of pair scores
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Create a matrix of pair scores, all 0. If accumulate is 1, the
+  scores are meant to be summed with PairMatrixAdd and normalized
+  with FinishPairMatrix.
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix *
+CreatePairMatrix(int nnod, char accumulate)
+{
+  struct pair_matrix *pm = NULL;
+  long int npair = (long int)nnod * (nnod - 1) / 2;
+
+  pm = (struct pair_matrix *)calloc(1, sizeof(struct pair_matrix));
+  pm->nnod = nnod;
+  pm->score = (float *)calloc(npair + 1, sizeof(float));
+  if (accumulate == 1)
+    pm->comp = (float *)calloc(npair + 1, sizeof(float));
+  else
+    pm->comp = NULL;
+  return pm;
+}
+
+void
+FreePairMatrix(struct pair_matrix *pm)
+{
+  free(pm->score);
+  if (pm->comp != NULL)
+    free(pm->comp);
+  free(pm);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Score of the pair i-j, in any order (0 if i == j)
+  ---------------------------------------------------------------------
+*/
+double
+PairMatrixGet(const struct pair_matrix *pm, int i, int j)
+{
+  if (i < j)
+    return pm->score[PAIR_MATRIX_INDEX(pm->nnod, i, j)];
+  else if (i > j)
+    return pm->score[PAIR_MATRIX_INDEX(pm->nnod, j, i)];
+  else
+    return 0.0;
+}
+
+/* Kahan summation of x into the score of the pair at index k */
+static void
+PairMatrixAddAt(struct pair_matrix *pm, long int k, float x)
+{
+  float y = x - pm->comp[k];
+  float t = pm->score[k] + y;
+
+  pm->comp[k] = (t - pm->score[k]) - y;
+  pm->score[k] = t;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Add x to the score of the pair i-j (i != j, in any order) of a
+  matrix created to accumulate
+  ---------------------------------------------------------------------
+*/
+void
+PairMatrixAdd(struct pair_matrix *pm, int i, int j, double x)
+{
+  if (i < j)
+    PairMatrixAddAt(pm, PAIR_MATRIX_INDEX(pm->nnod, i, j), (float)x);
+  else
+    PairMatrixAddAt(pm, PAIR_MATRIX_INDEX(pm->nnod, j, i), (float)x);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Divide the accumulated scores by norm, folding in the
+  compensations (which are freed)
+  ---------------------------------------------------------------------
+*/
+void
+FinishPairMatrix(struct pair_matrix *pm, double norm)
+{
+  long int k, npair = (long int)pm->nnod * (pm->nnod - 1) / 2;
+
+  if (pm->comp != NULL) {
+    for (k=0; k<npair; k++)
+      pm->score[k] = ((double)pm->score[k] - (double)pm->comp[k]) / norm;
+    free(pm->comp);
+    pm->comp = NULL;
+  }
+  else {
+    for (k=0; k<npair; k++)
+      pm->score[k] /= norm;
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Output of link reliabilities
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Default output: all pairs, as text, to missingF and spuriousF
+  ---------------------------------------------------------------------
+*/
+void
+SetLSOutput(struct ls_output *out, char *missingF, char *spuriousF)
+{
+  out->missingF = missingF;
+  out->spuriousF = spuriousF;
+  out->binaryF = NULL;
+  out->topk = 0;
+  out->perNode = 0;
+  out->threshold_sw = 0;
+  out->threshold = 0.0;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Handle one of the output command line options (LS_OUTPUT_OPTIONS,
+  for getopt). Returns 1 if opt is one of them, and 0 otherwise.
+  ---------------------------------------------------------------------
+*/
+int
+LSOutputOption(struct ls_output *out, int opt, char *arg)
+{
+  switch (opt) {
+  case 'm':
+    out->missingF = arg;
+    break;
+  case 's':
+    out->spuriousF = arg;
+    break;
+  case 'k':
+    out->topk = atoi(arg);
+    out->perNode = 1;
+    break;
+  case 'K':
+    out->topk = atoi(arg);
+    out->perNode = 0;
+    break;
+  case 'T':
+    out->threshold_sw = 1;
+    out->threshold = atof(arg);
+    break;
+  case 'b':
+    out->binaryF = arg;
+    break;
+  default:
+    return 0;
+  }
+  return 1;
+}
+
+void
+PrintLSOutputUsage(void)
+{
+  printf("  -m file: scores of the non-links (- for stdout)\n");
+  printf("  -s file: scores of the links\n");
+  printf("  -k topk: only the topk best non-links and worst links of each node\n");
+  printf("  -K topk: only the topk best non-links and worst links overall\n");
+  printf("  -T threshold: only non-links scoring >= threshold and links\n");
+  printf("     scoring < threshold\n");
+  printf("  -b file: binary dump of all the scores instead (floats for the\n");
+  printf("     pairs i < j, then the node labels)\n");
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Buffered writer: text is accumulated in one buffer while the other
+  one is written to the file by a separate task, so that formatting
+  and I/O overlap. The tasks only run in parallel inside an OpenMP
+  parallel region (see FWriteLinkScores); elsewhere, they run in
+  place.
+  ---------------------------------------------------------------------
+*/
+#define LS_WRITER_BUFSIZE (1 << 20)
+
+struct ls_writer{
+  FILE *outF;
+  char *buf[2];
+  size_t len;       // bytes used in the current buffer
+  int cur;          // current buffer
+};
+
+static struct ls_writer *
+CreateLSWriter(char *fileName, char *mode)
+{
+  struct ls_writer *w = NULL;
+  FILE *outF = NULL;
+
+  if (strcmp(fileName, "-") == 0)
+    outF = stdout;
+  else if ((outF = fopen(fileName, mode)) == NULL)
+    return NULL;
+  w = (struct ls_writer *)calloc(1, sizeof(struct ls_writer));
+  w->outF = outF;
+  w->buf[0] = (char *)malloc(LS_WRITER_BUFSIZE);
+  w->buf[1] = (char *)malloc(LS_WRITER_BUFSIZE);
+  w->len = 0;
+  w->cur = 0;
+  return w;
+}
+
+static void
+LSWriterFlush(struct ls_writer *w)
+{
+  char *buf = w->buf[w->cur];
+  size_t len = w->len;
+  FILE *outF = w->outF;
+
+  /* The other buffer may still be being written */
+#pragma omp taskwait
+#pragma omp task firstprivate(buf, len, outF)
+  fwrite(buf, 1, len, outF);
+  w->cur = 1 - w->cur;
+  w->len = 0;
+  return;
+}
+
+static void
+LSWriterPair(struct ls_writer *w, double score, char *label1, char *label2)
+{
+  if (LS_WRITER_BUFSIZE - w->len < 2 * MAX_LABEL_LENGTH + 64)
+    LSWriterFlush(w);
+  w->len += sprintf(w->buf[w->cur] + w->len, "%g %s %s\n",
+		    score, label1, label2);
+  return;
+}
+
+static void
+LSWriterBytes(struct ls_writer *w, const void *data, size_t size)
+{
+  size_t n;
+
+  while (size > 0) {
+    if (w->len == LS_WRITER_BUFSIZE)
+      LSWriterFlush(w);
+    n = LS_WRITER_BUFSIZE - w->len;
+    if (n > size)
+      n = size;
+    memcpy(w->buf[w->cur] + w->len, data, n);
+    w->len += n;
+    data = (const char *)data + n;
+    size -= n;
+  }
+  return;
+}
+
+static void
+FreeLSWriter(struct ls_writer *w)
+{
+  LSWriterFlush(w);
+#pragma omp taskwait
+  if (w->outF == stdout)
+    fflush(stdout);
+  else
+    fclose(w->outF);
+  free(w->buf[0]);
+  free(w->buf[1]);
+  free(w);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Bounded min-heap of the (at most) k pairs with the highest
+  sign * score, in the slots [0, k) of n1, n2 and score. The
+  smallest one is at the root.
+  ---------------------------------------------------------------------
+*/
+static void
+PairKeepHeapSiftDown(int *n1, int *n2, double *score, int size,
+		     double sign, int a, int b, double s)
+{
+  int i = 0, child;
+
+  while ((child = 2 * i + 1) < size) {
+    if (child + 1 < size && sign * score[child + 1] < sign * score[child])
+      child++;
+    if (sign * s <= sign * score[child])
+      break;
+    n1[i] = n1[child];
+    n2[i] = n2[child];
+    score[i] = score[child];
+    i = child;
+  }
+  n1[i] = a;
+  n2[i] = b;
+  score[i] = s;
+  return;
+}
+
+static void
+PairKeepHeapAdd(int *n1, int *n2, double *score, int *size, int k,
+		double sign, int a, int b, double s)
+{
+  int i;
+
+  if (*size < k) {
+    /* Sift up */
+    i = (*size)++;
+    while (i > 0 && sign * score[(i - 1) / 2] > sign * s) {
+      n1[i] = n1[(i - 1) / 2];
+      n2[i] = n2[(i - 1) / 2];
+      score[i] = score[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    n1[i] = a;
+    n2[i] = b;
+    score[i] = s;
+  }
+  else if (k > 0 && sign * s > sign * score[0]) {
+    PairKeepHeapSiftDown(n1, n2, score, k, sign, a, b, s);
+  }
+  return;
+}
+
+/* Sort the heap in place, by decreasing sign * score */
+static void
+PairKeepHeapSort(int *n1, int *n2, double *score, int size, double sign)
+{
+  int end, a, b;
+  double s;
+
+  for (end=size-1; end>0; end--) {
+    a = n1[end];
+    b = n2[end];
+    s = score[end];
+    n1[end] = n1[0];
+    n2[end] = n2[0];
+    score[end] = score[0];
+    PairKeepHeapSiftDown(n1, n2, score, end, sign, a, b, s);
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Where each scored pair goes: straight to the writer of its class
+  (0 for non-links, 1 for links) or, for top-k output, to the heaps
+  of its class (one per node, or a single one)
+  ---------------------------------------------------------------------
+*/
+struct ls_pair_out{
+  struct ls_output *out;
+  struct ls_writer *w[2];
+  struct pair_score *keep[2];
+  int *keepSize[2];
+};
+
+static void
+LSOutputPair(struct ls_pair_out *po, struct node_gra **nlist,
+	     int n1, int n2, double score, int islink)
+{
+  struct ls_output *out = po->out;
+  struct pair_score *keep = po->keep[islink];
+  int k = out->topk;
+  double sign = (islink == 0) ? 1.0 : -1.0;  // best non-links, worst links
+
+  if (out->threshold_sw == 1 &&
+      ((islink == 0 && score < out->threshold) ||
+       (islink == 1 && score >= out->threshold)))
+    return;
+
+  if (k <= 0) {
+    LSWriterPair(po->w[islink], score, nlist[n1]->label, nlist[n2]->label);
+  }
+  else if (out->perNode == 1) {
+    PairKeepHeapAdd(&keep->n1[n1 * k], &keep->n2[n1 * k],
+		    &keep->score[n1 * k], &po->keepSize[islink][n1], k,
+		    sign, n1, n2, score);
+    PairKeepHeapAdd(&keep->n1[n2 * k], &keep->n2[n2 * k],
+		    &keep->score[n2 * k], &po->keepSize[islink][n2], k,
+		    sign, n2, n1, score);
+  }
+  else {
+    PairKeepHeapAdd(keep->n1, keep->n2, keep->score, &po->keepSize[islink][0],
+		    k, sign, n1, n2, score);
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Binary dump of a matrix of pair scores (see FWriteLinkScores)
+  ---------------------------------------------------------------------
+*/
+static int
+FWriteBinaryLinkScores(char *fileName, struct node_gra **nlist, int nnod,
+		       struct pair_matrix *predA)
+{
+  struct ls_writer *w = NULL;
+  int header[3] = {1, nnod, 0};  // version, nnod, reserved
+  int i;
+
+  if ((w = CreateLSWriter(fileName, "wb")) == NULL)
+    return 1;
+  LSWriterBytes(w, "RGLS", 4);
+  LSWriterBytes(w, header, sizeof(header));
+  LSWriterBytes(w, predA->score,
+		(size_t)nnod * (nnod - 1) / 2 * sizeof(float));
+  for (i=0; i<nnod; i++)
+    LSWriterBytes(w, nlist[i]->label, strlen(nlist[i]->label) + 1);
+  FreeLSWriter(w);
+  return 0;
+}
+
+static int
+LSWriteLinkScores(struct ls_output *out,
+		  struct node_gra *net,
+		  struct pair_matrix *predA,
+		  struct pair_score *cand)
+{
+  int nnod = CountNodes(net), nheap, c, h, i;
+  struct node_gra **nlist = NULL, *p1, *p2;
+  struct node_lis *adja;
+  struct ls_pair_out po;
+  struct pair_score *keep;
+  int *mark = NULL;
+  int status = 0;
+
+  nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
+  p1 = net;
+  while ((p1 = p1->next) != NULL)
+    nlist[p1->num] = p1;
+
+  /* Binary dump */
+  if (out->binaryF != NULL) {
+    if (predA == NULL) {
+      fprintf(stderr, "FWriteLinkScores: the binary dump needs the scores of all pairs\n");
+      status = 1;
+    }
+    else if (FWriteBinaryLinkScores(out->binaryF, nlist, nnod, predA) != 0) {
+      fprintf(stderr, "FWriteLinkScores: cannot open %s\n", out->binaryF);
+      status = 1;
+    }
+    free(nlist);
+    return status;
+  }
+
+  /* Text output */
+  po.out = out;
+  if ((po.w[0] = CreateLSWriter(out->missingF, "w")) == NULL) {
+    fprintf(stderr, "FWriteLinkScores: cannot open %s\n", out->missingF);
+    free(nlist);
+    return 1;
+  }
+  if (out->spuriousF == NULL) {
+    po.w[1] = po.w[0];
+  }
+  else if ((po.w[1] = CreateLSWriter(out->spuriousF, "w")) == NULL) {
+    fprintf(stderr, "FWriteLinkScores: cannot open %s\n", out->spuriousF);
+    FreeLSWriter(po.w[0]);
+    free(nlist);
+    return 1;
+  }
+  nheap = (out->perNode == 1) ? nnod : 1;
+  for (c=0; c<2; c++) {
+    po.keep[c] = NULL;
+    po.keepSize[c] = NULL;
+    if (out->topk > 0) {
+      po.keep[c] = CreatePairScore(nheap * out->topk);
+      po.keepSize[c] = allocate_i_vec(nheap);
+      for (h=0; h<nheap; h++)
+	po.keepSize[c][h] = 0;
+    }
+  }
+
+  /* Go through the pairs */
+  if (predA != NULL) {
+    /* Mark the neighbors of each node instead of looking for each
+       pair in the adjacency lists */
+    mark = allocate_i_vec(nnod);
+    for (i=0; i<nnod; i++)
+      mark[i] = -1;
+    p1 = net;
+    while ((p1 = p1->next) != NULL) {
+      adja = p1->neig;
+      while ((adja = adja->next) != NULL)
+	mark[adja->node] = p1->num;
+      p2 = p1;
+      while ((p2 = p2->next) != NULL)
+	LSOutputPair(&po, nlist, p1->num, p2->num,
+		     PairMatrixGet(predA, p1->num, p2->num),
+		     mark[p2->num] == p1->num);
+    }
+    free_i_vec(mark);
+  }
+  else {
+    for (i=0; i<cand->npair; i++)
+      LSOutputPair(&po, nlist, cand->n1[i], cand->n2[i], cand->score[i],
+		   IsThereLink(nlist[cand->n1[i]], nlist[cand->n2[i]]));
+  }
+
+  /* Top-k pairs, sorted (node by node, if perNode) */
+  if (out->topk > 0) {
+    for (c=0; c<2; c++) {
+      keep = po.keep[c];
+      for (h=0; h<nheap; h++) {
+	i = h * out->topk;
+	PairKeepHeapSort(&keep->n1[i], &keep->n2[i], &keep->score[i],
+			 po.keepSize[c][h], (c == 0) ? 1.0 : -1.0);
+	for (; i<h*out->topk+po.keepSize[c][h]; i++)
+	  LSWriterPair(po.w[c], keep->score[i],
+		       nlist[keep->n1[i]]->label, nlist[keep->n2[i]]->label);
+      }
+      FreePairScore(keep);
+      free_i_vec(po.keepSize[c]);
+    }
+  }
+
+  if (po.w[1] != po.w[0])
+    FreeLSWriter(po.w[1]);
+  FreeLSWriter(po.w[0]);
+  free(nlist);
+  return status;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Write the link reliabilities of net, either the matrix predA of
+  all pairs or the candidate pairs cand (if predA is NULL), as set in
+  out. The formatting happens while a second thread writes the
+  previous buffer to disk. Returns 0 on success.
+
+  The binary dump (out->binaryF, predA only) holds, in native byte
+  order: the 4 characters "RGLS"; three ints (format version 1,
+  nnod, 0); the scores of the pairs i < j as floats, as in
+  predA->score (see PAIR_MATRIX_INDEX); and the labels of the
+  nodes, in the order of their num, each followed by '\0'.
+  ---------------------------------------------------------------------
+*/
+int
+FWriteLinkScores(struct ls_output *out,
+		 struct node_gra *net,
+		 struct pair_matrix *predA,
+		 struct pair_score *cand)
+{
+  int status = 0;
+
+#pragma omp parallel num_threads(2)
+  {
+#pragma omp single
+    status = LSWriteLinkScores(out, net, predA, cand);
+  }
+  return status;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Deferred scores: samples of the block model
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Create an (empty) store for nsample samples of a network with nnod
+  nodes
+  ---------------------------------------------------------------------
+*/
+struct sbm_samples *
+CreateSBMSamples(int nnod, int nsample)
+{
+  struct sbm_samples *samples;
+
+  samples = (struct sbm_samples *)calloc(1, sizeof(struct sbm_samples));
+  samples->nnod = nnod;
+  samples->nsample = 0;
+  samples->capacity = nsample;
+  samples->n2g = (int *)malloc(((long int)nsample * nnod + 1) * sizeof(int));
+  samples->ngroup = allocate_i_vec(nsample + 1);
+  samples->offset = (long int *)malloc((nsample + 1) * sizeof(long int));
+  samples->contribCapacity = 1024;
+  samples->ncontrib = 0;
+  samples->contrib = (float *)malloc(samples->contribCapacity *
+				     sizeof(float));
+  return samples;
+}
+
+void
+FreeSBMSamples(struct sbm_samples *samples)
+{
+  free(samples->n2g);
+  free_i_vec(samples->ngroup);
+  free(samples->offset);
+  free(samples->contrib);
+  free(samples);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Record the current partition of a sampler: the (compact) group of
+  each node and the contribution lk->score(r, l) of each pair of
+  non-empty groups. This costs O(nnod + ngroup^2), instead of the
+  O(nnod^2) of updating the scores of all node pairs.
+  ---------------------------------------------------------------------
+*/
+void
+AddSBMSample(struct sbm_samples *samples,
+	     const struct sbm_likelihood *lk,
+	     struct node_gra **nlist, struct group **glist, struct group_links *G2G)
+{
+  int nnod = samples->nnod, K = 0, a, b, ga, gb, i, l, r;
+  int *n2g = NULL, *gmap = NULL, *glabel = NULL;
+  float *contrib = NULL;
+
+  if (samples->nsample == samples->capacity) {
+    fprintf(stderr, "ERROR: No room for more samples in AddSBMSample\n");
+    exit(1);
+  }
+
+  /* Compact labels of the non-empty groups */
+  gmap = allocate_i_vec(nnod + 1);
+  glabel = allocate_i_vec(nnod + 1);
+  for (i=0; i<nnod; i++) {
+    if (glist[i]->size > 0) {
+      gmap[i] = K;
+      glabel[K++] = i;
+    }
+  }
+  n2g = samples->n2g + (long int)samples->nsample * nnod;
+  for (i=0; i<nnod; i++)
+    n2g[i] = gmap[nlist[i]->inGroup];
+
+  /* Contributions of the group pairs (upper triangle, row by row) */
+  samples->offset[samples->nsample] = samples->ncontrib;
+  samples->ngroup[samples->nsample] = K;
+  while (samples->ncontrib + (long int)K * (K + 1) / 2 >
+	 samples->contribCapacity) {
+    samples->contribCapacity *= 2;
+    samples->contrib = (float *)realloc(samples->contrib,
+					samples->contribCapacity *
+					sizeof(float));
+  }
+  contrib = samples->contrib + samples->ncontrib;
+  for (a=0; a<K; a++) {
+    ga = glabel[a];
+    for (b=a; b<K; b++) {
+      gb = glabel[b];
+      if (a == b) {
+	l = glist[ga]->inlinks;
+	r = glist[ga]->size * (glist[ga]->size - 1) / 2;
+      }
+      else {
+	l = G2G_LINKS(G2G, ga, gb);
+	r = glist[ga]->size * glist[gb]->size;
+      }
+      *contrib++ = lk->score(r, l, lk);
+    }
+  }
+  samples->ncontrib += (long int)K * (K + 1) / 2;
+  samples->nsample++;
+
+  free_i_vec(gmap);
+  free_i_vec(glabel);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Score of the pair of nodes n1-n2 (n1 != n2), averaged over all the
+  recorded samples
+  ---------------------------------------------------------------------
+*/
+double
+SBMSamplesPairScore(struct sbm_samples *samples, int n1, int n2)
+{
+  int s, a, b, K, tmp, *n2g;
+  double score = 0.0;
+
+  for (s=0; s<samples->nsample; s++) {
+    n2g = samples->n2g + (long int)s * samples->nnod;
+    K = samples->ngroup[s];
+    a = n2g[n1];
+    b = n2g[n2];
+    if (a > b) {
+      tmp = a; a = b; b = tmp;
+    }
+    score += samples->contrib[samples->offset[s] +
+			      (long int)a * K - (long int)a * (a - 1) / 2 +
+			      (b - a)];
+  }
+  return score / (double)samples->nsample;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Scores of all node pairs (as returned by LinkScore), computed from
+  the samples in parallel, one row (the pairs i < j of node i) per
+  thread at a time
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix *
+SBMSamplesScoreMatrix(struct sbm_samples *samples)
+{
+  int nnod = samples->nnod, i;
+  struct pair_matrix *predA = CreatePairMatrix(nnod, 0);
+
+#pragma omp parallel
+  {
+    double *row = allocate_d_vec(nnod);
+
+#pragma omp for schedule(dynamic)
+    for (i=0; i<nnod-1; i++) {
+      int j, s, a, b, K, *n2g;
+      float *contrib, *score;
+
+      for (j=i+1; j<nnod; j++)
+	row[j] = 0.0;
+      for (s=0; s<samples->nsample; s++) {
+	n2g = samples->n2g + (long int)s * nnod;
+	contrib = samples->contrib + samples->offset[s];
+	K = samples->ngroup[s];
+	a = n2g[i];
+	for (j=i+1; j<nnod; j++) {
+	  b = n2g[j];
+	  if (a <= b)
+	    row[j] += contrib[(long int)a * K - (long int)a * (a - 1) / 2 +
+			      (b - a)];
+	  else
+	    row[j] += contrib[(long int)b * K - (long int)b * (b - 1) / 2 +
+			      (a - b)];
+	}
+      }
+      score = &predA->score[PAIR_MATRIX_INDEX(nnod, i, i + 1)];
+      for (j=i+1; j<nnod; j++)
+	score[j - i - 1] = row[j] / (double)samples->nsample;
+    }
+
+    free_d_vec(row);
+  }
+
+  return predA;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Scores of a set of candidate pairs, computed from the samples in
+  parallel
+  ---------------------------------------------------------------------
+*/
+void
+SBMSamplesCandidateScores(struct sbm_samples *samples,
+			  struct pair_score *cand)
+{
+  int pair;
+
+#pragma omp parallel for schedule(static)
+  for (pair=0; pair<cand->npair; pair++)
+    cand->score[pair] = SBMSamplesPairScore(samples,
+					    cand->n1[pair], cand->n2[pair]);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+  Link reliability chains
+  ---------------------------------------------------------------------
+  ---------------------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------------------------
+  Start a Markov chain over the partitions of net from a random
+  partition, without bringing it to equilibrium (see CreateLSChain)
+  ---------------------------------------------------------------------
+*/
+static struct ls_chain *
+StartLSChain(struct node_gra *net,
+	     const struct sbm_likelihood *lk,
+	     char gibbs_sw,
+	     gsl_rng *gen)
+{
+  struct ls_chain *chain = NULL;
+  int nnod = CountNodes(net), i, dice;
+  struct node_gra *p = NULL;
+  struct group *lastg = NULL;
+
+  chain = (struct ls_chain *)calloc(1, sizeof(struct ls_chain));
+  chain->nnod = nnod;
+  chain->gibbs_sw = gibbs_sw;
+  chain->lk = lk;
+  chain->gen = gen;
+  chain->decorStep = 1;
+  chain->niter = 0;
+
+  /* Map nodes and groups to a list for faster access */
+  chain->nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
+  chain->glist = (struct group **) calloc(nnod, sizeof(struct group *));
+  lastg = chain->part = CreateHeaderGroup();
+  p = net;
+  while ((p = p->next) != NULL) {
+    chain->nlist[p->num] = p;
+    lastg = chain->glist[p->num] = CreateGroup(lastg, p->num);
+  }
+
+  /* Place nodes in random partitions (the heat-bath chain starts
+     from one node per group) */
+  p = net;
+  ResetNetGroup(net);
+  while ((p = p->next) != NULL) {
+    dice = floor(gsl_rng_uniform(gen) * (double)nnod);
+    if (gibbs_sw)
+      AddNodeToGroup(chain->glist[p->num], p);
+    else
+      AddNodeToGroup(chain->glist[dice], p);
+  }
+
+  /* Get the initial group-to-group links matrix */
+  chain->G2G = CreateGroupLinks(chain->part, nnod);
+  chain->n2gList = allocate_i_vec(nnod);
+  for (i=0; i<nnod; i++)
+    chain->n2gList[i] = 0;
+  chain->H = lk->partitionH(chain->part, lk);
+
+  return chain;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Estimate the decorrelation step of a Metropolis chain from its
+  current state
+  ---------------------------------------------------------------------
+*/
+static void
+LSChainDecorrelationStep(struct ls_chain *chain, char verbose_sw)
+{
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "# CALCULATING DECORRELATION TIME\n");
+    fprintf(stderr, "# ------------------------------\n");
+    break;
+  }
+  chain->decorStep = SBMGetDecorrelationStep(&chain->H, chain->lk,
+					     chain->nlist, chain->part,
+					     chain->nnod, chain->G2G,
+					     chain->gen, verbose_sw);
+  /* A degenerate decay estimate must not freeze the chain */
+  if (chain->decorStep < 1)
+    chain->decorStep = 1;
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "\n# Decorrelation step = %d\n\n", chain->decorStep);
+    break;
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Bring a chain to equilibrium
+  ---------------------------------------------------------------------
+*/
+static void
+ThermalizeLSChain(struct ls_chain *chain, char verbose_sw)
+{
+  /* Thermalization */
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "#\n#\n# THERMALIZING\n");
+    fprintf(stderr, "# ------------\n");
+    break;
+  }
+  SBMThermalize(chain->gibbs_sw, chain->decorStep, &chain->H, chain->lk,
+		chain->nlist, chain->glist, chain->part,
+		chain->nnod, chain->G2G, chain->n2gList, chain->gen, verbose_sw);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Start a Markov chain over the partitions of net, with Metropolis
+  (gibbs_sw = 0) or heat-bath (gibbs_sw = 1) moves of the block model
+  lk, and bring it to equilibrium. The chain uses (but does not own)
+  the network, the model and the random number generator; since it
+  changes the groups of the nodes, chains that run at the same time
+  need different copies of the network.
+  ---------------------------------------------------------------------
+*/
+struct ls_chain *
+CreateLSChain(struct node_gra *net,
+	      const struct sbm_likelihood *lk,
+	      char gibbs_sw,
+	      gsl_rng *gen,
+	      char verbose_sw)
+{
+  struct ls_chain *chain = StartLSChain(net, lk, gibbs_sw, gen);
+
+  if (!gibbs_sw)
+    LSChainDecorrelationStep(chain, verbose_sw);
+  ThermalizeLSChain(chain, verbose_sw);
+
+  return chain;
+}
+
+void
+FreeLSChain(struct ls_chain *chain)
+{
+  RemovePartition(chain->part);
+  free(chain->glist);
+  free(chain->nlist);
+  FreeGroupLinks(chain->G2G);
+  free_i_vec(chain->n2gList);
+  free(chain);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Advance a chain by one sampling iteration: decorStep Metropolis
+  steps, or one heat-bath sweep
+  ---------------------------------------------------------------------
+*/
+void
+LSChainStep(struct ls_chain *chain)
+{
+  if (chain->gibbs_sw)
+    SBMGibbsStep(&chain->H, chain->lk, chain->nlist, chain->glist,
+		 chain->part, chain->nnod, chain->G2G, chain->n2gList,
+		 chain->gen);
+  else
+    SBMMCStep(chain->decorStep, &chain->H, chain->lk,
+	      chain->nlist, chain->glist, chain->part,
+	      chain->nnod, chain->G2G, chain->n2gList, chain->gen);
+  chain->niter++;
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Add the current partition of a chain to the scores: to the
+  candidate pairs if cand is not NULL, to the record of samples if
+  samples is not NULL, and to the predicted adjacency matrix
+  otherwise
+  ---------------------------------------------------------------------
+*/
+void
+LSChainAddScores(struct ls_chain *chain,
+		 struct pair_matrix *predA,
+		 struct pair_score *cand,
+		 struct sbm_samples *samples)
+{
+  struct group **glist = chain->glist;
+  struct node_lis *p1=NULL, *p2=NULL;
+  float contrib;
+  int i, j, r, l, pair;
+  int nnod = chain->nnod;
+
+  /* In deferred mode, just record the sample */
+  if (samples != NULL) {
+    AddSBMSample(samples, chain->lk, chain->nlist, glist, chain->G2G);
+    return;
+  }
+
+  /* If there are candidate pairs, update only their scores */
+  if (cand != NULL) {
+    for (pair=0; pair<cand->npair; pair++) {
+      GroupPairLinks(chain->nlist[cand->n1[pair]],
+		     chain->nlist[cand->n2[pair]],
+		     glist, chain->G2G, &l, &r);
+      cand->score[pair] += chain->lk->score(r, l, chain->lk);
+    }
+    return;
+  }
+
+  /* Update the predicted adjacency matrix by going through all
+     group pairs (each node pair is stored once, with the lowest
+     node number first) */
+  for (i=0; i<nnod; i++) {
+    if (glist[i]->size > 0) {
+	
+      /* update the within-group pairs */
+      r = glist[i]->size * (glist[i]->size - 1) / 2;
+      l = glist[i]->inlinks;
+      contrib = chain->lk->score(r, l, chain->lk);
+      p1 = glist[i]->nodeList;
+      while ((p1 = p1->next) != NULL) {
+	p2 = p1;
+	while ((p2 = p2->next) != NULL) {
+	  if (p1->node < p2->node)
+	    PairMatrixAddAt(predA,
+			    PAIR_MATRIX_INDEX(nnod, p1->node, p2->node),
+			    contrib);
+	  else
+	    PairMatrixAddAt(predA,
+			    PAIR_MATRIX_INDEX(nnod, p2->node, p1->node),
+			    contrib);
+	}
+      }
+      
+      /* update the between-group pairs */
+      for (j=i+1; j<nnod; j++) {
+	if (glist[j]->size > 0) {
+	  l = G2G_LINKS(chain->G2G, i, j);
+	  r = glist[i]->size * glist[j]->size;
+	  contrib = chain->lk->score(r, l, chain->lk);
+	  p1 = glist[i]->nodeList;
+	  while ((p1 = p1->next) != NULL) {
+	    p2 = glist[j]->nodeList;
+	    while ((p2 = p2->next) != NULL) {
+	      if (p1->node < p2->node)
+		PairMatrixAddAt(predA,
+				PAIR_MATRIX_INDEX(nnod, p1->node, p2->node),
+				contrib);
+	      else
+		PairMatrixAddAt(predA,
+				PAIR_MATRIX_INDEX(nnod, p2->node, p1->node),
+				contrib);
+	    }
+	  }
+	}
+      }
+    }
+  }
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Sampler behind SBMLinkScore and LinkScoreSamples. Scores are
+  accumulated in a matrix, in the candidate pairs (if cand is not
+  NULL), or deferred by just recording each sample (if samples is
+  not NULL).
+  ---------------------------------------------------------------------
+*/
+static struct pair_matrix *
+LinkScoreSampler(struct node_gra *net,
+		 const struct sbm_likelihood *lk,
+		 int nIter,
+		 char gibbs_sw,
+		 gsl_rng *gen,
+		 char verbose_sw,
+		 struct pair_score *cand,
+		 struct sbm_samples *samples)
+{
+  int nnod=CountNodes(net);
+  struct ls_chain *chain=NULL;
+  int iter;
+  struct pair_matrix *predA=NULL;
+  int pair;
+  int norm = 0;
+
+  /*
+    PRELIMINARIES
+  */
+  /* Initialize the predicted adjacency matrix, or the candidate
+     scores if only those pairs are scored */
+  if (cand != NULL) {
+    for (pair=0; pair<cand->npair; pair++)
+      cand->score[pair] = 0.0;
+  }
+  else if (samples == NULL) {
+    predA = CreatePairMatrix(nnod, 1);
+  }
+
+  /* Start the chain and bring it to equilibrium */
+  chain = CreateLSChain(net, lk, gibbs_sw, gen, verbose_sw);
+  
+  /*
+    SAMPLIN' ALONG
+  */
+  for (iter=0; iter<nIter; iter++) {
+    LSChainStep(chain);
+    switch (verbose_sw) {
+    case 'q':
+      break;
+    case 'v':
+      fprintf(stderr, "%d %lf\n", iter, chain->H);
+      break;
+    case 'd':
+      fprintf(stderr, "%d %lf %lf %d\n", iter, chain->H,
+	      lk->partitionH(chain->part, lk), NNonEmptyGroups(chain->part));
+      if (!gibbs_sw)
+	FPrintPartition(stderr, chain->part, 0);
+      break;
+    }
+
+    /* Update partition function and scores */
+    norm += 1;
+    LSChainAddScores(chain, predA, cand, samples);
+  }  /* End of iter loop */
 
-  return;
+  /* Normalize the predicted adjacency matrix (or the candidate
+     scores) */
+  if (cand != NULL) {
+    for (pair=0; pair<cand->npair; pair++) {
+      cand->score[pair] /= (double)norm;
+    }
+  }
+  else if (samples == NULL) {
+    FinishPairMatrix(predA, (double)norm);
+  }
+
+  /* Done */
+  FreeLSChain(chain);
+
+  return predA;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Predict the links missing in a network under the block model lk,
+  with Metropolis (gibbs_sw = 0) or heat-bath (gibbs_sw = 1) moves.
+  The algorithm returns a matrix of scores for all links.
+  If cand is not NULL, only the candidate pairs are scored (the
+  scores are left in cand->score) and NULL is returned.
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix *
+SBMLinkScore(struct node_gra *net,
+	     const struct sbm_likelihood *lk,
+	     int nIter,
+	     char gibbs_sw,
+	     gsl_rng *gen,
+	     char verbose_sw,
+	     struct pair_score *cand)
+{
+  return LinkScoreSampler(net, lk, nIter, gibbs_sw, gen, verbose_sw,
+			  cand, NULL);
 }
 
 /*
   ---------------------------------------------------------------------
   Predict the links missing in a network. The algorithm returns a
   matrix of scores for all links.
+  If cand is not NULL, only the candidate pairs are scored (the
+  scores are left in cand->score) and NULL is returned.
   ---------------------------------------------------------------------
 */
-double **
+struct pair_matrix *
 LinkScore(struct node_gra *net,
 	  double linC,
 	  int nIter,
 	  gsl_rng *gen,
-	  char verbose_sw)
+	  char verbose_sw,
+	  struct pair_score *cand)
 {
-  int nnod=CountNodes(net);
-  struct group *part=NULL;
-  struct node_gra *p=NULL, *node=NULL;
-  struct node_gra **nlist=NULL;
-  struct group **glist=NULL;
-  struct group *lastg=NULL;
-  double H;
-  int iter, decorStep;
-  double **predA=NULL;
-  int i, j;
-  int **G2G=NULL;
-  int *n2gList=NULL;
-  int LogChooseListSize = 500;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
-  struct node_lis *p1=NULL, *p2=NULL;
-  double contrib;
-  int dice;
-  int norm = 0;
-  int r, l;
-  double mutualInfo;
-  int LogFactListSize = 10000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
+  struct sbm_likelihood *lk = CreateSBMLikelihood(CountNodes(net), linC);
+  struct pair_matrix *predA = NULL;
+
+  predA = LinkScoreSampler(net, lk, nIter, 0, gen, verbose_sw, cand, NULL);
+  FreeSBMLikelihood(lk);
+  return predA;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Same sampling as LinkScore, but the scores are not accumulated:
+  each sample is recorded, and the scores are obtained afterwards
+  with SBMSamplesPairScore, SBMSamplesCandidateScores or
+  SBMSamplesScoreMatrix. The samples take O(nIter (nnod + ngroup^2))
+  memory.
+  ---------------------------------------------------------------------
+*/
+struct sbm_samples *
+LinkScoreSamples(struct node_gra *net,
+		 double linC,
+		 int nIter,
+		 gsl_rng *gen,
+		 char verbose_sw)
+{
+  struct sbm_samples *samples = CreateSBMSamples(CountNodes(net), nIter);
+  struct sbm_likelihood *lk = CreateSBMLikelihood(CountNodes(net), linC);
+
+  LinkScoreSampler(net, lk, nIter, 0, gen, verbose_sw, NULL, samples);
+  FreeSBMLikelihood(lk);
+  return samples;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Same scores as SBMLinkScore, pooled over nchain independent chains
+  that run on up to nthread threads. Each chain works on its own copy
+  of the network, with a generator seeded from gen. The chains sample
+  nIter iterations each, in blocks; after each block, the
+  Gelman-Rubin R-hat of the energy and of the scores of a random
+  sample of node pairs is computed over the second half of the
+  iterations so far, and if rhatMax > 0 and all of them are below
+  rhatMax the sampling stops early. If diag is not NULL, the final
+  diagnostics are left in it.
+  If cand is not NULL, only the candidate pairs are scored (the
+  scores are left in cand->score) and NULL is returned.
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix *
+MultiChainLinkScore(struct node_gra *net,
+		    const struct sbm_likelihood *lk,
+		    int nIter,
+		    char gibbs_sw,
+		    int nchain,
+		    int nthread,
+		    double rhatMax,
+		    gsl_rng *gen,
+		    char verbose_sw,
+		    struct pair_score *cand,
+		    struct ls_diagnostics *diag)
+{
+  int nnod = CountNodes(net);
+  int c, k, pair, done = 0, half, block, nblock;
+  long int pk, npair = (long int)nnod * (nnod - 1) / 2;
+  int nmon = 50, *mon1 = NULL, *mon2 = NULL;
+  struct node_gra **nets = NULL;
+  gsl_rng **gens = NULL;
+  struct ls_chain **chains = NULL;
+  struct pair_matrix **predAc = NULL, *predA = NULL;
+  struct pair_score **candc = NULL;
+  double ***trace = NULL, **x = NULL;
+  double rhat, rhatH = HUGE_VAL, rhatScore = HUGE_VAL;
+
+  if (nchain < 1)
+    nchain = 1;
+  if (nthread < 1)
+    nthread = 1;
+  if (nnod < 2)
+    nmon = 0;
 
   /*
     PRELIMINARIES
   */
-  /* Initialize the predicted adjacency matrix */
-  predA = allocate_d_mat(nnod, nnod);
-  for (i=0; i<nnod; i++)
-    for (j=0; j<nnod; j++)
-      predA[i][j] = 0.0;
-
-  /* Map nodes and groups to a list for faster access */
-  nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
-  glist = (struct group **) calloc(nnod, sizeof(struct group *));
-  lastg = part = CreateHeaderGroup();
-  p = net;
-  while ((p = p->next) != NULL) {
-    nlist[p->num] = p;
-    lastg = glist[p->num] = CreateGroup(lastg, p->num);
+  /* Each chain gets its own network, generator and score
+     accumulator, and a trace of its energy (trace[c][0]) and of the
+     scores of the monitored pairs (trace[c][1..nmon]) */
+  nets = (struct node_gra **)calloc(nchain, sizeof(struct node_gra *));
+  gens = (gsl_rng **)calloc(nchain, sizeof(gsl_rng *));
+  chains = (struct ls_chain **)calloc(nchain, sizeof(struct ls_chain *));
+  trace = (double ***)calloc(nchain, sizeof(double **));
+  if (cand != NULL)
+    candc = (struct pair_score **)calloc(nchain, sizeof(struct pair_score *));
+  else
+    predAc = (struct pair_matrix **)calloc(nchain,
+					   sizeof(struct pair_matrix *));
+  for (c=0; c<nchain; c++) {
+    nets[c] = (c == 0) ? net : CopyNetwork(net);
+    gens[c] = gsl_rng_alloc(gsl_rng_mt19937);
+    gsl_rng_set(gens[c], gsl_rng_get(gen));
+    trace[c] = allocate_d_mat(nmon + 1, nIter + 1);
+    if (cand != NULL) {
+      candc[c] = CreatePairScore(cand->npair);
+      for (pair=0; pair<cand->npair; pair++) {
+	candc[c]->n1[pair] = cand->n1[pair];
+	candc[c]->n2[pair] = cand->n2[pair];
+	candc[c]->score[pair] = 0.0;
+      }
+    }
+    else {
+      predAc[c] = CreatePairMatrix(nnod, 1);
+    }
   }
 
-  /* Place nodes in random partitions */
-  p = net;
-  ResetNetGroup(net);
-  while ((p = p->next) != NULL) {
-    dice = floor(gsl_rng_uniform(gen) * (double)nnod);
-    AddNodeToGroup(glist[dice], p);
+  /* Pairs whose scores are monitored for convergence */
+  mon1 = allocate_i_vec(nmon + 1);
+  mon2 = allocate_i_vec(nmon + 1);
+  for (k=0; k<nmon; k++) {
+    mon1[k] = floor(gsl_rng_uniform(gen) * (double)nnod);
+    do {
+      mon2[k] = floor(gsl_rng_uniform(gen) * (double)nnod);
+    } while (mon2[k] == mon1[k]);
   }
 
-  /* Get the initial group-to-group links matrix */
-  G2G = allocate_i_mat(nnod, nnod);
-  n2gList = allocate_i_vec(nnod);
-  for (i=0; i<nnod; i++) {
-    G2G[i][i] = glist[i]->inlinks;
-    for (j=i+1; j<nnod; j++) {
-      G2G[i][j] = G2G[j][i] = NG2GLinks(glist[i], glist[j]);
-    }
+  /* Start the chains; the Metropolis chains share a decorrelation
+     step, estimated once on the first chain before they run in
+     parallel */
+  for (c=0; c<nchain; c++)
+    chains[c] = StartLSChain(nets[c], lk, gibbs_sw, gens[c]);
+  if (!gibbs_sw) {
+    LSChainDecorrelationStep(chains[0], verbose_sw);
+    for (c=1; c<nchain; c++)
+      chains[c]->decorStep = chains[0]->decorStep;
   }
 
-  /*
-    GET READY FOR THE SAMPLING
-  */
-  /* Get the decorrelation time */
-  H = PartitionH(part, linC);
-  switch (verbose_sw) {
-  case 'q':
-    break;
-  default:
-    fprintf(stderr, "# CALCULATING DECORRELATION TIME\n");
-    fprintf(stderr, "# ------------------------------\n");
-    break;
-  }
-  decorStep = GetDecorrelationStep(&H, linC, nlist, glist, part,
-				   nnod, G2G, n2gList,
-				   LogChooseList, LogChooseListSize,
-				   LogFactList, LogFactListSize,
-				   gen, verbose_sw);
+  /* Bring all the chains to equilibrium */
   switch (verbose_sw) {
   case 'q':
     break;
   default:
-    fprintf(stderr, "\n# Decorrelation step = %d\n\n", decorStep);
+    fprintf(stderr, "# THERMALIZING %d CHAINS\n", nchain);
     break;
   }
+#pragma omp parallel for num_threads(nthread) schedule(dynamic, 1)
+  for (c=0; c<nchain; c++)
+    ThermalizeLSChain(chains[c], 'q');
 
-  /* Thermalization */
-  switch (verbose_sw) {
-  case 'q':
-    break;
-  default:
-    fprintf(stderr, "#\n#\n# THERMALIZING\n");
-    fprintf(stderr, "# ------------\n");
-    break;
-  }
-  ThermalizeLinkScoreMC(decorStep, &H, linC, nlist, glist, part,
-			nnod, G2G, n2gList,
-			LogChooseList, LogChooseListSize,
-			LogFactList, LogFactListSize,
-			gen, verbose_sw);
-  
   /*
     SAMPLIN' ALONG
   */
-  /* Unless we are in debug mode, reset the origin of energies */
-  switch (verbose_sw) {
-  case 'd':
-    break;
-  default:
-    /* H = 0; */
-    break;
+  /* Without early stopping, all the iterations are one block */
+  if (rhatMax > 0.0 && nchain > 1) {
+    block = nIter / 20;
+    if (block < 10)
+      block = 10;
   }
-
-  /* Do the MC Steps */
-  for (iter=0; iter<nIter; iter++) {
-    LinkScoreMCStep(decorStep, &H, linC, nlist, glist, part,
-		    nnod, G2G, n2gList, LogChooseList, LogChooseListSize,
-		    LogFactList, LogFactListSize,
-		    gen);
+  else {
+    block = nIter;
+  }
+  x = (double **)calloc(nchain, sizeof(double *));
+  while (done < nIter) {
+    nblock = (nIter - done < block) ? nIter - done : block;
+
+#pragma omp parallel for num_threads(nthread) schedule(dynamic, 1)
+    for (c=0; c<nchain; c++) {
+      struct ls_chain *chain = chains[c];
+      int iter, m, l, r;
+
+      for (iter=done; iter<done+nblock; iter++) {
+	LSChainStep(chain);
+	if (cand != NULL)
+	  LSChainAddScores(chain, NULL, candc[c], NULL);
+	else
+	  LSChainAddScores(chain, predAc[c], NULL, NULL);
+	trace[c][0][iter] = chain->H;
+	for (m=0; m<nmon; m++) {
+	  GroupPairLinks(chain->nlist[mon1[m]], chain->nlist[mon2[m]],
+			 chain->glist, chain->G2G, &l, &r);
+	  trace[c][m + 1][iter] = lk->score(r, l, lk);
+	}
+      }
+    }
+    done += nblock;
+
+    /* Convergence diagnostics, discarding the first half of each
+       chain */
+    half = done / 2;
+    for (c=0; c<nchain; c++)
+      x[c] = &trace[c][0][half];
+    rhatH = gelman_rubin(x, nchain, done - half);
+    rhatScore = (nmon > 0) ? 1.0 : HUGE_VAL;
+    for (k=1; k<=nmon; k++) {
+      for (c=0; c<nchain; c++)
+	x[c] = &trace[c][k][half];
+      if ((rhat = gelman_rubin(x, nchain, done - half)) > rhatScore)
+	rhatScore = rhat;
+    }
     switch (verbose_sw) {
     case 'q':
       break;
-    case 'v':
-      fprintf(stderr, "%d %lf\n", iter, H);
+    default:
+      fprintf(stderr, "%d R-hat(H) = %g max R-hat(scores) = %g\n",
+	      done, rhatH, rhatScore);
       break;
-    case 'd':
-      fprintf(stderr, "%d %lf %lf\n", iter, H, PartitionH(part, linC));
-      FPrintPartition(stderr, part, 0);
+    }
+    if (rhatMax > 0.0 && rhatH < rhatMax && rhatScore < rhatMax)
       break;
+  }
+
+  /*
+    POOL THE CHAINS
+  */
+  if (cand != NULL) {
+    for (pair=0; pair<cand->npair; pair++) {
+      cand->score[pair] = 0.0;
+      for (c=0; c<nchain; c++)
+	cand->score[pair] += candc[c]->score[pair];
+      cand->score[pair] /= (double)nchain * (double)done;
     }
+  }
+  else {
+    predA = predAc[0];
+    FinishPairMatrix(predA, (double)nchain * (double)done);
+    for (c=1; c<nchain; c++) {
+      FinishPairMatrix(predAc[c], (double)nchain * (double)done);
+      for (pk=0; pk<npair; pk++)
+	predA->score[pk] += predAc[c]->score[pk];
+    }
+  }
+  if (diag != NULL) {
+    diag->niter = done;
+    diag->rhatH = rhatH;
+    diag->rhatScore = rhatScore;
+  }
 
-    /* Update partition function */
-    norm += 1;
+  /* Done */
+  for (c=0; c<nchain; c++) {
+    FreeLSChain(chains[c]);
+    free_d_mat(trace[c], nmon + 1);
+    gsl_rng_free(gens[c]);
+    if (c > 0)
+      RemoveGraph(nets[c]);
+    if (cand != NULL)
+      FreePairScore(candc[c]);
+    else if (c > 0)
+      FreePairMatrix(predAc[c]);
+  }
+  free(nets);
+  free(gens);
+  free(chains);
+  free(trace);
+  free(candc);
+  free(predAc);
+  free(x);
+  free_i_vec(mon1);
+  free_i_vec(mon2);
 
-    /* Update the predicted adjacency matrix by going through all
-       group pairs */
-    for (i=0; i<nnod; i++) {
-      if (glist[i]->size > 0) {
-	
-	/* update the within-group pairs */
-	r = glist[i]->size * (glist[i]->size - 1) / 2;
-	l = glist[i]->inlinks;
-	contrib = (float)(l + 1) / (float)(r + 2);
-	p1 = glist[i]->nodeList;
-	while ((p1 = p1->next) != NULL) {
-	  p2 = p1;
-	  while ((p2 = p2->next) != NULL) {
-	    predA[p1->node][p2->node] += contrib;
-	    predA[p2->node][p1->node] += contrib;
-	  }
-	}
-      
-	/* update the between-group pairs */
-	for (j=i+1; j<nnod; j++) {
-	  if (glist[j]->size > 0) {
-	    l = G2G[i][j];
-	    r = glist[i]->size * glist[j]->size;
-	    contrib = (float)(l + 1) / (float)(r + 2);
-	    p1 = glist[i]->nodeList;
-	    while ((p1 = p1->next) != NULL) {
-	      p2 = glist[j]->nodeList;
-	      while ((p2 = p2->next) != NULL) {
-		predA[p1->node][p2->node] += contrib;
-		predA[p2->node][p1->node] += contrib;
-	      }
-	    }
-	  }
-	}
-      }
-    } /* Done updating adjacency matrix */
+  return predA;
+}
 
-  }  /* End of iter loop */
+/*
+  ---------------------------------------------------------------------
+  Sampling settings of the link reliability programs
+  ---------------------------------------------------------------------
+*/
+void
+SetLSSampling(struct ls_sampling *smp, int niter)
+{
+  smp->niter = niter;
+  smp->nchain = 1;
+  smp->nthread = 1;
+  smp->rhatMax = 0.0;
+  return;
+}
 
-  /* Normalize the predicted adjacency matrix */
-  for (i=0; i<nnod; i++) {
-    for (j=0; j<nnod; j++) {
-      predA[i][j] /= (double)norm;
-    }
+/*
+  ---------------------------------------------------------------------
+  Handle one of the sampling command line options
+  (LS_SAMPLING_OPTIONS, for getopt). Returns 1 if opt is one of them,
+  and 0 otherwise.
+  ---------------------------------------------------------------------
+*/
+int
+LSSamplingOption(struct ls_sampling *smp, int opt, char *arg)
+{
+  switch (opt) {
+  case 'i':
+    smp->niter = atoi(arg);
+    break;
+  case 'c':
+    smp->nchain = atoi(arg);
+    break;
+  case 't':
+    smp->nthread = atoi(arg);
+    break;
+  case 'r':
+    smp->rhatMax = atof(arg);
+    break;
+  case 'D':
+    SetDecorrelationCache(arg);
+    break;
+  default:
+    return 0;
   }
+  return 1;
+}
 
-  /* Done */
-  RemovePartition(part);
-  free(glist);
-  free(nlist);
-  free_i_mat(G2G, nnod);
-  free_i_vec(n2gList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
-  FreeFastLogFact(LogFactList);
+void
+PrintLSSamplingUsage(void)
+{
+  printf("  -i niter: number of sampling iterations (of each chain)\n");
+  printf("  -c nchain: pool the scores of nchain independent chains\n");
+  printf("  -t nthread: number of threads for the chains (default 1)\n");
+  printf("  -r rhat: stop early once the Gelman-Rubin R-hat of the energy and\n");
+  printf("     of a sample of pair scores are all below rhat (e.g. 1.01)\n");
+  printf("  -D file: reuse the decorrelation steps stored in file, and store\n");
+  printf("     new ones (default: the file in $%s, if set)\n",
+	 DECOR_CACHE_ENV);
+  return;
+}
 
+/*
+  ---------------------------------------------------------------------
+  Link scores under the block model lk with the sampling settings
+  smp: those of a single chain (SBMLinkScore) or, if smp->nchain > 1,
+  those pooled over several chains (MultiChainLinkScore), whose
+  convergence diagnostics are reported on stderr.
+  If cand is not NULL, only the candidate pairs are scored (the
+  scores are left in cand->score) and NULL is returned.
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix *
+SampledLinkScore(struct node_gra *net,
+		 const struct sbm_likelihood *lk,
+		 char gibbs_sw,
+		 const struct ls_sampling *smp,
+		 gsl_rng *gen,
+		 char verbose_sw,
+		 struct pair_score *cand)
+{
+  struct pair_matrix *predA = NULL;
+  struct ls_diagnostics diag;
+
+  if (smp->nchain <= 1)
+    return SBMLinkScore(net, lk, smp->niter, gibbs_sw, gen, verbose_sw, cand);
+
+  predA = MultiChainLinkScore(net, lk, smp->niter, gibbs_sw,
+			      smp->nchain, smp->nthread, smp->rhatMax,
+			      gen, verbose_sw, cand, &diag);
+  fprintf(stderr,
+	  "# %d chains x %d iterations: R-hat(H) = %g, max R-hat(scores) = %g\n",
+	  smp->nchain, diag.niter, diag.rhatH, diag.rhatScore);
   return predA;
 }
 
@@ -720,11 +2981,11 @@ SBMError(struct node_gra *net, gsl_rng *gen)
   struct node_gra **nlist;
   int i, j, nnod=CountNodes(net);
   struct node_gra *p;
-  double score=0.0;
-  double **pairScore;
+  double score=0.0, s;
+  struct pair_matrix *pairScore;
 
   /* Get the link score */
-  pairScore = LinkScore(net, 0.0, 10000, gen, 'q');
+  pairScore = LinkScore(net, 0.0, 10000, gen, 'q', NULL);
 
   /* Map nodes to a list for faster access */
   nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
@@ -736,13 +2997,14 @@ SBMError(struct node_gra *net, gsl_rng *gen)
   /* Calculate the reliability score */
   for (i=0; i<nnod; i++) {
     for (j=i+1; j<nnod; j++) {
+      s = PairMatrixGet(pairScore, i, j);
 /*       fprintf(stderr, "%s %s %lf\n", */
-/* 	      nlist[i]->label, nlist[j]->label, pairScore[i][j]); */
+/* 	      nlist[i]->label, nlist[j]->label, s); */
       if (IsThereLink(nlist[i], nlist[j]) == 1) {
-	score += (1.0 - pairScore[i][j]) * (1.0 - pairScore[i][j]);
+	score += (1.0 - s) * (1.0 - s);
       }
       else {
-	score += pairScore[i][j] * pairScore[i][j];
+	score += s * s;
       }
     }
   }
@@ -752,7 +3014,7 @@ SBMError(struct node_gra *net, gsl_rng *gen)
 
   /* Done */
   free(nlist);
-  free_d_mat(pairScore, nnod);
+  FreePairMatrix(pairScore);
   return score;
 }
 
@@ -802,10 +3064,10 @@ NetFromSBMScores(struct node_gra *net, gsl_rng *gen)
   int n1, n2, nnod=CountNodes(net);
   struct node_gra *p_new, *p, *net_new;
   double score=0.0;
-  double **pairScore;
+  struct pair_matrix *pairScore;
 
   /* Get the link score */
-  pairScore = LinkScore(net, 0.0, 10000, gen, 'q');
+  pairScore = LinkScore(net, 0.0, 10000, gen, 'q', NULL);
 
   /* Create an empty network */
   net_new = EmptyGraph(nnod);
@@ -824,8 +3086,8 @@ NetFromSBMScores(struct node_gra *net, gsl_rng *gen)
   /* Add the links */
   for (n1=0; n1<nnod; n1++) {
     for (n2=n1+1; n2<nnod; n2++) {
-/*       if (gsl_rng_uniform(gen) < pairScore[n1][n2]) { */
-      if (pairScore[n1][n2] > 0.5) {
+/*       if (gsl_rng_uniform(gen) < PairMatrixGet(pairScore, n1, n2)) { */
+      if (PairMatrixGet(pairScore, n1, n2) > 0.5) {
 	AddAdjacency(nlist[n1], nlist[n2], 0, 0, 0, 0);
 	AddAdjacency(nlist[n2], nlist[n1], 0, 0, 0, 0);
       }
@@ -834,7 +3096,7 @@ NetFromSBMScores(struct node_gra *net, gsl_rng *gen)
 
   /* Done */
   free(nlist);
-  free_d_mat(pairScore, nnod);
+  FreePairMatrix(pairScore);
   return net_new;
 }
 
@@ -864,10 +3126,10 @@ NetworkScore(struct node_gra *netTar,
   double H;
   int iter, decorStep;
   int norm=0;
-  int **G2G=NULL;
+  struct group_links *G2G=NULL;
   int *n2gList=NULL;
-  int LogChooseListSize = 500;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
+  int LogChooseListSize = FastLogTableSize((long int)nnod * (nnod - 1) / 2);
+  double *LogChooseList=InitializeFastLogChoose(LogChooseListSize);
   struct node_lis *p1=NULL, *p2=NULL;
   double scoreTar=0.0, scoreObs=0.0;
   double contribObs, contribTar, contribBase;
@@ -875,8 +3137,8 @@ NetworkScore(struct node_gra *netTar,
   int i, j, dice;
   int r, lObs, lTar;
   double mutualInfo;
-  int LogFactListSize = 10000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
+  int LogFactListSize = LogChooseListSize;
+  double *LogFactList = LogChooseList; /* same ln(r!) table */
 
   /*
     PRELIMINARIES
@@ -900,14 +3162,10 @@ NetworkScore(struct node_gra *netTar,
   }
 
   /* Get the initial group-to-group links matrix */
-  G2G = allocate_i_mat(nnod, nnod);
+  G2G = CreateGroupLinks(part, nnod);
   n2gList = allocate_i_vec(nnod);
-  for (i=0; i<nnod; i++) {
-    G2G[i][i] = glist[i]->inlinks;
-    for (j=i+1; j<nnod; j++) {
-      G2G[i][j] = G2G[j][i] = NG2GLinks(glist[i], glist[j]);
-    }
-  }
+  for (i=0; i<nnod; i++)
+    n2gList[i] = 0;
 
   /*
     GET READY FOR THE SAMPLING
@@ -922,8 +3180,7 @@ NetworkScore(struct node_gra *netTar,
     fprintf(stderr, "# ------------------------------\n");
     break;
   }
-  decorStep = GetDecorrelationStep(&H, linC, nlist, glist, part,
-				   nnod, G2G, n2gList,
+  decorStep = GetDecorrelationStep(&H, linC, nlist, part, nnod, G2G,
 				   LogChooseList, LogChooseListSize,
 				   LogFactList, LogFactListSize, 
 				   gen, verbose_sw);
@@ -999,7 +3256,7 @@ NetworkScore(struct node_gra *netTar,
 	  g2Tar = g2Tar->next;
 	  if (g2Obs->size > 0) {
 	    r = g1Obs->size * g2Obs->size;
-	    lObs = G2G[g1Obs->label][g2Obs->label];
+	    lObs = G2G_LINKS(G2G, g1Obs->label, g2Obs->label);
 	    lTar = NG2GLinks(g1Tar, g2Tar);
 	    contribTar += (+log(r + 1) + LogChoose(r, lObs)
 			   -log(2 * r + 1) - LogChoose(2 * r, lObs + lTar));
@@ -1027,9 +3284,9 @@ NetworkScore(struct node_gra *netTar,
   RemovePartition(part);
   free(glist);
   free(nlist);
-  free_i_mat(G2G, nnod);
+  FreeGroupLinks(G2G);
   free_i_vec(n2gList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
+  FreeFastLogChoose(LogChooseList);
   
   return scoreTar / scoreObs;
 }
@@ -1047,7 +3304,7 @@ NetReconstruct(struct node_gra *netObs,
 {
   struct node_gra *net, **nlist, *p, *n1Add, *n2Add, *n1Remove, *n2Remove;
   int i, n1, n2;
-  double **linkScores;
+  struct pair_matrix *linkScores;
   double scoreNew, scoreOld, maxLinkScore, minLinkScore;
   int nnod=CountNodes(netObs);
   int someChanged, someRejected;
@@ -1067,7 +3324,7 @@ NetReconstruct(struct node_gra *netObs,
   do {   /* Keep going until no changes occur */
 
     /* Get the (quick'n'dirty) link scores */
-    linkScores = LinkScore(net, 0.0, 1000, gen, 'q');
+    linkScores = LinkScore(net, 0.0, 1000, gen, 'q', NULL);
 
     someChanged = 0;
     someRejected = 0;
@@ -1080,17 +3337,17 @@ NetReconstruct(struct node_gra *netObs,
       minLinkScore = 1.0;
       for (n1=0; n1<nnod; n1++) {
 	for (n2=n1+1; n2<nnod; n2++) {
-	  if ((linkScores[n1][n2] > maxLinkScore) &&
+	  if ((PairMatrixGet(linkScores, n1, n2) > maxLinkScore) &&
 	      (IsThereLink(nlist[n1], nlist[n2]) == 0)) {
 	    n1Add = nlist[n1];
 	    n2Add = nlist[n2];
-	    maxLinkScore = linkScores[n1][n2];
+	    maxLinkScore = PairMatrixGet(linkScores, n1, n2);
 	  }
-	  if ((linkScores[n1][n2] < minLinkScore) &&
+	  if ((PairMatrixGet(linkScores, n1, n2) < minLinkScore) &&
 	      (IsThereLink(nlist[n1], nlist[n2]) == 1)) {
 	    n1Remove = nlist[n1];
 	    n2Remove = nlist[n2];
-	    minLinkScore = linkScores[n1][n2];
+	    minLinkScore = PairMatrixGet(linkScores, n1, n2);
 	  }
 	}
       }
@@ -1117,6 +3374,7 @@ NetReconstruct(struct node_gra *netObs,
 	RemoveLink(n1Add, n2Add, 1);
       }
     } while(someRejected < thresReject);
+    FreePairMatrix(linkScores);
   } while (someChanged == 1);
 
   return net;
@@ -1146,12 +3404,12 @@ PartitionSampling(struct node_gra *net,
   struct group *lastg=NULL;
   double H;
   int iter, decorStep;
-  int **G2G=NULL;
+  struct group_links *G2G=NULL;
   int *n2gList=NULL;
-  int LogChooseListSize = 500;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
-  int LogFactListSize = 10000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
+  int LogChooseListSize = FastLogTableSize((long int)nnod * (nnod - 1) / 2);
+  double *LogChooseList=InitializeFastLogChoose(LogChooseListSize);
+  int LogFactListSize = LogChooseListSize;
+  double *LogFactList = LogChooseList; /* same ln(r!) table */
   int dice;
   int i, j;
 
@@ -1180,14 +3438,10 @@ PartitionSampling(struct node_gra *net,
   }
 
   /* Get the initial group-to-group links matrix */
-  G2G = allocate_i_mat(nnod, nnod);
+  G2G = CreateGroupLinks(part, nnod);
   n2gList = allocate_i_vec(nnod);
-  for (i=0; i<nnod; i++) {
-    G2G[i][i] = glist[i]->inlinks;
-    for (j=i+1; j<nnod; j++) {
-      G2G[i][j] = G2G[j][i] = NG2GLinks(glist[i], glist[j]);
-    }
-  }
+  for (i=0; i<nnod; i++)
+    n2gList[i] = 0;
 
   /*
     GET READY FOR THE SAMPLING
@@ -1202,8 +3456,7 @@ PartitionSampling(struct node_gra *net,
     fprintf(stderr, "# ------------------------------\n");
     break;
   }
-  decorStep = GetDecorrelationStep(&H, linC, nlist, glist, part,
-				   nnod, G2G, n2gList,
+  decorStep = GetDecorrelationStep(&H, linC, nlist, part, nnod, G2G,
 				   LogChooseList, LogChooseListSize,
 				   LogFactList, LogFactListSize,
 				   gen, verbose_sw);
@@ -1278,9 +3531,9 @@ PartitionSampling(struct node_gra *net,
   RemovePartition(part);
   free(glist);
   free(nlist);
-  free_i_mat(G2G, nnod);
+  FreeGroupLinks(G2G);
   free_i_vec(n2gList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
+  FreeFastLogChoose(LogChooseList);
   
   return partList;
 }
@@ -1515,7 +3768,6 @@ int
 LSGetDecorrelationStepKState(int K,
 			     double *H,
 			     struct node_gra **nlist,
-			     struct group **glist,
 			     struct group *part,
 			     int nnod,
 			     int *ng,
@@ -1526,82 +3778,139 @@ LSGetDecorrelationStepKState(int K,
 			     gsl_rng *gen,
 			     char verbose_sw)
 {
-  struct group *partRef;
-  int step, x1, x2;
-  double y1, y2;
-  double mutualInfo;
+  int x1, x2;
   int rep, nrep=10;
   double *decay, meanDecay, sigmaDecay, result;
   int norm=0;
+  int *nignored;
+  unsigned long *seeds;
+  unsigned long long key;
+
+  /* Seeds of the estimates, drawn even if the step is cached */
+  seeds = (unsigned long *)calloc(nrep, sizeof(unsigned long));
+  for (rep=0; rep<nrep; rep++)
+    seeds[rep] = gsl_rng_get(gen);
+
+  /* Reuse the step cached for this network and model, if any */
+  key = NodeListHash(nlist, nnod, hash_bytes("LSKState", 8, 0));
+  key = hash_bytes(&K, sizeof(int), key);
+  if ((result = GetCachedDecorrelationStep(key)) > 0) {
+    switch (verbose_sw) {
+    case 'q':
+      break;
+    default:
+      fprintf(stderr, "# Decorrelation step (cached): %d\n", (int)result);
+      break;
+    }
+    free(seeds);
+    return (int)result;
+  }
 
   x2 = nnod / 5;
   if (x2 < 10)
     x2 = 10;
   x1 = x2 / 4;
 
-  /* Get the nrep initial estimates */
+  /* Get the nrep initial estimates. They are independent, so they
+     run concurrently, each on its own copy of the current state and
+     with its own random number generator. */
   decay = allocate_d_vec(nrep);
+  nignored = allocate_i_vec(nrep);
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "#\n# Estimating decorrelation time (%d estimates)\n",
+	    nrep);
+    break;
+  }
+#pragma omp parallel for schedule(dynamic, 1)
   for (rep=0; rep<nrep; rep++) {
-    switch (verbose_sw) {
-    case 'q':
-      break;
-    default:
-      fprintf(stderr, "#\n# Estimating decorrelation time (%d/%d)\n",
-	      rep + 1, nrep);
-      break;
+    struct node_gra **cnlist = NULL, *cnet = NULL;
+    struct group **cglist = NULL, *cpart = NULL, *partRef = NULL;
+    int ***cN2G = NULL, ***cG2G = NULL;
+    int cng = *ng, step, k;
+    double cH = *H, y1, y2;
+    gsl_rng *rgen = gsl_rng_alloc(gsl_rng_mt19937);
+
+    /* Copy the state */
+    cnlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
+    cglist = (struct group **) calloc(nnod, sizeof(struct group *));
+    cnet = CopyNodeList(nlist, nnod, cnlist);
+    cpart = CopyPartitionToNodes(part, cnlist, cglist);
+    cN2G = (int ***) calloc(K, sizeof(int **));
+    cG2G = (int ***) calloc(K, sizeof(int **));
+    for (k=0; k<K; k++) {
+      cN2G[k] = copy_i_mat((*N2G)[k], nnod, nnod);
+      cG2G[k] = copy_i_mat((*G2G)[k], nnod, nnod);
     }
-    partRef = CopyPartition(part);
-    for (step=0; step<=x2; step++) {
-      switch (verbose_sw) {
-      case 'd':
-	fprintf(stderr, "# %d / %d\n", step, x2);
-	break;
-      default:
-	break;
-      }
-      LSMCStepKState(K, 1, H, nlist,
-		     glist, part,
-		     nnod, ng,
-		     N2G,
-		     G2G,
-		     LogList, LogListSize,
-		     LogFactList, LogFactListSize,
-		     gen);
-      if (step == x1) {
-	y1 = MutualInformation(partRef, part, 0);
+    gsl_rng_set(rgen, seeds[rep]);
+
+    nignored[rep] = 0;
+    do {
+      partRef = CopyPartition(cpart);
+      for (step=0; step<=x2; step++) {
+	switch (verbose_sw) {
+	case 'd':
+	  fprintf(stderr, "# %d / %d\n", step, x2);
+	  break;
+	default:
+	  break;
+	}
+	LSMCStepKState(K, 1, &cH, cnlist,
+		       cglist, cpart,
+		       nnod, &cng,
+		       &cN2G,
+		       &cG2G,
+		       LogList, LogListSize,
+		       LogFactList, LogFactListSize,
+		       rgen);
+	if (step == x1) {
+	  y1 = MutualInformation(partRef, cpart, 0);
+	}
       }
+      y2 = MutualInformation(partRef, cpart, 0);
+      RemovePartition(partRef);
+      decay[rep] = 2. * CalculateDecay(nnod, x1, y1, x2, y2);
+      if (decay[rep] < 0.)
+	nignored[rep]++;
+    } while (decay[rep] < 0.);
+
+    /* Free memory */
+    for (k=0; k<K; k++) {
+      free_i_mat(cN2G[k], nnod);
+      free_i_mat(cG2G[k], nnod);
     }
-    y2 = MutualInformation(partRef, part, 0);
-    decay[rep] = 2. * CalculateDecay(nnod, x1, y1, x2, y2);
+    free(cN2G);
+    free(cG2G);
+    RemovePartition(cpart);
+    RemoveGraph(cnet);
+    free(cglist);
+    free(cnlist);
+    gsl_rng_free(rgen);
+  }
+  for (rep=0; rep<nrep; rep++) {
     switch (verbose_sw) {
     case 'q':
       break;
     default:
+      if (nignored[rep] > 0)
+	fprintf(stderr, "#\tignoring %d negative estimate(s)...\n",
+		nignored[rep]);
       fprintf(stderr, "# Decorrelation time (estimate %d) = %g\n",
 	      rep + 1, decay[rep]);
       break;
     }
-    if (decay[rep] < 0.) {
-      rep--;
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tignoring...\n");
-	break;
-      }
-    }
-    /* Free memory */
-    RemovePartition(partRef);
   }
   
   /* Get rid of bad estimates (Chauvenet criterion)  */
   meanDecay = mean(decay, nrep);
   sigmaDecay = stddev(decay, nrep);
-  result = meanDecay * nrep;
+  /* Average the accepted estimates (subtracting the rejected ones
+     from the total would lose all precision after a huge outlier) */
+  result = 0.;
   for (rep=0; rep<nrep; rep++) {
     if (fabs(decay[rep] - meanDecay) / sigmaDecay > 2) {
-      result -= decay[rep];
       switch (verbose_sw) {
       case 'q':
 	break;
@@ -1611,6 +3920,7 @@ LSGetDecorrelationStepKState(int K,
       }
     }
     else {
+      result += decay[rep];
       norm++;
     }
   }
@@ -1625,7 +3935,10 @@ LSGetDecorrelationStepKState(int K,
 
   /* Clean up */
   free_d_vec(decay);
+  free_i_vec(nignored);
+  free(seeds);
 
+  CacheDecorrelationStep(key, (int)(result / norm + 0.5));
   return (int)(result / norm + 0.5);
 }
 
@@ -1843,7 +4156,6 @@ LSMultiLinkScoreKState(int K,
   if (decorStep <= 0) {
     decorStep = LSGetDecorrelationStepKState(K, &H,
   					     nlist,
-  					     glist,
   					     part,
   					     nnod,
   					     &ng,
@@ -2011,306 +4323,21 @@ GibbsLinkScoreStep(double *H,
 		   struct group **glist,
 		   struct group *part,
 		   int nnod,
-		   int **G2G,
+		   struct group_links *G2G,
 		   int *n2gList,
-		   double **LogChooseList,
+		   double *LogChooseList,
 		   int LogChooseListSize,
 		   double *LogFactList, int LogFactListSize,
 		   gsl_rng *gen)
 {
-  double *dH;
-  struct group *g, *oldg, *newg;
-  int oldgnum, newgnum, n2g, oldg2g, newg2g, ng, noldg, nnewg;
-  struct node_gra *node;
-  int n2oldg, n2newg, newg2oldg, oldg2oldg, newg2newg;
-  int r, l;
-  int i, j, ngroup=nnod;
-  int move;
-  int effectng;
-  /* Shortlist of groups. Groups not in this list are empty for
-     sure. Note that, during a step, we may have to add groups to this
-     list (groups that were initially empty but got filled) but we
-     never remove groups from it (even if they loose all their nodes
-     during a step). slgXsize is the size of slgX. */
-  int *slg=NULL;
-  int slgn, slgsize, isinlist;
-  int newgn, target;
-  double dice, norm, dHempty, cum;
-  
-  /* Preliminaries */
-  dH = allocate_d_vec(nnod);
-  slg = allocate_i_vec(nnod);  // Shortlist of groups
-  slgsize = 0;
-  g = part;
-  while ((g=g->next) != NULL)
-    if (g->size > 0)
-      slg[slgsize++] = g->label;
-
-  /* Steps */
-  for (move=0; move<nnod; move++) {
-    node = nlist[move];
-    oldgnum = node->inGroup;
-    oldg = glist[oldgnum];
-    norm = 0.0;
-
-    /* Loop over destination groups */
-    for (newgn=0; newgn<slgsize; newgn++) {
-      newgnum = slg[newgn];
-      newg = glist[newgnum];
-
-      if (newgnum != oldgnum) {	
-	/* Calculate the change of energy */
-	dH[newgnum] = 0.0;
-	noldg = oldg->size;
-	nnewg = newg->size;
-	if (noldg == 1)  /* number of groups would decrease by one */ 
-	  dH[newgnum] -= linC;
-	if (nnewg == 0)  /* number of groups would increase by one */
-	  dH[newgnum] += linC;
-	n2oldg = NLinksToGroup(node, oldg);
-	n2newg = NLinksToGroup(node, newg);
-	newg2oldg = NG2GLinks(newg, oldg);
-	oldg2oldg = oldg->inlinks;
-	newg2newg = newg->inlinks;
-	effectng = 0;
-	for (slgn=0; slgn<slgsize; slgn++) {
-	  g = glist[slg[slgn]];
-	  if (g->size > 0) {  /* group is not empty */
-	    effectng++;
-	    n2gList[g->label] = NLinksToGroup(node, g);
-	    if (g->label == oldg->label) {
-	      /* old conf, oldg-oldg */
-	      r = noldg * (noldg - 1) / 2;
-	      l = oldg2oldg;
-	      dH[newgnum] -= log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* new conf, oldg-olg */
-	      r = (noldg - 1) * (noldg - 2) / 2;
-	      l = oldg2oldg - n2oldg;
-	      dH[newgnum] += log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* old conf, newg-oldg */
-	      r = nnewg * noldg;
-	      l = newg2oldg;
-	      dH[newgnum] -= log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* new conf, newg-oldg */
-	      r = (nnewg + 1) * (noldg - 1);
-	      l = newg2oldg + n2oldg - n2newg;
-	      dH[newgnum] += log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	    }
-	    else if (g->label == newg->label) {
-	      /* old conf, newg-newg */
-	      r = nnewg * (nnewg - 1) / 2;
-	      l = newg2newg;
-	      dH[newgnum] -= log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* new conf, newg-olg */
-	      r = (nnewg + 1) * nnewg / 2;
-	      l = newg2newg + n2newg;
-	      dH[newgnum] += log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	    }
-	    else {
-	      n2g = n2gList[g->label];
-	      oldg2g = G2G[oldg->label][g->label];
-	      newg2g = G2G[newg->label][g->label];
-	      ng = g->size;
-	      /* old conf, oldg-g */
-	      r = noldg * ng;
-	      l = oldg2g;
-	      dH[newgnum] -= log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* new conf, oldg-g */
-	      r = (noldg - 1) * ng;
-	      l = oldg2g - n2g;
-	      dH[newgnum] += log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* old conf, newg-g */
-	      r = nnewg * ng;
-	      l = newg2g;
-	      dH[newgnum] -= log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	      /* new conf, newg-g */
-	      r = (nnewg + 1) * ng;
-	      l = newg2g + n2g;
-	      dH[newgnum] += log(r + 1) + FastLogChoose(r, l,
-							LogChooseList,
-							LogChooseListSize);
-	    }
-	  }
-	  else { /* group is empty */
-	    n2gList[g->label] = 0.0;
-	  }
-	}
-
-	/* Labeled-groups sampling correction */
-	if (noldg == 1 && nnewg != 0) { // effectng would decrease by one
-	  dH[newgnum] -= -FastLogFact(ngroup - effectng,
-				      LogFactList, LogFactListSize);
-	  dH[newgnum] += -FastLogFact(ngroup - (effectng-1),
-				      LogFactList, LogFactListSize);
-	}
-	else if (noldg != 1 && nnewg == 0) {  // effectng would increase by one
-	  dH[newgnum] -= -FastLogFact(ngroup - effectng,
-				      LogFactList, LogFactListSize);
-	  dH[newgnum] += -FastLogFact(ngroup - (effectng+1),
-				      LogFactList, LogFactListSize);
-	}
-      }
-
-      else { // oldg and newg are the same: nothing changes
-	dH[newgnum] = 0.0;
-      }
-
-      norm += exp(-dH[newgnum]);
-    }
-
-    /** Calculate the change of energy to go to an empty group **/
-    dHempty = 0.0;
-    nnewg = 0;
-    if (noldg == 1)  /* number of groups would decrease by one */ 
-      dHempty -= linC;
-    if (nnewg == 0)  /* number of groups would increase by one */
-      dHempty += linC;
-    n2newg = 0;
-    newg2oldg = 0;
-    newg2newg = 0;
-
-    for (slgn=0; slgn<slgsize; slgn++) {
-      g = glist[slg[slgn]];
-      if (g->size > 0) {  /* group is not empty */
-	if (g->label == oldg->label) {
-	  /* old conf, oldg-oldg */
-	  r = noldg * (noldg - 1) / 2;
-	  l = oldg2oldg;
-	  dHempty -= log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* new conf, oldg-olg */
-	  r = (noldg - 1) * (noldg - 2) / 2;
-	  l = oldg2oldg - n2oldg;
-	  dHempty += log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* old conf, newg-oldg */
-	  r = nnewg * noldg;
-	  l = newg2oldg;
-	  dHempty -= log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* new conf, newg-oldg */
-	  r = (nnewg + 1) * (noldg - 1);
-	  l = newg2oldg + n2oldg - n2newg;
-	  dHempty += log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	}
-	else {
-	  n2g = n2gList[g->label];
-	  oldg2g = G2G[oldg->label][g->label];
-	  newg2g = 0;
-	  ng = g->size;
-	  /* old conf, oldg-g */
-	  r = noldg * ng;
-	  l = oldg2g;
-	  dHempty -= log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* new conf, oldg-g */
-	  r = (noldg - 1) * ng;
-	  l = oldg2g - n2g;
-	  dHempty += log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* old conf, newg-g */
-	  r = nnewg * ng;
-	  l = newg2g;
-	  dHempty -= log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	  /* new conf, newg-g */
-	  r = (nnewg + 1) * ng;
-	  l = newg2g + n2g;
-	  dHempty += log(r + 1) + FastLogChoose(r, l,
-						LogChooseList,
-						LogChooseListSize);
-	}
-      }
-    }
-
-    /* Labeled-groups sampling correction */
-    if (noldg == 1 && nnewg != 0) { // effectng would decrease by one
-      dHempty -= -FastLogFact(ngroup - effectng,
-			      LogFactList, LogFactListSize);
-      dHempty += -FastLogFact(ngroup - (effectng-1),
-			      LogFactList, LogFactListSize);
-    }
-    else if (noldg != 1 && nnewg == 0) {  // effectng would increase by one
-      dHempty -= -FastLogFact(ngroup - effectng,
-			      LogFactList, LogFactListSize);
-      dHempty += -FastLogFact(ngroup - (effectng+1),
-			      LogFactList, LogFactListSize);
-    }
+  struct sbm_likelihood lk;
 
-    norm += exp(-dHempty) * (double)(nnod - slgsize);
-    
-    /** CHOOSE THE MOVE **/
-    dice = norm * gsl_rng_uniform(gen);
-
-    if (dice > (norm - (double)(nnod - slgsize) * exp(-dHempty))) {
-      /* Select an empty group */
-      newg = GetEmptyGroup(part);
-      newgnum = newg->label;
-      dH[newgnum] = dHempty;
-    }
-    else {
-      /* Select group in shortlist */
-      target = 0;
-      cum = 0.0;
-      while (cum < dice) {
-	cum += exp(-dH[slg[target++]]);
-      }
-      newgnum = slg[target - 1];
-      newg = glist[newgnum];
-    }
-    
-    /* MAKE THE MOVE AND UPDATE MATRICES */
-    MoveNode(node, oldg, newg);
-    *H += dH[newgnum];
-    
-    /* update G2G */
-    for (slgn=0; slgn<slgsize; slgn++) {
-      G2G[slg[slgn]][oldgnum] -= n2gList[slg[slgn]];
-      G2G[oldgnum][slg[slgn]] = G2G[slg[slgn]][oldgnum];
-      G2G[slg[slgn]][newgnum] += n2gList[slg[slgn]];
-      G2G[newgnum][slg[slgn]] = G2G[slg[slgn]][newgnum];
-    }
-    
-    /* Add newg to shortlist (if it's not there already!) */
-    isinlist = 0;
-    for (slgn=0; slgn<slgsize; slgn++)
-      if (newgnum == slg[slgn])
-	isinlist = 1;
-    if (isinlist == 0)
-      slg[slgsize++] = newgnum;
-  }  /* nnod moves completed: done! */
-
-  free_i_vec(slg);
-  free_d_vec(dH);
+  SetPlainLikelihood(&lk, linC, LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize);
+  SBMGibbsStep(H, &lk, nlist, glist, part, nnod, G2G, n2gList, gen);
+  return;
 }
 
-
 /*
   ---------------------------------------------------------------------
   
@@ -2323,76 +4350,20 @@ GibbsThermalizeLinkScore(double *H,
 			 struct group **glist,
 			 struct group *part,
 			 int nnod,
-			 int **G2G,
+			 struct group_links *G2G,
 			 int *n2gList,
-			 double **LogChooseList,
+			 double *LogChooseList,
 			 int LogChooseListSize,
 			 double *LogFactList, int LogFactListSize,
 			 gsl_rng *gen,
 			 char verbose_sw)
 {
-  double HMean0=1.e10, HStd0=1.e-10, HMean1, HStd1, *Hvalues;
-  int rep, nrep=20;
-  int equilibrated=0;
-
-  Hvalues = allocate_d_vec(nrep);
-
-  do {
-    
-    /* MC steps */
-    for (rep=0; rep<nrep; rep++) {
-      GibbsLinkScoreStep(H, linC, nlist, glist, part,
-			 nnod, G2G, n2gList, LogChooseList, LogChooseListSize,
-			 LogFactList, LogFactListSize,
-			 gen);
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      case 'd':
-	fprintf(stderr, "%lf %lf %d\n", *H, PartitionH(part, linC),
-		NNonEmptyGroups(part));
-	break;
-      default:
-	fprintf(stderr, "%lf\n", *H);
-	break;
-      }
-      Hvalues[rep] = *H;
-    }
-    
-    /* Check for equilibration */
-    HMean1 = mean(Hvalues, nrep);
-    HStd1 = stddev(Hvalues, nrep);
-    if ((HMean0 - HStd0 / sqrt(nrep)) - (HMean1 + HStd1 / sqrt(nrep))
-	< EPSILON) {
-      equilibrated++;
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tequilibrated (%d/5) H=%lf\n",
-		equilibrated, HMean1);
-	break;
-      }
-    }
-    else {
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tnot equilibrated yet H0=%g+-%g H1=%g+-%g\n",
-		HMean0, HStd0 / sqrt(nrep), HMean1, HStd1 / sqrt(nrep));
-	break;
-      }
-      HMean0 = HMean1;
-      HStd0 = HStd1;
-      equilibrated = 0;
-    }
-
-  } while (equilibrated < 5);
-  
-  /* Clean up */
-  free_d_vec(Hvalues);
+  struct sbm_likelihood lk;
 
+  SetPlainLikelihood(&lk, linC, LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize);
+  SBMThermalize(1, 1, H, &lk, nlist, glist, part,
+		nnod, G2G, n2gList, gen, verbose_sw);
   return;
 }
 
@@ -2400,186 +4371,22 @@ GibbsThermalizeLinkScore(double *H,
   ---------------------------------------------------------------------
   Predict the links missing in a network. The algorithm returns a
   matrix of scores for all links.
+  If cand is not NULL, only the candidate pairs are scored (the
+  scores are left in cand->score) and NULL is returned.
   ---------------------------------------------------------------------
 */
-double **
+struct pair_matrix *
 GibbsLinkScore(struct node_gra *net,
 	       double linC,
 	       int nIter,
 	       gsl_rng *gen,
-	       char verbose_sw)
+	       char verbose_sw,
+	       struct pair_score *cand)
 {
-  int nnod=CountNodes(net);
-  struct group *part=NULL;
-  struct node_gra *p=NULL, *node=NULL;
-  struct node_gra **nlist=NULL;
-  struct group **glist=NULL;
-  struct group *lastg=NULL;
-  double H;
-  int iter, decorStep;
-  double **predA=NULL;
-  int i, j;
-  int **G2G=NULL;
-  int *n2gList=NULL;
-  int LogChooseListSize = 10000;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
-  struct node_lis *p1=NULL, *p2=NULL;
-  double contrib;
-  int dice;
-  int norm = 0;
-  int r, l;
-  double mutualInfo;
-  int LogFactListSize = 10000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
-
-  /*
-    PRELIMINARIES
-  */
-  /* Initialize the predicted adjacency matrix */
-  predA = allocate_d_mat(nnod, nnod);
-  for (i=0; i<nnod; i++)
-    for (j=0; j<nnod; j++)
-      predA[i][j] = 0.0;
-
-  /* Map nodes and groups to a list for faster access */
-  nlist = (struct node_gra **) calloc(nnod, sizeof(struct node_gra *));
-  glist = (struct group **) calloc(nnod, sizeof(struct group *));
-  lastg = part = CreateHeaderGroup();
-  p = net;
-  while ((p = p->next) != NULL) {
-    nlist[p->num] = p;
-    lastg = glist[p->num] = CreateGroup(lastg, p->num);
-  }
-
-  /* Place nodes in random partitions */
-  p = net;
-  ResetNetGroup(net);
-  while ((p = p->next) != NULL) {
-    dice = floor(gsl_rng_uniform(gen) * (double)nnod);
-    /* AddNodeToGroup(glist[dice], p); */
-    AddNodeToGroup(glist[p->num], p);
-  }
-
-  /* Get the initial group-to-group links matrix */
-  G2G = allocate_i_mat(nnod, nnod);
-  n2gList = allocate_i_vec(nnod);
-  for (i=0; i<nnod; i++) {
-    G2G[i][i] = glist[i]->inlinks;
-    for (j=i+1; j<nnod; j++) {
-      G2G[i][j] = G2G[j][i] = NG2GLinks(glist[i], glist[j]);
-    }
-  }
-
-  /* Initial energy */
-  H = PartitionH(part, linC);
-
-  /*
-    GET READY FOR THE SAMPLING
-  */
-
-  /* Thermalization */
-  switch (verbose_sw) {
-  case 'q':
-    break;
-  default:
-    fprintf(stderr, "#\n#\n# THERMALIZING\n");
-    fprintf(stderr, "# ------------\n");
-    break;
-  }
-  GibbsThermalizeLinkScore(&H, linC, nlist, glist, part,
-			   nnod, G2G, n2gList,
-			   LogChooseList, LogChooseListSize,
-			   LogFactList, LogFactListSize,
-			   gen, verbose_sw);
-  
-  /*
-    SAMPLIN' ALONG
-  */
-  /* Unless we are in debug mode, reset the origin of energies */
-  switch (verbose_sw) {
-  case 'd':
-    break;
-  default:
-    /* H = 0; */
-    break;
-  }
-
-  /* Do the MC Steps */
-  for (iter=0; iter<nIter; iter++) {
-    GibbsLinkScoreStep(&H, linC, nlist, glist, part,
-		       nnod, G2G, n2gList, LogChooseList, LogChooseListSize,
-		       LogFactList, LogFactListSize,
-		       gen);
-    switch (verbose_sw) {
-    case 'q':
-      break;
-    case 'v':
-      fprintf(stderr, "%d %lf\n", iter, H);
-      break;
-    case 'd':
-      fprintf(stderr, "%d %lf %lf %d\n", iter, H, PartitionH(part, linC),
-	      NNonEmptyGroups(part));
-      /* FPrintPartition(stderr, part, 0); */
-      break;
-    }
-
-    /* Update partition function */
-    norm += 1;
-
-    /* Update the predicted adjacency matrix by going through all
-       group pairs */
-    for (i=0; i<nnod; i++) {
-      if (glist[i]->size > 0) {
-	
-	/* update the within-group pairs */
-	r = glist[i]->size * (glist[i]->size - 1) / 2;
-	l = glist[i]->inlinks;
-	contrib = (float)(l + 1) / (float)(r + 2);
-	p1 = glist[i]->nodeList;
-	while ((p1 = p1->next) != NULL) {
-	  p2 = p1;
-	  while ((p2 = p2->next) != NULL) {
-	    predA[p1->node][p2->node] += contrib;
-	    predA[p2->node][p1->node] += contrib;
-	  }
-	}
-      
-	/* update the between-group pairs */
-	for (j=i+1; j<nnod; j++) {
-	  if (glist[j]->size > 0) {
-	    l = G2G[i][j];
-	    r = glist[i]->size * glist[j]->size;
-	    contrib = (float)(l + 1) / (float)(r + 2);
-	    p1 = glist[i]->nodeList;
-	    while ((p1 = p1->next) != NULL) {
-	      p2 = glist[j]->nodeList;
-	      while ((p2 = p2->next) != NULL) {
-		predA[p1->node][p2->node] += contrib;
-		predA[p2->node][p1->node] += contrib;
-	      }
-	    }
-	  }
-	}
-      }
-    } /* Done updating adjacency matrix */
-
-  }  /* End of iter loop */
-
-  /* Normalize the predicted adjacency matrix */
-  for (i=0; i<nnod; i++) {
-    for (j=0; j<nnod; j++) {
-      predA[i][j] /= (double)norm;
-    }
-  }
-
-  /* Done */
-  RemovePartition(part);
-  free(glist);
-  free(nlist);
-  free_i_mat(G2G, nnod);
-  free_i_vec(n2gList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
-  FreeFastLogFact(LogFactList);
+  struct sbm_likelihood *lk = CreateSBMLikelihood(CountNodes(net), linC);
+  struct pair_matrix *predA = NULL;
 
+  predA = LinkScoreSampler(net, lk, nIter, 1, gen, verbose_sw, cand, NULL);
+  FreeSBMLikelihood(lk);
   return predA;
 }
@@ -18,6 +18,302 @@
 
 #define EPSILON 1.e-6
 
+/*
+  ---------------------------------------------------------------------
+  Link counts between groups, stored only for the non-empty groups:
+  each group that is (or has recently been) non-empty gets a slot in
+  a compact count matrix, and the slots of groups that become empty
+  are recycled
+  ---------------------------------------------------------------------
+*/
+struct group_links{
+  int nlabel;       // number of group labels
+  int nslot;        // number of slots used so far (free ones included)
+  int capacity;     // size of the count matrix
+  int *slot;        // slot of each group label, or -1 if it has none
+  int *label;       // group label in each slot, or -1 if it is free
+  int *freeSlot;    // stack of free slots
+  int nfree;        // number of free slots
+  int **count;      // links between the groups in each pair of slots
+};
+
+/* Links between groups g1 and g2, which must both have a slot */
+#define G2G_LINKS(gl, g1, g2) \
+  ((gl)->count[(gl)->slot[(g1)]][(gl)->slot[(g2)]])
+
+struct group_links *CreateGroupLinks(struct group *part, int nlabel);
+struct group_links *CopyGroupLinks(struct group_links *gl);
+void FreeGroupLinks(struct group_links *gl);
+void GroupLinksActivate(struct group_links *gl, int g);
+void GroupLinksPrune(struct group_links *gl, struct group **glist);
+void GroupLinksMoveNode(struct group_links *gl,
+			int *glabels, int ngroup, int *n2gList,
+			int oldg, int newg);
+
+/*
+  ---------------------------------------------------------------------
+  Self-contained copy of the state of a block model sampler (nodes,
+  partition and link counts), to run a sampler on it while the
+  original is used elsewhere
+  ---------------------------------------------------------------------
+*/
+struct sbm_state{
+  int nnod;
+  struct node_gra *net;          // copies of the nodes
+  struct node_gra **nlist;
+  struct group *part;
+  struct group **glist;
+  struct group_links *G2G;
+  int *n2gList;
+  double H;
+};
+
+struct sbm_state *CopySBMState(struct node_gra **nlist, struct group *part,
+			       int nnod, struct group_links *G2G, double H);
+void FreeSBMState(struct sbm_state *state);
+
+/*
+  ---------------------------------------------------------------------
+  Candidate node pairs, for scoring only some pairs instead of the
+  whole nnod x nnod matrix
+  ---------------------------------------------------------------------
+*/
+struct pair_score{
+  int npair;        // number of pairs
+  int *n1;          // num of the first node of each pair
+  int *n2;          // num of the second node of each pair
+  double *score;    // score of each pair
+};
+
+struct pair_score *CreatePairScore(int npair);
+void FreePairScore(struct pair_score *cand);
+struct pair_score *CandidatePairs(struct node_gra *net,
+				  int nnonlink,
+				  gsl_rng *gen);
+struct pair_score *FReadCandidatePairs(FILE *inF, struct node_gra *net);
+void GroupPairLinks(struct node_gra *n1, struct node_gra *n2,
+		    struct group **glist, struct group_links *G2G,
+		    int *l, int *r);
+
+/*
+  ---------------------------------------------------------------------
+  Scores of all the pairs of nnod nodes, which are symmetric, stored
+  once per pair i < j as floats, row by row. While scores are being
+  accumulated, comp holds the compensation of each sum (Kahan
+  summation); FinishPairMatrix folds it in and frees it.
+  ---------------------------------------------------------------------
+*/
+struct pair_matrix{
+  int nnod;
+  float *score;     // nnod (nnod - 1) / 2 scores
+  float *comp;      // compensations (NULL when not accumulating)
+};
+
+/* Index of pair i < j in score */
+#define PAIR_MATRIX_INDEX(nnod, i, j) \
+  ((long int)(i) * (nnod) - (long int)(i) * ((i) + 1) / 2 + (j) - (i) - 1)
+
+struct pair_matrix *CreatePairMatrix(int nnod, char accumulate);
+void FreePairMatrix(struct pair_matrix *pm);
+double PairMatrixGet(const struct pair_matrix *pm, int i, int j);
+void PairMatrixAdd(struct pair_matrix *pm, int i, int j, double x);
+void FinishPairMatrix(struct pair_matrix *pm, double norm);
+
+/*
+  ---------------------------------------------------------------------
+  Output of link reliabilities. The scores of non-links go to
+  missingF and those of links to spuriousF (or to missingF as well,
+  if spuriousF is NULL), as "score label1 label2" lines; "-" stands
+  for stdout. Optionally, only the topk highest-scoring non-links and
+  lowest-scoring links (of each node, or overall) are written, and
+  only non-links scoring at least threshold and links scoring below
+  it. If binaryF is set, all scores are dumped there instead (see
+  FWriteLinkScores).
+  ---------------------------------------------------------------------
+*/
+struct ls_output{
+  char *missingF;      // non-links ("-" for stdout)
+  char *spuriousF;     // links (NULL: together with the non-links)
+  char *binaryF;       // if not NULL, binary dump of all the scores
+  int topk;            // if > 0, number of pairs to keep...
+  char perNode;        // ...for each node (1) or overall (0)
+  char threshold_sw;   // if 1, filter the pairs by threshold
+  double threshold;
+};
+
+#define LS_OUTPUT_OPTIONS "m:s:k:K:T:b:"
+
+void SetLSOutput(struct ls_output *out, char *missingF, char *spuriousF);
+int LSOutputOption(struct ls_output *out, int opt, char *arg);
+void PrintLSOutputUsage(void);
+int FWriteLinkScores(struct ls_output *out,
+		     struct node_gra *net,
+		     struct pair_matrix *predA,
+		     struct pair_score *cand);
+
+/*
+  ---------------------------------------------------------------------
+  Likelihood of a block model, as seen by the samplers. All the link
+  reliability models share the same moves and bookkeeping, and only
+  differ in these terms. The energy of a partition with ng non-empty
+  groups out of nnod is
+
+    linC ng + sum_{group pairs} block(r, l) - ln((nnod - ng)!)
+            - degeneracy(ng)
+
+  where r is the number of node pairs in a pair of groups and l the
+  number of links among them, and score(r, l) is the reliability of
+  a node pair in such a pair of groups.
+  ---------------------------------------------------------------------
+*/
+struct sbm_likelihood{
+  const char *name;          // model name (tags cached decorrelation steps)
+  double linC;               // cost of each non-empty group
+  double (*block)(int r, int l, const struct sbm_likelihood *lk);
+  double (*score)(int r, int l, const struct sbm_likelihood *lk);
+  double (*degeneracy)(int ng);  // NULL if the model has no such term
+  double (*partitionH)(struct group *part, const struct sbm_likelihood *lk);
+  double *LogChooseList;     // ln(r!) table of the block terms
+  int LogChooseListSize;
+  double *LogFactList;       // ln(r!) table of the group labels
+  int LogFactListSize;
+  double *HarmonicList;      // harmonic numbers (multiblock models)
+  double *LogGammaListA;     // ln(Gamma(r + a)) table (sparse model)
+  double *LogGammaListB;     // ln(Gamma(r + b)) table
+  double *LogGammaListAB;    // ln(Gamma(r + a + b)) table
+  int LogGammaListSize;
+  double a, b;               // beta prior on the link densities
+};
+
+struct sbm_likelihood *CreateSBMLikelihood(int nnod, double linC);
+void FreeSBMLikelihood(struct sbm_likelihood *lk);
+void SBMMCStep(int factor,
+	       double *H,
+	       const struct sbm_likelihood *lk,
+	       struct node_gra **nlist,
+	       struct group **glist,
+	       struct group *part,
+	       int nnod,
+	       struct group_links *G2G,
+	       int *n2gList,
+	       gsl_rng *gen);
+void SBMGibbsStep(double *H,
+		  const struct sbm_likelihood *lk,
+		  struct node_gra **nlist,
+		  struct group **glist,
+		  struct group *part,
+		  int nnod,
+		  struct group_links *G2G,
+		  int *n2gList,
+		  gsl_rng *gen);
+int SBMGetDecorrelationStep(double *H,
+			    const struct sbm_likelihood *lk,
+			    struct node_gra **nlist,
+			    struct group *part,
+			    int nnod,
+			    struct group_links *G2G,
+			    gsl_rng *gen,
+			    char verbose_sw);
+void SBMThermalize(char gibbs_sw,
+		   int decorStep,
+		   double *H,
+		   const struct sbm_likelihood *lk,
+		   struct node_gra **nlist,
+		   struct group **glist,
+		   struct group *part,
+		   int nnod,
+		   struct group_links *G2G,
+		   int *n2gList,
+		   gsl_rng *gen,
+		   char verbose_sw);
+
+/*
+  ---------------------------------------------------------------------
+  Samples of the block model, for computing scores after sampling
+  ---------------------------------------------------------------------
+*/
+struct sbm_samples{
+  int nnod;                  // number of nodes
+  int nsample;               // number of samples recorded
+  int capacity;              // number of samples there is room for
+  int *n2g;                  // group of each node in each sample
+  int *ngroup;               // number of non-empty groups in each sample
+  long int *offset;          // start of each sample in contrib
+  float *contrib;            // contribution of each pair of groups
+  long int ncontrib;         // length of contrib
+  long int contribCapacity;  // allocated length of contrib
+};
+
+struct sbm_samples *CreateSBMSamples(int nnod, int nsample);
+void FreeSBMSamples(struct sbm_samples *samples);
+void AddSBMSample(struct sbm_samples *samples,
+		  const struct sbm_likelihood *lk,
+		  struct node_gra **nlist, struct group **glist, struct group_links *G2G);
+double SBMSamplesPairScore(struct sbm_samples *samples, int n1, int n2);
+struct pair_matrix *SBMSamplesScoreMatrix(struct sbm_samples *samples);
+void SBMSamplesCandidateScores(struct sbm_samples *samples,
+			       struct pair_score *cand);
+
+/*
+  ---------------------------------------------------------------------
+  Link reliability Markov chains, which can be advanced one iteration
+  at a time (so that several of them can run side by side)
+  ---------------------------------------------------------------------
+*/
+struct ls_chain{
+  int nnod;                  // number of nodes
+  char gibbs_sw;             // heat-bath (1) or Metropolis (0) moves
+  const struct sbm_likelihood *lk;  // the model (not owned by the chain)
+  struct node_gra **nlist;   // the nodes, by num
+  struct group *part;        // the current partition
+  struct group **glist;      // the groups, by label
+  struct group_links *G2G;   // links between groups
+  int *n2gList;              // scratch node-to-group link counts
+  double H;                  // energy of the current partition
+  int decorStep;             // MC steps per iteration (Metropolis)
+  int niter;                 // iterations sampled so far
+  gsl_rng *gen;              // random number generator (not owned)
+};
+
+/*
+  Convergence of a set of chains, after niter iterations of each:
+  potential scale reduction factors (R-hat) of the energy and the
+  largest one among a sample of pair scores
+*/
+struct ls_diagnostics{
+  int niter;
+  double rhatH;
+  double rhatScore;
+};
+
+/*
+  Sampling settings of the link reliability programs: nchain
+  independent chains of niter iterations each, run on nthread
+  threads, stopping early once all the R-hat diagnostics are below
+  rhatMax (if rhatMax > 0). The -D option of LS_SAMPLING_OPTIONS sets
+  the decorrelation step cache (see SetDecorrelationCache).
+*/
+struct ls_sampling{
+  int niter;
+  int nchain;
+  int nthread;
+  double rhatMax;
+};
+
+#define LS_SAMPLING_OPTIONS "i:c:t:r:D:"
+
+struct ls_chain *CreateLSChain(struct node_gra *net,
+			       const struct sbm_likelihood *lk,
+			       char gibbs_sw,
+			       gsl_rng *gen,
+			       char verbose_sw);
+void FreeLSChain(struct ls_chain *chain);
+void LSChainStep(struct ls_chain *chain);
+void LSChainAddScores(struct ls_chain *chain,
+		      struct pair_matrix *predA,
+		      struct pair_score *cand,
+		      struct sbm_samples *samples);
+
 /*
   ---------------------------------------------------------------------
   Missing links
@@ -33,21 +329,19 @@ void LinkScoreMCStep(int factor,
 		     struct group **glist,
 		     struct group *part,
 		     int nnod,
-		     int **G2G,
+		     struct group_links *G2G,
 		     int *n2gList,
-		     double **LogChooseList,
+		     double *LogChooseList,
 		     int LogChooseListSize,
 		     double *LogFactList, int LogFactListSize,
 		     gsl_rng *gen);
 int GetDecorrelationStep(double *H,
 			 double linC,
 			 struct node_gra **nlist,
-			 struct group **glist,
 			 struct group *part,
 			 int nnod,
-			 int **G2G,
-			 int *n2gList,
-			 double **LogChooseList,
+			 struct group_links *G2G,
+			 double *LogChooseList,
 			 int LogChooseListSize,
 			 double *LogFactList, int LogFactListSize,
 			 gsl_rng *gen,
@@ -59,18 +353,52 @@ void ThermalizeLinkScoreMC(int decorStep,
 			   struct group **glist,
 			   struct group *part,
 			   int nnod,
-			   int **G2G,
+			   struct group_links *G2G,
 			   int *n2gList,
-			   double **LogChooseList,
+			   double *LogChooseList,
 			   int LogChooseListSize,
 			   double *LogFactList, int LogFactListSize,
 			   gsl_rng *gen,
 			   char verbose_sw);
-double **LinkScore(struct node_gra *net,
-		   double linC,
-		   int nIter,
-		   gsl_rng *gen,
-		   char verbose_sw);
+struct pair_matrix *SBMLinkScore(struct node_gra *net,
+				 const struct sbm_likelihood *lk,
+				 int nIter,
+				 char gibbs_sw,
+				 gsl_rng *gen,
+				 char verbose_sw,
+				 struct pair_score *cand);
+struct pair_matrix *LinkScore(struct node_gra *net,
+			      double linC,
+			      int nIter,
+			      gsl_rng *gen,
+			      char verbose_sw,
+			      struct pair_score *cand);
+struct sbm_samples *LinkScoreSamples(struct node_gra *net,
+				     double linC,
+				     int nIter,
+				     gsl_rng *gen,
+				     char verbose_sw);
+struct pair_matrix *MultiChainLinkScore(struct node_gra *net,
+					const struct sbm_likelihood *lk,
+					int nIter,
+					char gibbs_sw,
+					int nchain,
+					int nthread,
+					double rhatMax,
+					gsl_rng *gen,
+					char verbose_sw,
+					struct pair_score *cand,
+					struct ls_diagnostics *diag);
+void SetLSSampling(struct ls_sampling *smp, int niter);
+int LSSamplingOption(struct ls_sampling *smp, int opt, char *arg);
+void PrintLSSamplingUsage(void);
+struct pair_matrix *SampledLinkScore(struct node_gra *net,
+				     const struct sbm_likelihood *lk,
+				     char gibbs_sw,
+				     const struct ls_sampling *smp,
+				     gsl_rng *gen,
+				     char verbose_sw,
+				     struct pair_score *cand);
 double SBMError(struct node_gra *net, gsl_rng *gen);
 double SBMStructureScore(struct node_gra *net, int nrep, gsl_rng *gen);
 struct node_gra *NetFromSBMScores(struct node_gra *net, gsl_rng *gen);
@@ -112,7 +440,6 @@ void LSMCStepKState(int K,
 int LSGetDecorrelationStepKState(int K,
 				 double *H,
 				 struct node_gra **nlist,
-				 struct group **glist,
 				 struct group *part,
 				 int nnod,
 				 int *ng,
@@ -158,9 +485,9 @@ void GibbsLinkScoreStep(double *H,
 			struct group **glist,
 			struct group *part,
 			int nnod,
-			int **G2G,
+			struct group_links *G2G,
 			int *n2gList,
-			double **LogChooseList,
+			double *LogChooseList,
 			int LogChooseListSize,
 			double *LogFactList, int LogFactListSize,
 			gsl_rng *gen);
@@ -170,18 +497,19 @@ void GibbsThermalizeLinkScore(double *H,
 			      struct group **glist,
 			      struct group *part,
 			      int nnod,
-			      int **G2G,
+			      struct group_links *G2G,
 			      int *n2gList,
-			      double **LogChooseList,
+			      double *LogChooseList,
 			      int LogChooseListSize,
 			      double *LogFactList, int LogFactListSize,
 			      gsl_rng *gen,
 			      char verbose_sw);
-double **GibbsLinkScore(struct node_gra *net,
-			double linC,
-			int nIter,
-			gsl_rng *gen,
-			char verbose_sw);
+struct pair_matrix *GibbsLinkScore(struct node_gra *net,
+				   double linC,
+				   int nIter,
+				   gsl_rng *gen,
+				   char verbose_sw,
+				   struct pair_score *cand);
 
 
 
@@ -4,6 +4,7 @@
   $Revision$
 */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -41,157 +42,366 @@ EmptyGraph(int S)
 
 /*
   ---------------------------------------------------------------------
-  Create an Erdos-Renyi random graph
+  ---------------------------------------------------------------------
+  Sparse generators: the models below are sampled as flat lists of
+  nlink undirected links (ori[i], des[i]) between nodes 0..S-1, in
+  time and memory O(S + nlink). The lists can be written to a file
+  with FPrintLinks or turned into a network with LinksToGraph (node
+  num i has label i+1). ori and des are allocated by the generator and
+  must be freed with free_i_vec.
+  ---------------------------------------------------------------------
   ---------------------------------------------------------------------
 */
-struct node_gra *
-ERGraph(int S, double p, gsl_rng *gen)
-{
-  int node1, node2;
-  struct node_gra **nodeList = NULL;
-  struct node_gra *root = NULL, *last = NULL;
-  char label[MAX_LABEL_LENGTH];
 
-  /* Create header */
-  last = root = CreateHeaderGraph();
-  
-  /* Create nodes */
-  nodeList = (struct node_gra **)calloc(S, sizeof(struct node_gra *));
-  for (node1=0; node1<S; node1++) {
-    sprintf(&label[0], "%d", node1+1);
-    last = nodeList[node1] = CreateNodeGraph(last, &label[0]);
+/*
+  Append the link n1-n2 to the lists, doubling their capacity when
+  needed.
+*/
+static void
+PushLink(int n1, int n2, int *nlink, int *cap, int **ori, int **des)
+{
+  if (*nlink == *cap) {
+    *cap = 2 * *cap + 16;
+    *ori = (int *)realloc(*ori, *cap * sizeof(int));
+    *des = (int *)realloc(*des, *cap * sizeof(int));
+    if (*ori == NULL || *des == NULL) {
+      fprintf(stderr, "ERROR: Cannot allocate %d links\n", *cap);
+      exit(1);
+    }
   }
+  (*ori)[*nlink] = n1;
+  (*des)[*nlink] = n2;
+  (*nlink)++;
+}
 
-  /* Create the links */
-  for (node1=0; node1<S; node1++) {
-    for (node2=node1+1; node2<S; node2++) {
-      if (gsl_rng_uniform(gen) < p) {
-	AddAdjacency(nodeList[node1], nodeList[node2], 0, 0, 0, 0);
-	AddAdjacency(nodeList[node2], nodeList[node1], 0, 0, 0, 0);
+/*
+  Add each pair of nodes in a block independently with probability p,
+  using geometric skip-sampling (Batagelj and Brandes, PRE 2005): the
+  number of pairs skipped before the next link is drawn from a
+  geometric distribution, so the cost is O(n + links) instead of
+  O(pairs). The block contains the pairs between nodes o1..o1+n1-1 and
+  o2..o2+n2-1 or, if o1 == o2, the n1(n1-1)/2 pairs within o1..o1+n1-1.
+*/
+static void
+SkipSampleBlock(int o1, int n1, int o2, int n2, double p, gsl_rng *gen,
+		int *nlink, int *cap, int **ori, int **des)
+{
+  long long int npair, idx = -1, start = 0;
+  int row = 1;
+  double lq, skip;
+
+  if (o1 == o2)
+    npair = (long long int)n1 * (n1 - 1) / 2;
+  else
+    npair = (long long int)n1 * n2;
+  if (p <= 0.0 || npair == 0)
+    return;
+  lq = log1p(-p);
+
+  while (1) {
+    /* Pairs skipped before the next link */
+    if (p >= 1.0)
+      skip = 0.0;
+    else
+      skip = floor(log1p(-gsl_rng_uniform(gen)) / lq);
+    if (skip >= (double)(npair - idx - 1))
+      break;
+    idx += 1 + (long long int)skip;
+
+    /* Map idx to a pair of nodes */
+    if (o1 == o2) {
+      /* Row r contains the pairs (r, c) with c < r */
+      while (idx >= start + row) {
+	start += row;
+	row++;
       }
+      PushLink(o1 + row, o1 + (int)(idx - start), nlink, cap, ori, des);
+    }
+    else {
+      PushLink(o1 + (int)(idx / n2), o2 + (int)(idx % n2),
+	       nlink, cap, ori, des);
     }
   }
+}
 
-  /* Done */
-  free(nodeList);
-  return root;
+/*
+  ---------------------------------------------------------------------
+  Links of an Erdos-Renyi random graph with S nodes and link
+  probability p. Returns the number of links.
+  ---------------------------------------------------------------------
+*/
+int
+ERLinks(int S, double p, gsl_rng *gen, int **ori, int **des)
+{
+  int nlink = 0, cap = 0;
+
+  *ori = *des = NULL;
+  SkipSampleBlock(0, S, 0, S, p, gen, &nlink, &cap, ori, des);
+  return nlink;
 }
 
 /*
   ---------------------------------------------------------------------
-  Create a preferential attachment (aka Barabasi-Albert) network
+  Links of a preferential attachment (aka Barabasi-Albert) network:
+  m initial fully connected nodes, and each new node connects to m
+  different existing nodes chosen with probability proportional to
+  their degree. Link ends are stored in a flat array, so that each
+  choice takes constant time. Returns the number of links.
   ---------------------------------------------------------------------
 */
-struct node_gra *
-PAGraph(int S, int m, gsl_rng *gen)
+int
+PALinks(int S, int m, gsl_rng *gen, int **ori, int **des)
 {
-  int node1, node2, n;
-  struct node_gra **nodeList=NULL;
-  struct node_gra *root=NULL, *last=NULL;
-  char label[MAX_LABEL_LENGTH];
+  int node1, node2, n, k;
   int *paList=NULL, norm=0;
+  int nlink = 0, cap = 0;
+
+  *ori = *des = NULL;
 
   /* The list for selecting nodes preferentially */
-  paList = (int *)calloc(2 * S * m, sizeof(int));
+  paList = (int *)calloc(2 * (long)S * m + 1, sizeof(int));
 
   /* Initial m fully connected nodes */
-  nodeList = (struct node_gra **)calloc(S, sizeof(struct node_gra *));
-  last = root = CreateHeaderGraph();
-  for (node1=0; node1<m; node1++) {
-    sprintf(&label[0], "%d", node1+1);
-    last = nodeList[node1] = CreateNodeGraph(last, &label[0]);
+  for (node1=0; node1<m && node1<S; node1++) {
     for (node2=0; node2<node1; node2++) {
-      AddAdjacency(nodeList[node1], nodeList[node2], 0, 0, 0, 0);
-      AddAdjacency(nodeList[node2], nodeList[node1], 0, 0, 0, 0);
+      PushLink(node1, node2, &nlink, &cap, ori, des);
       paList[norm++]=node1;
       paList[norm++]=node2;
     }
   }
-  
+
   /* Create remaining nodes and links */
   for (node1=m; node1<S; node1++) {
-    sprintf(&label[0], "%d", node1+1);
-    last = nodeList[node1] = CreateNodeGraph(last, &label[0]);
     for (n=0; n<m; n++) {
+      /* preferential attachment, avoiding the m-1 targets of node1
+	 chosen so far */
       do {
-	/* preferential attachment */
 	node2 = paList[(int)(gsl_rng_uniform(gen) * norm)];
+	for (k=0; k<n; k++)
+	  if ((*des)[nlink - n + k] == node2)
+	    break;
       }
-      while (IsThereLink(nodeList[node1], nodeList[node2]) == 1);
-      AddAdjacency(nodeList[node1], nodeList[node2], 0, 0, 0, 0);
-      AddAdjacency(nodeList[node2], nodeList[node1], 0, 0, 0, 0);
+      while (k < n);
+      PushLink(node1, node2, &nlink, &cap, ori, des);
+    }
+    /* Only now node1 can be chosen (no self-links) */
+    for (n=0; n<m; n++) {
       paList[norm++]=node1;
-      paList[norm++]=node2;
+      paList[norm++]=(*des)[nlink - m + n];
     }
   }
 
   /* Done */
-  free(nodeList);
   free(paList);
-  return root;
+  return nlink;
 }
 
 /*
   ---------------------------------------------------------------------
-  Create an undirected block graph. Arguments:
+  Links of an undirected block graph (stochastic block model) with
+  ngroup groups of consecutive nodes of sizes gsize, and probability
+  q[g1][g2] (g1 <= g2) of a link between a node in g1 and a node in
+  g2. Each block of pairs is sampled with geometric skips. Returns the
+  number of links.
+  ---------------------------------------------------------------------
+*/
+int
+BlockLinks(int ngroup, int *gsize, double **q, gsl_rng *gen,
+	   int **ori, int **des)
+{
+  int g1, g2, o1, o2;
+  int nlink = 0, cap = 0;
 
-  - ngroup: number of groups
-  - gsize: a list with the group sizes
-  - q: matrix of block-to-block connectivity probability
-  - output_sw: 'v' for verbose
-  - gen: random number generator
+  *ori = *des = NULL;
+  for (g1=0, o1=0; g1<ngroup; o1+=gsize[g1], g1++)
+    for (g2=g1, o2=o1; g2<ngroup; o2+=gsize[g2], g2++)
+      SkipSampleBlock(o1, gsize[g1], o2, gsize[g2], q[g1][g2], gen,
+		      &nlink, &cap, ori, des);
+  return nlink;
+}
+
+/*
+  Block probabilities of a Girvan-Newman graph (to be freed with
+  free_d_mat).
+*/
+static double **
+GirvanNewmanBlocks(int ngroup, int gsize, double kin, double kout)
+{
+  double **q;
+  int g1, g2;
+
+  q = allocate_d_mat(ngroup, ngroup);
+  for (g1=0; g1<ngroup; g1++) {
+    q[g1][g1] = (double)(kin) / (double)(gsize - 1);
+    for (g2=g1+1; g2<ngroup; g2++) {
+      q[g1][g2] = q[g2][g1] =
+	(double)(kout) / (double)(gsize * (ngroup - 1));
+    }
+  }
+  return q;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Links of a Girvan-Newman graph (PNAS, 2002): ngroup groups of gsize
+  nodes, with average kin links within the group and kout links to
+  other groups per node. Returns the number of links.
+  ---------------------------------------------------------------------
+*/
+int
+GirvanNewmanLinks(int ngroup, int gsize, double kin, double kout,
+		  gsl_rng *gen, int **ori, int **des)
+{
+  double **q = GirvanNewmanBlocks(ngroup, gsize, kin, kout);
+  int *gsizes = allocate_i_vec(ngroup);
+  int g, nlink;
+
+  for (g=0; g<ngroup; g++)
+    gsizes[g] = gsize;
+  nlink = BlockLinks(ngroup, gsizes, q, gen, ori, des);
 
+  free_d_mat(q, ngroup);
+  free_i_vec(gsizes);
+  return nlink;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Write a list of links, one per line, using node labels (num + 1)
+  ---------------------------------------------------------------------
+*/
+void
+FPrintLinks(FILE *outF, int nlink, int *ori, int *des)
+{
+  int i;
+
+  for (i=0; i<nlink; i++)
+    fprintf(outF, "%d %d\n", ori[i] + 1, des[i] + 1);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Build a network with S nodes (labels 1..S) from a list of links. The
+  adjacency lists are built by appending at their ends, in time
+  O(S + nlink).
   ---------------------------------------------------------------------
 */
 struct node_gra *
-UndirectedBlockGraph(int ngroup, int *gsize, double **q,
-		     char output_sw, gsl_rng *gen)
+LinksToGraph(int S, int nlink, int *ori, int *des)
 {
-  int node1, node2;
+  int node1, i;
   struct node_gra **nodeList = NULL;
+  struct node_lis **lastList = NULL;
   struct node_gra *root = NULL, *last = NULL;
   char label[MAX_LABEL_LENGTH];
-  int i, S=0;
 
   /* Create header */
   last = root = CreateHeaderGraph();
   
   /* Create nodes */
-  for (i=0; i<ngroup; i++)
-    S += gsize[i];
-  nodeList = (struct node_gra **)calloc(S, sizeof(struct node_gra *));
-  S = 0;
-  for (i=0; i<ngroup; i++) {
-    for (node1=S; node1<S+gsize[i]; node1++) {
-      sprintf(&label[0], "%d", node1+1);
-      last = nodeList[node1] = CreateNodeGraph(last, &label[0]);
-      last->inGroup = i;
-    }
-    S += gsize[i];
+  nodeList = (struct node_gra **)calloc(S + 1, sizeof(struct node_gra *));
+  lastList = (struct node_lis **)calloc(S + 1, sizeof(struct node_lis *));
+  for (node1=0; node1<S; node1++) {
+    sprintf(&label[0], "%d", node1+1);
+    last = nodeList[node1] = CreateNodeGraph(last, &label[0]);
+    lastList[node1] = last->neig;
   }
 
   /* Create the links */
-  for (node1=0; node1<S; node1++) {
-    for (node2=node1+1; node2<S; node2++) {
-      switch (output_sw) {
-      case 'v':
-	fprintf(stderr, "%s %s %g\n",
-		nodeList[node1]->label, nodeList[node2]->label,
-		q[(nodeList[node1])->inGroup][(nodeList[node2])->inGroup]);
-	break;
-      default:
-	break;
-      }
-      if (gsl_rng_uniform(gen) <
-	  q[(nodeList[node1])->inGroup][(nodeList[node2])->inGroup]) {
-	AddAdjacency(nodeList[node1], nodeList[node2], 0, 0, 0, 0);
-	AddAdjacency(nodeList[node2], nodeList[node1], 0, 0, 0, 0);
-      }
-    }
+  for (i=0; i<nlink; i++) {
+    lastList[ori[i]] = AppendAdjacency(lastList[ori[i]], nodeList[des[i]],
+				       0, 0);
+    lastList[des[i]] = AppendAdjacency(lastList[des[i]], nodeList[ori[i]],
+				       0, 0);
   }
 
   /* Done */
   free(nodeList);
+  free(lastList);
+  return root;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Create an Erdos-Renyi random graph
+  ---------------------------------------------------------------------
+*/
+struct node_gra *
+ERGraph(int S, double p, gsl_rng *gen)
+{
+  int *ori, *des, nlink;
+  struct node_gra *root = NULL;
+
+  nlink = ERLinks(S, p, gen, &ori, &des);
+  root = LinksToGraph(S, nlink, ori, des);
+
+  /* Done */
+  free_i_vec(ori);
+  free_i_vec(des);
+  return root;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Create a preferential attachment (aka Barabasi-Albert) network
+  ---------------------------------------------------------------------
+*/
+struct node_gra *
+PAGraph(int S, int m, gsl_rng *gen)
+{
+  int *ori, *des, nlink;
+  struct node_gra *root = NULL;
+
+  nlink = PALinks(S, m, gen, &ori, &des);
+  root = LinksToGraph(S, nlink, ori, des);
+
+  /* Done */
+  free_i_vec(ori);
+  free_i_vec(des);
+  return root;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Create an undirected block graph. Arguments:
+
+  - ngroup: number of groups
+  - gsize: a list with the group sizes
+  - q: matrix of block-to-block connectivity probability
+  - output_sw: 'v' for verbose
+  - gen: random number generator
+
+  ---------------------------------------------------------------------
+*/
+struct node_gra *
+UndirectedBlockGraph(int ngroup, int *gsize, double **q,
+		     char output_sw, gsl_rng *gen)
+{
+  int *ori, *des, nlink;
+  struct node_gra *root = NULL, *p;
+  int g1, g2, i, S=0;
+
+  /* Report the block probabilities */
+  if (output_sw == 'v')
+    for (g1=0; g1<ngroup; g1++)
+      for (g2=g1; g2<ngroup; g2++)
+	fprintf(stderr, "%d %d %g\n", g1, g2, q[g1][g2]);
+
+  /* Create the network */
+  for (i=0; i<ngroup; i++)
+    S += gsize[i];
+  nlink = BlockLinks(ngroup, gsize, q, gen, &ori, &des);
+  root = LinksToGraph(S, nlink, ori, des);
+
+  /* Set the groups */
+  p = root->next;
+  for (g1=0; g1<ngroup; g1++)
+    for (i=0; i<gsize[g1]; i++, p=p->next)
+      p->inGroup = g1;
+
+  /* Done */
+  free_i_vec(ori);
+  free_i_vec(des);
   return root;
 }
 
@@ -206,19 +416,14 @@ GirvanNewmanGraph(int ngroup, int gsize, double kin, double kout,
 {
   double **q;
   int *gsizes;
-  int g1, g2;
+  int g1;
   struct node_gra *net=NULL;
 
   /* Prepare arrays necessary for UndirectedBlockGraph */
-  q = allocate_d_mat(ngroup, ngroup);
+  q = GirvanNewmanBlocks(ngroup, gsize, kin, kout);
   gsizes = allocate_i_vec(ngroup);
-  for (g1=0; g1<ngroup; g1++) {
+  for (g1=0; g1<ngroup; g1++)
     gsizes[g1] = gsize;
-    q[g1][g1] = (double)(kin) / (double)(gsize - 1);
-    for (g2=g1+1; g2<ngroup; g2++) {
-      q[g1][g2] = (double)(kout) / (double)(gsize * (ngroup - 1));
-    }
-  }
 
   /* Do it */
   net = UndirectedBlockGraph(ngroup, gsizes, q, output_sw, gen);
@@ -7,9 +7,22 @@
 #ifndef RGRAPH_MODELS_H
 #define RGRAPH_MODELS_H 1
 
+#include <stdio.h>
 #include <gsl/gsl_rng.h>
 
 struct node_gra *EmptyGraph(int S);
+
+/* Sparse generators (flat lists of links) */
+int ERLinks(int S, double p, gsl_rng *gen, int **ori, int **des);
+int PALinks(int S, int m, gsl_rng *gen, int **ori, int **des);
+int BlockLinks(int ngroup, int *gsize, double **q, gsl_rng *gen,
+	       int **ori, int **des);
+int GirvanNewmanLinks(int ngroup, int gsize, double kin, double kout,
+		      gsl_rng *gen, int **ori, int **des);
+void FPrintLinks(FILE *outF, int nlink, int *ori, int *des);
+struct node_gra *LinksToGraph(int S, int nlink, int *ori, int *des);
+
+/* Networks */
 struct node_gra *ERGraph(int S, double p, gsl_rng *gen);
 struct node_gra *PAGraph(int S, int m, gsl_rng *gen);
 struct node_gra *UndirectedBlockGraph(int ngroup,
@@ -3,6 +3,7 @@
   $Revision$
 */
 
+#define _GNU_SOURCE  /* for the reentrant hsearch_r */
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -12,6 +13,7 @@
 
 #include "tools.h"
 #include "graph.h"
+#include "datastruct.h"
 #include "modules.h"
 
 #define EPSILON_MOD 1.e-6
@@ -865,6 +867,36 @@ NLinksToGroupByNum(struct node_gra* node, int gLabel)
   return inlink;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Count, in a single pass over the adjacency list of a node, the
+  number of links from the node to each group. On return,
+  n2gList[g] holds the number of links to group g for all the groups
+  in the list glabels (of size ngroup), which must include all the
+  groups the neighbors of node belong to; if glabels is NULL, the
+  groups are 0..ngroup-1. The cost is O(ngroup + degree), rather than
+  O(ngroup * degree) for repeated calls to NLinksToGroup.
+  ---------------------------------------------------------------------
+*/
+void
+NodeLinksToGroups(struct node_gra* node, int *glabels, int ngroup,
+		  int *n2gList)
+{
+  struct node_lis *nei = node->neig;
+  int i;
+
+  if (glabels == NULL)
+    for (i=0; i<ngroup; i++)
+      n2gList[i] = 0;
+  else
+    for (i=0; i<ngroup; i++)
+      n2gList[glabels[i]] = 0;
+  while ((nei = nei->next) != NULL)
+    n2gList[(nei->ref)->inGroup]++;
+
+  return;
+}
+
 
 
 
@@ -1048,6 +1080,60 @@ CopyPartition(struct group *original)
   return copy_root;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Creates a copy of a whole partition on copies of its nodes
+  (clist[i] is the copy of the node with num i, as returned by
+  CopyNodeList), so that the original and the copy can be changed
+  independently. The group properties are copied rather than
+  recomputed. If glist is not NULL, glist[label] is set to the copy
+  of each group.
+  ---------------------------------------------------------------------
+*/
+struct group *
+CopyPartitionToNodes(struct group *original, struct node_gra **clist,
+		     struct group **glist)
+{
+  struct group *copy_root = NULL, *copy = NULL;
+  struct group *g = original;
+  struct node_lis *node = NULL, *last = NULL;
+
+  copy = copy_root = CreateHeaderGroup();
+  while ((g = g->next) != NULL) {
+    copy = CreateGroup(copy, g->label);
+    copy->size = g->size;
+    copy->totlinks = g->totlinks;
+    copy->inlinks = g->inlinks;
+    copy->outlinks = g->outlinks;
+    copy->totlinksW = g->totlinksW;
+    copy->inlinksW = g->inlinksW;
+    copy->outlinksW = g->outlinksW;
+    copy->coorX = g->coorX;
+    copy->coorY = g->coorY;
+    copy->coorZ = g->coorZ;
+    if (glist != NULL)
+      glist[g->label] = copy;
+
+    /* Copy the node list, keeping its order */
+    last = copy->nodeList;
+    node = g->nodeList;
+    while ((node = node->next) != NULL) {
+      last->next = (struct node_lis *)calloc(1, sizeof(struct node_lis));
+      last = last->next;
+      last->node = node->node;
+      last->nodeLabel = (char *) calloc(MAX_LABEL_LENGTH, sizeof(char));
+      strcpy(last->nodeLabel, node->nodeLabel);
+      last->status = node->status;
+      last->next = NULL;
+      last->ref = clist[node->ref->num];
+      last->btw = node->btw;
+      last->weight = node->weight;
+    }
+  }
+
+  return copy_root;
+}
+
 /*
   ---------------------------------------------------------------------
   Creates a network that contains only the nodes in one of the groups
@@ -1424,65 +1510,46 @@ MapPartToNetSoft(struct group *part, struct node_gra *net)
 struct group *
 ClustersPartition(struct node_gra *net)
 {
-  struct node_gra *p, *last;
-  struct node_bfs *list,*lp,*lp2;
-  int nnod=0;
-  int anod=0;
-  int size;
-  int size_ant;
+  struct node_gra *p, *node;
+  struct node_lis *l;
+  struct ring_queue *queue;
   struct group *part = NULL;
   struct group *thisgroup = NULL;
   int groupcoun = 0;
-  int d;
 
   /* Initialize some variables */
   part = CreateHeaderGroup();
-  size = 0;
   ResetNetGroup(net);
-  nnod = CountNodes(net);
-  list = CreateHeaderList();
+  ResetNodesState(net);
+  queue = ring_queue_create(CountNodes(net));
 
-  /* Start the search for clusters */
-  last = net;
-  do{
-    /* Find the first unclassified node... */
-    p = last->next;
-    while (p->inGroup >= 0)
-      p = p->next;
-    last = p;
-
-    /* Create a new group in the partition and add the node */
+  /* Start a search from each unclassified node */
+  p = net;
+  while ((p = p->next) != NULL) {
+    if (p->state != 0)
+      continue;
+
+    /* Create a new group in the partition and enqueue the node */
     thisgroup = CreateGroup(part, groupcoun++);
-    AddNodeToGroup(thisgroup, p);
-
-    /* ...and enqueue it */
-    ResetNodesState(net);
-    d = 0;
-    Enqueue(p, list, list, &size, d);
-    anod++;
-    lp = list;
-
-    /* Update the list with successive neighbors */
-    do{
-      size_ant = size;
-      lp = RenewQueue(list, lp, &size, d);
-      lp2 = lp;
-
-      while (lp2->next != NULL) {
-	lp2 = lp2->next;
-	anod++;
-
-	/* Add the node to the group */
-	AddNodeToGroup(thisgroup, lp2->ref);
+    p->state = 1;
+    ring_queue_enqueue(queue, p);
+
+    /* Add successive neighbors to the group */
+    while (!ring_queue_empty(queue)) {
+      node = (struct node_gra *)ring_queue_dequeue(queue);
+      AddNodeToGroup(thisgroup, node);
+      l = node->neig;
+      while ((l = l->next) != NULL) {
+	if (l->ref->state == 0) {
+	  l->ref->state = 1;
+	  ring_queue_enqueue(queue, l->ref);
+	}
       }
-      d++;
-    } while(size != size_ant);
-
-    ClearList(list, &size);
-  } while(anod < nnod);
+    }
+  }
 
   /* Free memory */
-  free(list);
+  ring_queue_free(queue);
 
   /* Done */
   return part;
@@ -1596,17 +1663,27 @@ FPrintPajekPartitionFile(char *fname, struct node_gra *net)
 
 /*
   ---------------------------------------------------------------------
-  Compute the mutual information between two partitions
+  Compute the mutual information between two partitions. Each node
+  of part1 is mapped to the index of its group (by node number, or by
+  label if label_sw == 1), and the non-empty cells of the contingency
+  table are then counted in a single pass over part2, so that the
+  cost is linear in the number of nodes.
   ---------------------------------------------------------------------
 */
 double
 MutualInformation(struct group *part1, struct group *part2, int label_sw)
 {
   struct group *g1 = NULL, *g2 = NULL;
-  struct node_lis *n1 = NULL, *n2 = NULL;
-  int S = 0, S1 = 0, S2 = 0, S12 = 0;
+  struct node_lis *n = NULL;
+  int S = 0, S12 = 0;
+  int ngroup1 = 0, ngroup2 = 0, i1, i2;
+  int *size1 = NULL, *size2 = NULL;
   double H1 = 0.0, H2 = 0.0, H12 = 0.0;
   double I12 = 0.0;
+  struct hashmap *nodeGroup = NULL, *overlap = NULL;
+  struct hsearch_data labelGroup;
+  ENTRY e, *ep = NULL;
+  unsigned long long i;
 
   /*
     Count the number of nodes
@@ -1616,64 +1693,102 @@ MutualInformation(struct group *part1, struct group *part2, int label_sw)
     fprintf(stderr, "WARNING : partitions have different size!\n");
 
   /*
-    Compute the H1 and H2 entropies
+    Compute the H1 and H2 entropies, and keep the size of each group
   */
-  g1 = part1;
-  while ((g1 = g1->next) != NULL) {
-    if (g1->size > 0) {
-      S1 = g1->size;
-      H1 += (double)S1 * log((double)S1 / (double)S);
+  for (g1=part1->next; g1!=NULL; g1=g1->next)
+    ngroup1++;
+  for (g2=part2->next; g2!=NULL; g2=g2->next)
+    ngroup2++;
+  size1 = allocate_i_vec(ngroup1 + 1);
+  size2 = allocate_i_vec(ngroup2 + 1);
+
+  for (g1=part1->next, i1=0; g1!=NULL; g1=g1->next, i1++) {
+    size1[i1] = g1->size;
+    if (g1->size > 0)
+      H1 += (double)g1->size * log((double)g1->size / (double)S);
+  }
+  for (g2=part2->next, i2=0; g2!=NULL; g2=g2->next, i2++) {
+    size2[i2] = g2->size;
+    if (g2->size > 0)
+      H2 += (double)g2->size * log((double)g2->size / (double)S);
+  }
+
+  /*
+    Map the nodes of part1 to their group
+  */
+  if (label_sw == 0) {
+    nodeGroup = hashmap_create(S);
+  }
+  else {
+    memset(&labelGroup, 0, sizeof(struct hsearch_data));
+    if (hcreate_r(2 * S + 1, &labelGroup) == 0) {
+      fprintf(stderr, "ERROR: Could not create label table in MutualInformation\n");
+      exit(1);
     }
   }
-  g2 = part2;
-  while ((g2 = g2->next) != NULL) {
-    if (g2->size > 0) {
-      S2 = g2->size;
-      H2 += (double)S2 * log((double)S2 / (double)S);
+  for (g1=part1->next, i1=0; g1!=NULL; g1=g1->next, i1++) {
+    for (n=g1->nodeList->next; n!=NULL; n=n->next) {
+      if (label_sw == 0) {
+	hashmap_set(nodeGroup, (unsigned long long)n->node, i1);
+      }
+      else {
+	e.key = n->nodeLabel;
+	e.data = (void *)(long)i1;
+	hsearch_r(e, ENTER, &ep, &labelGroup);
+      }
     }
   }
 
   /*
-    Compute the join entropy H12
+    Count the overlap S12 of every pair of groups that share nodes
   */
-  g1 = part1;
-  while ((g1 = g1->next) != NULL) {
-    if (g1->size > 0) {
-      S1 = g1->size;
-
-      g2 = part2;
-      while ((g2 = g2->next) != NULL) {
-	if (g2->size > 0) {
-
-	  S2 = g2->size;
-
-	  /*
-	    Compute overlap
-	  */
-	  S12 = 0;
-	  n1 = g1->nodeList;
-	  while ((n1 = n1->next) != NULL) {
-	    n2 = g2->nodeList;
-	    while ((n2 = n2->next) != NULL) {
-	      if ((label_sw == 0 && n1->node == n2->node ) || (label_sw == 1 && strcmp(n1->nodeLabel,n2->nodeLabel) == 0)) {
-		S12++;
-		break;
-	      }
-	    }
-	  } /* Overlap size S12 has been calculated */
-	  if (S12 > 0)
-	    H12 += (double)S12 * log((double)(S12 * S) /
-				 (double)(S1 * S2));
-	}
+  overlap = hashmap_create(S);
+  for (g2=part2->next, i2=0; g2!=NULL; g2=g2->next, i2++) {
+    for (n=g2->nodeList->next; n!=NULL; n=n->next) {
+      if (label_sw == 0) {
+	if (!hashmap_get(nodeGroup, (unsigned long long)n->node, &i1))
+	  continue;
+      }
+      else {
+	e.key = n->nodeLabel;
+	if (hsearch_r(e, FIND, &ep, &labelGroup) == 0)
+	  continue;
+	i1 = (int)(long)ep->data;
       }
+      hashmap_increment(overlap,
+			((unsigned long long)i1 << 32) | (unsigned)i2, 1);
+    }
+  }
+
+  /*
+    Compute the join entropy H12
+  */
+  for (i=0; i<=overlap->mask; i++) {
+    if (overlap->key[i] != hashset_empty) {
+      i1 = (int)(overlap->key[i] >> 32);
+      i2 = (int)(overlap->key[i] & 0xffffffffULL);
+      S12 = overlap->value[i];
+      H12 += (double)S12 * log((double)S12 * (double)S /
+			       ((double)size1[i1] * (double)size2[i2]));
     }
-  } /* End of loop over groups */
+  }
 
   /*
     Compute mutual information
   */
   I12 = -2.0 * H12 / (H1 + H2);
 
+  /*
+    Free memory
+  */
+  hashmap_free(overlap);
+  if (label_sw == 0)
+    hashmap_free(nodeGroup);
+  else
+    hdestroy_r(&labelGroup);
+  free_i_vec(size1);
+  free_i_vec(size2);
+
   return I12;
 }
 
@@ -1759,7 +1874,6 @@ CorrectlyClassified(struct group *refpart, struct group *actpart)
   /* Count correctly classified nodes */
   g2 = actpart;
   while ((g2 = g2->next) != NULL) {
-    nnod += g2->size;
     if (map[g2->label] > -1){
       p = g2->nodeList;
       while ((p = p->next) != NULL) {
@@ -1780,6 +1894,321 @@ CorrectlyClassified(struct group *refpart, struct group *actpart)
   return (double)correct / (double)nnod;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Put a label in the label -> index table, growing the table when it
+  gets half full (hsearch tables cannot be resized, so the table is
+  rebuilt from the list of labels). Returns the index of the label.
+  ---------------------------------------------------------------------
+*/
+static int
+LabelIndex(char *label,
+	   struct hsearch_data *table, size_t *capacity,
+	   char ***labels, int *nlabel)
+{
+  ENTRY e, *ep = NULL;
+  int i;
+
+  e.key = label;
+  if (*capacity > 0 && hsearch_r(e, FIND, &ep, table) != 0)
+    return (int)(long)ep->data;
+
+  /* New label: grow the table and the list if necessary */
+  if (2 * (size_t)(*nlabel + 1) > *capacity) {
+    *capacity = (*capacity > 0) ? 2 * *capacity : 1024;
+    hdestroy_r(table);
+    memset(table, 0, sizeof(struct hsearch_data));
+    if (hcreate_r(*capacity, table) == 0) {
+      fprintf(stderr, "ERROR: Could not create label table in FCreatePartitionArrays\n");
+      exit(1);
+    }
+    *labels = (char **)realloc(*labels, *capacity * sizeof(char *));
+    for (i=0; i<*nlabel; i++) {
+      e.key = (*labels)[i];
+      e.data = (void *)(long)i;
+      hsearch_r(e, ENTER, &ep, table);
+    }
+  }
+
+  (*labels)[*nlabel] = strdup(label);
+  e.key = (*labels)[*nlabel];
+  e.data = (void *)(long)*nlabel;
+  hsearch_r(e, ENTER, &ep, table);
+  return (*nlabel)++;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Read M partitions (in the format of FCreatePartition) and store
+  each of them as an array part[m][i] with the group of node i, or -1
+  if the node is not in partition m. Nodes are numbered in order of
+  appearance across all the files, and non-empty groups are numbered
+  0, 1, ... in the order they appear in each file. The number of
+  nodes is returned in nnod and their labels in labels. Each
+  partition is released as soon as it has been converted, so that
+  only the arrays are kept in memory.
+  ---------------------------------------------------------------------
+*/
+int **
+FCreatePartitionArrays(FILE **inF, int M, int *nnod, char ***labels)
+{
+  struct group *part = NULL, *g = NULL;
+  struct node_lis *n = NULL;
+  struct hsearch_data table;
+  size_t capacity = 0;
+  int **parts = NULL, *size = NULL;
+  int m, i, k, node, nlabel = 0;
+
+  memset(&table, 0, sizeof(struct hsearch_data));
+  *labels = NULL;
+  parts = (int **)calloc(M, sizeof(int *));
+  size = allocate_i_vec(M);
+
+  for (m=0; m<M; m++) {
+    part = FCreatePartition(inF[m]);
+    parts[m] = NULL;
+    size[m] = 0;
+    for (g=part->next, k=0; g!=NULL; g=g->next) {
+      if (g->size > 0) {
+	for (n=g->nodeList->next; n!=NULL; n=n->next) {
+	  node = LabelIndex(n->nodeLabel, &table, &capacity, labels, &nlabel);
+	  if (node >= size[m]) {
+	    parts[m] = (int *)realloc(parts[m], nlabel * sizeof(int));
+	    for (i=size[m]; i<nlabel; i++)
+	      parts[m][i] = -1;
+	    size[m] = nlabel;
+	  }
+	  parts[m][node] = k;
+	}
+	k++;
+      }
+    }
+    RemovePartition(part);
+  }
+
+  /* Pad all the arrays to the final number of nodes */
+  for (m=0; m<M; m++) {
+    parts[m] = (int *)realloc(parts[m], (nlabel + 1) * sizeof(int));
+    for (i=size[m]; i<nlabel; i++)
+      parts[m][i] = -1;
+  }
+
+  hdestroy_r(&table);
+  free_i_vec(size);
+  *nnod = nlabel;
+  return parts;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Free the arrays and labels returned by FCreatePartitionArrays
+  ---------------------------------------------------------------------
+*/
+void
+FreePartitionArrays(int **parts, int M, char **labels, int nnod)
+{
+  int i;
+
+  for (i=0; i<M; i++)
+    free(parts[i]);
+  free(parts);
+  for (i=0; i<nnod; i++)
+    free(labels[i]);
+  free(labels);
+  return;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Count the nodes that are in both partition arrays, the size of
+  each group (restricted to those nodes) and the non-empty cells of
+  the contingency table, keyed by (group1 << 32 | group2). The
+  caller frees size1, size2 and the returned map.
+  ---------------------------------------------------------------------
+*/
+static struct hashmap *
+ContingencyArray(int *part1, int *part2, int nnod,
+		 int **size1, int *ngroup1, int **size2, int *ngroup2,
+		 int *S)
+{
+  struct hashmap *cells = hashmap_create(nnod);
+  int i;
+
+  *ngroup1 = *ngroup2 = 0;
+  for (i=0; i<nnod; i++) {
+    if (part1[i] >= *ngroup1)
+      *ngroup1 = part1[i] + 1;
+    if (part2[i] >= *ngroup2)
+      *ngroup2 = part2[i] + 1;
+  }
+  *size1 = allocate_i_vec(*ngroup1 + 1);
+  *size2 = allocate_i_vec(*ngroup2 + 1);
+  for (i=0; i<*ngroup1; i++)
+    (*size1)[i] = 0;
+  for (i=0; i<*ngroup2; i++)
+    (*size2)[i] = 0;
+
+  *S = 0;
+  for (i=0; i<nnod; i++) {
+    if (part1[i] >= 0 && part2[i] >= 0) {
+      (*S)++;
+      (*size1)[part1[i]]++;
+      (*size2)[part2[i]]++;
+      hashmap_increment(cells,
+			((unsigned long long)part1[i] << 32) |
+			(unsigned)part2[i], 1);
+    }
+  }
+
+  return cells;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Normalized mutual information between two partition arrays (as
+  returned by FCreatePartitionArrays), computed over the nodes that
+  are in both partitions
+  ---------------------------------------------------------------------
+*/
+double
+MutualInformationArray(int *part1, int *part2, int nnod)
+{
+  struct hashmap *cells = NULL;
+  int *size1 = NULL, *size2 = NULL;
+  int S, S12, g1, g2, ngroup1, ngroup2;
+  unsigned long long i;
+  double H1 = 0.0, H2 = 0.0, H12 = 0.0;
+
+  cells = ContingencyArray(part1, part2, nnod,
+			   &size1, &ngroup1, &size2, &ngroup2, &S);
+
+  for (i=0; i<=cells->mask; i++) {
+    if (cells->key[i] != hashset_empty) {
+      g1 = (int)(cells->key[i] >> 32);
+      g2 = (int)(cells->key[i] & 0xffffffffULL);
+      S12 = cells->value[i];
+      H12 += (double)S12 * log((double)S12 * (double)S /
+			       ((double)size1[g1] * (double)size2[g2]));
+    }
+  }
+  for (g1=0; g1<ngroup1; g1++)
+    if (size1[g1] > 0)
+      H1 += (double)size1[g1] * log((double)size1[g1] / (double)S);
+  for (g2=0; g2<ngroup2; g2++)
+    if (size2[g2] > 0)
+      H2 += (double)size2[g2] * log((double)size2[g2] / (double)S);
+
+  hashmap_free(cells);
+  free_i_vec(size1);
+  free_i_vec(size2);
+
+  /* Two one-group partitions are identical */
+  if (H1 + H2 == 0.0)
+    return 1.0;
+  return -2.0 * H12 / (H1 + H2);
+}
+
+/*
+  ---------------------------------------------------------------------
+  Fraction of nodes of an actual partition array that are correctly
+  classified with respect to a reference partition array, as in
+  CorrectlyClassified: each actual group is mapped to the reference
+  group it overlaps most, and if several actual groups are mapped to
+  the same reference group only the one with the largest overlap is
+  kept. Only nodes that are in both partitions are considered.
+  ---------------------------------------------------------------------
+*/
+double
+CorrectlyClassifiedArray(int *refpart, int *actpart, int nnod)
+{
+  struct hashmap *cells = NULL;
+  int *sizeref = NULL, *sizeact = NULL, *map = NULL, *best = NULL, *owner;
+  int S, S12, gref, gact, ngroupref, ngroupact, correct = 0;
+  unsigned long long i;
+
+  cells = ContingencyArray(refpart, actpart, nnod,
+			   &sizeref, &ngroupref, &sizeact, &ngroupact, &S);
+  map = allocate_i_vec(ngroupact + 1);
+  best = allocate_i_vec(ngroupact + 1);
+  owner = allocate_i_vec(ngroupref + 1);
+  for (gact=0; gact<ngroupact; gact++) {
+    map[gact] = -1;
+    best[gact] = 0;
+  }
+  for (gref=0; gref<ngroupref; gref++)
+    owner[gref] = -1;
+
+  /* Best reference group for each actual group (ties go to the
+     reference group with the lowest index, as in CorrectlyClassified) */
+  for (i=0; i<=cells->mask; i++) {
+    if (cells->key[i] != hashset_empty) {
+      gref = (int)(cells->key[i] >> 32);
+      gact = (int)(cells->key[i] & 0xffffffffULL);
+      S12 = cells->value[i];
+      if (S12 > best[gact] || (S12 == best[gact] && gref < map[gact])) {
+	best[gact] = S12;
+	map[gact] = gref;
+      }
+    }
+  }
+
+  /* Keep a single actual group per reference group */
+  for (gact=0; gact<ngroupact; gact++) {
+    if ((gref = map[gact]) >= 0 &&
+	(owner[gref] < 0 || best[gact] > best[owner[gref]]))
+      owner[gref] = gact;
+  }
+  for (gref=0; gref<ngroupref; gref++)
+    if (owner[gref] >= 0)
+      correct += best[owner[gref]];
+
+  hashmap_free(cells);
+  free_i_vec(sizeref);
+  free_i_vec(sizeact);
+  free_i_vec(map);
+  free_i_vec(best);
+  free_i_vec(owner);
+
+  return (S > 0) ? (double)correct / (double)S : 0.0;
+}
+
+/*
+  ---------------------------------------------------------------------
+  Compare all pairs of M partition arrays. nmi[m1][m2] is the
+  normalized mutual information and cc[m1][m2] the fraction of nodes
+  of m2 correctly classified with m1 as the reference (either matrix
+  can be NULL). The pairs are distributed among the available
+  threads.
+  ---------------------------------------------------------------------
+*/
+void
+PartitionSimilarityMatrices(int **parts, int M, int nnod,
+			    double **nmi, double **cc)
+{
+  long pair, npair = (long)M * M;
+
+#pragma omp parallel for schedule(dynamic)
+  for (pair=0; pair<npair; pair++) {
+    int m1 = pair / M, m2 = pair % M;
+
+    if (m1 == m2) {
+      if (nmi != NULL)
+	nmi[m1][m2] = 1.0;
+      if (cc != NULL)
+	cc[m1][m2] = 1.0;
+      continue;
+    }
+    if (nmi != NULL && m1 < m2)
+      nmi[m1][m2] = nmi[m2][m1] = MutualInformationArray(parts[m1],
+							  parts[m2],
+							  nnod);
+    if (cc != NULL)
+      cc[m1][m2] = CorrectlyClassifiedArray(parts[m1], parts[m2], nnod);
+  }
+
+  return;
+}
+
 
 /*
   ---------------------------------------------------------------------
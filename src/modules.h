@@ -97,6 +97,8 @@ void BlockModel(struct group *part,
 int NLinksToGroup(struct node_gra* node, struct group *g);
 int NWeightLinksToGroup(struct node_gra* node, struct group *g, double w);
 int NLinksToGroupByNum(struct node_gra* node, int gLabel);
+void NodeLinksToGroups(struct node_gra* node, int *glabels, int ngroup,
+		       int *n2gList);
 double StrengthToGroup(struct node_gra* node, struct group *g);
 double StrengthToGroupByNum(struct node_gra* node, int gLabel);
 int NG2GLinks(struct group *g1, struct group *g2);
@@ -105,6 +107,9 @@ double NG2GLinksWeight(struct group *g1, struct group *g2);
 void MergeGroups(struct group *g1, struct group *g2);
 struct group *CopyGroup(struct group *copy_root, struct group *g);
 struct group *CopyPartition(struct group *original);
+struct group *CopyPartitionToNodes(struct group *original,
+				   struct node_gra **clist,
+				   struct group **glist);
 struct node_gra *BuildNetFromGroup(struct group *group);
 struct node_gra *BuildNetFromGroupNeig(struct group *group);
 void GroupSizeStatistics(struct group *part,
@@ -148,6 +153,12 @@ void FPrintPajekPartitionFile(char *fname, struct node_gra *net);
 double MutualInformation(struct group *part1, struct group *part2, int label_sw);
 double CorrectlyClassified(struct group *refpart,
 			   struct group *actpart);
+int **FCreatePartitionArrays(FILE **inF, int M, int *nnod, char ***labels);
+void FreePartitionArrays(int **parts, int M, char **labels, int nnod);
+double MutualInformationArray(int *part1, int *part2, int nnod);
+double CorrectlyClassifiedArray(int *refpart, int *actpart, int nnod);
+void PartitionSimilarityMatrices(int **parts, int M, int nnod,
+				 double **nmi, double **cc);
 
 /*
   ---------------------------------------------------------------------
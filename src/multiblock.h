@@ -17,179 +17,46 @@
 #include "missing.h"
 
 double LogDegeneracy(int ngroup);
+double PartitionHMB(struct group *part, double linC, double *HarmonicList);
+double ORPartitionHMB(struct group *part, double linC, double *HarmonicList);
+
 /*
   ---------------------------------------------------------------------
-  Missing links
+  Block model likelihoods (see struct sbm_likelihood)
   ---------------------------------------------------------------------
 */
-double PartitionHMB(struct group *part, double linC, double *HarmonicList);
-void LSMCStepMB(int factor,
-		double *H,
-		double linC,
-		struct node_gra **nlist,
-		struct group **glist,
-		struct group *part,
-		int nnod,
-		int **G2G,
-		int *n2gList,
-		double **LogChooseList,
-		int LogChooseListSize,
-		double *LogFactList, int LogFactListSize,
-		double *HarmonicList,
-		gsl_rng *gen);
-int GetDecorrelationStepMB(double *H,
-			   double linC,
-			   struct node_gra **nlist,
-			   struct group **glist,
-			   struct group *part,
-			   int nnod,
-			   int **G2G,
-			   int *n2gList,
-			   double **LogChooseList,
-			   int LogChooseListSize,
-			   double *LogFactList, int LogFactListSize,
-			   double *HarmonicList,
-			   gsl_rng *gen,
-			   char verbose_sw);
-void ThermalizeLSMCMB(int decorStep,
-		      double *H,
-		      double linC,
-		      struct node_gra **nlist,
-		      struct group **glist,
-		      struct group *part,
-		      int nnod,
-		      int **G2G,
-		      int *n2gList,
-		      double **LogChooseList,
-		      int LogChooseListSize,
-		      double *LogFactList, int LogFactListSize,
-		      double *HarmonicList,
-		      gsl_rng *gen,
-		      char verbose_sw);
-double **LinkScoreMB(struct node_gra *net,
-		      double linC,
-		      int nIter,
-		      gsl_rng *gen,
-		      char verbose_sw);
-double ORPartitionHMB(struct group *part, double linC, double *HarmonicList);
-void ORLSMCStepMB(int factor,
-                double *H,
-                double linC,
-                struct node_gra **nlist,
-                struct group **glist,
-                struct group *part,
-                int nnod,
-                int **G2G,
-                int *n2gList,
-                double **LogChooseList,
-                int LogChooseListSize,
-                double *LogFactList, int LogFactListSize,
-                double *HarmonicList,
-                gsl_rng *gen);
-int ORGetDecorrelationStepMB(double *H,
-                           double linC,
-                           struct node_gra **nlist,
-                           struct group **glist,
-                           struct group *part,
-                           int nnod,
-                           int **G2G,
-                           int *n2gList,
-                           double **LogChooseList,
-                           int LogChooseListSize,
-                           double *LogFactList, int LogFactListSize,
-                           double *HarmonicList,
-                           gsl_rng *gen,
-                           char verbose_sw);
-void ORThermalizeLSMCMB(int decorStep,
-                      double *H,
-                      double linC,
-                      struct node_gra **nlist,
-                      struct group **glist,
-                      struct group *part,
-                      int nnod,
-                      int **G2G,
-                      int *n2gList,
-                      double **LogChooseList,
-                      int LogChooseListSize,
-                      double *LogFactList, int LogFactListSize,
-                      double *HarmonicList,
-                      gsl_rng *gen,
-                      char verbose_sw);
-double **ORLinkScoreMB(struct node_gra *net,
-                      double linC,
-                      int nIter,
-                      gsl_rng *gen,
-                      char verbose_sw);
+struct sbm_likelihood *CreateSBMLikelihoodMB(int nnod, double linC);
+struct sbm_likelihood *ORCreateSBMLikelihoodMB(int nnod, double linC);
 
 /*
   ---------------------------------------------------------------------
-  Link reliability Gibbs sampling
+  Link reliability
   ---------------------------------------------------------------------
 */
-void GibbsLinkScoreStepMB(double *H,
-			double linC,
-			struct node_gra **nlist,
-			struct group **glist,
-			struct group *part,
-			int nnod,
-			int **G2G,
-			int *n2gList,
-			double **LogChooseList,
-			int LogChooseListSize,
-			double *LogFactList, int LogFactListSize,
-			double *HarmonicList,
-			gsl_rng *gen);
-void GibbsThermalizeLinkScoreMB(double *H,
-			      double linC,
-			      struct node_gra **nlist,
-			      struct group **glist,
-			      struct group *part,
-			      int nnod,
-			      int **G2G,
-			      int *n2gList,
-			      double **LogChooseList,
-			      int LogChooseListSize,
-			      double *LogFactList, int LogFactListSize,
-			      double *HarmonicList,
-			      gsl_rng *gen,
-			      char verbose_sw);
-double **GibbsLinkScoreMB(struct node_gra *net,
-			double linC,
-			int nIter,
-			gsl_rng *gen,
-			char verbose_sw);
-void ORGibbsLinkScoreStepMB(double *H,
-			double linC,
-			struct node_gra **nlist,
-			struct group **glist,
-			struct group *part,
-			int nnod,
-			int **G2G,
-			int *n2gList,
-			double **LogChooseList,
-			int LogChooseListSize,
-			double *LogFactList, int LogFactListSize,
-			double *HarmonicList,
-			gsl_rng *gen);
-void ORGibbsThermalizeLinkScoreMB(double *H,
-			      double linC,
-			      struct node_gra **nlist,
-			      struct group **glist,
-			      struct group *part,
-			      int nnod,
-			      int **G2G,
-			      int *n2gList,
-			      double **LogChooseList,
-			      int LogChooseListSize,
-			      double *LogFactList, int LogFactListSize,
-			      double *HarmonicList,
-			      gsl_rng *gen,
-			      char verbose_sw);
-double **ORGibbsLinkScoreMB(struct node_gra *net,
-			double linC,
-			int nIter,
-			gsl_rng *gen,
-			char verbose_sw);
+struct pair_matrix *LinkScoreMB(struct node_gra *net,
+				double linC,
+				int nIter,
+				gsl_rng *gen,
+				char verbose_sw,
+				struct pair_score *cand);
+struct pair_matrix *ORLinkScoreMB(struct node_gra *net,
+				  double linC,
+				  int nIter,
+				  gsl_rng *gen,
+				  char verbose_sw,
+				  struct pair_score *cand);
+struct pair_matrix *GibbsLinkScoreMB(struct node_gra *net,
+				     double linC,
+				     int nIter,
+				     gsl_rng *gen,
+				     char verbose_sw,
+				     struct pair_score *cand);
+struct pair_matrix *ORGibbsLinkScoreMB(struct node_gra *net,
+				       double linC,
+				       int nIter,
+				       gsl_rng *gen,
+				       char verbose_sw,
+				       struct pair_score *cand);
 
 
 #endif /* !RGRAPH_MULTIBLOCK_H */
@@ -4,8 +4,8 @@
   $Revision: 130 $
 */
 
-#ifndef RGRAPH_MULTIBLOCK_H
-#define RGRAPH_MULTIBLOCK_H 1
+#ifndef RGRAPH_ONLY_DEG_H
+#define RGRAPH_ONLY_DEG_H 1
 
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_multiroots.h>
@@ -16,99 +16,33 @@
 #include "modules.h"
 #include "missing.h"
 
-double LogDegeneracy(int ngroup);
+double LogDegeneracy_OD(int ngroup);
+double PartitionHMB_OD(struct group *part, double linC, double *HarmonicList);
+
 /*
   ---------------------------------------------------------------------
-  Missing links
+  Block model likelihood (see struct sbm_likelihood)
   ---------------------------------------------------------------------
 */
-double PartitionHMB_OD(struct group *part, double linC, double *HarmonicList);
-void LSMCStepMB_OD(int factor,
-		double *H,
-		double linC,
-		struct node_gra **nlist,
-		struct group **glist,
-		struct group *part,
-		int nnod,
-		int **G2G,
-		int *n2gList,
-		double **LogChooseList,
-		int LogChooseListSize,
-		double *LogFactList, int LogFactListSize,
-		double *HarmonicList,
-		gsl_rng *gen);
-int GetDecorrelationStepMB_OD(double *H,
-			   double linC,
-			   struct node_gra **nlist,
-			   struct group **glist,
-			   struct group *part,
-			   int nnod,
-			   int **G2G,
-			   int *n2gList,
-			   double **LogChooseList,
-			   int LogChooseListSize,
-			   double *LogFactList, int LogFactListSize,
-			   double *HarmonicList,
-			   gsl_rng *gen,
-			   char verbose_sw);
-void ThermalizeLSMCMB_OD(int decorStep,
-		      double *H,
-		      double linC,
-		      struct node_gra **nlist,
-		      struct group **glist,
-		      struct group *part,
-		      int nnod,
-		      int **G2G,
-		      int *n2gList,
-		      double **LogChooseList,
-		      int LogChooseListSize,
-		      double *LogFactList, int LogFactListSize,
-		      double *HarmonicList,
-		      gsl_rng *gen,
-		      char verbose_sw);
-double **LinkScoreMB_OD(struct node_gra *net,
-		      double linC,
-		      int nIter,
-		      gsl_rng *gen,
-		      char verbose_sw);
-
+struct sbm_likelihood *CreateSBMLikelihoodMB_OD(int nnod, double linC);
 
 /*
   ---------------------------------------------------------------------
-  Link reliability Gibbs sampling
+  Link reliability
   ---------------------------------------------------------------------
 */
-void GibbsLinkScoreStepMB_OD(double *H,
-			double linC,
-			struct node_gra **nlist,
-			struct group **glist,
-			struct group *part,
-			int nnod,
-			int **G2G,
-			int *n2gList,
-			double **LogChooseList,
-			int LogChooseListSize,
-			double *LogFactList, int LogFactListSize,
-			double *HarmonicList,
-			gsl_rng *gen);
-void GibbsThermalizeLinkScoreMB_OD(double *H,
-			      double linC,
-			      struct node_gra **nlist,
-			      struct group **glist,
-			      struct group *part,
-			      int nnod,
-			      int **G2G,
-			      int *n2gList,
-			      double **LogChooseList,
-			      int LogChooseListSize,
-			      double *LogFactList, int LogFactListSize,
-			      double *HarmonicList,
-			      gsl_rng *gen,
-			      char verbose_sw);
-double **GibbsLinkScoreMB_OD(struct node_gra *net,
-			double linC,
-			int nIter,
-			gsl_rng *gen,
-			char verbose_sw);
+struct pair_matrix *LinkScoreMB_OD(struct node_gra *net,
+				   double linC,
+				   int nIter,
+				   gsl_rng *gen,
+				   char verbose_sw,
+				   struct pair_score *cand);
+struct pair_matrix *GibbsLinkScoreMB_OD(struct node_gra *net,
+					double linC,
+					int nIter,
+					gsl_rng *gen,
+					char verbose_sw,
+					struct pair_score *cand);
+
 
 #endif /* !RGRAPH_ONLY_DEG_H */
@@ -281,7 +281,7 @@ MCStep2State(int factor,
 		     int **N1G2_0, int **N2G1_0, int **N1G2_1, int **N2G1_1,
 		     int **G1G2_0, int **G2G1_0, int **G1G2_1, int **G2G1_1,
 		     double *LogList, int LogListSize,
-		     double **LogChooseList, int LogChooseListSize,
+		     double *LogChooseList, int LogChooseListSize,
 		     double *LogFactList, int LogFactListSize,
 		     gsl_rng *gen)
 {
@@ -482,7 +482,6 @@ int
 GetDecorrelationStep2State(double *H,
 				   struct node_gra **nlist1,
 				   struct node_gra **nlist2,
-				   struct group **glist1, struct group **glist2,
 				   struct group *part1, struct group *part2,
 				   int nnod1, int nnod2,
 				   int *ng1, int *ng2,
@@ -492,93 +491,165 @@ GetDecorrelationStep2State(double *H,
 				   int **G1G2_1, int **G2G1_1,
 				   double *LogList,
 				   int LogListSize,
-				   double **LogChooseList,
+				   double *LogChooseList,
 				   int LogChooseListSize,
 				   double *LogFactList, int LogFactListSize,
 				   gsl_rng *gen,
 				   char verbose_sw)
 {
-  struct group *part1Ref, *part2Ref;
-  int step, x1, x2;
-  double y11, y12, y21, y22;
-  double mutualInfo;
+  int x1, x2;
   int rep, nrep=10;
   double *decay1, meanDecay1, *decay2, meanDecay2;
   double **decay, meanDecay, sigmaDecay, result;
   int norm=0;
+  int *nignored;
+  unsigned long *seeds;
+  unsigned long long key;
+
+  /* Seeds of the estimates, drawn even if the step is cached */
+  seeds = (unsigned long *)calloc(nrep, sizeof(unsigned long));
+  for (rep=0; rep<nrep; rep++)
+    seeds[rep] = gsl_rng_get(gen);
+
+  /* Reuse the step cached for this network and model, if any */
+  key = NodeListHash(nlist1, nnod1, hash_bytes("2State", 6, 0));
+  key = NodeListHash(nlist2, nnod2, key);
+  if ((result = GetCachedDecorrelationStep(key)) > 0) {
+    switch (verbose_sw) {
+    case 'q':
+      break;
+    default:
+      fprintf(stderr, "# Decorrelation step (cached): %d\n", (int)result);
+      break;
+    }
+    free(seeds);
+    return (int)result;
+  }
 
   x2 = (nnod1 + nnod2) / 5;
   if (x2 < 10)
     x2 = 10;
   x1 = x2 / 4;
 
-  /* Get the nrep initial estimates */
+  /* Get the nrep initial estimates. They are independent, so they
+     run concurrently, each on its own copy of the current state and
+     with its own random number generator. */
   decay1 = allocate_d_vec(nrep);
   decay2 = allocate_d_vec(nrep);
+  nignored = allocate_i_vec(nrep);
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "#\n# Estimating decorrelation time (%d estimates)\n",
+	    nrep);
+    break;
+  }
+#pragma omp parallel for schedule(dynamic, 1)
   for (rep=0; rep<nrep; rep++) {
-    switch (verbose_sw) {
-    case 'q':
-      break;
-    default:
-      fprintf(stderr, "#\n# Estimating decorrelation time (%d/%d)\n",
-	      rep + 1, nrep);
-      break;
-    }
-    part1Ref = CopyPartition(part1);
-    part2Ref = CopyPartition(part2);
-    for (step=0; step<=x2; step++) {
-      switch (verbose_sw) {
-      case 'd':
-	fprintf(stderr, "# %d / %d\n", step, x2);
-	break;
-      default:
-	break;
-      }
-      MCStep2State(1, H, nlist1, nlist2,
-			   glist1, glist2, part1, part2,
-			   nnod1, nnod2, ng1, ng2,
-			   N1G2_0, N2G1_0, N1G2_1, N2G1_1,
-			   G1G2_0, G2G1_0, G1G2_1, G2G1_1,
-			   LogList, LogListSize,
-			   LogChooseList, LogChooseListSize,
-			   LogFactList, LogFactListSize,
-			   gen);
-      if (step == x1) {
-	y11 = MutualInformation(part1Ref, part1, 0);
-	y12 = MutualInformation(part2Ref, part2, 0);
+    struct node_gra **cnlist1 = NULL, **cnlist2 = NULL;
+    struct node_gra *cnet1 = NULL, *cnet2 = NULL;
+    struct group **cglist1 = NULL, **cglist2 = NULL;
+    struct group *cpart1 = NULL, *cpart2 = NULL;
+    struct group *part1Ref = NULL, *part2Ref = NULL;
+    int **cN1G2_0, **cN2G1_0, **cN1G2_1, **cN2G1_1;
+    int **cG1G2_0, **cG2G1_0, **cG1G2_1, **cG2G1_1;
+    int cng1 = *ng1, cng2 = *ng2, step;
+    double cH = *H, y11, y12, y21, y22;
+    gsl_rng *rgen = gsl_rng_alloc(gsl_rng_mt19937);
+
+    /* Copy the state */
+    cnlist1 = (struct node_gra **) calloc(nnod1, sizeof(struct node_gra *));
+    cnlist2 = (struct node_gra **) calloc(nnod2, sizeof(struct node_gra *));
+    cglist1 = (struct group **) calloc(nnod1, sizeof(struct group *));
+    cglist2 = (struct group **) calloc(nnod2, sizeof(struct group *));
+    cnet1 = CopyNodeList(nlist1, nnod1, cnlist1);
+    cnet2 = CopyNodeList(nlist2, nnod2, cnlist2);
+    cpart1 = CopyPartitionToNodes(part1, cnlist1, cglist1);
+    cpart2 = CopyPartitionToNodes(part2, cnlist2, cglist2);
+    cN1G2_0 = copy_i_mat(N1G2_0, nnod1, nnod2);
+    cN2G1_0 = copy_i_mat(N2G1_0, nnod2, nnod1);
+    cN1G2_1 = copy_i_mat(N1G2_1, nnod1, nnod2);
+    cN2G1_1 = copy_i_mat(N2G1_1, nnod2, nnod1);
+    cG1G2_0 = copy_i_mat(G1G2_0, nnod1, nnod2);
+    cG2G1_0 = copy_i_mat(G2G1_0, nnod2, nnod1);
+    cG1G2_1 = copy_i_mat(G1G2_1, nnod1, nnod2);
+    cG2G1_1 = copy_i_mat(G2G1_1, nnod2, nnod1);
+    gsl_rng_set(rgen, seeds[rep]);
+
+    nignored[rep] = 0;
+    do {
+      part1Ref = CopyPartition(cpart1);
+      part2Ref = CopyPartition(cpart2);
+      for (step=0; step<=x2; step++) {
+	switch (verbose_sw) {
+	case 'd':
+	  fprintf(stderr, "# %d / %d\n", step, x2);
+	  break;
+	default:
+	  break;
+	}
+	MCStep2State(1, &cH, cnlist1, cnlist2,
+		     cglist1, cglist2, cpart1, cpart2,
+		     nnod1, nnod2, &cng1, &cng2,
+		     cN1G2_0, cN2G1_0, cN1G2_1, cN2G1_1,
+		     cG1G2_0, cG2G1_0, cG1G2_1, cG2G1_1,
+		     LogList, LogListSize,
+		     LogChooseList, LogChooseListSize,
+		     LogFactList, LogFactListSize,
+		     rgen);
+	if (step == x1) {
+	  y11 = MutualInformation(part1Ref, cpart1, 0);
+	  y12 = MutualInformation(part2Ref, cpart2, 0);
+	}
       }
-    }
-    y21 = MutualInformation(part1Ref, part1, 0);
-    y22 = MutualInformation(part2Ref, part2, 0);
-    if (nnod1 > 1)
-      decay1[rep] = 2. * CalculateDecay(nnod1, x1, y11, x2, y21);
-    else
-      decay1[rep] = 1.e-6;
-    if (nnod2 > 1)
-      decay2[rep] = 2. * CalculateDecay(nnod2, x1, y12, x2, y22);
-    else
-      decay2[rep] = 1.e-6;
+      y21 = MutualInformation(part1Ref, cpart1, 0);
+      y22 = MutualInformation(part2Ref, cpart2, 0);
+      if (nnod1 > 1)
+	decay1[rep] = 2. * CalculateDecay(nnod1, x1, y11, x2, y21);
+      else
+	decay1[rep] = 1.e-6;
+      if (nnod2 > 1)
+	decay2[rep] = 2. * CalculateDecay(nnod2, x1, y12, x2, y22);
+      else
+	decay2[rep] = 1.e-6;
+      RemovePartition(part1Ref);
+      RemovePartition(part2Ref);
+      if (decay1[rep] < 0. || decay2[rep] < 0.)
+	nignored[rep]++;
+    } while (decay1[rep] < 0. || decay2[rep] < 0.);
+
+    /* Free memory */
+    free_i_mat(cN1G2_0, nnod1);
+    free_i_mat(cN2G1_0, nnod2);
+    free_i_mat(cN1G2_1, nnod1);
+    free_i_mat(cN2G1_1, nnod2);
+    free_i_mat(cG1G2_0, nnod1);
+    free_i_mat(cG2G1_0, nnod2);
+    free_i_mat(cG1G2_1, nnod1);
+    free_i_mat(cG2G1_1, nnod2);
+    RemovePartition(cpart1);
+    RemovePartition(cpart2);
+    RemoveGraph(cnet1);
+    RemoveGraph(cnet2);
+    free(cglist1);
+    free(cglist2);
+    free(cnlist1);
+    free(cnlist2);
+    gsl_rng_free(rgen);
+  }
+  for (rep=0; rep<nrep; rep++) {
     switch (verbose_sw) {
     case 'q':
       break;
     default:
+      if (nignored[rep] > 0)
+	fprintf(stderr, "#\tignoring %d negative estimate(s)...\n",
+		nignored[rep]);
       fprintf(stderr, "# Decorrelation times (estimate %d) = %g %g\n",
 	      rep + 1, decay1[rep], decay2[rep]);
       break;
     }
-    if (decay1[rep] < 0. || decay2[rep] < 0.) {
-      rep--;
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tignoring...\n");
-	break;
-      }
-    }
-    /* Free memory */
-    RemovePartition(part1Ref);
-    RemovePartition(part2Ref);
   }
   
   /* Get rid of bad estimates (Chauvenet criterion)  */
@@ -608,10 +679,11 @@ GetDecorrelationStep2State(double *H,
       break;
     }
   }
-  result = meanDecay * nrep;
+  /* Average the accepted estimates (subtracting the rejected ones
+     from the total would lose all precision after a huge outlier) */
+  result = 0.;
   for (rep=0; rep<nrep; rep++) {
     if (fabs((*decay)[rep] - meanDecay) / sigmaDecay > 2) {
-      result -= (*decay)[rep];
       switch (verbose_sw) {
       case 'q':
 	break;
@@ -621,6 +693,7 @@ GetDecorrelationStep2State(double *H,
       }
     }
     else {
+      result += (*decay)[rep];
       norm++;
     }
   }
@@ -636,7 +709,10 @@ GetDecorrelationStep2State(double *H,
   /* Clean up */
   free_d_vec(decay1);
   free_d_vec(decay2);
+  free_i_vec(nignored);
+  free(seeds);
 
+  CacheDecorrelationStep(key, (int)(result / norm + 0.5));
   return (int)(result / norm + 0.5);
 }
 
@@ -660,7 +736,7 @@ ThermalizeMC2State(int decorStep,
 			   int **G1G2_1, int **G2G1_1,
 			   double *LogList,
 			   int LogListSize,
-			   double **LogChooseList,
+			   double *LogChooseList,
 			   int LogChooseListSize,
 			   double *LogFactList, int LogFactListSize,
 			   gsl_rng *gen,
@@ -763,12 +839,12 @@ MultiLinkScore2State(struct binet *ratings,
   int **N1G2_1=NULL, **N2G1_1=NULL;
   int **G1G2_0=NULL, **G2G1_0=NULL;
   int **G1G2_1=NULL, **G2G1_1=NULL;
-  int LogChooseListSize = 500;
-  double **LogChooseList=InitializeFastLogChoose(LogChooseListSize);
+  int LogChooseListSize = FastLogTableSize((long int)nnod1 * nnod2);
+  double *LogChooseList=InitializeFastLogChoose(LogChooseListSize);
   int LogListSize = 5000;
   double *LogList=InitializeFastLog(LogListSize);
-  int LogFactListSize = 2000;
-  double *LogFactList=InitializeFastLogFact(LogFactListSize);
+  int LogFactListSize = LogChooseListSize;
+  double *LogFactList = LogChooseList; /* same ln(r!) table */
   struct node_lis *n1=NULL, *n2=NULL;
   double contrib;
   int norm = 0;
@@ -893,7 +969,6 @@ MultiLinkScore2State(struct binet *ratings,
   if (decorStep <= 0) {
     decorStep = GetDecorrelationStep2State(&H,
 						   nlist1, nlist2,
-						   glist1, glist2,
 						   part1, part2,
 						   nnod1, nnod2,
 						   &ng1, &ng2,
@@ -1047,8 +1122,7 @@ MultiLinkScore2State(struct binet *ratings,
   free_i_mat(N1G2_1, nnod1);
   free_i_mat(N2G1_1, nnod2);
   FreeFastLog(LogList);
-  FreeFastLogChoose(LogChooseList, LogChooseListSize);
-  FreeFastLogFact(LogFactList);
+  FreeFastLogChoose(LogChooseList);
   RemoveBipart(ratingsClean);
 
   /* Done */
@@ -1326,7 +1400,6 @@ GetDecorrelationStepKState(int K,
 			   double *H,
 			   struct node_gra **nlist1,
 			   struct node_gra **nlist2,
-			   struct group **glist1, struct group **glist2,
 			   struct group *part1, struct group *part2,
 			   int nnod1, int nnod2,
 			   int *ng1, int *ng2,
@@ -1337,86 +1410,155 @@ GetDecorrelationStepKState(int K,
 			   gsl_rng *gen,
 			   char verbose_sw)
 {
-  struct group *part1Ref, *part2Ref;
-  int step, x1, x2;
-  double y11, y12, y21, y22;
-  double mutualInfo;
+  int x1, x2;
   int rep, nrep=10;
   double *decay1, meanDecay1, *decay2, meanDecay2;
   double **decay, meanDecay, sigmaDecay, result;
   int norm=0;
+  int *nignored;
+  unsigned long *seeds;
+  unsigned long long key;
+
+  /* Seeds of the estimates, drawn even if the step is cached */
+  seeds = (unsigned long *)calloc(nrep, sizeof(unsigned long));
+  for (rep=0; rep<nrep; rep++)
+    seeds[rep] = gsl_rng_get(gen);
+
+  /* Reuse the step cached for this network and model, if any */
+  key = NodeListHash(nlist1, nnod1, hash_bytes("KState", 6, 0));
+  key = NodeListHash(nlist2, nnod2, key);
+  key = hash_bytes(&K, sizeof(int), key);
+  if ((result = GetCachedDecorrelationStep(key)) > 0) {
+    switch (verbose_sw) {
+    case 'q':
+      break;
+    default:
+      fprintf(stderr, "# Decorrelation step (cached): %d\n", (int)result);
+      break;
+    }
+    free(seeds);
+    return (int)result;
+  }
 
   x2 = (nnod1 + nnod2) / 5;
   if (x2 < 10)
     x2 = 10;
   x1 = x2 / 4;
 
-  /* Get the nrep initial estimates */
+  /* Get the nrep initial estimates. They are independent, so they
+     run concurrently, each on its own copy of the current state and
+     with its own random number generator. */
   decay1 = allocate_d_vec(nrep);
   decay2 = allocate_d_vec(nrep);
+  nignored = allocate_i_vec(nrep);
+  switch (verbose_sw) {
+  case 'q':
+    break;
+  default:
+    fprintf(stderr, "#\n# Estimating decorrelation time (%d estimates)\n",
+	    nrep);
+    break;
+  }
+#pragma omp parallel for schedule(dynamic, 1)
   for (rep=0; rep<nrep; rep++) {
-    switch (verbose_sw) {
-    case 'q':
-      break;
-    default:
-      fprintf(stderr, "#\n# Estimating decorrelation time (%d/%d)\n",
-	      rep + 1, nrep);
-      break;
-    }
-    part1Ref = CopyPartition(part1);
-    part2Ref = CopyPartition(part2);
-    for (step=0; step<=x2; step++) {
-      switch (verbose_sw) {
-      case 'd':
-	fprintf(stderr, "# %d / %d\n", step, x2);
-	break;
-      default:
-	break;
-      }
-      MCStepKState(K, 1, H, nlist1, nlist2,
-		   glist1, glist2, part1, part2,
-		   nnod1, nnod2, ng1, ng2,
-		   N1G2, N2G1,
-		   G1G2, G2G1,
-		   LogList, LogListSize,
-		   LogFactList, LogFactListSize,
-		   gen);
-      if (step == x1) {
-	y11 = MutualInformation(part1Ref, part1, 0);
-	y12 = MutualInformation(part2Ref, part2, 0);
+    struct node_gra **cnlist1 = NULL, **cnlist2 = NULL;
+    struct node_gra *cnet1 = NULL, *cnet2 = NULL;
+    struct group **cglist1 = NULL, **cglist2 = NULL;
+    struct group *cpart1 = NULL, *cpart2 = NULL;
+    struct group *part1Ref = NULL, *part2Ref = NULL;
+    int **cN1G2[K], **cN2G1[K], **cG1G2[K], **cG2G1[K];
+    int k;
+    int cng1 = *ng1, cng2 = *ng2, step;
+    double cH = *H, y11, y12, y21, y22;
+    gsl_rng *rgen = gsl_rng_alloc(gsl_rng_mt19937);
+
+    /* Copy the state */
+    cnlist1 = (struct node_gra **) calloc(nnod1, sizeof(struct node_gra *));
+    cnlist2 = (struct node_gra **) calloc(nnod2, sizeof(struct node_gra *));
+    cglist1 = (struct group **) calloc(nnod1, sizeof(struct group *));
+    cglist2 = (struct group **) calloc(nnod2, sizeof(struct group *));
+    cnet1 = CopyNodeList(nlist1, nnod1, cnlist1);
+    cnet2 = CopyNodeList(nlist2, nnod2, cnlist2);
+    cpart1 = CopyPartitionToNodes(part1, cnlist1, cglist1);
+    cpart2 = CopyPartitionToNodes(part2, cnlist2, cglist2);
+    for (k=0; k<K; k++) {
+      cN1G2[k] = copy_i_mat(N1G2[k], nnod1, nnod2);
+      cN2G1[k] = copy_i_mat(N2G1[k], nnod2, nnod1);
+      cG1G2[k] = copy_i_mat(G1G2[k], nnod1, nnod2);
+      cG2G1[k] = copy_i_mat(G2G1[k], nnod2, nnod1);
+    }
+    gsl_rng_set(rgen, seeds[rep]);
+
+    nignored[rep] = 0;
+    do {
+      part1Ref = CopyPartition(cpart1);
+      part2Ref = CopyPartition(cpart2);
+      for (step=0; step<=x2; step++) {
+	switch (verbose_sw) {
+	case 'd':
+	  fprintf(stderr, "# %d / %d\n", step, x2);
+	  break;
+	default:
+	  break;
+	}
+	MCStepKState(K, 1, &cH, cnlist1, cnlist2,
+		     cglist1, cglist2, cpart1, cpart2,
+		     nnod1, nnod2, &cng1, &cng2,
+		     cN1G2, cN2G1,
+		     cG1G2, cG2G1,
+		     LogList, LogListSize,
+		     LogFactList, LogFactListSize,
+		     rgen);
+	if (step == x1) {
+	  y11 = MutualInformation(part1Ref, cpart1, 0);
+	  y12 = MutualInformation(part2Ref, cpart2, 0);
+	}
       }
-    }
-    y21 = MutualInformation(part1Ref, part1, 0);
-    y22 = MutualInformation(part2Ref, part2, 0);
-    if (nnod1 > 1)
-      decay1[rep] = 2. * CalculateDecay(nnod1, x1, y11, x2, y21);
-    else
-      decay1[rep] = 1.e-6;
-    if (nnod2 > 1)
-      decay2[rep] = 2. * CalculateDecay(nnod2, x1, y12, x2, y22);
-    else
-      decay2[rep] = 1.e-6;
+      y21 = MutualInformation(part1Ref, cpart1, 0);
+      y22 = MutualInformation(part2Ref, cpart2, 0);
+      if (nnod1 > 1)
+	decay1[rep] = 2. * CalculateDecay(nnod1, x1, y11, x2, y21);
+      else
+	decay1[rep] = 1.e-6;
+      if (nnod2 > 1)
+	decay2[rep] = 2. * CalculateDecay(nnod2, x1, y12, x2, y22);
+      else
+	decay2[rep] = 1.e-6;
+      RemovePartition(part1Ref);
+      RemovePartition(part2Ref);
+      if (decay1[rep] < 0. || decay2[rep] < 0.)
+	nignored[rep]++;
+    } while (decay1[rep] < 0. || decay2[rep] < 0.);
+
+    /* Free memory */
+    for (k=0; k<K; k++) {
+      free_i_mat(cN1G2[k], nnod1);
+      free_i_mat(cN2G1[k], nnod2);
+      free_i_mat(cG1G2[k], nnod1);
+      free_i_mat(cG2G1[k], nnod2);
+    }
+    RemovePartition(cpart1);
+    RemovePartition(cpart2);
+    RemoveGraph(cnet1);
+    RemoveGraph(cnet2);
+    free(cglist1);
+    free(cglist2);
+    free(cnlist1);
+    free(cnlist2);
+    gsl_rng_free(rgen);
+  }
+  for (rep=0; rep<nrep; rep++) {
     switch (verbose_sw) {
     case 'q':
       break;
     default:
+      if (nignored[rep] > 0)
+	fprintf(stderr, "#\tignoring %d negative estimate(s)...\n",
+		nignored[rep]);
       fprintf(stderr, "# Decorrelation times (estimate %d) = %g %g\n",
 	      rep + 1, decay1[rep], decay2[rep]);
       break;
     }
-    if (decay1[rep] < 0. || decay2[rep] < 0.) {
-      rep--;
-      switch (verbose_sw) {
-      case 'q':
-	break;
-      default:
-	fprintf(stderr, "#\tignoring...\n");
-	break;
-      }
-    }
-    /* Free memory */
-    RemovePartition(part1Ref);
-    RemovePartition(part2Ref);
   }
   
   /* Get rid of bad estimates (Chauvenet criterion)  */
@@ -1446,10 +1588,11 @@ GetDecorrelationStepKState(int K,
       break;
     }
   }
-  result = meanDecay * nrep;
+  /* Average the accepted estimates (subtracting the rejected ones
+     from the total would lose all precision after a huge outlier) */
+  result = 0.;
   for (rep=0; rep<nrep; rep++) {
     if (fabs((*decay)[rep] - meanDecay) / sigmaDecay > 2) {
-      result -= (*decay)[rep];
       switch (verbose_sw) {
       case 'q':
 	break;
@@ -1459,6 +1602,7 @@ GetDecorrelationStepKState(int K,
       }
     }
     else {
+      result += (*decay)[rep];
       norm++;
     }
   }
@@ -1474,7 +1618,10 @@ GetDecorrelationStepKState(int K,
   /* Clean up */
   free_d_vec(decay1);
   free_d_vec(decay2);
+  free_i_vec(nignored);
+  free(seeds);
 
+  CacheDecorrelationStep(key, (int)(result / norm + 0.5));
   return (int)(result / norm + 0.5);
 }
 
@@ -1714,7 +1861,6 @@ MultiLinkScoreKState(int K,
   if (decorStep <= 0) {
     decorStep = GetDecorrelationStepKState(K, &H,
 					   nlist1, nlist2,
-					   glist1, glist2,
 					   part1, part2,
 					   nnod1, nnod2,
 					   &ng1, &ng2,
@@ -66,7 +66,7 @@ void MCStep2State(int factor,
 			  int **G1G2_1, int **G2G1_1,
 			  double *LogList,
 			  int LogListSize,
-			  double **LogChooseList,
+			  double *LogChooseList,
 			  int LogChooseListSize,
 			  double *LogFactList,
 			  int LogFactListSize,
@@ -74,8 +74,6 @@ void MCStep2State(int factor,
 int GetDecorrelationStep2State(double *H,
 				       struct node_gra **nlist1,
 				       struct node_gra **nlist2,
-				       struct group **glist1,
-				       struct group **glist2,
 				       struct group *part1, struct group *part2,
 				       int nnod1, int nnod2,
 				       int *ng1, int *ng2,
@@ -85,7 +83,7 @@ int GetDecorrelationStep2State(double *H,
 				       int **G1G2_1, int **G2G1_1,
 				       double *LogList,
 				       int LogListSize,
-				       double **LogChooseList,
+				       double *LogChooseList,
 				       int LogChooseListSize,
 				       double *LogFactList,
 				       int LogFactListSize,
@@ -105,7 +103,7 @@ void ThermalizeMC2State(int decorStep,
 				int **G1G2_1, int **G2G1_1,
 				double *LogList,
 				int LogListSize,
-				double **LogChooseList,
+				double *LogChooseList,
 				int LogChooseListSize,
 				double *LogFactList,
 				int LogFactListSize,
@@ -135,8 +133,6 @@ int GetDecorrelationStepKState(int K,
 			       double *H,
 			       struct node_gra **nlist1,
 			       struct node_gra **nlist2,
-			       struct group **glist1,
-			       struct group **glist2,
 			       struct group *part1, struct group *part2,
 			       int nnod1, int nnod2,
 			       int *ng1, int *ng2,
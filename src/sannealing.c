@@ -7,6 +7,9 @@
 #include "sannealing.h"
 #include "partition.h"
 #include "movements.h"
+#include "fillpartitions.h"
+#include "graph.h"
+#include "bipartite.h"
 
 #define VERBOSE
 #ifndef EXPLAIN
@@ -21,6 +24,10 @@
 #define info(M, ...) fprintf(stderr,M, ##__VA_ARGS__)
 #endif
 
+// Progress messages of an annealing, only shown if verbose is not 0.
+#define sainfo(verbose, M, ...) \
+  do { if (verbose) { info(M, ##__VA_ARGS__); } } while (0)
+
 #define EPSILON_MOD 1.e-6
 
 /**
@@ -34,6 +41,7 @@ Modularity optimisation using simulated annealing.
 @param Ts Cooling factor.
 @param proba_components probability to try using connected components to split a module.
 @param nochange_limit number of consecutive non improving step before stopping.
+@param verbose If 0, no progress messages are printed.
 @param gen random number generator.
 **/
 unsigned int
@@ -42,6 +50,7 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
 		  double Ti, double Tf, double Ts,
 		  double proba_components,
 		  unsigned int nochange_limit,
+		  int verbose,
 		  gsl_rng *gen)
 {
   Partition *part = *ppart;
@@ -52,7 +61,7 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
   unsigned int nochange_count=0;
 
   double dE=0.0, E=0.0, previousE=0.0, best_E=-1.0/0.0;  //initial best is -infinity.
-  info ("#Simulated annealing:\n");
+  sainfo (verbose, "#Simulated annealing:\n");
   explain ("#Ti: %f Tf: %f c: %f fac: %f\n",Ti,Tf,Ts,fac);
   explain ("#nochang_limit: %d, proba_components: %f \n",nochange_limit, proba_components);
 
@@ -66,10 +75,10 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
   else
 	collective_movements = floor(fac * (double)part->N);
 
-  info ("#T\tE\tStop\n");
+  sainfo (verbose, "#T\tE\tStop\n");
   /// SIMULATED ANNEALING ///
   for (T=Ti; T > Tf; T = T*Ts) {
-	info ("%e\t%e\t%d\n", T , E, nochange_count);
+	sainfo (verbose, "%e\t%e\t%d\n", T , E, nochange_count);
 	//// INDIVIDUAL MOVEMENTS. ////
 	for (i=individual_movements; i; i--) {
 	  //// Select a node and a target group.
@@ -194,13 +203,13 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
 		nochange_count++;
 		// If we reach the limit...
 		if (nochange_count == nochange_limit){
-		  info ("# Too much rounds without changes (%d)... \n",nochange_count);
+		  sainfo (verbose, "# Too much rounds without changes (%d)... \n",nochange_count);
 		  // If the current partition is the best so far. Terminate the
 		  // SA by breaking out of the temperature loop.
 		  if (E+EPSILON_MOD>= best_E) break;
 
 		  // Otherwise, reset the partition to the best one and proceed.
-		  info ("# Restarting from a better place (%e<%e)\n",E,best_E);
+		  sainfo (verbose, "# Restarting from a better place (%e<%e)\n",E,best_E);
 		  E = best_E;
 		  nochange_count = 0;
 		  FreePartition(part);
@@ -210,7 +219,7 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
 	// Compare the current partition to the best partition so far and
 	// update it if needed.
 	else if ( E > best_E) {
-	  info ("# Saving a new best partition (%e)\n",E);
+	  sainfo (verbose, "# Saving a new best partition (%e)\n",E);
 	  if (best_part!=NULL)
 		FreePartition(best_part);
 	  best_part = CopyPartitionStruct(part);
@@ -222,7 +231,7 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
 
   } // End of the Temperature loop (end of SA).
 
-  info ("# End of SA, best partition so far: %e\n",best_E);
+  sainfo (verbose, "# End of SA, best partition so far: %e\n",best_E);
 
   FreePartition(part);
   *ppart = best_part;
@@ -302,3 +311,110 @@ SplitModuleSA(unsigned int target, unsigned int empty,
   free(indices);
   return 0;
 }
+
+/**
+Modularity of degree-preserving randomizations of a network (null
+model for the significance of its modularity).
+
+The edge list (as returned by EdgeListFileInput) is randomized nrep
+times with the link switching algorithm (SwapSymmetricLinks, or
+SwapBipartLinks for bipartite networks, which keeps the two sets of
+nodes). Each replica is converted to an adjacency array and its
+modularity is optimised with GeneralSA, which runs quietly (a single
+message is printed when all replicas are done). Replicas are processed
+concurrently by a pool of OpenMP threads; each thread owns a single
+edge list, partition and adjacency array at a time, so memory grows
+with the number of threads rather than with nrep. The seeds of the
+replica generators are drawn in advance from a generator seeded with
+seed (so that no replica repeats the random numbers of a run seeded
+with seed), and results do not depend on the number of threads.
+
+The links must be simple (for bipartite networks, not repeated), as
+the link switching algorithm requires; otherwise an error is printed
+and nullmod is left untouched.
+
+@param nodes_in,nodes_out,weights,E,N Edge list and number of nodes (for bipartite networks, N is the number of nodes in nodes_in).
+@param bipartite If 1, modules are found for the nodes in nodes_in of a bipartite network.
+@param nrep Number of randomized replicas.
+@param fac,Ti,Tf,Ts,proba_components,nochange_limit Simulated annealing parameters (see GeneralSA).
+@param seed Seed for the random number generators.
+@param nullmod Modularity of each replica (output, array of size nrep).
+@return 0 on success, -1 if the links are not simple.
+**/
+int
+NullModelModularity(unsigned int *nodes_in, unsigned int *nodes_out,
+					double *weights, unsigned int E, unsigned int N,
+					int bipartite, unsigned int nrep,
+					double fac,
+					double Ti, double Tf, double Ts,
+					double proba_components,
+					unsigned int nochange_limit,
+					unsigned long int seed,
+					double *nullmod)
+{
+  int r;
+  unsigned long int *seeds;
+  gsl_rng *seedGen;
+
+  // The edge list is the same for every replica, so check it once.
+  if ((!bipartite &&
+	   !IsSymmetricLinkListSimple(E, (int *)nodes_in, (int *)nodes_out)) ||
+	  (bipartite &&
+	   !IsBipartLinkListSimple(E, (int *)nodes_in, (int *)nodes_out))){
+	fprintf(stderr, "Error in NullModelModularity: the links are not simple, "
+			"no null model computed\n");
+	return -1;
+  }
+
+  seeds = malloc(nrep*sizeof(unsigned long int));
+  seedGen = gsl_rng_alloc(gsl_rng_mt19937);
+  gsl_rng_set(seedGen, seed);
+  for (r=0; r<(int)nrep; r++)
+	seeds[r] = gsl_rng_get(seedGen);
+  gsl_rng_free(seedGen);
+
+#pragma omp parallel
+  {
+	unsigned int *ori = malloc((E+1)*sizeof(unsigned int));
+	unsigned int *des = malloc((E+1)*sizeof(unsigned int));
+	gsl_rng *gen = gsl_rng_alloc(gsl_rng_mt19937);
+	Partition *part;
+	AdjaArray *adj;
+
+#pragma omp for schedule(dynamic, 1)
+	for (r=0; r<(int)nrep; r++){
+	  memcpy(ori, nodes_in, E*sizeof(unsigned int));
+	  memcpy(des, nodes_out, E*sizeof(unsigned int));
+	  gsl_rng_set(gen, seeds[r]);
+
+	  // Randomize and build the replica.
+	  if (!bipartite){
+		SwapSymmetricLinks(E, (int *)ori, (int *)des, 100, gen);
+		part = CreatePartition(N,N);
+		adj = CreateAdjaArray(N,E);
+		EdgeListToAdjaArray((int *)ori, (int *)des, weights, adj, part, 1);
+	  }else{
+		SwapBipartLinks(E, (int *)ori, (int *)des, 100, gen);
+		ProjectBipartEdgeList(ori, des, weights, E, &part, &adj);
+	  }
+
+	  // Find its modules.
+	  AssignNodesToModules(part,gen);
+	  GeneralSA(&part, adj, fac,
+				Ti, Tf, Ts,
+				proba_components, nochange_limit,
+				0, gen);
+	  nullmod[r] = PartitionModularity(part,adj,0);
+
+	  FreeAdjaArray(adj);
+	  FreePartition(part);
+	}
+
+	free(ori);
+	free(des);
+	gsl_rng_free(gen);
+  }
+  free(seeds);
+  info ("# Null model: %u replicas optimised\n", nrep);
+  return 0;
+}
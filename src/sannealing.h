@@ -25,6 +25,7 @@ GeneralSA(Partition **ppart, AdjaArray *adj,
 		  double Ti, double Tf, double Ts,
 		  double cluster_prob,
 		  unsigned int nochange_limit,
+		  int verbose,
 		  gsl_rng *gen);
 
 unsigned int
@@ -33,3 +34,14 @@ SplitModuleSA(unsigned int target, unsigned int empty,
 			  unsigned int nochange_limit,
 			  Partition *part, AdjaArray *adj,
 			  gsl_rng *gen);
+
+int
+NullModelModularity(unsigned int *nodes_in, unsigned int *nodes_out,
+					double *weights, unsigned int E, unsigned int N,
+					int bipartite, unsigned int nrep,
+					double fac,
+					double Ti, double Tf, double Ts,
+					double proba_components,
+					unsigned int nochange_limit,
+					unsigned long int seed,
+					double *nullmod);
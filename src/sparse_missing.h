@@ -20,38 +20,13 @@
   ---------------------------------------------------------------------
 */
 double SparsePartitionH(struct group *part, double betaA, double betaB);
-void SparseGibbsLinkScoreStep(double *H,
-			      struct node_gra **nlist,
-			      struct group **glist,
-			      struct group *part,
-			      int nnod,
-			      int **G2G,
-			      int *n2gList,
-			      double *LogGammaListA,
-			      double *LogGammaListB,
-			      double *LogGammaListAB,
-			      int LogGammaListSize,
-			      double *LogFactList, int LogFactListSize,
-			      double betaA, double betaB,
-			      gsl_rng *gen);
-void SparseGibbsThermalizeLinkScore(double *H,
-				    struct node_gra **nlist,
-				    struct group **glist,
-				    struct group *part,
-				    int nnod,
-				    int **G2G,
-				    int *n2gList,
-				    double *LogGammaListA,
-				    double *LogGammaListB,
-				    double *LogGammaListAB,
-				    int LogGammaListSize,
-				    double *LogFactList, int LogFactListSize,
-				    double betaA, double betaB,
-				    gsl_rng *gen, char verbose_sw);
-double **SparseGibbsLinkScore(struct node_gra *net,
-			      int nIter,
-			      gsl_rng *gen,
-			      char verbose_sw);
+struct sbm_likelihood *SparseCreateSBMLikelihood(double betaA, double betaB);
+struct sbm_likelihood *SparseCreateSBMLikelihoodNet(struct node_gra *net);
+struct pair_matrix *SparseGibbsLinkScore(struct node_gra *net,
+					 int nIter,
+					 gsl_rng *gen,
+					 char verbose_sw,
+					 struct pair_score *cand);
 
 
 
@@ -11,8 +11,23 @@
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_sf_gamma.h>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #include "tools.h"
 
+/* Matrices are aligned to cache lines and, when they take at least
+   MAT_HUGEPAGE_BYTES (define it to 0 to disable this), to huge pages */
+#define MAT_ALIGN 64
+#define MAT_HUGEPAGE_ALIGN (2UL << 20)
+#ifndef MAT_HUGEPAGE_BYTES
+#define MAT_HUGEPAGE_BYTES (16UL << 20)
+#endif
+
+/* Maximum number of entries (32 MB) of the ln(r!) tables */
+#define FAST_LOG_MAX_SIZE (1 << 22)
+
 /*
   ---------------------------------------------------------------------
   ---------------------------------------------------------------------
@@ -23,33 +38,74 @@
 
 /*
   -----------------------------------------------------------------------------
-  Allocation of a matrix of integers
+  Allocation of a matrix (rows x columns elements of elsize bytes) as a
+  single block: the elements are stored contiguously, row after row,
+  starting at a cache-line boundary, and are followed by the array of
+  row pointers that is returned. The start of the block is stored
+  just before the row pointers, so that free_mat works even if rows
+  are swapped. Large matrices are aligned to, and advised to use,
+  huge pages where available. Returns NULL (after a message with the
+  requested size) if there is not enough memory.
   -----------------------------------------------------------------------------
 */
-int **
-allocate_i_mat(int nrows, int ncolumns)
+static void **
+allocate_mat(int nrows, int ncolumns, size_t elsize)
 {
-  int **array;
+  size_t databytes, ptrbytes, align = MAT_ALIGN;
+  char *block = NULL;
+  void **array;
   int i;
 
-  array = (int**)malloc(nrows * sizeof(int *));
-  if(array == NULL){
-      fprintf(stderr, "out of memory\n");
-      return NULL;
+  databytes = (size_t)nrows * (size_t)ncolumns * elsize;
+  databytes = (databytes + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+  ptrbytes = ((size_t)nrows + 1) * sizeof(void *);
+
+#if defined(MADV_HUGEPAGE) && MAT_HUGEPAGE_BYTES > 0
+  if (databytes >= MAT_HUGEPAGE_BYTES)
+    align = MAT_HUGEPAGE_ALIGN;
+#endif
+  if (posix_memalign((void **)&block, align, databytes + ptrbytes) != 0) {
+    fprintf(stderr,
+	    "ERROR: out of memory allocating a %d x %d matrix (%lu bytes)\n",
+	    nrows, ncolumns, (unsigned long)(databytes + ptrbytes));
+    return NULL;
   }
+#if defined(MADV_HUGEPAGE) && MAT_HUGEPAGE_BYTES > 0
+  if (align == MAT_HUGEPAGE_ALIGN)
+    madvise(block, databytes, MADV_HUGEPAGE);
+#endif
 
-  for(i = 0; i < nrows; i++){
-    array[i] = (int*)malloc(ncolumns * sizeof(int));
-      if(array[i] == NULL)
-	{
-	  fprintf(stderr, "out of memory\n");
-	  return NULL;
-	}
-  }
+  array = (void **)(block + databytes) + 1;
+  array[-1] = block;
+  for (i=0; i<nrows; i++)
+    array[i] = block + (size_t)i * ncolumns * elsize;
 
   return array;
 }
 
+/*
+  -----------------------------------------------------------------------------
+  Free a matrix allocated with allocate_mat
+  -----------------------------------------------------------------------------
+*/
+static void
+free_mat(void **array)
+{
+  if (array != NULL)
+    free(array[-1]);
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Allocation of a matrix of integers
+  -----------------------------------------------------------------------------
+*/
+int **
+allocate_i_mat(int nrows, int ncolumns)
+{
+  return (int **)allocate_mat(nrows, ncolumns, sizeof(int));
+}
+
 
 /*
   -----------------------------------------------------------------------------
@@ -105,6 +161,25 @@ allocate_d_vec(int nelem)
   return array;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Allocate a copy of a matrix of integers
+  ---------------------------------------------------------------------
+*/
+int **
+copy_i_mat(int **data, int nrows, int ncolumns)
+{
+  int **array;
+  int i;
+
+  array = allocate_i_mat(nrows, ncolumns);
+  if (array != NULL)
+    for (i=0; i<nrows; i++)
+      memcpy(array[i], data[i], (size_t)ncolumns * sizeof(int));
+
+  return array;
+}
+
 /*
   ---------------------------------------------------------------------
   Allocation of a matrix of doubles
@@ -114,22 +189,10 @@ double **
 allocate_d_mat(int nrows, int ncolumns)
 {
   double **array;
-  int i;
-
-  array = (double**)malloc(nrows * sizeof(double *));
-  if(array == NULL){
-    fprintf(stderr, "out of memory\n");
-    return NULL;
-  }
 
-  for(i = 0; i < nrows; i++){
-    array[i] = (double*)malloc(ncolumns * sizeof(double));
-    if(array[i] == NULL){
-      fprintf(stderr, "out of memory\n");
-      return NULL;
-    }else
-      memset(array[i], 0, ncolumns * sizeof(double));
-  }
+  array = (double **)allocate_mat(nrows, ncolumns, sizeof(double));
+  if (array != NULL && nrows > 0)
+    memset(array[0], 0, (size_t)nrows * ncolumns * sizeof(double));
 
   return array;
 }
@@ -137,19 +200,15 @@ allocate_d_mat(int nrows, int ncolumns)
 
 /*
   ---------------------------------------------------------------------
-  Free a matrix of integers
+  Free a matrix of integers. nrows is not needed any more, and is
+  kept for compatibility.
   ---------------------------------------------------------------------
 */
 void 
 free_i_mat(int **data, int nrows)
 {
-  int i;
-
-  for(i=0; i<nrows; i++){
-    free(data[i]);
-  }
-
-  free(data);
+  (void)nrows;
+  free_mat((void **)data);
 }
 
 /*
@@ -176,19 +235,15 @@ free_d_vec(double *data)
 
 /*
   ---------------------------------------------------------------------
-  Free a matrix of doubles
+  Free a matrix of doubles. nrows is not needed any more, and is
+  kept for compatibility.
   ---------------------------------------------------------------------
 */
 void
 free_d_mat(double **data, int nrows)
 {
-  int i;
-
-  for(i=0; i<nrows; i++){
-    free(data[i]);
-  }
-
-  free(data);
+  (void)nrows;
+  free_mat((void **)data);
 }
 
 
@@ -304,6 +359,42 @@ min(double *data, int N)
   return m;
 }
 
+/*
+  ---------------------------------------------------------------------
+  Gelman-Rubin potential scale reduction factor (R-hat) of M chains
+  of N values each (data[m][0..N-1] is chain m). Values close to 1
+  indicate that the chains sample the same distribution; HUGE_VAL is
+  returned when it cannot be estimated.
+  ---------------------------------------------------------------------
+*/
+double
+gelman_rubin(double **data, int M, int N)
+{
+  int m, i;
+  double cm, w = 0.0, b = 0.0, mm = 0.0, v;
+  double *chainMean = NULL;
+
+  if (M < 2 || N < 2)
+    return HUGE_VAL;
+
+  chainMean = allocate_d_vec(M);
+  for (m=0; m<M; m++) {
+    cm = chainMean[m] = mean(data[m], N);
+    mm += cm / (double)M;
+    for (i=0; i<N; i++)
+      w += (data[m][i] - cm) * (data[m][i] - cm) / (double)((N - 1) * M);
+  }
+  for (m=0; m<M; m++)
+    b += (chainMean[m] - mm) * (chainMean[m] - mm) * (double)N /
+      (double)(M - 1);
+  free_d_vec(chainMean);
+
+  if (w <= 0.0)
+    return (b <= 0.0) ? 1.0 : HUGE_VAL;
+  v = (double)(N - 1) / (double)N * w + b / (double)N;
+  return sqrt(v / w);
+}
+
 /*
   ---------------------------------------------------------------------
   ---------------------------------------------------------------------
@@ -363,56 +454,65 @@ LogChoose(int a, int b)
 
 /*
   ---------------------------------------------------------------------
-  Initialize a matrix to be used by FastLogChoose
+  Size of the tables of ln(r!) needed to evaluate FastLogChoose (and
+  FastLogFact) for all r <= maxr, capped at FAST_LOG_MAX_SIZE entries
+  (beyond that, the functions fall back to computing the value).
   ---------------------------------------------------------------------
 */
-double **
-InitializeFastLogChoose(int LogChooseListSize)
+int
+FastLogTableSize(long int maxr)
 {
-  double **LogChooseList;
-  int i, j;
-
-  LogChooseList = allocate_d_mat(LogChooseListSize, LogChooseListSize);
-  for (i=0; i<LogChooseListSize; i++)
-    for (j=0; j<LogChooseListSize; j++)
-      LogChooseList[i][j] = -1.0;
+  if (maxr + 1 > FAST_LOG_MAX_SIZE)
+    return FAST_LOG_MAX_SIZE;
+  else if (maxr < 1)
+    return 2;
+  else
+    return (int)(maxr + 1);
+}
 
-  return LogChooseList;
+/*
+  ---------------------------------------------------------------------
+  Initialize the table used by FastLogChoose: ln(r!) for r <
+  LogChooseListSize. This is the same table as the one used by
+  FastLogFact, so the two functions can share it. The table is
+  filled at once and is read-only afterwards, so it can be shared by
+  several threads.
+  ---------------------------------------------------------------------
+*/
+double *
+InitializeFastLogChoose(int LogChooseListSize)
+{
+  return InitializeFastLogFact(LogChooseListSize);
 }
 
 /*
   ---------------------------------------------------------------------
-  Free a used by FastLogChoose
+  Free a table used by FastLogChoose
   ---------------------------------------------------------------------
 */
 void
-FreeFastLogChoose(double **LogChooseList, int LogChooseListSize)
+FreeFastLogChoose(double *LogChooseList)
 {
-  free_d_mat(LogChooseList, LogChooseListSize);
+  FreeFastLogFact(LogChooseList);
   return;
 }
 
 /*
   ---------------------------------------------------------------------
-  Fast log of the binomial coefficient: checks, first, in a matrix to
-  see if the coefficient has been calculated before. At the begining,
-  the matrix MUST BE initialized to <0 values (RECOMMENDED: Use
-  InitializeFastLogChoose for that purpose).
+  Fast log of the binomial coefficient: if r is small enough,
+  ln C(r, l) = ln(r!) - ln(l!) - ln((r-l)!) is obtained from three
+  previously tabulated values, otherwise it is calculated. The table
+  MUST BE initialized with InitializeFastLogChoose (or
+  InitializeFastLogFact).
   ---------------------------------------------------------------------
 */
 double
-FastLogChoose(int r, int l, double **LogChooseList, int LogChooseListSize)
+FastLogChoose(int r, int l, double *LogChooseList, int LogChooseListSize)
 {
-/*   fprintf(stderr, "Using fast logchoose\n"); */
-  if (r < LogChooseListSize) {
-    if (LogChooseList[r][l] < 0.) {
-      LogChooseList[r][l] = LogChoose(r, l);
-    }
-    return LogChooseList[r][l];
-  }
-  else {
+  if (r < LogChooseListSize)
+    return LogChooseList[r] - LogChooseList[l] - LogChooseList[r - l];
+  else
     return LogChoose(r, l);
-  }
 }
 
 /*
@@ -476,6 +576,7 @@ InitializeFastLogFact(int LogFactListSize)
   int i;
 
   LogFactList = allocate_d_vec(LogFactListSize);
+#pragma omp parallel for schedule(static)
   for (i=0; i<LogFactListSize; i++)
     LogFactList[i] = gsl_sf_lnfact(i);
 
@@ -619,3 +720,98 @@ CountLinesInFile(char *inFileName)
 
   return n;
 }
+
+/*
+  -----------------------------------------------------------------------------
+  64-bit FNV-1a hash of n bytes, continuing from hash (pass 0 to
+  start a new hash)
+  -----------------------------------------------------------------------------
+*/
+unsigned long long
+hash_bytes(const void *data, size_t n, unsigned long long hash)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  size_t i;
+
+  if (hash == 0)
+    hash = 14695981039346656037ULL;
+  for (i=0; i<n; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/*
+  -----------------------------------------------------------------------------
+  Decorrelation step cache. When a cache file is set (with
+  SetDecorrelationCache or, failing that, with the environment
+  variable DECOR_CACHE_ENV), the decorrelation steps estimated by the
+  samplers are appended to it as "key step" lines, where the key is a
+  hash of the network and the model, and later runs on the same
+  network reuse them. GetCachedDecorrelationStep returns the last step
+  stored under key, or 0 if there is none. The file is only accessed
+  inside a critical section, so the samplers can run concurrently.
+  -----------------------------------------------------------------------------
+*/
+static char *DecorCacheF = NULL;
+
+void
+SetDecorrelationCache(char *fname)
+{
+  DecorCacheF = fname;
+  return;
+}
+
+static char *
+DecorrelationCacheName(void)
+{
+  if (DecorCacheF != NULL)
+    return DecorCacheF;
+  return getenv(DECOR_CACHE_ENV);
+}
+
+int
+GetCachedDecorrelationStep(unsigned long long key)
+{
+  char *fname = DecorrelationCacheName();
+  FILE *inFile;
+  unsigned long long k;
+  int step, result = 0;
+
+  if (fname == NULL)
+    return 0;
+#pragma omp critical (decor_cache)
+  {
+    if ((inFile = fopen(fname, "r")) != NULL) {
+      while (fscanf(inFile, "%llx %d", &k, &step) == 2)
+	if (k == key && step > 0)
+	  result = step;
+      fclose(inFile);
+    }
+  }
+
+  return result;
+}
+
+void
+CacheDecorrelationStep(unsigned long long key, int step)
+{
+  char *fname = DecorrelationCacheName();
+  FILE *outFile;
+
+  if (fname == NULL || step <= 0)
+    return;
+#pragma omp critical (decor_cache)
+  {
+    if ((outFile = fopen(fname, "a")) != NULL) {
+      fprintf(outFile, "%016llx %d\n", key, step);
+      fclose(outFile);
+    }
+    else {
+      fprintf(stderr, "WARNING: cannot write decorrelation cache %s\n",
+	      fname);
+    }
+  }
+  return;
+}
@@ -7,8 +7,12 @@
 #ifndef RGRAPH_TOOLS_H
 #define RGRAPH_TOOLS_H 1
 
+#include <stddef.h>
 #include <gsl/gsl_rng.h>
 
+/* Environment variable with the name of the decorrelation step cache */
+#define DECOR_CACHE_ENV "RGRAPH_DECOR_CACHE"
+
 /*
   ---------------------------------------------------------------------
   Vector and matrix memory management
@@ -19,6 +23,7 @@ void fprintf_i_mat(FILE *outf, int **mat, int nrows, int ncolumns);
 int *allocate_i_vec(int nelem);
 double *allocate_d_vec(int nelem);
 double **allocate_d_mat(int nrows, int ncolumns);
+int **copy_i_mat(int **data, int nrows, int ncolumns);
 void free_i_mat(int **data, int nrows);
 void free_i_vec(int *data);
 void free_d_vec(double *data);
@@ -40,6 +45,7 @@ double mean(double *data, int N);
 double stddev(double *data, int N);
 double max(double *data, int N);
 double min(double *data, int N);
+double gelman_rubin(double **data, int M, int N);
 
 /*
   ---------------------------------------------------------------------
@@ -49,12 +55,12 @@ double min(double *data, int N);
 long int fact(long int a);
 long double Choose(int a, int b);
 double LogChoose(int a, int b);
-double **InitializeFastLogChoose(int LogChooseListSize);
-void FreeFastLogChoose(double **LogChooseList,
-		       int LogChooseListSize);
+int FastLogTableSize(long int maxr);
+double *InitializeFastLogChoose(int LogChooseListSize);
+void FreeFastLogChoose(double *LogChooseList);
 double FastLogChoose(int a,
 		     int b,
-		     double **LogChooseList,
+		     double *LogChooseList,
 		     int LogChooseListSize);
 
 double *InitializeFastLog(int LogListSize);
@@ -78,5 +84,10 @@ void FreeHarmonicList(double *HarmonicList);
   ---------------------------------------------------------------------
 */
 int CountLinesInFile(char *inFileName);
+unsigned long long hash_bytes(const void *data, size_t n,
+			      unsigned long long hash);
+void SetDecorrelationCache(char *fname);
+int GetCachedDecorrelationStep(unsigned long long key);
+void CacheDecorrelationStep(unsigned long long key, int step);
 
 #endif /* !RGRAPH_TOOLS_H */
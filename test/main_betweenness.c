@@ -2,6 +2,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <gsl/gsl_rng.h>
+
 #include "graph.h"
 
 #define EPS 1.e-6
@@ -51,6 +53,46 @@ main()
       printf("OK\n");
   }
 
+  /* Link betweenness (both directions of a link get the same value) */
+  struct node_lis *l;
+  CalculateLinkBetweenness(net);
+  p = net;
+  while ((p = p->next) != NULL) {
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      if ((atoi(p->label) == 1 && atoi(l->ref->label) == 3) ||
+	  (atoi(p->label) == 3 && atoi(l->ref->label) == 1)) {
+	printf("%s-%s\t%g %g ", p->label, l->ref->label, l->btw, 29. / 3.);
+	if (fabs(l->btw - 29. / 3.) > EPS) {
+	  printf("WRONG!\n");
+	  return 1;
+	}
+	else
+	  printf("OK\n");
+      }
+    }
+  }
+
+  /* Sampling all sources must give the exact values and empty
+     confidence intervals */
+  gsl_rng *randGen = gsl_rng_alloc(gsl_rng_mt19937);
+  double ci[7];
+  gsl_rng_set(randGen, 1111);
+  if (CalculateNodeBetweennessSampled(net, 7, 0.0, 0.05, randGen, ci) != 7)
+    return 1;
+  p = net;
+  while ((p = p->next) != NULL) {
+    printf("%s\t%g +- %g (sampled) ", p->label, p->dvar1, ci[p->num]);
+    if (fabs(p->dvar1 - rightResult[atoi(p->label)]) > EPS ||
+	ci[p->num] != 0.0) {
+      printf("WRONG!\n");
+      return 1;
+    }
+    else
+      printf("OK\n");
+  }
+  gsl_rng_free(randGen);
+
   /* Free memory */
   RemoveGraph(net);
 
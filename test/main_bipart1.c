@@ -13,6 +13,47 @@
 #include "graph.h"
 #include "bipartite.h"
 
+/*
+  Check that the degrees of the nodes in one side of a bipartite
+  network (net) are deg[num], that their strengths are str[num] (if
+  str is not NULL), and that each link has the same weight seen from
+  both sides. Returns the number of errors.
+*/
+static int
+CheckSide(struct node_gra *net, int *deg, double *str)
+{
+  struct node_gra *p = net;
+  struct node_lis *l, *r;
+  double s;
+  int nerr = 0;
+
+  while ((p = p->next) != NULL) {
+    if ((int)NodeDegree(p) != deg[p->num]) {
+      fprintf(stderr, "Degree of %s = %d != %d\tWRONG!\n",
+	      p->label, NodeDegree(p), deg[p->num]);
+      nerr++;
+    }
+    s = 0.0;
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      s += l->weight;
+      r = l->ref->neig;
+      while ((r = r->next) != NULL && r->ref != p);
+      if (r == NULL || r->weight != l->weight) {
+	fprintf(stderr, "Link %s-%s is not symmetric\tWRONG!\n",
+		p->label, l->ref->label);
+	nerr++;
+      }
+    }
+    if (str != NULL && fabs(s - str[p->num]) > 1.e-9) {
+      fprintf(stderr, "Strength of %s = %g != %g\tWRONG!\n",
+	      p->label, s, str[p->num]);
+      nerr++;
+    }
+  }
+  return nerr;
+}
+
 int main()
 {
   struct binet *binet = NULL;
@@ -41,7 +82,56 @@ int main()
   InvertBipart(binet);
 
   fprintf(stderr, "Randomizing the network...\n");
+  int *deg1 = (int *)calloc(CountNodes(binet->net1), sizeof(int));
+  int *deg2 = (int *)calloc(CountNodes(binet->net2), sizeof(int));
+  double *str1 = (double *)calloc(CountNodes(binet->net1), sizeof(double));
+  int nlink = NLinksBipart(binet);
+  struct node_gra *p;
+  struct node_lis *l, *r;
+
+  /* Give the links random weights (the same from both sides) */
+  p = binet->net1;
+  while ((p = p->next) != NULL) {
+    deg1[p->num] = NodeDegree(p);
+    l = p->neig;
+    while ((l = l->next) != NULL) {
+      l->weight = gsl_rng_uniform(randGen);
+      str1[p->num] += l->weight;
+      r = l->ref->neig;
+      while ((r = r->next) != NULL && r->ref != p);
+      r->weight = l->weight;
+    }
+  }
+  p = binet->net2;
+  while ((p = p->next) != NULL)
+    deg2[p->num] = NodeDegree(p);
+
+  /* Switching must preserve degrees, the number of links and, since
+     each link keeps its origin and weight, the strengths in net1 */
   RandomizeBipart(binet, 100, randGen);
+  if (NLinksBipart(binet) != nlink) {
+    fprintf(stderr, "L = %d != %d\tWRONG!\n", NLinksBipart(binet), nlink);
+    return 1;
+  }
+  if (CheckSide(binet->net1, deg1, str1) + CheckSide(binet->net2, deg2, NULL))
+    return 1;
+
+  /* Curveball trades must preserve degrees and the number of links,
+     and give all links weight 1 */
+  fprintf(stderr, "Randomizing the network (curveball)...\n");
+  RandomizeBipartCurveball(binet, 100, randGen);
+  if (NLinksBipart(binet) != nlink) {
+    fprintf(stderr, "L = %d != %d\tWRONG!\n", NLinksBipart(binet), nlink);
+    return 1;
+  }
+  p = binet->net1;
+  while ((p = p->next) != NULL)
+    str1[p->num] = (double)deg1[p->num];
+  if (CheckSide(binet->net1, deg1, str1) + CheckSide(binet->net2, deg2, NULL))
+    return 1;
+  free(deg1);
+  free(deg2);
+  free(str1);
 
   fprintf(stderr, "Projecting the network...\n");
   struct node_gra *projection;
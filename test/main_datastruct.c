@@ -0,0 +1,74 @@
+/*
+  main_datastruct.c
+  $LastChangedDate$
+  $Revision$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "datastruct.h"
+
+int
+main()
+{
+  struct array_stack *theStack = array_stack_create(1);
+  struct ring_queue *theQueue = ring_queue_create(2);
+  struct hashmap *theMap = hashmap_create(1);
+  long i, expected = 0;
+  int value;
+
+  /* LIFO order across capacity doublings */
+  for (i=1; i<=100; i++)
+    array_stack_push(theStack, (void *)i);
+  if ((long)array_stack_top(theStack) != 100)
+    return 1;
+  for (i=100; i>=1; i--)
+    if ((long)array_stack_pop(theStack) != i)
+      return 1;
+  if (!array_stack_empty(theStack) || array_stack_pop(theStack) != NULL)
+    return 1;
+
+  /* FIFO order with interleaved operations, so that the buffer wraps
+     around before it grows */
+  for (i=1; i<=1000; i++) {
+    ring_queue_enqueue(theQueue, (void *)i);
+    if (i % 3 == 0) {
+      if ((long)ring_queue_dequeue(theQueue) != ++expected)
+	return 1;
+    }
+  }
+  while (!ring_queue_empty(theQueue)) {
+    if ((long)ring_queue_first(theQueue) != expected + 1 ||
+	(long)ring_queue_dequeue(theQueue) != ++expected)
+      return 1;
+  }
+  if (expected != 1000)
+    return 1;
+
+  /* Clearing keeps the buffer */
+  ring_queue_enqueue(theQueue, (void *)1);
+  ring_queue_clear(theQueue);
+  if (!ring_queue_empty(theQueue) || theQueue->capacity < 1000)
+    return 1;
+  array_stack_free(theStack);
+  ring_queue_free(theQueue);
+
+  /* Counting and lookups across capacity doublings */
+  for (i=0; i<3000; i++)
+    hashmap_increment(theMap, (unsigned long long)(i % 1000) << 32, 1);
+  hashmap_set(theMap, 7, -5);
+  if (theMap->length != 1001)
+    return 1;
+  for (i=0; i<1000; i++)
+    if (!hashmap_get(theMap, (unsigned long long)i << 32, &value) ||
+	value != 3)
+      return 1;
+  if (!hashmap_get(theMap, 7, &value) || value != -5 ||
+      hashmap_increment(theMap, 7, 2) != -3 ||
+      hashmap_get(theMap, 8, &value))
+    return 1;
+  hashmap_free(theMap);
+
+  return 0;
+}
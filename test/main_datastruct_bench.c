@@ -0,0 +1,88 @@
+/*
+  main_datastruct_bench.c
+  $LastChangedDate$
+  $Revision$
+
+  Throughput of the list-based and array-based stacks and queues (not
+  part of make check; build it with make datastruct_bench).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "datastruct.h"
+
+#define NOPS 1000000
+#define NROUNDS 20
+
+/*
+  Push NOPS elements and pop them all, NROUNDS times, and return the
+  number of push+pop pairs per second.
+*/
+static double
+StackThroughput(int array_sw)
+{
+  struct stack *theStack = stack_create();
+  struct array_stack *theArrayStack = array_stack_create(16);
+  clock_t start = clock();
+  long i, r;
+
+  for (r=0; r<NROUNDS; r++) {
+    if (array_sw) {
+      for (i=0; i<NOPS; i++)
+	array_stack_push(theArrayStack, (void *)i);
+      while (!array_stack_empty(theArrayStack))
+	array_stack_pop(theArrayStack);
+    }
+    else {
+      for (i=0; i<NOPS; i++)
+	stack_push(theStack, (void *)i);
+      while (!stack_empty(theStack))
+	stack_pop(theStack);
+    }
+  }
+
+  stack_free(theStack);
+  array_stack_free(theArrayStack);
+  return (double)NOPS * NROUNDS * CLOCKS_PER_SEC / (clock() - start + 1);
+}
+
+static double
+QueueThroughput(int array_sw)
+{
+  struct queue *theQueue = queue_create();
+  struct ring_queue *theRingQueue = ring_queue_create(16);
+  clock_t start = clock();
+  long i, r;
+
+  for (r=0; r<NROUNDS; r++) {
+    if (array_sw) {
+      for (i=0; i<NOPS; i++)
+	ring_queue_enqueue(theRingQueue, (void *)i);
+      while (!ring_queue_empty(theRingQueue))
+	ring_queue_dequeue(theRingQueue);
+    }
+    else {
+      for (i=0; i<NOPS; i++)
+	queue_enqueue(theQueue, (void *)i);
+      while (!queue_empty(theQueue))
+	queue_dequeue(theQueue);
+    }
+  }
+
+  queue_free(theQueue);
+  ring_queue_free(theRingQueue);
+  return (double)NOPS * NROUNDS * CLOCKS_PER_SEC / (clock() - start + 1);
+}
+
+int
+main()
+{
+  fprintf(stdout, "stack       %.3g push+pop/s\n", StackThroughput(0));
+  fprintf(stdout, "array_stack %.3g push+pop/s\n", StackThroughput(1));
+  fprintf(stdout, "queue       %.3g enqueue+dequeue/s\n", QueueThroughput(0));
+  fprintf(stdout, "ring_queue  %.3g enqueue+dequeue/s\n", QueueThroughput(1));
+
+  return 0;
+}
@@ -48,6 +48,21 @@ main()
       return 1;
   }
   fprintf(stdout, "Synchronizability = %g\n", Synchronizability(net));
+  if (fabs(Synchronizability(net) -
+	   gsl_vector_get(spec, 10) / gsl_vector_get(spec, 2)) > EPS)
+    return 1;
+  gsl_vector_free(spec);
+
+  /* Sparse solver: bottom and top of the spectrum */
+  spec = LaplacianSpectrumLanczos(net, 4, 0);
+  for (i=0; i<4; i++)
+    if (fabs(gsl_vector_get(spec, i) - rightResult[i]) > EPS)
+      return 1;
+  gsl_vector_free(spec);
+  spec = LaplacianSpectrumLanczos(net, 3, 1);
+  for (i=0; i<3; i++)
+    if (fabs(gsl_vector_get(spec, i) - rightResult[8 + i]) > EPS)
+      return 1;
 
   /* Free memory */
   RemoveGraph(net);
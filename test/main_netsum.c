@@ -16,8 +16,9 @@ int main()
 {
   struct node_gra *net1=NULL, *net2=NULL, *netSum=NULL;
   FILE *inFile;
-  double C, L;
-  int wrong;
+  struct node_gra *p;
+  double C, L, Cav, *Cnode;
+  int wrong, wrongNode;
 
   /*
     ------------------------------------------------------------
@@ -45,6 +46,14 @@ int main()
   */
   C = ClusteringCoefficient(netSum);
   L = AverageInverseDistance(netSum);
+  Cnode = (double *)calloc(CountNodes(netSum), sizeof(double));
+  ClusteringCoefficients(netSum, NULL, &Cav, Cnode);
+  wrongNode = 0;
+  p = netSum;
+  while ((p = p->next) != NULL)
+    if (fabs(Cnode[p->num] - OneNodeClusteringCoefficient(p, netSum)) > EPS)
+      wrongNode = 1;
+  free(Cnode);
   RemoveGraph(net1);
   RemoveGraph(net2);
   RemoveGraph(netSum);
@@ -63,6 +72,13 @@ int main()
   else {
     fprintf(stderr, "L: %lf == 0.448485 \tOK!\n", L);
   }
+  if (fabs(Cav - C) > EPS || wrongNode) {
+    wrong = 1;
+    fprintf(stderr, "Single-pass clustering coefficients \tWRONG!\n");
+  }
+  else {
+    fprintf(stderr, "Single-pass clustering coefficients \tOK!\n");
+  }
   if (wrong == 0)
     return 0;
   else
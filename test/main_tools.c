@@ -17,6 +17,8 @@ int main()
   int result = 0;
   double *vec = allocate_d_vec(4);
   double m, s, mi, ma;
+  double **dmat;
+  int **imat, *row, i, j;
 
   vec[0] = 1.0;
   vec[1] = 1.0;
@@ -42,5 +44,44 @@ int main()
 
   free_d_vec(vec);
 
+  /* Gelman-Rubin R-hat of two chains (1, 2, 3) and (3, 4, 5):
+     W = 1, B = 6, so R = sqrt((2/3 W + B/3) / W) = sqrt(8/3) */
+  dmat = allocate_d_mat(2, 3);
+  for (j=0; j<3; j++) {
+    dmat[0][j] = 1.0 + j;
+    dmat[1][j] = 3.0 + j;
+  }
+  if (fabs(gelman_rubin(dmat, 2, 3) - sqrt(8.0 / 3.0)) > EPS)
+    result = 1;
+  if (gelman_rubin(dmat, 1, 3) != HUGE_VAL)
+    result = 1;
+  dmat[1][0] = 1.0;
+  dmat[1][1] = 2.0;
+  dmat[1][2] = 3.0;
+  if (fabs(gelman_rubin(dmat, 2, 3) - sqrt(2.0 / 3.0)) > EPS)
+    result = 1;
+  free_d_mat(dmat, 2);
+
+  /* Matrices: contiguous, aligned, zeroed (doubles), and freed
+     correctly even if rows are swapped */
+  dmat = allocate_d_mat(7, 13);
+  imat = allocate_i_mat(5, 3);
+  if ((unsigned long)dmat[0] % 64 != 0 || (unsigned long)imat[0] % 64 != 0)
+    result = 1;
+  for (i=0; i<7; i++)
+    for (j=0; j<13; j++)
+      if (dmat[i][j] != 0.0 || &dmat[i][j] != dmat[0] + i * 13 + j)
+	result = 1;
+  for (i=0; i<5; i++)
+    for (j=0; j<3; j++)
+      imat[i][j] = i * 3 + j;
+  row = imat[0];
+  imat[0] = imat[4];
+  imat[4] = row;
+  if (imat[0][2] != 14 || imat[4][0] != 0)
+    result = 1;
+  free_d_mat(dmat, 7);
+  free_i_mat(imat, 5);
+
   return result;
 }
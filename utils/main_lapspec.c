@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <gsl/gsl_math.h>
@@ -14,15 +15,27 @@ main(int argc, char **argv)
   FILE *infile=NULL;
   struct node_gra *net=NULL;
   gsl_vector *spec;
-  int i, nnod;
+  int i, nnod, k=0, largest=0, first=0;
   char *netF;
 
   /* Command line parameters */
-  if (argc < 2) {
-    printf("\nUse: lapspec net_file\n\n");
+  if (argc != 2 && argc != 4) {
+    printf("\nUse: lapspec net_file [bottom|top k]\n\n");
+    printf("Without k, the full spectrum is computed with a dense solver.\n");
+    printf("With bottom (top) k, only the k smallest (largest) eigenvalues\n");
+    printf("are computed with a sparse solver, suitable for large networks.\n\n");
     return -1;
   }
   netF = argv[1];
+  if (argc == 4) {
+    if (strcmp(argv[2], "top") == 0)
+      largest = 1;
+    else if (strcmp(argv[2], "bottom") != 0) {
+      printf("\nUse: lapspec net_file [bottom|top k]\n\n");
+      return -1;
+    }
+    k = atoi(argv[3]);
+  }
 
   /* Build the network */
   infile = fopen(netF, "r");
@@ -31,11 +44,21 @@ main(int argc, char **argv)
   nnod = CountNodes(net);
 
   /* Calculate the spectrum of the Laplacian */
-  spec = LaplacianSpectrum(net);
+  if (k > 0) {
+    if (k > nnod)
+      k = nnod;
+    spec = LaplacianSpectrumLanczos(net, k, largest);
+    if (largest)
+      first = nnod - k;
+  }
+  else {
+    spec = LaplacianSpectrum(net);
+    k = nnod;
+  }
 
-  /* Check results */
-  for (i=0; i<nnod; i++)
-    fprintf(stdout, "%d %lf\n", i+1, gsl_vector_get(spec, i));
+  /* Output the eigenvalues with their rank in the full spectrum */
+  for (i=0; i<k; i++)
+    fprintf(stdout, "%d %lf\n", first+i+1, gsl_vector_get(spec, i));
 
   /* Free memory */
   RemoveGraph(net);
@@ -1,18 +1,140 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <gsl/gsl_rng.h>
 
+#include "tools.h"
 #include "graph.h"
 #include "modules.h"
 
+#define USAGE "Usage:\n\
+  mutualinfo part_file1 part_file2\n\
+  mutualinfo -b part_file1 part_file2 ... part_fileM\n\
+\n\
+With -b, all the partitions are compared with each other and the\n\
+matrices of normalized mutual information and of fractions of\n\
+correctly classified nodes (row = reference partition) are printed,\n\
+followed by a summary of the consensus (medoid) partition.\n"
+
+/*
+  ---------------------------------------------------------------------
+  Compare M partitions with each other
+  ---------------------------------------------------------------------
+*/
+int
+BatchMutualInformation(int M, char **fnames)
+{
+  FILE **inF = NULL;
+  int **parts = NULL;
+  char **labels = NULL;
+  int nnod, m1, m2, medoid = 0, ngroup;
+  double **nmi = NULL, **cc = NULL;
+  double *mean = NULL, sum = 0.0, sum2 = 0.0, avg, std;
+
+  /*
+    ------------------------------------------------------------
+    Read the partitions into arrays
+    ------------------------------------------------------------
+  */
+  inF = (FILE **)calloc(M, sizeof(FILE *));
+  for (m1=0; m1<M; m1++) {
+    if ((inF[m1] = fopen(fnames[m1], "r")) == NULL) {
+      fprintf(stderr, "ERROR: Could not open %s\n", fnames[m1]);
+      return 1;
+    }
+  }
+  parts = FCreatePartitionArrays(inF, M, &nnod, &labels);
+  for (m1=0; m1<M; m1++)
+    fclose(inF[m1]);
+  free(inF);
+
+  /*
+    ------------------------------------------------------------
+    Compare all pairs
+    ------------------------------------------------------------
+  */
+  nmi = allocate_d_mat(M, M);
+  cc = allocate_d_mat(M, M);
+  PartitionSimilarityMatrices(parts, M, nnod, nmi, cc);
+
+  /*
+    ------------------------------------------------------------
+    Output
+    ------------------------------------------------------------
+  */
+  printf("# Normalized mutual information\n");
+  for (m1=0; m1<M; m1++) {
+    for (m2=0; m2<M; m2++)
+      printf("%s%f", (m2 > 0) ? " " : "", nmi[m1][m2]);
+    printf("\n");
+  }
+  printf("# Fraction of correctly classified nodes (row = reference)\n");
+  for (m1=0; m1<M; m1++) {
+    for (m2=0; m2<M; m2++)
+      printf("%s%f", (m2 > 0) ? " " : "", cc[m1][m2]);
+    printf("\n");
+  }
+
+  /* The medoid is the partition most similar, on average, to all
+     the others */
+  mean = allocate_d_vec(M);
+  for (m1=0; m1<M; m1++) {
+    mean[m1] = 0.0;
+    for (m2=0; m2<M; m2++) {
+      if (m2 != m1) {
+	mean[m1] += nmi[m1][m2];
+	if (m2 > m1) {
+	  sum += nmi[m1][m2];
+	  sum2 += nmi[m1][m2] * nmi[m1][m2];
+	}
+      }
+    }
+    if (M > 1)
+      mean[m1] /= (double)(M - 1);
+    if (mean[m1] > mean[medoid])
+      medoid = m1;
+  }
+  for (ngroup=0, m1=0; m1<nnod; m1++)
+    if (parts[medoid][m1] >= ngroup)
+      ngroup = parts[medoid][m1] + 1;
+
+  if (M > 1) {
+    avg = sum / ((double)M * (M - 1) / 2.0);
+    std = sqrt(fabs(sum2 / ((double)M * (M - 1) / 2.0) - avg * avg));
+    printf("# Mean NMI between partitions: %f +- %f (%d partitions, %d nodes)\n",
+	   avg, std, M, nnod);
+  }
+  printf("# Consensus (medoid) partition: %s (%d groups, mean NMI to the others %f)\n",
+	 fnames[medoid], ngroup, mean[medoid]);
+
+  /*
+    ------------------------------------------------------------
+    Free memory
+    ------------------------------------------------------------
+  */
+  free_d_vec(mean);
+  free_d_mat(nmi, M);
+  free_d_mat(cc, M);
+  FreePartitionArrays(parts, M, labels, nnod);
+
+  return 0;
+}
+
 int main(int argc,char* argv[])
 {
   FILE *inf = NULL;
   struct group *part1 = NULL;
   struct group *part2 = NULL;
 
+  if (argc > 2 && strcmp(argv[1], "-b") == 0)
+    return BatchMutualInformation(argc - 2, &argv[2]);
+  if (argc != 3) {
+    fprintf(stderr, USAGE);
+    return 1;
+  }
+
   /*
     ------------------------------------------------------------
     Build the network and the partition
@@ -35,7 +157,7 @@ int main(int argc,char* argv[])
   */
 
   printf("MI = %f\n", MutualInformation(part1, part2, 1));
-      
+
   /*
     ------------------------------------------------------------
     Free memory
@@ -0,0 +1,76 @@
+/*
+  main_netgen.c
+  $LastChangedDate$
+  $Revision$
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gsl/gsl_rng.h>
+
+#include "tools.h"
+#include "graph.h"
+#include "models.h"
+
+#define USAGE "\nUse: netgen er S p seed\n\
+     netgen pa S m seed\n\
+     netgen gn ngroup gsize kin kout seed\n\n\
+Generate an Erdos-Renyi (er), preferential attachment (pa) or\n\
+Girvan-Newman (gn) random network and write its links, one per line,\n\
+to the standard output. Time and memory are linear in the number of\n\
+nodes and links, so large sparse networks can be generated.\n\n"
+
+int
+main(int argc, char **argv)
+{
+  gsl_rng *rand_gen;
+  int *ori, *des, nlink;
+  int seed;
+
+  /*
+    ---------------------------------------------------------------------------
+    Command line parameters and network generation
+    ---------------------------------------------------------------------------
+  */
+  if (argc < 2) {
+    printf(USAGE);
+    return -1;
+  }
+  rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
+
+  if (strcmp(argv[1], "er") == 0 && argc == 5) {
+    seed = atoi(argv[4]);
+    gsl_rng_set(rand_gen, seed);
+    nlink = ERLinks(atoi(argv[2]), atof(argv[3]), rand_gen, &ori, &des);
+  }
+  else if (strcmp(argv[1], "pa") == 0 && argc == 5) {
+    seed = atoi(argv[4]);
+    gsl_rng_set(rand_gen, seed);
+    nlink = PALinks(atoi(argv[2]), atoi(argv[3]), rand_gen, &ori, &des);
+  }
+  else if (strcmp(argv[1], "gn") == 0 && argc == 7) {
+    seed = atoi(argv[6]);
+    gsl_rng_set(rand_gen, seed);
+    nlink = GirvanNewmanLinks(atoi(argv[2]), atoi(argv[3]),
+			      atof(argv[4]), atof(argv[5]),
+			      rand_gen, &ori, &des);
+  }
+  else {
+    printf(USAGE);
+    gsl_rng_free(rand_gen);
+    return -1;
+  }
+
+  /*
+    ---------------------------------------------------------------------------
+    Output results and finish
+    ---------------------------------------------------------------------------
+  */
+  FPrintLinks(stdout, nlink, ori, des);
+  free_i_vec(ori);
+  free_i_vec(des);
+  gsl_rng_free(rand_gen);
+  return 0;
+}
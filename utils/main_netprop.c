@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+#include <gsl/gsl_rng.h>
 
 /* #include "prng.h" */
 #include "tools.h"
@@ -9,23 +12,71 @@
 /* #include "missing.h" */
 #include "matrix.h"
 
+#define USAGE "Usage:\n\
+\tnetprop [-k NSRC | -e EPS] [-d DELTA] [-a LOG2M] [-s SEED] net_file\n\
+\tnetprop -h\n"
+
+#define ARGUMENTS "Arguments:\n\
+\t -k NSRC: Approximate betweenness from NSRC sampled sources (default: exact),\n\
+\t -e EPS: Approximate betweenness, sampling sources until all normalized\n\
+\t         betweennesses are within EPS (default: exact),\n\
+\t -d DELTA: Confidence intervals hold with probability 1-DELTA (default 0.05),\n\
+\t -a LOG2M: Approximate distances with HyperANF, using 2^LOG2M registers\n\
+\t           per node (4 to 16; memory 2^(LOG2M+1) bytes per node, relative\n\
+\t           error about 1.04/2^(LOG2M/2)) (default: exact),\n\
+\t -s SEED: Random number generator seed (positive integer, default 1111),\n\
+\t -h : Display this message.\n"
+
 int
 main(int argc, char **argv)
 {
   char *netF;
   FILE *infile=NULL;
   struct node_gra *net=NULL;
-  struct node_gra *components[1000];
+  int *comp, *compSize;
   int i,ncomponents,sizeGC=0,sizeothers=0;
+  gsl_rng *rand_gen;
+  unsigned int seed = 1111;
+  int nsources = 0, sampled = 0;
+  int log2m = 0;
+  double apl, invDist, effDiam;
+  double eps = 0.0, delta = 0.05;
+  int c;
 /*   struct prng *rand_gen; */
 /*   int seed; */
 
   /* Command line parameters */
-  if (argc < 2) {
+  while ((c = getopt(argc, argv, "hk:e:d:a:s:")) != -1)
+    switch (c) {
+    case 'h':
+      printf(USAGE ARGUMENTS);
+      return -1;
+    case 'k':
+      nsources = atoi(optarg);
+      sampled = 1;
+      break;
+    case 'e':
+      eps = atof(optarg);
+      sampled = 1;
+      break;
+    case 'd':
+      delta = atof(optarg);
+      break;
+    case 'a':
+      log2m = atoi(optarg);
+      break;
+    case 's':
+      seed = atoi(optarg);
+      break;
+    default:
+      printf(USAGE);
+      return -1;
+    }
+  if (optind >= argc) {
     printf("\nUse: netprop net_file\n\n");
     return -1;
   }
-  netF = argv[1];
+  netF = argv[optind];
 /*   seed = atoi(argv[2]); */
 /*   rand_gen = prng_new("mt19937(1111)"); */
 /*   prng_seed(rand_gen, seed); */
@@ -39,12 +90,15 @@ main(int argc, char **argv)
     Calculate and print a variety of network properties
   */
   /* Calculate the size of the giant component and the number of components */
-  ncomponents = GetAllConnectedSets(net,components);
+  comp = allocate_i_vec(CountNodes(net));
+  ncomponents = StronglyConnectedComponents(net, comp, &compSize);
   for(i=0;i<ncomponents;i++)
   {
-    if (CountNodes(components[i])>sizeGC) sizeGC = CountNodes(components[i]);
-    sizeothers += CountNodes(components[i]);
+    if (compSize[i]>sizeGC) sizeGC = compSize[i];
+    sizeothers += compSize[i];
   }
+  free_i_vec(comp);
+  free_i_vec(compSize);
 
   printf("Num_components %d\n", ncomponents);
   printf("Size_GC %d\n", sizeGC);
@@ -57,17 +111,38 @@ main(int argc, char **argv)
   printf("Av_degree %g\n", AverageDegree(net, 1));
 
   /* Distance, clustering... */
-  printf("Inverse_path_length %lf\n", AverageInverseDistance(net));
+  if (log2m > 0) {
+    if (ApproxDistanceStatistics(net, log2m, seed,
+				 &apl, &invDist, &effDiam) != 0)
+      return -1;
+    printf("Inverse_path_length %lf\n", invDist);
+    printf("Path_length %lf\n", apl);
+    printf("Effective_diameter %lf\n", effDiam);
+  }
+  else
+    printf("Inverse_path_length %lf\n", AverageInverseDistance(net));
   printf("Clustering %lf\n", ClusteringCoefficient(net));
   printf("Assortativity %lf\n", Assortativity(net));
 
   /* Betweenness */
-  double betMean, betStddev, betMin, betMax;
-  NodeBetweennessStatistics(net, &betMean, &betStddev, &betMin, &betMax);
+  double betMean, betStddev, betMin, betMax, betCI;
+  if (sampled) {
+    rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
+    gsl_rng_set(rand_gen, seed);
+    printf("Betweenness_sources %d\n",
+	   NodeBetweennessStatisticsSampled(net, nsources, eps, delta, rand_gen,
+					    &betMean, &betStddev,
+					    &betMin, &betMax, &betCI));
+    gsl_rng_free(rand_gen);
+  }
+  else
+    NodeBetweennessStatistics(net, &betMean, &betStddev, &betMin, &betMax);
   printf("Betweenness_mean %lf\n", betMean);
   printf("Betweenness_std %lf\n", betStddev);
   printf("Betweenness_min %lf\n", betMin);
   printf("Betweenness_max %lf\n", betMax);
+  if (sampled)
+    printf("Betweenness_ci %lf\n", betCI);
 
   /* Synchronizability */
   printf("Synchronizability %lf\n", Synchronizability(net));
@@ -20,18 +20,24 @@ main(int argc, char **argv)
   gsl_rng *rand_gen;
   struct node_gra *net=NULL;
   int seed;
+  int nrep = 0;
+  char *fnameFmt = "random_%04d.dat";
 
   /*
     ---------------------------------------------------------------------------
     Command line parameters
     ---------------------------------------------------------------------------
   */
-  if (argc < 2) {
-    printf("\nUse: netrandomize.out net_file seed\n\n");
+  if (argc < 3) {
+    printf("\nUse: netrandomize.out net_file seed [nrep [fname_format]]\n\n");
     return -1;
   }
   netF = argv[1];
   seed = atoi(argv[2]);
+  if (argc > 3)
+    nrep = atoi(argv[3]);
+  if (argc > 4)
+    fnameFmt = argv[4];
   rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
   gsl_rng_set(rand_gen, seed);
 
@@ -49,6 +55,13 @@ main(int argc, char **argv)
     Randomize the network
     ---------------------------------------------------------------------------
   */
+  if (nrep > 0) {
+    /* nrep replicas, written to files in parallel */
+    RandomizeSymmetricReplicas(net, nrep, 100, seed, fnameFmt, NULL, NULL);
+    RemoveGraph(net);
+    gsl_rng_free(rand_gen);
+    return 0;
+  }
   net = RandomizeSymmetricNetwork(net, 100, rand_gen);
 
   /*
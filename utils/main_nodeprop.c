@@ -7,9 +7,25 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <gsl/gsl_rng.h>
+
+#include "tools.h"
 #include "graph.h"
 
+#define USAGE "Usage:\n\
+\tnodeprop [-k NSRC | -e EPS] [-d DELTA] [-s SEED] net_file\n\
+\tnodeprop -h\n"
+
+#define ARGUMENTS "Arguments:\n\
+\t -k NSRC: Approximate betweenness from NSRC sampled sources (default: exact),\n\
+\t -e EPS: Approximate betweenness, sampling sources until all normalized\n\
+\t         betweennesses are within EPS (default: exact),\n\
+\t -d DELTA: Confidence intervals hold with probability 1-DELTA (default 0.05),\n\
+\t -s SEED: Random number generator seed (positive integer, default 1111),\n\
+\t -h : Display this message.\n"
+
 int
 main(int argc, char **argv)
 {
@@ -17,17 +33,46 @@ main(int argc, char **argv)
   FILE *infile=NULL;
   struct node_gra *net=NULL;
   struct node_gra *p=NULL;
+  gsl_rng *rand_gen;
+  unsigned int seed = 1111;
+  int nsources = 0, sampled = 0, nused;
+  double eps = 0.0, delta = 0.05;
+  double *ci = NULL;
+  int c;
 
   /*
     ---------------------------------------------------------------------------
     Command line parameters
     ---------------------------------------------------------------------------
   */
-  if (argc < 2) {
-    printf("\nUse: betweenness.out net_file\n\n");
+  while ((c = getopt(argc, argv, "hk:e:d:s:")) != -1)
+    switch (c) {
+    case 'h':
+      printf(USAGE ARGUMENTS);
+      return -1;
+    case 'k':
+      nsources = atoi(optarg);
+      sampled = 1;
+      break;
+    case 'e':
+      eps = atof(optarg);
+      sampled = 1;
+      break;
+    case 'd':
+      delta = atof(optarg);
+      break;
+    case 's':
+      seed = atoi(optarg);
+      break;
+    default:
+      printf(USAGE);
+      return -1;
+    }
+  if (optind >= argc) {
+    printf(USAGE ARGUMENTS);
     return -1;
   }
-  netF = argv[1];
+  netF = argv[optind];
 
   /*
     ---------------------------------------------------------------------------
@@ -43,7 +88,19 @@ main(int argc, char **argv)
     Calculate betweenness
     ---------------------------------------------------------------------------
   */
-  CalculateNodeBetweenness(net);
+  if (sampled) {
+    rand_gen = gsl_rng_alloc(gsl_rng_mt19937);
+    gsl_rng_set(rand_gen, seed);
+    ci = allocate_d_vec(CountNodes(net));
+    nused = CalculateNodeBetweennessSampled(net, nsources, eps, delta,
+					    rand_gen, ci);
+    printf("# Sampled betweenness: %d of %d sources, %g%% confidence\n",
+	   nused, CountNodes(net), 100. * (1. - delta));
+    gsl_rng_free(rand_gen);
+  }
+  else {
+    CalculateNodeBetweenness(net);
+  }
 
   /*
     ---------------------------------------------------------------------------
@@ -51,8 +108,14 @@ main(int argc, char **argv)
     ---------------------------------------------------------------------------
   */
   p = net;
-  while ((p = p->next) != NULL)
-    printf("%s %d %g\n", p->label, NodeDegree(p), p->dvar1);
+  while ((p = p->next) != NULL) {
+    if (sampled)
+      printf("%s %d %g %g\n", p->label, NodeDegree(p), p->dvar1, ci[p->num]);
+    else
+      printf("%s %d %g\n", p->label, NodeDegree(p), p->dvar1);
+  }
+  if (ci != NULL)
+    free_d_vec(ci);
   RemoveGraph(net);
   return 0;
 }